@@ -41,6 +41,11 @@ namespace dragonRfl
          */
         void spawnHumanControlForPlayer(od::Server &localServer, odNet::ClientId client);
 
+        /**
+         * @brief Despawns the controller of the given client, if it has one. Call this before removing the client.
+         */
+        void despawnHumanControlForPlayer(od::Server &localServer, odNet::ClientId client);
+
         virtual const char *getName() const override;
         virtual void onLoaded() override;
         virtual void onGameStartup(od::Server &localServer, od::Client &localClient, bool loadIntroLevel) override;
@@ -14,7 +14,7 @@
 #include <odCore/rfl/DummyClass.h>
 
 #include <odCore/physics/Handles.h>
-#include <odCore/physics/PhysicsSystem.h>
+#include <odCore/physics/TriggerManager.h>
 
 namespace dragonRfl
 {
@@ -79,7 +79,7 @@ namespace dragonRfl
     };
 
 
-    class Detector_Sv final : public odRfl::ServerClass, public odRfl::SpawnableClass, public odRfl::ClassImpl<Detector_Sv>
+    class Detector_Sv final : public odRfl::ServerClass, public odRfl::SpawnableClass, public odRfl::ClassImpl<Detector_Sv>, public odPhysics::TriggerCallback
     {
     public:
 
@@ -89,15 +89,19 @@ namespace dragonRfl
 
         virtual void onLoaded() override;
         virtual void onSpawned() override;
-        virtual void onUpdate(float relTime) override;
+        virtual void onDespawned() override;
+
+        virtual void onActivatorEntered(od::LevelObjectId activatorId) override;
+        virtual void onActivatorLeft(od::LevelObjectId activatorId) override;
 
 
     private:
 
+        void _updatePlayerIsIn();
+
         DetectorFields mFields;
 
         std::shared_ptr<odPhysics::ObjectHandle> mPhysicsHandle;
-        odPhysics::ContactTestResultVector mResultCache;
         bool mPlayerWasIn;
     };
 
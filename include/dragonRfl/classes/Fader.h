@@ -32,7 +32,7 @@ namespace dragonRfl
     struct FaderStates final : public odState::StateBundle<FaderStates>
     {
         OD_BEGIN_STATE_LIST()
-            OD_STATE(fade, odState::StateFlags::LERPED)
+            OD_STATE(fade, odState::StateFlags::LERPED | odState::StateFlags::UNIT_INTERVAL)
         OD_END_STATE_LIST()
 
         odState::State<float> fade;
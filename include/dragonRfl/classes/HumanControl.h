@@ -40,8 +40,11 @@ namespace dragonRfl
 
         virtual void onLoaded() override;
 		virtual void onSpawned() override;
+		virtual void onDespawned() override;
 		virtual void onUpdate(float relTime) override;
 
+        inline odNet::ClientId getClientId() const { return mClientId; }
+
 
 	 private:
 
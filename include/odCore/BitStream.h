@@ -0,0 +1,97 @@
+
+#ifndef INCLUDE_ODCORE_BITSTREAM_H_
+#define INCLUDE_ODCORE_BITSTREAM_H_
+
+#include <vector>
+
+#include <odCore/CTypes.h>
+
+namespace od
+{
+
+    /**
+     * @brief Appends values of arbitrary bit width to a byte vector.
+     *
+     * Bits are packed LSB-first. Bits that don't fill up a whole byte yet are held back until flush() is
+     * called, so don't forget to flush before using the buffer.
+     */
+    class BitWriter
+    {
+    public:
+
+        explicit BitWriter(std::vector<char> &buffer);
+        BitWriter(const BitWriter &bw) = delete;
+        ~BitWriter();
+
+        /**
+         * @brief Writes the lowest \p bits bits of \p value. \p bits must not exceed 32.
+         */
+        void write(uint32_t value, size_t bits);
+
+        inline void writeBool(bool b) { write(b ? 1 : 0, 1); }
+
+        /**
+         * @brief Writes the raw bit pattern of \p f, so it is transferred without loss.
+         */
+        void writeFloat(float f);
+
+        /**
+         * @brief Pads the pending bits with zeros to a full byte and appends them to the buffer.
+         */
+        void flush();
+
+        inline size_t getBitCount() const { return mBitCount; }
+
+
+    private:
+
+        std::vector<char> &mBuffer;
+        uint64_t mPendingBits;
+        size_t mPendingBitCount;
+        size_t mBitCount;
+
+    };
+
+
+    /**
+     * @brief Reads values written by a BitWriter from a contiguous memory block.
+     *
+     * Bit streams usually come from the network, so reading past the end of the block does not panic. Instead, the
+     * reader is marked as failed and all reads from then on return zero. Check hasFailed() after reading everything.
+     */
+    class BitReader
+    {
+    public:
+
+        BitReader(const char *data, size_t size);
+
+        /**
+         * @brief Reads a value of \p bits bits. \p bits must not exceed 32.
+         */
+        uint32_t read(size_t bits);
+
+        inline bool readBool() { return read(1) != 0; }
+
+        float readFloat();
+
+        inline size_t getRemainingBitCount() const { return (mEnd - mPos)*8 + mPendingBitCount; }
+
+        /**
+         * @brief Returns true if any read so far went past the end of the block.
+         */
+        inline bool hasFailed() const { return mFailed; }
+
+
+    private:
+
+        const uint8_t *mPos;
+        const uint8_t *mEnd;
+        uint64_t mPendingBits;
+        size_t mPendingBitCount;
+        bool mFailed;
+
+    };
+
+}
+
+#endif
@@ -75,6 +75,13 @@ namespace od
         inline const od::FilePath &getEngineRootDir() const { return mEngineRoot; }
         inline void setIsDone(bool b) { mIsDone.store(b, std::memory_order_relaxed); }
 
+        /**
+         * @brief Sets how many seconds past the latest snapshot object states may be extrapolated when snapshots are late.
+         *
+         * Takes effect with the next level load. 0 disables extrapolation.
+         */
+        inline void setMaxExtrapolationTime(double t) { mMaxExtrapolationTime = t; }
+
         inline odDb::DbManager &getDbManager() { return mDbManager; }
         inline odRfl::RflManager &getRflManager() { return mRflManager; }
         inline odPhysics::PhysicsSystem &getPhysicsSystem() { return *mPhysicsSystem; }
@@ -122,6 +129,8 @@ namespace od
 
         std::atomic_bool mIsDone;
 
+        double mMaxExtrapolationTime;
+
         std::unique_ptr<Level> mLevel;
 
         std::shared_ptr<odNet::QueuedDownlinkConnector> mDownlinkConnector; // created by us
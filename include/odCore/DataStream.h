@@ -8,8 +8,11 @@
 #ifndef INCLUDE_DATASTREAM_H_
 #define INCLUDE_DATASTREAM_H_
 
+#include <array>
 #include <istream>
 #include <vector>
+#include <cstring>
+#include <type_traits>
 
 #include <odCore/CTypes.h>
 #include <odCore/Logger.h>
@@ -18,7 +21,13 @@ namespace od
 {
 
     /**
-     * @brief Lightweight wrapper for a std::stream for reading binary data.
+     * @brief Lightweight wrapper for a std::stream or a contiguous memory block for reading binary data.
+     *
+     * A reader constructed over a memory block never touches the std::istream machinery. Primitives are loaded
+     * inline by operator>> with a single bounds check, and blocks are plain bounds-checked memcpys, which makes
+     * this the preferred way of reading data that is already in memory.
+     * Note that copies of a stream-backed reader share the stream's position, while copies of a
+     * memory-backed reader each have their own position.
      */
 	class DataReader
 	{
@@ -47,16 +56,33 @@ namespace od
 
 	    DataReader();
 		DataReader(std::istream &stream);
+		DataReader(const char *data, size_t size);
 		DataReader(const DataReader &dr);
 
 		DataReader &operator=(const DataReader &dr);
 
-		inline void setStream(std::istream &stream) { mStream = &stream; }
+		inline bool isMemoryBacked() const { return mBufferBegin != nullptr; }
+
+		void setStream(std::istream &stream);
+
+		/**
+		 * @brief Returns the underlying stream. Will panic for memory-backed readers.
+		 */
 		std::istream &getStream();
 
 		template <typename T>
 		DataReader &operator>>(T &s)
         {
+            // primitives are read inline from memory blocks. everything else, and every read near EOF, goes through readTyped
+            if constexpr(std::is_arithmetic<T>::value && !std::is_same<T, bool>::value)
+            {
+                if(static_cast<size_t>(mBufferEnd - mBufferPos) >= sizeof(T))
+                {
+                    _loadLittleEndian(s);
+                    return *this;
+                }
+            }
+
             readTyped(s);
             return *this;
         }
@@ -91,6 +117,52 @@ namespace od
 
 		void read(char *data, size_t size);
 
+		/**
+		 * @brief Reads \p count little-endian values of arithmetic type T into \p dest.
+		 *
+		 * This performs a single bulk read instead of one read per element, so it should be
+		 * preferred over looping with operator>> when decoding large arrays of primitives.
+		 */
+		template <typename T>
+		void readArray(T *dest, size_t count)
+		{
+		    static_assert(std::is_arithmetic<T>::value, "readArray only supports arithmetic types");
+
+		    this->read(reinterpret_cast<char*>(dest), count*sizeof(T));
+
+		    if(std::is_integral<T>::value && sizeof(T) > 1 && !_isHostLittleEndian())
+		    {
+		        for(size_t i = 0; i < count; ++i)
+		        {
+		            _swapBytes(dest[i]);
+		        }
+		    }
+		}
+
+		/**
+		 * @brief Returns a memory-backed reader over the next \p size bytes and advances this reader past them.
+		 *
+		 * Memory-backed readers return a view into their own block without copying anything. Stream-backed
+		 * readers fill \p storage with a single read. In that case, the returned reader is only valid as long
+		 * as \p storage is not modified.
+		 *
+		 * Use this to decode many small records from a stream without paying for the stream machinery on
+		 * every primitive.
+		 */
+		DataReader readBlock(size_t size, std::vector<char> &storage);
+
+		/**
+		 * @brief Returns a pointer to the next \p size bytes without advancing the reader.
+		 *
+		 * Only works for memory-backed readers. Panics if the reader is stream-backed or less than \p size bytes remain.
+		 */
+		const char *peekBuffer(size_t size);
+
+		/**
+		 * @brief Returns the number of bytes left in a memory-backed reader. Panics if the reader is stream-backed.
+		 */
+		size_t getRemainingSize() const;
+
 		void ignore(size_t n);
 		void seek(size_t offset);
 		size_t tell();
@@ -100,7 +172,57 @@ namespace od
 
         void _checkStream();
 
+        static inline bool _isHostLittleEndian()
+        {
+            const uint16_t probe = 1;
+            uint8_t firstByte;
+            std::memcpy(&firstByte, &probe, 1);
+            return firstByte == 1;
+        }
+
+        /**
+         * @brief Loads a value from the current position of the memory block and advances past it. Does no bounds checks.
+         */
+        template <typename T>
+        inline void _loadLittleEndian(T &v)
+        {
+            if constexpr(std::is_integral<T>::value)
+            {
+                // using bitshifts makes this endianess-independent
+                using UnsignedType = typename std::make_unsigned<T>::type;
+                const uint8_t *bytes = reinterpret_cast<const uint8_t*>(mBufferPos);
+                UnsignedType value = 0;
+                for(size_t i = 0; i < sizeof(T); ++i)
+                {
+                    value |= static_cast<UnsignedType>(bytes[i]) << (i*8);
+                }
+                v = static_cast<T>(value);
+
+            }else
+            {
+                // FIXME: host endianess dependent, just like the stream path
+                std::memcpy(&v, mBufferPos, sizeof(T));
+            }
+
+            mBufferPos += sizeof(T);
+        }
+
+        template <typename T>
+        static inline void _swapBytes(T &v)
+        {
+            char *bytes = reinterpret_cast<char*>(&v);
+            for(size_t i = 0; i < sizeof(T)/2; ++i)
+            {
+                std::swap(bytes[i], bytes[sizeof(T)-1-i]);
+            }
+        }
+
 		std::istream *mStream;
+
+		// only used by memory-backed readers
+		const char *mBufferBegin;
+		const char *mBufferPos;
+		const char *mBufferEnd;
 	};
 
 
@@ -132,6 +132,11 @@ namespace od
         void loadDefinition(DataReader &dr);
         void loadPolyData(DataReader &dr);
 
+        /**
+         * @brief Returns the number of bytes loadPolyData() will read. Only valid after the definition was loaded.
+         */
+        size_t getPolyDataSize() const;
+
         void spawn(odPhysics::PhysicsSystem &physicsSystem, odRender::Renderer *renderer);
         void despawn();
 
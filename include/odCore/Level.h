@@ -16,6 +16,7 @@
 #include <unordered_map>
 #include <glm/vec3.hpp>
 
+#include <odCore/BoundingBox.h>
 #include <odCore/IdTypes.h>
 #include <odCore/Engine.h>
 #include <odCore/FilePath.h>
@@ -31,6 +32,26 @@ namespace od
 {
     class LevelObject;
     class Layer;
+    class ThreadPool;
+    class LevelAssetManifest;
+
+    /**
+     * @brief Describes a generated level, for benchmarking and testing the engine without game data.
+     *
+     * The generated level is a square grid of floor layers with rolling terrain, each of which sees it's direct
+     * neighbours. Objects are scattered randomly across the terrain. They have no class, so it's up to the user to
+     * give them behaviour.
+     */
+    struct SyntheticLevelParameters
+    {
+        SyntheticLevelParameters();
+
+        uint32_t layerGridSize; ///< Number of layers along each axis
+        uint32_t layerSize; ///< Width and height of each layer, in cells
+        float terrainAmplitude; ///< Max. deviation of the terrain height, in length units
+        size_t objectCount;
+        uint32_t seed;
+    };
 
     class Level
     {
@@ -42,6 +63,7 @@ namespace od
         inline Engine &getEngine() { return mEngine; }
         inline odPhysics::PhysicsSystem &getPhysicsSystem() { return mPhysicsSystem; }
         inline float getVerticalExtent() const { return mVerticalExtent; } ///< @return The distance between the lowest and the highest point in terrain
+        inline const AxisAlignedBoundingBox &getBoundingBox() const { return mBoundingBox; } ///< @return A box containing all layers
         inline std::shared_ptr<odDb::DependencyTable> getDependencyTable() const { return mDependencyTable; }
 
         /**
@@ -51,6 +73,13 @@ namespace od
          */
         void loadLevel(const FilePath &levelPath, odDb::DbManager &dbManager);
 
+        /**
+         * @brief Generates a level instead of loading one from a file.
+         *
+         * Layers and objects are generated in the level file formats and go through the same parsers as loaded ones.
+         */
+        void loadSyntheticLevel(const SyntheticLevelParameters &params);
+
         void addToDestructionQueue(LevelObjectId objId);
 
         Layer *getLayerById(LayerId id);
@@ -115,9 +144,15 @@ namespace od
     private:
 
         void _loadNameAndDeps(SrscFile &file, odDb::DbManager &dbManager);
-        void _loadLayers(SrscFile &file);
+        void _loadLayers(SrscFile &file, ThreadPool &pool);
         void _loadLayerGroups(SrscFile &file);
-        void _loadObjects(SrscFile &file, odDb::DbManager &dbManage);
+        void _loadObjects(SrscFile &file, LevelAssetManifest &manifest);
+        void _calculateBounds();
+
+        /**
+         * @brief Identifies the parts of the level file an asset manifest depends on (dependencies and object records).
+         */
+        uint64_t _getContentStamp(SrscFile &file);
 
         Engine mEngine;
         odPhysics::PhysicsSystem &mPhysicsSystem;
@@ -132,12 +167,16 @@ namespace od
         std::vector<ObjectRecordData> mObjectRecords;
 
 		float mVerticalExtent;
+		AxisAlignedBoundingBox mBoundingBox;
 		Layer *mCurrentActivePvsLayer;
 
         std::unordered_set<LevelObjectId> mDestructionQueue;
 
         std::vector<std::unique_ptr<Layer>> mLayers;
         std::unordered_map<LevelObjectId, std::shared_ptr<LevelObject>> mLevelObjects;
+
+        // everything the level's objects reference, prefetched during loading. kept so spawning objects never has to wait for a load
+        std::vector<std::shared_ptr<odDb::Asset>> mPrefetchedAssets;
     };
 
 
@@ -0,0 +1,124 @@
+
+#ifndef INCLUDE_ODCORE_LEVELASSETMANIFEST_H_
+#define INCLUDE_ODCORE_LEVELASSETMANIFEST_H_
+
+#include <any>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <set>
+#include <tuple>
+#include <vector>
+
+#include <odCore/FilePath.h>
+#include <odCore/SrscFile.h>
+
+#include <odCore/rfl/FieldLoaderProbe.h>
+
+namespace odDb
+{
+    class Asset;
+    class Class;
+    class Database;
+    class DbManager;
+    class DependencyTable;
+}
+
+namespace od
+{
+    class ObjectRecordData;
+
+    /**
+     * @brief Deduplicated set of assets a level depends on, loaded in batches on the asset loader pool.
+     *
+     * The manifest is built by walking the class references of all object records, and then the models and
+     * field asset references of the loaded classes, as well as the field overrides of the objects. Classes
+     * referenced by fields are walked, too. Every asset is requested asynchronously as soon as it is discovered,
+     * so the whole dependency graph is loaded in a few parallel waves instead of piecemeal when objects spawn.
+     *
+     * A manifest can be written next to the level. Later loads read it before parsing any objects and request
+     * everything listed right away. Manifest files are only a hint: entries that don't resolve are skipped, and
+     * the walk still runs to pick up anything that's missing.
+     */
+    class LevelAssetManifest
+    {
+    public:
+
+        explicit LevelAssetManifest(odDb::DbManager &dbManager);
+        LevelAssetManifest(const LevelAssetManifest &m) = delete;
+
+        inline size_t getRequestCount() const { return mRequests.size(); }
+        inline size_t getWalkedCount() const { return mWalkedKeys.size(); }
+
+        /**
+         * @brief Reads a manifest file and requests all assets listed in it.
+         *
+         * @param contentStamp  Identifies the level contents the manifest was built for. Files with another stamp are ignored.
+         * @return true if a matching manifest file was read.
+         */
+        bool readFromFile(const FilePath &path, uint64_t contentStamp);
+
+        /**
+         * @brief Writes all assets found by walkObjects() to a manifest file. Failures are logged and otherwise ignored.
+         */
+        void writeToFile(const FilePath &path, uint64_t contentStamp);
+
+        /**
+         * @brief Returns true if walkObjects() found a different set of assets than listed in the manifest file read before.
+         */
+        bool differsFromFile() const;
+
+        /**
+         * @brief Requests everything the given object records depend on.
+         *
+         * Blocks until all referenced classes are loaded (they have to be inspected to find their dependencies),
+         * but not for any other assets.
+         */
+        void walkObjects(std::vector<ObjectRecordData> &records, odDb::DependencyTable &levelDependencies);
+
+        /**
+         * @brief Waits for all requested assets and returns the ones that were loaded successfully.
+         */
+        std::vector<std::shared_ptr<odDb::Asset>> waitForAll();
+
+
+    private:
+
+        typedef std::tuple<const odDb::Database*, RecordType, RecordId> Key;
+
+        struct Request
+        {
+            std::shared_ptr<odDb::Database> database;
+            std::any future; // a std::shared_future<std::shared_ptr<T>> for the requested asset type
+            std::function<std::shared_ptr<odDb::Asset>()> get;
+        };
+
+        template <typename T>
+        std::shared_future<std::shared_ptr<T>> _request(const std::shared_ptr<odDb::Database> &db, RecordId id, bool walked);
+
+        template <typename T>
+        std::shared_future<std::shared_ptr<T>> _requestRef(odDb::DependencyTable &deps, const odDb::AssetRef &ref);
+
+        bool _requestByType(const std::shared_ptr<odDb::Database> &db, RecordType type, RecordId id);
+
+        void _walkClass(odDb::Class &dbClass);
+        void _walkFields(const odRfl::FieldLoaderProbe &fields, odDb::DependencyTable &deps);
+
+        odDb::DbManager &mDbManager;
+
+        std::map<Key, Request> mRequests;
+        std::set<Key> mWalkedKeys;
+        std::set<Key> mFileKeys;
+        bool mReadFromFile;
+
+        // state used during walkObjects()
+        std::set<const odDb::Class*> mWalkedClasses;
+        std::deque<std::shared_future<std::shared_ptr<odDb::Class>>> mClassQueue;
+        std::vector<odRfl::FieldLoaderProbe::AssetRefEntry> mRefBuffer;
+    };
+
+}
+
+#endif
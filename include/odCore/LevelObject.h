@@ -47,6 +47,8 @@ namespace odRender
 namespace odPhysics
 {
     class ObjectHandle;
+    struct RayQuery;
+    struct RayQueryResult;
 }
 
 namespace od
@@ -232,6 +234,16 @@ namespace od
 
         void updateAssociatedLayer(bool callChangedHook = true);
 
+        /**
+         * @brief Fills in the ray updateAssociatedLayer() casts, so callers updating many objects can test them as a batch.
+         */
+        void getAssociatedLayerRayQuery(odPhysics::RayQuery &query);
+
+        /**
+         * @brief Completes updateAssociatedLayer() with the result of the query from getAssociatedLayerRayQuery().
+         */
+        void updateAssociatedLayer(const odPhysics::RayQueryResult &result, bool callChangedHook = true);
+
         void setRflClassInstance(std::unique_ptr<odRfl::ClassBase> instance);
 
         void setupRenderingAndPhysics(ObjectRenderMode renderMode, ObjectPhysicsMode physicsMode);
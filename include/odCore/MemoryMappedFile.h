@@ -0,0 +1,62 @@
+
+#ifndef INCLUDE_ODCORE_MEMORYMAPPEDFILE_H_
+#define INCLUDE_ODCORE_MEMORYMAPPEDFILE_H_
+
+#include <memory>
+
+#include <odCore/CTypes.h>
+#include <odCore/FilePath.h>
+
+namespace od
+{
+
+    /**
+     * @brief Read-only mapping of a whole file into memory.
+     *
+     * The mapping is immutable for it's whole lifetime, so it is safe to read
+     * from it from any number of threads without synchronization.
+     */
+    class MemoryMappedFile
+    {
+    public:
+
+        /**
+         * @brief Maps the given file. Panics if the file can not be opened or mapped.
+         */
+        MemoryMappedFile(const FilePath &path);
+        MemoryMappedFile(const MemoryMappedFile &f) = delete;
+        ~MemoryMappedFile();
+
+        /**
+         * @brief Maps the given file. Returns nullptr if the file can not be opened or mapped.
+         *
+         * For files that may vanish at any time, like cache entries other processes may evict.
+         */
+        static std::unique_ptr<MemoryMappedFile> tryOpen(const FilePath &path);
+
+        inline const char *getData() const { return mData; }
+        inline size_t getSize() const { return mSize; }
+
+
+    private:
+
+        MemoryMappedFile();
+
+        /**
+         * @brief Opens and maps the file. Returns nullptr on success, or a description of what failed.
+         */
+        const char *_map(const FilePath &path);
+
+        const char *mData;
+        size_t mSize;
+
+#if defined (__WIN32__)
+        void *mFileHandle;
+        void *mMappingHandle;
+#endif
+
+    };
+
+}
+
+#endif
@@ -28,7 +28,7 @@ namespace od
     {
 
         OD_BEGIN_STATE_LIST()
-            OD_STATE(position,   odState::StateFlags::LERPED)
+            OD_STATE(position,   odState::StateFlags::LERPED | odState::StateFlags::POSITION)
             OD_STATE(rotation,   odState::StateFlags::LERPED)
             OD_STATE(scale,      odState::StateFlags::LERPED)
             OD_STATE(visibility, 0)
@@ -10,11 +10,14 @@
 
 #include <memory>
 #include <atomic>
+#include <functional>
 #include <unordered_map>
 #include <mutex>
 #include <vector>
 
 #include <odCore/FilePath.h>
+#include <odCore/IdTypes.h>
+#include <odCore/ThreadPool.h>
 
 #include <odCore/net/IdTypes.h>
 #include <odCore/net/QueuedUplinkConnector.h>
@@ -34,6 +37,7 @@ namespace odRfl
 namespace odPhysics
 {
     class PhysicsSystem;
+    class TriggerManager;
 }
 
 namespace odInput
@@ -49,6 +53,7 @@ namespace odNet
 
 namespace odState
 {
+    class ClientInterest;
     class StateManager;
     class EventQueue;
 }
@@ -56,6 +61,7 @@ namespace odState
 namespace od
 {
     class Level;
+    struct SyntheticLevelParameters;
 
     class LagCompensationGuard
     {
@@ -83,6 +89,26 @@ namespace od
     {
     public:
 
+        /**
+         * @brief How long the phases of a server tick took, in milliseconds.
+         */
+        struct TickTimings
+        {
+            TickTimings();
+
+            double levelUpdate;
+            double physics;
+            double clients; ///< Processing received packets and input
+            double commit; ///< Committing states to the timeline and dispatching events
+            double send; ///< Encoding and sending snapshots and events
+            double total;
+        };
+
+        /**
+         * @brief Level path sent to clients when a synthetic level is loaded. Only synthetic clients can handle that.
+         */
+        static constexpr const char *SYNTHETIC_LEVEL_PATH = "<synthetic>";
+
         Server(odDb::DbManager &dbManager, odRfl::RflManager &rflManager);
         ~Server();
 
@@ -94,6 +120,7 @@ namespace od
         inline odDb::DbManager &getDbManager() { return mDbManager; }
         inline odRfl::RflManager &getRflManager() { return mRflManager; }
         inline odPhysics::PhysicsSystem &getPhysicsSystem() { return *mPhysicsSystem; }
+        inline odPhysics::TriggerManager &getTriggerManager() { return *mTriggerManager; }
         inline odState::StateManager &getStateManager() { return *mStateManager; }
         inline odState::EventQueue &getEventQueue() { return *mEventQueue; }
 
@@ -111,12 +138,22 @@ namespace od
         /**
          * @brief Assigns a downlink connector to a client.
          *
-         * The client must have already been added to the server via the addClient() method.
+         * The client must have already been added to the server via the addClient() method. If a level is loaded
+         * already, the client is told to load it, too.
          *
-         * This method is synchronized with the server main loop. It is okay to call it from a different thread.
+         * Unlike addClient(), this is not synchronized with the server main loop, as it may send to the client right
+         * away. Call it before the server starts running, or between ticks from the tick hook passed to run().
          */
         void setClientDownlinkConnector(odNet::ClientId id, std::shared_ptr<odNet::DownlinkConnector> connector);
 
+        /**
+         * @brief Removes a client that was added via addClient(). Does nothing if there is no such client.
+         *
+         * Anything in the level that still refers to the client must be gone before this is called. Like
+         * setClientDownlinkConnector(), this is not synchronized with the server main loop, so call it between ticks.
+         */
+        void removeClient(odNet::ClientId id);
+
         /**
          * TODO: this is a bit hackish. need this because objects need to send animation events somehow, and event dispatch only works one-way right now
          */
@@ -151,6 +188,24 @@ namespace od
          */
         odNet::DownlinkMessageDispatcher &getMessageDispatcherForClient(odNet::ClientId id);
 
+        /**
+         * @brief Sets the object the given client views the level from, usually it's player character.
+         *
+         * Snapshots sent to that client only contain objects that are relevant from that object's point of view.
+         * Clients without a viewpoint object receive every object. Requires a loaded level.
+         */
+        void setClientViewpointObject(odNet::ClientId id, od::LevelObjectId objectId);
+
+        /**
+         * @brief Sets how far from their viewpoint object clients receive updates on objects, in length units. Infinite by default.
+         */
+        void setClientRelevanceDistance(float distance);
+
+        /**
+         * @brief Limits how many objects are sent to each client per snapshot. 0 means unlimited (the default).
+         */
+        void setMaxObjectsPerSnapshot(size_t count);
+
         LagCompensationGuard compensateLag(odNet::ClientId id);
 
         float getEstimatedClientLag(odNet::ClientId id);
@@ -166,7 +221,31 @@ namespace od
 
         void loadLevel(const FilePath &path);
 
-        void run();
+        /**
+         * @brief Generates a level instead of loading one. Meant for benchmarks and tests, see SyntheticLevelParameters.
+         */
+        void loadSyntheticLevel(const SyntheticLevelParameters &params);
+
+        /**
+         * @brief Runs the server loop at a fixed tick rate until setIsDone(true) is called.
+         *
+         * @param tickHook  If given, called on the server thread before every tick. Use this for anything that has to
+         *                  happen between ticks, like hooking up clients that were accepted on another thread.
+         */
+        void run(const std::function<void()> &tickHook = nullptr);
+
+        /**
+         * @brief Advances the server by a single tick of the given length.
+         *
+         * run() calls this in a loop. Calling it directly allows driving the server without the wall clock.
+         * Requires a loaded level.
+         */
+        void step(double relTime);
+
+        /**
+         * @brief Returns how long the phases of the last tick took.
+         */
+        inline const TickTimings &getLastTickTimings() const { return mLastTickTimings; }
 
 
     private:
@@ -190,19 +269,28 @@ namespace od
             // for lag compensation:
             float viewInterpolationTime;
             float lastMeasuredRoundTripTime;
+
+            // decides what goes into this client's snapshots. only exists while a level is loaded
+            std::unique_ptr<odState::ClientInterest> interest;
         };
 
         ClientData &_getClientData(odNet::ClientId id);
+        void _createClientInterest(ClientData &client);
+        void _onLevelLoaded(const std::string &clientLevelPath);
+        void _sendLevelToClient(ClientData &client);
+        void _copyClientsToUpdateList();
 
         odDb::DbManager &mDbManager;
         odRfl::RflManager &mRflManager;
 
         std::unique_ptr<odPhysics::PhysicsSystem> mPhysicsSystem;
+        std::unique_ptr<odPhysics::TriggerManager> mTriggerManager; // level must be destroyed first, as despawning objects removes triggers
         std::unique_ptr<Level> mLevel;
         std::unique_ptr<odState::StateManager> mStateManager;
         std::unique_ptr<odState::EventQueue> mEventQueue;
 
         FilePath mEngineRoot;
+        std::string mClientLevelPath;
 
         std::atomic_bool mIsDone;
 
@@ -216,7 +304,15 @@ namespace od
         //  holding the mutex.
         std::vector<ClientData*> mTempClientUpdateList;
 
+        float mClientRelevanceDistance;
+        size_t mMaxObjectsPerSnapshot;
+
+        // delta-encodes snapshots against the different ticks clients acknowledged in parallel
+        ThreadPool mSnapshotEncoderPool;
+        std::vector<odState::TickNumber> mTempReferenceTicks;
+
         double mServerTime;
+        TickTimings mLastTickTimings;
 
     };
 
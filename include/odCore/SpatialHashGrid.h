@@ -0,0 +1,263 @@
+
+#ifndef INCLUDE_ODCORE_SPATIALHASHGRID_H_
+#define INCLUDE_ODCORE_SPATIALHASHGRID_H_
+
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+#include <odCore/BoundingBox.h>
+#include <odCore/Panic.h>
+
+namespace od
+{
+
+    /**
+     * @brief A uniform grid over the xz plane, hashed so only occupied cells take up memory.
+     *
+     * Items are entered with an AABB and stored in every cell that box touches. Moving an item within the
+     * same range of cells only updates it's box. Items covering more than MAX_CELLS_PER_ITEM cells are kept in
+     * a separate list that every query checks, so a few huge items don't flood the grid.
+     *
+     * Items are identified by value, so T should be cheap to hash and compare, like a pointer or an ID.
+     * Queries mark the items they visit to report each only once, so nothing about this is thread safe.
+     */
+    template <typename T>
+    class SpatialHashGrid
+    {
+    public:
+
+        static constexpr size_t MAX_CELLS_PER_ITEM = 64;
+
+        explicit SpatialHashGrid(float cellSize)
+        : mCellSize(cellSize)
+        , mQueryStamp(0)
+        {
+            if(!(cellSize > 0))
+            {
+                OD_PANIC() << "Cell size of spatial hash grid must be positive";
+            }
+        }
+
+        SpatialHashGrid(const SpatialHashGrid &grid) = delete;
+
+        inline float getCellSize() const { return mCellSize; }
+        inline size_t getItemCount() const { return mItems.size(); }
+
+        inline bool contains(const T &item) const { return mItems.find(item) != mItems.end(); }
+
+        /**
+         * @brief Adds item to the grid, or updates it's box if it already is in the grid.
+         */
+        void insert(const T &item, const AxisAlignedBoundingBox &box)
+        {
+            CellRange range = _getCellRange(box);
+
+            auto it = mItems.find(item);
+            if(it == mItems.end())
+            {
+                Entry &entry = mItems[item];
+                entry.item = item;
+                entry.box = box;
+                entry.range = range;
+                entry.queryStamp = mQueryStamp;
+                _link(entry);
+
+            }else
+            {
+                Entry &entry = it->second;
+                entry.box = box;
+                if(range != entry.range)
+                {
+                    _unlink(entry);
+                    entry.range = range;
+                    _link(entry);
+                }
+            }
+        }
+
+        void remove(const T &item)
+        {
+            auto it = mItems.find(item);
+            if(it == mItems.end())
+            {
+                return;
+            }
+
+            _unlink(it->second);
+            mItems.erase(it);
+        }
+
+        void clear()
+        {
+            mItems.clear();
+            mCells.clear();
+            mOversizedEntries.clear();
+        }
+
+        /**
+         * @brief Calls f(item, itemBox) once for every item whose box intersects box.
+         *
+         * f must not insert or remove items.
+         */
+        template <typename F>
+        void query(const AxisAlignedBoundingBox &box, const F &f)
+        {
+            uint64_t stamp = ++mQueryStamp;
+            auto visit = [stamp, &box, &f](Entry *entry)
+            {
+                if(entry->queryStamp != stamp)
+                {
+                    entry->queryStamp = stamp;
+                    if(entry->box.intersects(box))
+                    {
+                        f(entry->item, entry->box);
+                    }
+                }
+            };
+
+            for(auto entry : mOversizedEntries)
+            {
+                visit(entry);
+            }
+
+            CellRange range = _getCellRange(box);
+            if(range.getCellCount() <= mCells.size())
+            {
+                for(int32_t z = range.minZ; z <= range.maxZ; ++z)
+                {
+                    for(int32_t x = range.minX; x <= range.maxX; ++x)
+                    {
+                        auto cell = mCells.find(_getCellKey(x, z));
+                        if(cell != mCells.end())
+                        {
+                            for(auto entry : cell->second)
+                            {
+                                visit(entry);
+                            }
+                        }
+                    }
+                }
+
+            }else
+            {
+                // the box covers more cells than are occupied. cheaper to go through the occupied ones
+                for(auto &cell : mCells)
+                {
+                    int32_t x = static_cast<int32_t>(cell.first >> 32);
+                    int32_t z = static_cast<int32_t>(cell.first & 0xffffffff);
+                    if(range.contains(x, z))
+                    {
+                        for(auto entry : cell.second)
+                        {
+                            visit(entry);
+                        }
+                    }
+                }
+            }
+        }
+
+
+    private:
+
+        struct CellRange
+        {
+            int32_t minX;
+            int32_t minZ;
+            int32_t maxX;
+            int32_t maxZ;
+
+            inline size_t getCellCount() const { return static_cast<size_t>(maxX - minX + 1) * static_cast<size_t>(maxZ - minZ + 1); }
+            inline bool contains(int32_t x, int32_t z) const { return x >= minX && x <= maxX && z >= minZ && z <= maxZ; }
+            inline bool operator!=(const CellRange &r) const { return minX != r.minX || minZ != r.minZ || maxX != r.maxX || maxZ != r.maxZ; }
+        };
+
+        struct Entry
+        {
+            T item;
+            AxisAlignedBoundingBox box;
+            CellRange range;
+            uint64_t queryStamp;
+        };
+
+        static inline uint64_t _getCellKey(int32_t x, int32_t z)
+        {
+            return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(z);
+        }
+
+        CellRange _getCellRange(const AxisAlignedBoundingBox &box) const
+        {
+            CellRange range;
+            range.minX = static_cast<int32_t>(std::floor(box.min().x / mCellSize));
+            range.minZ = static_cast<int32_t>(std::floor(box.min().z / mCellSize));
+            range.maxX = static_cast<int32_t>(std::floor(box.max().x / mCellSize));
+            range.maxZ = static_cast<int32_t>(std::floor(box.max().z / mCellSize));
+            return range;
+        }
+
+        void _link(Entry &entry)
+        {
+            if(entry.range.getCellCount() > MAX_CELLS_PER_ITEM)
+            {
+                mOversizedEntries.push_back(&entry);
+                return;
+            }
+
+            for(int32_t z = entry.range.minZ; z <= entry.range.maxZ; ++z)
+            {
+                for(int32_t x = entry.range.minX; x <= entry.range.maxX; ++x)
+                {
+                    mCells[_getCellKey(x, z)].push_back(&entry);
+                }
+            }
+        }
+
+        void _unlink(Entry &entry)
+        {
+            if(entry.range.getCellCount() > MAX_CELLS_PER_ITEM)
+            {
+                _eraseEntry(mOversizedEntries, &entry);
+                return;
+            }
+
+            for(int32_t z = entry.range.minZ; z <= entry.range.maxZ; ++z)
+            {
+                for(int32_t x = entry.range.minX; x <= entry.range.maxX; ++x)
+                {
+                    auto cell = mCells.find(_getCellKey(x, z));
+                    if(cell != mCells.end())
+                    {
+                        _eraseEntry(cell->second, &entry);
+                        if(cell->second.empty())
+                        {
+                            mCells.erase(cell);
+                        }
+                    }
+                }
+            }
+        }
+
+        static void _eraseEntry(std::vector<Entry*> &entries, Entry *entry)
+        {
+            auto it = std::find(entries.begin(), entries.end(), entry);
+            if(it != entries.end())
+            {
+                *it = entries.back();
+                entries.pop_back();
+            }
+        }
+
+        float mCellSize;
+        uint64_t mQueryStamp;
+
+        std::unordered_map<T, Entry> mItems; // node based, so cells can point to entries
+        std::unordered_map<uint64_t, std::vector<Entry*>> mCells;
+        std::vector<Entry*> mOversizedEntries;
+
+    };
+
+}
+
+#endif
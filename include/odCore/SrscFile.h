@@ -12,6 +12,8 @@
 #include <vector>
 #include <fstream>
 #include <mutex>
+#include <memory>
+#include <unordered_map>
 
 #include <odCore/FilePath.h>
 #include <odCore/DataStream.h>
@@ -20,6 +22,8 @@
 namespace od
 {
 
+    class MemoryMappedFile;
+
     typedef uint16_t RecordId;
     typedef uint16_t RecordType;
 
@@ -35,6 +39,21 @@ namespace od
 	{
 	public:
 
+	    /**
+	     * @brief How record data is read from the file.
+	     *
+	     * In STREAM mode, all records are read through one shared std::ifstream. Only one cursor can be
+	     * active at a time, as it holds the file's lock for as long as it exists.
+	     *
+	     * In MEMORY_MAPPED mode, the whole file is mapped into memory and each cursor reads from it's own
+	     * slice of that mapping. No locking is involved, so any number of cursors can be active at once.
+	     */
+	    enum class AccessMode
+	    {
+	        STREAM,
+	        MEMORY_MAPPED
+	    };
+
 		struct DirEntry
 		{
 			uint16_t index;
@@ -51,11 +70,18 @@ namespace od
         {
         public:
 
-            RecordInputCursor(SrscFile &file, std::mutex &mutex, DirIterator &dirIt);
+            RecordInputCursor(SrscFile &file, DirIterator &dirIt);
             RecordInputCursor(RecordInputCursor &&c);
+            ~RecordInputCursor();
 
             inline const DirIterator &getDirIterator() { return mDirIterator; }
 
+            /**
+             * @brief Returns a reader for the record the cursor currently points to.
+             *
+             * For memory-mapped files, the reader is memory-backed and stays valid as long as the file is open.
+             * Otherwise, it is only valid as long as the cursor exists and is not used to access another record.
+             */
             DataReader getReader();
 
             bool isValid();
@@ -78,19 +104,37 @@ namespace od
             std::unique_lock<std::mutex> mLock;
         };
 
-		SrscFile(const FilePath &filePath);
+		SrscFile(const FilePath &filePath, AccessMode accessMode = AccessMode::STREAM);
 		~SrscFile();
 
 		inline const FilePath &getFilePath() const { return mFilePath; }
 		inline uint16_t getVersion() const { return mVersion; };
 		inline size_t getRecordCount() const { return mDirectory.size(); };
 		inline const std::vector<DirEntry> &getDirectory() const { return mDirectory; };
+		inline AccessMode getAccessMode() const { return mAccessMode; }
 
 		// low level access to directory. no locking
 		DirIterator getDirectoryBegin();
 		DirIterator getDirectoryEnd();
 		std::istream &getStreamForRecord(const DirIterator &dirIt);
 
+		/**
+		 * @brief Looks up the first directory entry of the given type and/or ID using the directory index.
+		 *
+		 * These are O(1) and return getDirectoryEnd() if no such record exists. No locking.
+		 */
+		DirIterator findFirstRecordOfType(RecordType type);
+		DirIterator findFirstRecordOfId(RecordId id);
+		DirIterator findFirstRecordOfTypeId(RecordType type, RecordId id);
+
+		/**
+		 * @brief Returns a pointer to the start of a record's data within the mapped file.
+		 *
+		 * Only available in MEMORY_MAPPED mode. Will panic in STREAM mode or if the record's data
+		 * range exceeds the file. No locking required.
+		 */
+		const char *getMappedRecordData(const DirIterator &dirIt);
+
 		// high level interface with proper locking
         RecordInputCursor getFirstRecordOfType(RecordType type);
         RecordInputCursor getFirstRecordOfId(RecordId id);
@@ -108,15 +152,29 @@ namespace od
 	protected:
 
 		void _readHeaderAndDirectory();
+		void _buildDirectoryIndex();
 		void _checkDirIterator(const DirIterator &it);
 
+		template <typename K>
+		DirIterator _lookupIndex(const std::unordered_map<K, size_t> &index, K key);
+
+		static inline uint32_t _typeIdKey(RecordType type, RecordId id) { return (static_cast<uint32_t>(type) << 16) | id; }
+
 		FilePath mFilePath;
+		AccessMode mAccessMode;
 		std::ifstream mInputStream;
+		std::unique_ptr<MemoryMappedFile> mMappedFile;
 
 		uint16_t mVersion;
 		uint32_t mDirectoryOffset;
 		std::vector<DirEntry> mDirectory;
 
+		// indices of the first directory entry with a given type, ID or type/ID pair.
+		//  the directory is never modified after loading, so these stay valid for the file's lifetime
+		std::unordered_map<RecordType, size_t> mFirstOfTypeIndex;
+		std::unordered_map<RecordId, size_t> mFirstOfIdIndex;
+		std::unordered_map<uint32_t, size_t> mFirstOfTypeIdIndex;
+
 		std::mutex mMutex;
 	};
 
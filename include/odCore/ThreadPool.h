@@ -0,0 +1,80 @@
+
+#ifndef INCLUDE_ODCORE_THREADPOOL_H_
+#define INCLUDE_ODCORE_THREADPOOL_H_
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <type_traits>
+
+namespace od
+{
+
+    /**
+     * @brief Fixed-size pool of worker threads processing a shared FIFO job queue.
+     *
+     * Jobs must not block waiting on other jobs of the same pool, as all workers
+     * might end up waiting on jobs that are still queued. Users that need to wait
+     * on queued work (like AssetFactory) should be able to steal it and run it
+     * on the waiting thread instead.
+     */
+    class ThreadPool
+    {
+    public:
+
+        /**
+         * @brief Returns the number of hardware threads, or 1 if that can't be determined.
+         */
+        static size_t getDefaultThreadCount();
+
+        /**
+         * @param threadCount  Number of workers to spawn. Must be at least 1.
+         * @param name         Name assigned to all workers. See ThreadUtils::setThreadName() for restrictions.
+         */
+        ThreadPool(size_t threadCount, const char *name);
+        ThreadPool(const ThreadPool &p) = delete;
+
+        /**
+         * @brief Processes all jobs left in the queue, then joins the workers.
+         */
+        ~ThreadPool();
+
+        inline size_t getThreadCount() const { return mWorkers.size(); }
+
+        void submit(std::function<void()> job);
+
+        /**
+         * @brief Submits a callable and returns a future for it's result.
+         */
+        template <typename F>
+        std::future<std::invoke_result_t<F>> async(F &&f)
+        {
+            // std::function requires copyable callables, so we can't move the packaged_task in there directly
+            auto task = std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(std::forward<F>(f));
+            auto future = task->get_future();
+            submit([task](){ (*task)(); });
+            return future;
+        }
+
+
+    private:
+
+        void _workerFunc();
+
+        std::vector<std::thread> mWorkers;
+
+        std::mutex mQueueMutex;
+        std::condition_variable mQueueCondition;
+        std::deque<std::function<void()>> mQueue;
+        bool mTerminate;
+
+    };
+
+}
+
+#endif
@@ -13,6 +13,8 @@
 #include <vector>
 #include <zlib.h> // has C-linkage built in
 
+#include <odCore/DataStream.h>
+
 namespace od
 {
 
@@ -27,9 +29,19 @@ namespace od
 
         inline std::streamoff getZlibDataStart() { return mZlibDataStart; };
         inline std::streamoff getZlibDataEnd() { return mZlibDataEnd; };
+        inline bool hasStreamEnded() const { return mStreamEnded; }
 
         void seekToEndOfZlib();
 
+        /**
+         * @brief Decompresses exactly \p size bytes directly into \p dest, bypassing the output buffer.
+         *
+         * Output that is still buffered from previous reads through the stream is consumed first. Panics if
+         * the zlib data ends before \p size bytes were produced. Use this for payloads of known size, so they
+         * don't have to be copied through the streambuf machinery.
+         */
+        void inflateInto(char *dest, size_t size);
+
         /**
          * Will restart the zstream so it can be used to read another compressed block without having to reload buffers etc.
          * Will do nothing if stream has not yet ended.
@@ -44,6 +56,11 @@ namespace od
 
     private:
 
+        /**
+         * @brief Inflates into the given memory until it is full or the zlib data ended. Returns the number of bytes produced.
+         */
+        size_t _inflate(Bytef *dest, size_t size);
+
         void _error(int zlibError);
 
 
@@ -74,7 +91,29 @@ namespace od
 
         inline std::streamoff getZlibDataStart() { return mBuffer->getZlibDataStart(); };
         inline std::streamoff getZlibDataEnd() { return mBuffer->getZlibDataEnd(); };
+        inline bool hasStreamEnded() const { return mBuffer->hasStreamEnded(); }
         inline void seekToEndOfZlib() { mBuffer->seekToEndOfZlib(); };
+        inline void inflateInto(char *dest, size_t size) { mBuffer->inflateInto(dest, size); }
+
+        /**
+         * @brief Decompresses a whole zlib block that is completely available in memory in a single call.
+         *
+         * This is the fastest path when the uncompressed size is known up front. If odCore was built with libdeflate,
+         * that is used instead of zlib. Output beyond \p destSize is dropped. Panics if the data decompresses to
+         * less than \p destSize bytes.
+         *
+         * @return The number of compressed bytes consumed. May be less than \p srcSize if the block is followed by other data.
+         */
+        static size_t inflateBuffer(const char *src, size_t srcSize, char *dest, size_t destSize);
+
+        /**
+         * @brief Decompresses a zlib block of known size starting at the reader's position directly into \p dest.
+         *
+         * Memory-backed readers are decoded using inflateBuffer(), stream-backed readers through a ZStream using
+         * inflateInto(). Either way, the reader is left right after the zlib data. \p compressedSize is only used as
+         * a hint, since stored sizes aren't always exact. Output beyond \p destSize is dropped, as with inflateBuffer().
+         */
+        static void inflateFromReader(DataReader &dr, size_t compressedSize, char *dest, size_t destSize);
 
     private:
 
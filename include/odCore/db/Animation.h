@@ -44,6 +44,7 @@ namespace odDb
 		inline float getMaxTime() const { return mMaxTime; } ///< As calculated from the keyframes
 
 		virtual void load(od::SrscFile::RecordInputCursor cursor) override;
+		virtual size_t getMemoryFootprint() const override;
 
 		std::pair<KfIterator, KfIterator> getKeyframesForNode(int32_t nodeId);
 
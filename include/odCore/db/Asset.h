@@ -43,9 +43,10 @@ namespace odDb
 		/**
 		 * Implemented by an asset to facilitate loading from a record.
 		 *
-		 * Until this returns, the asset container is locked and only accessible to this method
-		 * via the cursor provided. It is not possible to load an asset from the same container
-		 * until the file is unlocked again.
+		 * If the asset container is opened in STREAM mode, it is locked until this returns and only
+		 * accessible to this method via the cursor provided. It is not possible to load an asset from
+		 * the same container until the file is unlocked again. Memory mapped containers are never locked,
+		 * but relying on that would break assets loaded from stream-mode containers.
 		 *
 		 * If you need your asset to load another asset from the same container (like for texture animations),
 		 * store the IDs you want to load in this method and actually load them in the postLoad() method, which
@@ -60,6 +61,14 @@ namespace odDb
 		 */
 		virtual void postLoad();
 
+		/**
+		 * @brief Returns an estimate of the memory occupied by this asset in bytes. Used for budgeting the AssetRetentionCache.
+		 *
+		 * Assets should account for their large buffers (pixels, keyframes, samples etc.). The default
+		 * implementation returns the size of the base class.
+		 */
+		virtual size_t getMemoryFootprint() const;
+
 
 	private:
 
@@ -11,12 +11,19 @@
 #include <unordered_map>
 #include <memory>
 #include <vector>
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <type_traits>
 
 #include <odCore/FilePath.h>
 #include <odCore/SrscFile.h>
 #include <odCore/Logger.h>
+#include <odCore/ThreadPool.h>
 
 #include <odCore/db/Asset.h>
+#include <odCore/db/DecodedAssetCache.h>
+#include <odCore/db/AssetRetentionCache.h>
 
 namespace odDb
 {
@@ -35,37 +42,167 @@ namespace odDb
 	    typedef _AssetType AssetType;
 
 		AssetFactory(const AssetFactory &f) = delete;
-		virtual ~AssetFactory() = default;
+
+		virtual ~AssetFactory()
+		{
+		    waitForPendingLoads();
+		    _releaseRetainedAssets();
+		}
 
 		inline od::SrscFile &getSrscFile() { return mSrscFile; }
 
+		/**
+		 * @brief Returns the asset with the given ID, loading it on the calling thread if it is not cached.
+		 *
+		 * If the asset is already being loaded by another thread, this blocks until that load is done. If a
+		 * load was requested via getAssetAsync() but not picked up by a worker yet, the load is performed
+		 * on the calling thread instead. This means it is safe to call this from within loader jobs.
+		 */
 		std::shared_ptr<_AssetType> getAsset(od::RecordId assetId)
         {
-            // we access the cache using the []-operator, so we create an entry for the asset if if not existed yet.
-            //  since most of the time the assets we are looking for are either cached or can be loaded from the container,
-            //  doing it this way will save us one traversal of the map, as we don't have to use insert() to add a newly loaded
-            //  asset to the cache. for the rare case that we can not find an asset in the file, just erase the unnecessary entry.
-            std::weak_ptr<_AssetType> &asset = mAssetCache[assetId];
-            if(!asset.expired())
+            std::shared_ptr<PendingLoad> pending;
+            std::shared_ptr<_AssetType> cached;
+
+            {
+                std::lock_guard<std::mutex> lock(mCacheMutex);
+
+                cached = _getCachedAsset(assetId);
+                if(cached == nullptr)
+                {
+                    pending = _getOrCreatePendingLoad(assetId);
+                }
+            }
+
+            if(cached != nullptr)
             {
-                Logger::debug() << AssetTraits<_AssetType>::name() << " " << std::hex << assetId << std::dec << " found in cache";
-                return asset.lock();
+                _retain(cached);
+                return cached;
             }
 
-            // asset was not cached or got deleted. let implementation handle loading
-            Logger::debug() << AssetTraits<_AssetType>::name() << " " << std::hex << assetId << std::dec << " not found in cache. Loading from container " << mSrscFile.getFilePath().fileStr();
-            std::shared_ptr<_AssetType> loaded = this->loadAsset(assetId);
-            if(loaded == nullptr)
+            if(!pending->claimed.exchange(true))
             {
-                mAssetCache.erase(assetId);
+                _runLoad(assetId, *pending);
+            }
 
-                Logger::error() << AssetTraits<_AssetType>::name() << " " << std::hex << assetId << std::dec << " neither found in cache nor asset container " << mSrscFile.getFilePath().fileStr();
-                return nullptr;
+            return pending->future.get();
+        }
+
+        /**
+         * @brief Requests an asset to be loaded on the loader pool.
+         *
+         * Requests for assets that are already cached return a ready future. Requests for assets that are already
+         * being loaded share the future of that load, so every asset is only loaded once.
+         *
+         * If no loader pool was set or the asset container is not memory mapped (stream-mode containers
+         * can't be read concurrently), this will load the asset on the calling thread.
+         */
+        std::shared_future<std::shared_ptr<_AssetType>> getAssetAsync(od::RecordId assetId)
+        {
+            std::shared_ptr<PendingLoad> pending;
+            std::shared_ptr<_AssetType> cached;
+            bool isNewLoad = false;
+
+            {
+                std::lock_guard<std::mutex> lock(mCacheMutex);
+
+                cached = _getCachedAsset(assetId);
+                if(cached == nullptr)
+                {
+                    isNewLoad = (mPendingLoads.find(assetId) == mPendingLoads.end());
+                    pending = _getOrCreatePendingLoad(assetId);
+                }
+            }
+
+            if(cached != nullptr)
+            {
+                _retain(cached);
+
+                std::promise<std::shared_ptr<_AssetType>> ready;
+                ready.set_value(cached);
+                return ready.get_future().share();
+            }
+
+            if(!isNewLoad)
+            {
+                return pending->future;
+            }
+
+            bool canLoadConcurrently = (mLoaderPool != nullptr) && (mSrscFile.getAccessMode() == od::SrscFile::AccessMode::MEMORY_MAPPED);
+            if(canLoadConcurrently)
+            {
+                // the job only touches the factory if it wins the claim. see waitForPendingLoads() for why that matters
+                mLoaderPool->submit([this, pending, assetId]()
+                {
+                    if(!pending->claimed.exchange(true))
+                    {
+                        this->_runLoad(assetId, *pending);
+                    }
+                });
+
+            }else if(!pending->claimed.exchange(true))
+            {
+                _runLoad(assetId, *pending);
             }
 
-            asset = loaded; // this effectively inserts the asset into the cache
+            return pending->future;
+        }
+
+        /**
+         * @brief Sets the pool on which getAssetAsync() performs it's loads. Passing nullptr makes all loads synchronous.
+         *
+         * The pool must outlive this factory.
+         */
+        inline void setLoaderPool(od::ThreadPool *pool) { mLoaderPool = pool; }
+
+        /**
+         * @brief Sets the cache that is checked for decoded assets before decoding them from the container. May be nullptr.
+         *
+         * The cache must outlive this factory.
+         */
+        inline void setDecodedAssetCache(DecodedAssetCache *cache) { mDecodedAssetCache = cache; }
+
+        /**
+         * @brief Sets the cache that keeps recently used assets of this factory alive. May be nullptr.
+         *
+         * The cache must outlive this factory.
+         */
+        inline void setRetentionCache(AssetRetentionCache *cache) { mRetentionCache = cache; }
+
+        /**
+         * @brief Cancels all queued loads and blocks until all running loads are finished.
+         *
+         * Cancelled loads resolve to nullptr. This must be called before the factory is destroyed, since queued
+         * jobs refer to it. Once the derived factory is gone, running loads can't finish safely anymore, so
+         * owners should call this explicitly rather than relying on the base destructor.
+         */
+        void waitForPendingLoads()
+        {
+            std::vector<std::shared_ptr<PendingLoad>> pendingLoads;
 
-            return loaded;
+            {
+                std::lock_guard<std::mutex> lock(mCacheMutex);
+                pendingLoads.reserve(mPendingLoads.size());
+                for(auto &p : mPendingLoads)
+                {
+                    pendingLoads.push_back(p.second);
+                }
+            }
+
+            for(auto &pending : pendingLoads)
+            {
+                if(!pending->claimed.exchange(true))
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(mCacheMutex);
+                        mPendingLoads.erase(pending->assetId);
+                    }
+                    pending->promise.set_value(nullptr);
+
+                }else
+                {
+                    pending->future.wait();
+                }
+            }
         }
 
         /**
@@ -94,6 +231,9 @@ namespace odDb
 		AssetFactory(std::shared_ptr<DependencyTable> depTable, od::SrscFile &assetContainer)
         : mDependencyTable(depTable)
         , mSrscFile(assetContainer)
+        , mLoaderPool(nullptr)
+        , mDecodedAssetCache(nullptr)
+        , mRetentionCache(nullptr)
         {
         }
 
@@ -118,10 +258,30 @@ namespace odDb
 
             auto newAsset = createNewAsset(id);
             newAsset->setDepTableAndId(mDependencyTable, id);
-            newAsset->load(std::move(cursor));
 
-		    // FIXME: in contrast to load(...), postLoad() is not synchronized (due to it not using the cursor which holds the lock)
-		    //  this is not a problem atm, as asset loading is not threaded. later we might want to add a second mutex or something
+            // only asset types that implement DecodedCacheable can go through the cache
+            DecodedCacheable *cacheable = nullptr;
+            if constexpr(std::is_base_of<DecodedCacheable, _AssetType>::value)
+            {
+                if(mDecodedAssetCache != nullptr && mDecodedAssetCache->isEnabled())
+                {
+                    cacheable = newAsset.get();
+                }
+            }
+
+            od::RecordType type = AssetTraits<_AssetType>::baseType();
+            if(cacheable == nullptr || !mDecodedAssetCache->loadAsset(mSrscFile, type, id, *cacheable))
+            {
+                newAsset->load(std::move(cursor));
+
+                if(cacheable != nullptr)
+                {
+                    mDecodedAssetCache->storeAsset(mSrscFile, type, id, *cacheable);
+                }
+            }
+
+		    // postLoad() runs on whichever thread performs the load, outside of any container lock. it may only touch the
+		    //  asset itself and load other assets through the factories, which are safe to be called concurrently
 		    newAsset->postLoad();
 
 		    return newAsset;
@@ -130,10 +290,135 @@ namespace odDb
 
 	private:
 
+		struct PendingLoad
+		{
+		    PendingLoad(od::RecordId id)
+		    : assetId(id)
+		    , future(promise.get_future().share())
+		    , claimed(false)
+		    {
+		    }
+
+		    od::RecordId assetId;
+		    std::promise<std::shared_ptr<_AssetType>> promise;
+		    std::shared_future<std::shared_ptr<_AssetType>> future;
+
+		    // set by whoever actually performs the load. whoever fails to claim it waits on the future instead
+		    std::atomic<bool> claimed;
+		};
+
+		/**
+		 * @brief Returns the asset if it is cached and still alive, nullptr otherwise. Must be called with mCacheMutex held.
+		 */
+		std::shared_ptr<_AssetType> _getCachedAsset(od::RecordId assetId)
+		{
+		    auto it = mAssetCache.find(assetId);
+		    if(it == mAssetCache.end())
+		    {
+		        return nullptr;
+		    }
+
+		    auto asset = it->second.lock();
+		    if(asset == nullptr)
+		    {
+		        mAssetCache.erase(it);
+		        return nullptr;
+		    }
+
+		    Logger::debug() << AssetTraits<_AssetType>::name() << " " << std::hex << assetId << std::dec << " found in cache";
+
+		    return asset;
+		}
+
+		/**
+		 * @brief Must be called with mCacheMutex held.
+		 */
+		std::shared_ptr<PendingLoad> _getOrCreatePendingLoad(od::RecordId assetId)
+		{
+		    auto &pending = mPendingLoads[assetId];
+		    if(pending == nullptr)
+		    {
+		        pending = std::make_shared<PendingLoad>(assetId);
+		    }
+
+		    return pending;
+		}
+
+		/**
+		 * @brief Performs a claimed load and publishes the result. Must be called without mCacheMutex held.
+		 */
+		void _runLoad(od::RecordId assetId, PendingLoad &pending)
+		{
+		    Logger::debug() << AssetTraits<_AssetType>::name() << " " << std::hex << assetId << std::dec << " not found in cache. Loading from container " << mSrscFile.getFilePath().fileStr();
+
+		    std::shared_ptr<_AssetType> loaded = this->loadAsset(assetId);
+		    if(loaded == nullptr)
+		    {
+		        Logger::error() << AssetTraits<_AssetType>::name() << " " << std::hex << assetId << std::dec << " neither found in cache nor asset container " << mSrscFile.getFilePath().fileStr();
+		    }
+
+		    {
+		        std::lock_guard<std::mutex> lock(mCacheMutex);
+
+		        if(loaded != nullptr)
+		        {
+		            mAssetCache[assetId] = loaded;
+		        }
+
+		        mPendingLoads.erase(assetId);
+		    }
+
+		    pending.promise.set_value(loaded);
+
+		    _retain(loaded);
+		}
+
+		/**
+		 * @brief Must be called without mCacheMutex held, as the retention cache might destroy evicted assets.
+		 */
+		void _retain(const std::shared_ptr<_AssetType> &asset)
+		{
+		    if(mRetentionCache != nullptr && asset != nullptr)
+		    {
+		        mRetentionCache->touch(asset);
+		    }
+		}
+
+		void _releaseRetainedAssets()
+		{
+		    if(mRetentionCache == nullptr)
+		    {
+		        return;
+		    }
+
+		    std::vector<std::shared_ptr<_AssetType>> assets;
+
+		    {
+		        std::lock_guard<std::mutex> lock(mCacheMutex);
+		        for(auto &entry : mAssetCache)
+		        {
+		            if(auto asset = entry.second.lock(); asset != nullptr)
+		            {
+		                assets.push_back(asset);
+		            }
+		        }
+		    }
+
+		    for(auto &asset : assets)
+		    {
+		        mRetentionCache->release(asset.get());
+		    }
+		}
+
 		std::shared_ptr<DependencyTable> mDependencyTable;
 		od::SrscFile &mSrscFile;
+		od::ThreadPool *mLoaderPool;
+		DecodedAssetCache *mDecodedAssetCache;
+		AssetRetentionCache *mRetentionCache;
 
+		std::mutex mCacheMutex;
 		std::unordered_map<od::RecordId, std::weak_ptr<_AssetType>> mAssetCache;
+		std::unordered_map<od::RecordId, std::shared_ptr<PendingLoad>> mPendingLoads;
 	};
 
 
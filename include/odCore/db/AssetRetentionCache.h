@@ -0,0 +1,94 @@
+
+#ifndef INCLUDE_ODCORE_DB_ASSETRETENTIONCACHE_H_
+#define INCLUDE_ODCORE_DB_ASSETRETENTIONCACHE_H_
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace odDb
+{
+
+    class Asset;
+
+    /**
+     * @brief Byte-budgeted LRU of strong asset references.
+     *
+     * Asset factories only cache weak references, so an asset gets freed as soon as it's last user drops it. Asset
+     * factories report every asset they hand out to this cache, which keeps the most recently used ones alive until
+     * their combined Asset::getMemoryFootprint() exceeds the budget. This way, assets that are dropped and requested
+     * again shortly after (e.g. during level transitions or when objects respawn) are not decoded again.
+     *
+     * One instance is shared by all asset factories of a DbManager. All methods are thread safe.
+     */
+    class AssetRetentionCache
+    {
+    public:
+
+        struct Stats
+        {
+            size_t budget;
+            size_t retainedBytes;
+            size_t retainedCount;
+            size_t peakRetainedBytes;
+            size_t evictionCount;
+            size_t evictedBytes;
+        };
+
+        /**
+         * @param budget  Maximum number of bytes to retain. 0 disables retention.
+         */
+        explicit AssetRetentionCache(size_t budget);
+        AssetRetentionCache(const AssetRetentionCache &c) = delete;
+        ~AssetRetentionCache();
+
+        /**
+         * @brief Changes the budget, evicting assets as necessary. 0 disables retention and releases all assets.
+         */
+        void setBudget(size_t budget);
+
+        Stats getStats();
+
+        /**
+         * @brief Marks the asset as most recently used, adding it to the cache if it was not retained yet.
+         *
+         * Assets that exceed the budget on their own are not retained.
+         */
+        void touch(const std::shared_ptr<Asset> &asset);
+
+        /**
+         * @brief Drops the cache's reference to the given asset, if it holds one.
+         */
+        void release(const Asset *asset);
+
+
+    private:
+
+        struct Entry
+        {
+            std::shared_ptr<Asset> asset;
+            size_t size;
+        };
+
+        typedef std::list<Entry> LruList;
+
+        /**
+         * @brief Must be called with mMutex held. Evicted assets are moved to the passed list, so they can
+         * be destroyed after the mutex is released.
+         */
+        void _evictToBudget(LruList &evicted);
+
+        std::mutex mMutex;
+
+        // front is the most recently used asset
+        LruList mLruList;
+        std::unordered_map<const Asset*, LruList::iterator> mEntryMap;
+
+        Stats mStats;
+
+    };
+
+}
+
+#endif
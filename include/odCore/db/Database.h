@@ -12,6 +12,7 @@
 #include <vector>
 #include <unordered_map>
 #include <memory>
+#include <future>
 #include <vector>
 
 #include <odCore/FilePath.h>
@@ -52,9 +53,22 @@ namespace odDb
 
 		void loadDbFileAndDependencies(size_t dependencyDepth);
 
+        /**
+         * @brief Returns true if this database has a container for assets of the given base type.
+         *
+         * The load methods panic if it hasn't, so check this before loading assets named by untrusted sources.
+         */
+        bool hasAssetContainer(od::RecordType baseType) const;
+
         template <typename T>
         std::shared_ptr<T> loadAsset(od::RecordId recordId);
 
+        /**
+         * @brief Requests an asset to be loaded on the loader pool. See AssetFactory::getAssetAsync().
+         */
+        template <typename T>
+        std::shared_future<std::shared_ptr<T>> loadAssetAsync(od::RecordId recordId);
+
         std::shared_ptr<Texture>   loadTexture(od::RecordId recordId);
         std::shared_ptr<Class>     loadClass(od::RecordId recordId);
         std::shared_ptr<Model>     loadModel(od::RecordId recordId);
@@ -68,6 +82,12 @@ namespace odDb
         template <typename T>
         void _tryOpeningAssetContainer(std::unique_ptr<T> &factoryPtr, std::unique_ptr<od::SrscFile> &containerPtr, const char *extension);
 
+        template <typename T>
+        void _waitForPendingLoads(std::unique_ptr<T> &factoryPtr);
+
+        template <typename T>
+        std::shared_future<std::shared_ptr<typename T::AssetType>> _loadAssetAsync(std::unique_ptr<T> &factoryPtr, od::RecordId recordId);
+
 
 		od::FilePath mDbFilePath;
 		DbManager &mDbManager;
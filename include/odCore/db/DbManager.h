@@ -13,6 +13,10 @@
 
 #include <odCore/CTypes.h>
 #include <odCore/FilePath.h>
+#include <odCore/ThreadPool.h>
+
+#include <odCore/db/DecodedAssetCache.h>
+#include <odCore/db/AssetRetentionCache.h>
 
 #include <odCore/db/Database.h>
 
@@ -45,6 +49,29 @@ namespace odDb
          */
         size_t getLoadedDatabaseCount() const;
 
+        /**
+         * @brief Returns the pool on which the asset factories of all databases perform asynchronous loads.
+         */
+        inline od::ThreadPool &getLoaderPool() { return mLoaderPool; }
+
+        /**
+         * @brief Returns the decoded asset cache used by the asset factories of all databases. It is disabled by default.
+         */
+        inline DecodedAssetCache &getDecodedAssetCache() { return mDecodedAssetCache; }
+
+        /**
+         * @brief Returns the cache that keeps recently used assets of all databases alive, so they don't have to be
+         * decoded again when they are needed shortly after being dropped.
+         */
+        inline AssetRetentionCache &getRetentionCache() { return mRetentionCache; }
+
+        /**
+         * @brief Controls whether levels write an asset manifest next to the level file after loading, which speeds
+         * up later loads of the same level. Disabled by default, as level directories might not be writable.
+         */
+        inline void setLevelManifestWritingEnabled(bool b) { mLevelManifestWritingEnabled = b; }
+        inline bool isLevelManifestWritingEnabled() const { return mLevelManifestWritingEnabled; }
+
         template <typename T>
         std::shared_ptr<T> loadAsset(const GlobalAssetRef &ref)
         {
@@ -78,6 +105,12 @@ namespace odDb
         // FIXME: make sure a database that is unloaded, then loaded again gets the same global index!
         std::unordered_map<GlobalDatabaseIndex, std::weak_ptr<Database>> mLoadedDatabases;
         size_t mNextGlobalIndex;
+        bool mLevelManifestWritingEnabled;
+
+        // declared before the pool, so they outlive jobs drained during the pool's destruction
+        DecodedAssetCache mDecodedAssetCache;
+        AssetRetentionCache mRetentionCache;
+        od::ThreadPool mLoaderPool;
 	};
 
 }
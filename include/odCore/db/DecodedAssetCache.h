@@ -0,0 +1,120 @@
+
+#ifndef INCLUDE_ODCORE_DB_DECODEDASSETCACHE_H_
+#define INCLUDE_ODCORE_DB_DECODEDASSETCACHE_H_
+
+#include <atomic>
+
+#include <odCore/FilePath.h>
+#include <odCore/SrscFile.h>
+
+namespace odDb
+{
+
+    /**
+     * @brief Interface for assets that can be stored in a DecodedAssetCache.
+     *
+     * Asset types implementing this are cached automatically by their AssetFactory. All others always get decoded.
+     */
+    class DecodedCacheable
+    {
+    public:
+
+        virtual ~DecodedCacheable() = default;
+
+        /**
+         * @brief Returns the version of the representation written by saveDecoded(). Must not be 0.
+         *
+         * Bump this whenever the decoder or the decoded representation changes, so stale cache entries get ignored.
+         */
+        virtual uint32_t getDecoderVersion() const = 0;
+
+        /**
+         * @brief Writes everything load() produced to the given writer, so loadDecoded() can restore it without decoding.
+         */
+        virtual void saveDecoded(od::DataWriter &dw) = 0;
+
+        /**
+         * @brief Alternative to load() that restores the asset from data written by saveDecoded().
+         *
+         * The reader is memory-backed and spans exactly the payload. Implementations must check it's size before
+         * reading anything and return false if it doesn't fit what saveDecoded() writes. The asset is then decoded
+         * using load() as usual, so a partially restored state is fine. postLoad() is still called afterwards.
+         */
+        virtual bool loadDecoded(od::DataReader &dr) = 0;
+
+    };
+
+
+    /**
+     * @brief Optional on-disk cache for assets in their decoded form (e.g. inflated and converted texture pixels).
+     *
+     * Each entry is a single file in the cache directory, named after a hash of it's key. The key consists of
+     * the container path, the container's modification time and size, the record type and ID, and the decoder
+     * version reported by the asset. The full key is repeated in the entry header, so hash collisions and stale
+     * entries are detected and treated as misses.
+     *
+     * Entries consist of a small header followed by the payload written by DecodedCacheable::saveDecoded(). The payload
+     * starts at an aligned offset, so entries can be read straight out of a file mapping.
+     *
+     * Entries are written to a temporary file first and then renamed, so concurrent loaders never see partial
+     * entries. All methods are safe to be called from multiple threads.
+     */
+    class DecodedAssetCache
+    {
+    public:
+
+        /**
+         * @brief Creates a disabled cache. Use setCacheDirectory() to enable it.
+         */
+        DecodedAssetCache();
+        DecodedAssetCache(const DecodedAssetCache &c) = delete;
+
+        /**
+         * @brief Enables the cache, storing entries in the given directory. Creates the directory if necessary.
+         *
+         * This should be called before any assets are loaded, as it is not synchronized with loads in progress.
+         */
+        void setCacheDirectory(const od::FilePath &dir);
+
+        inline bool isEnabled() const { return mEnabled; }
+        inline size_t getHitCount() const { return mHitCount; }
+        inline size_t getMissCount() const { return mMissCount; }
+
+        /**
+         * @brief Tries to fill the asset from a matching cache entry.
+         *
+         * @return true if the asset was loaded from the cache, false if there was no usable entry. Entries the asset
+         *         rejects as malformed count as misses.
+         */
+        bool loadAsset(od::SrscFile &container, od::RecordType type, od::RecordId id, DecodedCacheable &asset);
+
+        /**
+         * @brief Writes the decoded form of a freshly loaded asset to the cache. Failures are logged and otherwise ignored.
+         *
+         * The entry is assembled in memory first, so a full disk or similar errors never leave a partial entry behind.
+         */
+        void storeAsset(od::SrscFile &container, od::RecordType type, od::RecordId id, DecodedCacheable &asset);
+
+
+    private:
+
+        struct ContainerStamp
+        {
+            int64_t mtime;
+            uint64_t size;
+        };
+
+        bool _getContainerStamp(od::SrscFile &container, ContainerStamp &stamp);
+        od::FilePath _getEntryPath(const std::string &containerPath, const ContainerStamp &stamp, od::RecordType type, od::RecordId id, uint32_t decoderVersion);
+
+        od::FilePath mCacheDirectory;
+        bool mEnabled;
+
+        std::atomic<size_t> mHitCount;
+        std::atomic<size_t> mMissCount;
+
+    };
+
+}
+
+#endif
@@ -3,6 +3,7 @@
 #define INCLUDE_ODCORE_DB_DEPENDENCYTABLE_H_
 
 #include <unordered_map>
+#include <future>
 
 #include <odCore/db/AssetRef.h>
 #include <odCore/db/Database.h>
@@ -36,6 +37,27 @@ namespace odDb
             }
         }
 
+        /**
+         * @brief Requests an asset to be loaded on the loader pool. Resolves to nullptr if the reference is invalid.
+         */
+        template <typename T>
+        std::shared_future<std::shared_ptr<T>> loadAssetAsync(const AssetRef &ref) const
+        {
+            auto db = getDependency(ref.dbIndex);
+            if(db != nullptr)
+            {
+                return db->loadAssetAsync<T>(ref.assetId);
+
+            }else
+            {
+                Logger::warn() << "Invalid depdendency index in asset reference: " << ref.dbIndex;
+
+                std::promise<std::shared_ptr<T>> invalid;
+                invalid.set_value(nullptr);
+                return invalid.get_future().share();
+            }
+        }
+
         void reserveDependencies(size_t n);
         void addDependency(DatabaseIndex index, std::shared_ptr<Database> db);
 
@@ -98,6 +98,7 @@ namespace odDb
 		const ModelBounds &getModelBounds(size_t lodIndex = 0);
 
 		virtual void load(od::SrscFile::RecordInputCursor cursor) override;
+		virtual size_t getMemoryFootprint() const override;
 
 
 	private:
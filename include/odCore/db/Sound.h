@@ -12,6 +12,7 @@
 #include <memory>
 
 #include <odCore/db/Asset.h>
+#include <odCore/db/DecodedAssetCache.h>
 
 #define OD_SOUND_FLAG_FLUSH_AFTER_PLAYING 	0x04
 #define OD_SOUND_FLAG_PLAY_LOOPING			0x08
@@ -25,7 +26,7 @@ namespace odAudio
 namespace odDb
 {
 
-	class Sound : public Asset
+	class Sound : public Asset, public DecodedCacheable
 	{
 	public:
 
@@ -41,6 +42,12 @@ namespace odDb
         inline std::weak_ptr<odAudio::Buffer> &getCachedSoundBuffer() { return mCachedSoundBuffer; }
 
 		virtual void load(od::SrscFile::RecordInputCursor cursor) override;
+		virtual size_t getMemoryFootprint() const override;
+
+		// implement DecodedCacheable
+		virtual uint32_t getDecoderVersion() const override;
+		virtual void saveDecoded(od::DataWriter &dw) override;
+		virtual bool loadDecoded(od::DataReader &dr) override;
 
 		float getLinearGain() const;
 
@@ -15,6 +15,7 @@
 #include <odCore/SrscRecordTypes.h>
 
 #include <odCore/db/Asset.h>
+#include <odCore/db/DecodedAssetCache.h>
 #include <odCore/db/Class.h>
 
 namespace odRender
@@ -28,7 +29,7 @@ namespace odDb
 
 	class TextureFactory;
 
-    class Texture : public Asset
+    class Texture : public Asset, public DecodedCacheable
     {
     public:
 
@@ -58,12 +59,25 @@ namespace odDb
 
         virtual void load(od::SrscFile::RecordInputCursor cursor) override;
         virtual void postLoad() override;
+        virtual size_t getMemoryFootprint() const override;
+
+        // implement DecodedCacheable
+        virtual uint32_t getDecoderVersion() const override;
+        virtual void saveDecoded(od::DataWriter &dw) override;
+        virtual bool loadDecoded(od::DataReader &dr) override;
 
 
     private:
 
         void _loadFromRecord(od::DataReader &dr);
-        unsigned char _filter16BitChannel(uint16_t color, uint32_t mask, uint32_t shift);
+
+        // batch converters to RGBA8888. these operate on whole images and keep their inner loops
+        //  free of branches and calls so the compiler can vectorize them
+        static void _convertPalette8(const uint8_t *src, size_t pixelCount, const uint8_t *paletteLut, uint8_t *dest);
+        static void _convert16(const uint8_t *src, size_t pixelCount, uint8_t alphaBits, uint8_t *dest);
+        static void _convert24(const uint8_t *src, size_t pixelCount, uint8_t *dest);
+        static void _convert32(const uint8_t *src, size_t pixelCount, bool useAlpha, uint8_t *dest);
+        static void _applyColorKey(uint8_t *rgba, size_t pixelCount, uint8_t keyRed, uint8_t keyGreen, uint8_t keyBlue);
 
         TextureFactory &mTextureFactory;
 
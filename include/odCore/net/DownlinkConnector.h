@@ -19,6 +19,7 @@
 #include <odCore/net/IdTypes.h>
 
 #include <odCore/state/Event.h>
+#include <odCore/state/StateQuantization.h>
 #include <odCore/state/Timeline.h>
 
 namespace odAnim
@@ -49,7 +50,12 @@ namespace odNet
         virtual ~DownlinkConnector() = default;
 
         virtual void globalDatabaseTableEntry(odDb::GlobalDatabaseIndex dbIndex, const std::string &path) = 0; // TODO: replace strings with string_views
-        virtual void loadLevel(const std::string &path, size_t loadedDatabaseCount) = 0;
+
+        /**
+         * The quantization is the one the server uses to encode states for this level. The receiving end has to use
+         * the same one to decode them.
+         */
+        virtual void loadLevel(const std::string &path, size_t loadedDatabaseCount, const odState::StateQuantization &quantization) = 0;
 
         virtual void objectStatesChanged(odState::TickNumber tick, od::LevelObjectId id, const od::ObjectStates &states) = 0;
         virtual void confirmSnapshot(odState::TickNumber tick, double realtime, size_t discreteChangeCount, odState::TickNumber referenceTick) = 0;
@@ -65,6 +71,13 @@ namespace odNet
         //virtual void objectMessage(MessageChannelCode code, od::LevelObjectId sender, od::LevelObjectId receiver, const char *data, size_t size) = 0;
 
         virtual void event(const odState::EventVariant &e, double realtime) = 0;
+
+        /**
+         * @brief Passes on anything this connector buffered. Called by the server after it sent everything for a tick.
+         *
+         * Does nothing by default.
+         */
+        virtual void flush() {}
     };
 
 }
@@ -10,26 +10,37 @@
 
 #include <array>
 
-#include <odCore/Exception.h>
+#include <odCore/CTypes.h>
 
 namespace odNet
 {
 
-    class IpParseException : public od::Exception
-    {
-    public:
-
-        IpParseException(const std::string &msg);
-
-    };
-
     class IpV4Address
     {
     public:
 
         IpV4Address(const std::array<int, 4> &addr);
+
+        /**
+         * @brief Parses an address in dotted decimal notation. Panics if the string is malformed.
+         */
         IpV4Address(const char *addrStr);
 
+        /**
+         * @brief Creates an address from it's 32 bit representation, with the first octet in the most significant byte.
+         */
+        explicit IpV4Address(uint32_t addr);
+
+        static IpV4Address any() { return IpV4Address(std::array<int, 4>{ 0, 0, 0, 0 }); }
+        static IpV4Address loopback() { return IpV4Address(std::array<int, 4>{ 127, 0, 0, 1 }); }
+
+        inline const std::array<int, 4> &getOctets() const { return mAddress; }
+
+        /**
+         * @brief Returns the 32 bit representation, with the first octet in the most significant byte.
+         */
+        uint32_t toUint32() const;
+
 
     private:
 
@@ -1,5 +1,3 @@
-
-
 /*
  * @file LocalTunnel.h
  * @author zal
@@ -11,18 +9,21 @@
  * This is not always desireable. One might want to simulate network latency or
  * simply test the network protocol. This header defines a set of classes that
  * create a buffer-backed tunnel between Server-/ClientConnectors that uses the
- * network protocol, and can also simulate latency and packet drops.
+ * network protocol, and can also simulate bad network conditions.
  */
 
 #ifndef INCLUDE_ODCORE_NET_LOCALTUNNEL_H_
 #define INCLUDE_ODCORE_NET_LOCALTUNNEL_H_
 
+#include <array>
 #include <memory>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <chrono>
 #include <atomic>
+#include <deque>
+#include <random>
 
 #include <odCore/net/PacketParser.h>
 #include <odCore/net/PacketBuilder.h>
@@ -32,24 +33,127 @@ namespace odNet
     class UplinkConnector;
     class DownlinkConnector;
 
+    /**
+     * @brief Connects a client and a server through the network protocol, optionally impairing the connection.
+     *
+     * Each direction is impaired separately according to it's LinkConditions. All randomness comes from seeded
+     * per-direction engines, so the same seed and the same sequence of packets always yield the same drops, delays
+     * and duplicates. Packets on the reliable link are never lost, duplicated or reordered, just like with a real
+     * transport. They are still delayed and limited by the bandwidth cap.
+     *
+     * By default, delayed packets are delivered by a dispatch thread according to the wall clock. For tests that
+     * need to be reproducible down to the timing, the tunnel can use a manual clock instead, in which case packets
+     * are only delivered from within advanceClock().
+     */
     class LocalTunnel
     {
     public:
 
+        enum class Direction
+        {
+            DOWNLINK,
+            UPLINK
+        };
+
+        enum class JitterDistribution
+        {
+            UNIFORM,    ///< Random delay in [0, jitter]
+            NORMAL,     ///< Absolute value of a normal distribution with standard deviation jitter
+            EXPONENTIAL ///< Exponential distribution with mean jitter. Produces occasional long delay spikes
+        };
+
+        struct LinkConditions
+        {
+            LinkConditions();
+
+            double latency; ///< Fixed delay every packet experiences, in seconds
+            double jitter; ///< Scale of the random delay added to latency, in seconds
+            JitterDistribution jitterDistribution;
+
+            /**
+             * Probability that an unreliable packet keeps it's own random delay rather than queuing up behind
+             * earlier packets. Only has an effect with jitter.
+             */
+            double reorderRate;
+            double duplicateRate; ///< Probability that an unreliable packet is delivered twice
+
+            // loss is modelled as a Gilbert-Elliott channel: a two-state Markov chain, stepped once per packet,
+            //  with a different loss probability for each state. with no burst transitions, this is uniform loss
+            double lossRate; ///< Loss probability in the good state
+            double burstLossRate; ///< Loss probability in the bad (burst) state
+            double burstStartRate; ///< Probability to transition from the good to the bad state
+            double burstEndRate; ///< Probability to transition from the bad to the good state
+
+            double bandwidth; ///< Max. bytes per second. Packets exceeding it are queued. 0 means unlimited
+            double maxQueueDelay; ///< Unreliable packets that would queue longer than this for bandwidth are dropped. 0 means no limit
+
+            /**
+             * @brief Returns true if these conditions delay any packets, and thus need the dispatch thread.
+             */
+            bool delaysPackets() const;
+        };
+
+        struct LinkStatistics
+        {
+            LinkStatistics();
+
+            size_t packetsSent;
+            size_t bytesSent;
+            size_t packetsDelivered; ///< Including duplicates
+            size_t bytesDelivered;
+            size_t packetsLost; ///< Dropped by the loss model
+            size_t packetsQueueDropped; ///< Dropped because the bandwidth queue was full
+            size_t packetsDuplicated;
+            size_t packetsReordered; ///< Delivered after a packet that was sent later
+            double totalDelay; ///< Sum of the delays of all delivered packets, in seconds
+            double maxDelay;
+
+            inline double getAverageDelay() const { return packetsDelivered > 0 ? totalDelay/packetsDelivered : 0.0; }
+        };
+
+        static constexpr uint64_t DEFAULT_SEED = 0;
+
         LocalTunnel(std::shared_ptr<DownlinkConnector> downlinkOutput, std::shared_ptr<UplinkConnector> uplinkOutput);
         ~LocalTunnel();
 
         inline std::shared_ptr<DownlinkConnector> getDownlinkInput() { return mDownlinkPacketBuilder; }
         inline std::shared_ptr<UplinkConnector> getUplinkInput() { return mUplinkPacketBuilder; }
 
-        inline void setDropRate(double dropRate) { mDropRate = dropRate; }
+        /**
+         * @brief Re-seeds the random engines of both directions and resets the loss model to the good state.
+         */
+        void setSeed(uint64_t seed);
+
+        void setConditions(const LinkConditions &conditions);
+        void setConditions(Direction direction, const LinkConditions &conditions);
+        LinkConditions getConditions(Direction direction);
 
+        /**
+         * @brief Convenience for setting uniform loss on both directions.
+         */
+        void setDropRate(double dropRate);
+
+        /**
+         * @brief Convenience for setting uniformly distributed latency on both directions.
+         */
         void setLatency(double min, double max);
 
+        LinkStatistics getStatistics(Direction direction);
 
-    private:
+        /**
+         * @brief Switches to a manual clock. Must be called before any packets are sent.
+         *
+         * The dispatch thread is not used then. Instead, packets are delivered on the calling thread by advanceClock().
+         */
+        void useManualClock();
 
-        using time_point = std::chrono::high_resolution_clock::time_point;
+        /**
+         * @brief Advances the manual clock by the given number of seconds and delivers all packets that arrived by then.
+         */
+        void advanceClock(double seconds);
+
+
+    private:
 
         static constexpr size_t MAX_PAYLOAD_SIZE = 512;
 
@@ -57,14 +161,47 @@ namespace odNet
         {
             std::array<char, MAX_PAYLOAD_SIZE> data;
             size_t size;
-            time_point arriveBy;
+            size_t sequenceNumber;
+            double sentAt;
+            double arriveBy;
             bool isUplink;
         };
 
-        bool _shouldDrop();
-        double _getRandomLatency();
+        struct LinkState
+        {
+            LinkState();
+
+            LinkConditions conditions;
+            LinkStatistics statistics;
+            std::mt19937_64 randomEngine;
+            bool inBurst;
+            size_t nextSequenceNumber;
+            size_t lastDeliveredSequenceNumber;
+            bool hasDelivered;
+            double queueFreeAt; // when the bandwidth-limited link has sent everything queued so far
+            double lastArrival; // latest arrival time scheduled so far
+        };
+
+        inline LinkState &_getLinkState(bool isUplink) { return isUplink ? mUplinkState : mDownlinkState; }
+        inline LinkState &_getLinkState(Direction direction) { return _getLinkState(direction == Direction::UPLINK); }
+
+        double _now();
+        double _random(LinkState &link);
+        double _randomJitter(LinkState &link);
+        void _startDispatchThreadIfNeeded();
+
+        /**
+         * @brief Decides the fate of a packet. Returns how many copies should be delivered.
+         *
+         * If the packet is delayed, those copies are queued, and 0 is returned.
+         */
+        size_t _schedulePacket(LinkState &link, const char *data, size_t size, PacketBuilder::LinkType linkType, bool isUplink);
+        void _queuePacket(LinkState &link, const char *data, size_t size, size_t sequenceNumber, double sentAt, double arriveBy, bool isUplink);
+        void _countDelivery(LinkState &link, size_t sequenceNumber, size_t size, double delay);
+
         void _addPacket(const char *data, size_t size, PacketBuilder::LinkType linkType, bool isUplink);
         void _parsePacket(const char *data, size_t size, bool isUplink);
+        void _deliverDuePackets(double now);
         void _dispatchThreadWorkerFunc();
 
         std::shared_ptr<PacketBuilder> mDownlinkPacketBuilder;
@@ -73,15 +210,18 @@ namespace odNet
         std::shared_ptr<PacketBuilder> mUplinkPacketBuilder;
         PacketParser mUplinkPacketParser;
 
-        double mLatencyMin;
-        double mLatencyMax;
-        double mDropRate;
+        LinkState mDownlinkState;
+        LinkState mUplinkState;
+
+        std::chrono::steady_clock::time_point mStartTime;
+        bool mUseManualClock;
+        double mManualClock;
 
         std::thread mDispatchThread;
         bool mDispatchThreadStarted;
         std::atomic_bool mTerminateDispatchThread;
-        std::deque<Packet> mPacketBuffer;
-        std::mutex mPacketBufferMutex;
+        std::deque<Packet> mPacketBuffer; // ascending by arrival time
+        std::mutex mMutex; // guards link states, the clock and the packet buffer
         std::condition_variable mDispatchCondition;
 
     };
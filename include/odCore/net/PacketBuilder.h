@@ -29,8 +29,17 @@ namespace odNet
          */
         PacketBuilder(const std::function<void(const char *, size_t, LinkType)> &packetCallback);
 
+        /**
+         * @brief Makes the builder coalesce packets into datagrams of up to the given size. 0 disables coalescing (the default).
+         *
+         * While enabled, packets are collected per link type and only passed to the packet callback when the next one
+         * wouldn't fit anymore or flush() is called. The callback then receives several packets at once, which a
+         * PacketParser can take apart in one pass. Packets larger than the datagram size are passed on alone.
+         */
+        void setCoalescing(size_t maxDatagramSize);
+
         virtual void globalDatabaseTableEntry(odDb::GlobalDatabaseIndex dbIndex, const std::string &path) override final;
-        virtual void loadLevel(const std::string &path, size_t loadedDatabaseCount) override final;
+        virtual void loadLevel(const std::string &path, size_t loadedDatabaseCount, const odState::StateQuantization &quantization) override final;
         virtual void objectStatesChanged(odState::TickNumber tick, od::LevelObjectId id, const od::ObjectStates &states) override final;
         virtual void objectExtraStatesChanged(odState::TickNumber tick, od::LevelObjectId id, const char *data, size_t size) override final;
         virtual void confirmSnapshot(odState::TickNumber tick, double realtime, size_t discreteChangeCount, odState::TickNumber referenceTick) override final;
@@ -41,18 +50,26 @@ namespace odNet
         virtual void analogActionTriggered(odInput::ActionCode code, const glm::vec2 &axes) override final;
         virtual void acknowledgeSnapshot(odState::TickNumber tick) override final;
 
+        virtual void flush() override final;
+
 
     private:
 
         void _beginPacket(PacketType type);
         void _endPacket(LinkType linkType);
+        void _flushDatagram(LinkType linkType);
 
         std::function<void(const char *, size_t, LinkType)> mPacketCallback;
+        odState::StateQuantization mQuantization;
+        std::vector<char> mBitBuffer;
         std::vector<char> mPacketBuffer;
         od::VectorOutputBuffer mStreamBuffer;
         std::ostream mOutputStream;
         od::DataWriter mWriter;
 
+        size_t mMaxDatagramSize;
+        std::vector<char> mDatagrams[2]; // pending coalesced packets, indexed by link type
+
     };
 
 }
@@ -4,6 +4,8 @@
 
 #include <memory>
 
+#include <odCore/state/StateQuantization.h>
+
 namespace od
 {
     class DataReader;
@@ -29,10 +31,19 @@ namespace odNet
         PacketParser(std::shared_ptr<DownlinkConnector> downlinkOutput, std::shared_ptr<UplinkConnector> uplinkOutput);
         ~PacketParser();
 
+        struct ParseResult
+        {
+            size_t packetCount;
+            size_t consumedBytes;
+            size_t remainingBytes; ///< Bytes at the end of the input that form an incomplete packet. Pass these again once more data arrived
+        };
+
         /**
-         * @return The number of bytes of input that were used.
+         * @brief Parses all complete packets in the given buffer in one pass.
+         *
+         * Payloads are read in place, without copying them.
          */
-        size_t parse(const char *data, size_t size);
+        ParseResult parse(const char *data, size_t size);
 
 
     private:
@@ -45,6 +56,9 @@ namespace odNet
 
         size_t mBadPacketCount;
 
+        // received with the last LOAD_LEVEL packet
+        odState::StateQuantization mQuantization;
+
     };
 
 }
@@ -28,6 +28,8 @@ namespace odNet
     struct PacketConstants
     {
         static constexpr size_t HEADER_SIZE = 3;
+        static constexpr size_t LOAD_LEVEL_HEADER_SIZE = 4 + 7*4; // database count, quantization bounds and resolution
+        static constexpr size_t OBJECT_STATES_HEADER_SIZE = 12;
         static constexpr size_t EXTRA_STATES_HEADER_SIZE = 12;
         static constexpr size_t GLOBAL_MESSAGE_HEADER_SIZE = 4;
     };
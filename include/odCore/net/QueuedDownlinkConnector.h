@@ -26,7 +26,7 @@ namespace odNet
         void flushQueue(DownlinkConnector &c);
 
         virtual void globalDatabaseTableEntry(odDb::GlobalDatabaseIndex dbIndex, const std::string &path) override;
-        virtual void loadLevel(const std::string &path, size_t loadedDatabaseCount) override;
+        virtual void loadLevel(const std::string &path, size_t loadedDatabaseCount, const odState::StateQuantization &quantization) override;
         virtual void objectStatesChanged(odState::TickNumber tick, od::LevelObjectId id, const od::ObjectStates &states) override;
         virtual void objectExtraStatesChanged(odState::TickNumber tick, od::LevelObjectId id, const char *data, size_t size) override;
         virtual void confirmSnapshot(odState::TickNumber tick, double realtime, size_t discreteChangeCount, odState::TickNumber referenceTick) override;
@@ -46,6 +46,7 @@ namespace odNet
         {
             size_t loadedDatabaseCount;
             std::string path;
+            odState::StateQuantization quantization;
         };
 
         struct ObjectStatesChanged
@@ -8,22 +8,102 @@
 #ifndef INCLUDE_ODCORE_NET_SOCKET_H_
 #define INCLUDE_ODCORE_NET_SOCKET_H_
 
+#include <functional>
+
 #include <odCore/CTypes.h>
-#include <odCore/DataStream.h>
+
+#include <odCore/net/IpAddress.h>
 
 namespace odNet
 {
-    class IpV4Address;
 
+    /**
+     * @brief An IPv4 address and port.
+     */
+    class UdpEndpoint
+    {
+    public:
+
+        struct Hash
+        {
+            size_t operator()(const UdpEndpoint &e) const
+            {
+                return std::hash<uint64_t>()((static_cast<uint64_t>(e.mAddress) << 16) | e.mPort);
+            }
+        };
+
+        UdpEndpoint();
+        UdpEndpoint(const IpV4Address &address, uint16_t port);
+
+        inline IpV4Address getAddress() const { return IpV4Address(mAddress); }
+        inline uint16_t getPort() const { return mPort; }
+
+        inline bool operator==(const UdpEndpoint &e) const { return mAddress == e.mAddress && mPort == e.mPort; }
+        inline bool operator!=(const UdpEndpoint &e) const { return !(*this == e); }
+
+
+    private:
+
+        uint32_t mAddress;
+        uint16_t mPort;
+
+    };
+
+
+    /**
+     * @brief A non-blocking UDP socket.
+     *
+     * Failing to create or bind the socket is considered fatal and panics. Transient errors while sending or
+     * receiving are logged, and the datagram in question is treated as lost.
+     */
     class UdpSocket
     {
     public:
 
+        static constexpr size_t MAX_DATAGRAM_SIZE = 65507;
+
         UdpSocket();
+        UdpSocket(const UdpSocket &s) = delete;
+        ~UdpSocket();
 
+        /**
+         * @brief Binds the socket to the given local address. Pass port 0 to let the system pick one.
+         */
         void bind(const IpV4Address &address, uint16_t port);
 
-        od::DataReader getReaderForNextPacket();
+        /**
+         * @brief Returns the local port the socket is bound to, or 0 if it is not bound yet.
+         */
+        uint16_t getLocalPort() const;
+
+        /**
+         * @brief Sends a datagram. Returns false if it could not be sent, e.g. because the send buffer is full.
+         *
+         * It is safe to call this while another thread is receiving on the same socket.
+         */
+        bool send(const UdpEndpoint &to, const char *data, size_t size);
+
+        /**
+         * @brief Receives the next pending datagram into the given buffer.
+         *
+         * @return The size of the datagram, or 0 if none was pending. Datagrams larger than the buffer are truncated.
+         */
+        size_t receive(char *buffer, size_t bufferSize, UdpEndpoint &from);
+
+        /**
+         * @brief Blocks until a datagram is pending or the timeout (in seconds) runs out. Returns true if one is pending.
+         */
+        bool waitForData(double timeout);
+
+
+    private:
+
+#if defined (__WIN32__)
+        uintptr_t mSocket; // a SOCKET. that way, we don't need to include winsock here
+#else
+        int mSocket;
+#endif
+
     };
 
 }
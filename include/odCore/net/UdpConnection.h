@@ -0,0 +1,212 @@
+
+#ifndef INCLUDE_ODCORE_NET_UDPCONNECTION_H_
+#define INCLUDE_ODCORE_NET_UDPCONNECTION_H_
+
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include <odCore/CTypes.h>
+
+namespace odNet
+{
+
+    /**
+     * @brief Reliability layer for one peer of a datagram-based connection.
+     *
+     * Every datagram carries a sequence number and acknowledges the latest datagram received from the peer, plus
+     * the 32 before it in a bitfield. On top of that, this provides two channels:
+     *  - An unreliable channel. Messages may be lost or arrive out of order, but never arrive twice. Messages that
+     *    don't fit a single datagram are split into fragments, and only delivered if all of them arrive.
+     *  - A reliable, ordered channel. Messages are split into fragments that fit a datagram, and each fragment is
+     *    resent until a datagram containing it is acknowledged. The receiver delivers messages strictly in order.
+     *
+     * This does not touch any sockets. Outgoing datagrams are passed to a callback, and incoming ones must be fed
+     * into receiveDatagram(), so the connection can be run over anything that carries datagrams. Time is passed in
+     * by the caller (in seconds, from an arbitrary but fixed origin).
+     *
+     * Not synchronized. The callbacks are called from within send(), receiveDatagram() and update() and must not
+     * call back into the connection.
+     *
+     * The connection closes itself if the peer sends a reliable message larger than MAX_RELIABLE_MESSAGE_SIZE, or
+     * stops acknowledging so that more than MAX_QUEUED_RELIABLE_FRAGMENTS are waiting to be sent. Closed
+     * connections ignore all further calls, and the owner should tear them down.
+     */
+    class UdpConnection
+    {
+    public:
+
+        enum class Channel
+        {
+            UNRELIABLE,
+            RELIABLE
+        };
+
+        static constexpr uint16_t PROTOCOL_ID = 0x444f; // "OD"
+        static constexpr size_t DEFAULT_MTU = 1200; // conservative, leaves room for IP and UDP headers and tunnels
+        static constexpr size_t DATAGRAM_HEADER_SIZE = 11; // protocol ID, sequence, flags, ack, ack bits
+        static constexpr size_t UNRELIABLE_CHUNK_HEADER_SIZE = 7; // type, group, index, count, size
+        static constexpr size_t RELIABLE_CHUNK_HEADER_SIZE = 6; // type, ID, flags, size
+        static constexpr size_t MAX_FRAGMENT_COUNT = 255;
+        static constexpr size_t RELIABLE_WINDOW = 1024; ///< Max. number of reliable fragments in flight
+        static constexpr size_t MAX_PENDING_FRAGMENT_GROUPS = 16; ///< Unreliable messages being reassembled at once
+        static constexpr size_t MAX_RELIABLE_MESSAGE_SIZE = 1024*1024; ///< Max. size of received reliable messages, in bytes
+        static constexpr size_t MAX_QUEUED_RELIABLE_FRAGMENTS = 8*RELIABLE_WINDOW; ///< Max. number of unacknowledged outgoing reliable fragments
+        static constexpr double ACK_DELAY = 0.02; ///< Max. time received datagrams go unacknowledged if we have nothing else to send
+        static constexpr double KEEPALIVE_INTERVAL = 0.25;
+        static constexpr double MIN_RESEND_TIMEOUT = 0.05;
+        static constexpr double INITIAL_RESEND_TIMEOUT = 0.2; ///< Used until we have an estimate of the round trip time
+
+        using DatagramCallback = std::function<void(const char *data, size_t size)>;
+        using MessageCallback = std::function<void(const char *data, size_t size, Channel channel)>;
+
+        /**
+         * @brief Returns true if the given datagram looks like it was sent by a UdpConnection.
+         *
+         * Useful to decide whether a datagram from an unknown sender should create a new connection.
+         */
+        static bool isConnectionDatagram(const char *data, size_t size);
+
+        UdpConnection(const DatagramCallback &datagramCallback, const MessageCallback &messageCallback);
+
+        /**
+         * @brief Sets the max. size of datagrams this connection sends. Defaults to DEFAULT_MTU.
+         */
+        void setMtu(size_t mtu);
+        inline size_t getMtu() const { return mMtu; }
+
+        /**
+         * @brief Returns the smoothed round trip time in seconds, or 0.0 if nothing was acknowledged yet.
+         */
+        inline double getRoundTripTime() const { return mRoundTripTime; }
+
+        inline size_t getSentDatagramCount() const { return mSentDatagramCount; }
+        inline size_t getReceivedDatagramCount() const { return mReceivedDatagramCount; }
+        inline size_t getResentFragmentCount() const { return mResentFragmentCount; }
+        inline size_t getPendingReliableFragmentCount() const { return mOutgoingReliable.size(); }
+
+        /**
+         * @brief Returns true if the connection closed itself because one of it's limits was exceeded.
+         */
+        inline bool isClosed() const { return mClosed; }
+
+        /**
+         * @brief Sends a message over the given channel. Reliable messages are queued until acknowledged.
+         */
+        void send(const char *data, size_t size, Channel channel, double now);
+
+        /**
+         * @brief Processes a datagram received from the peer. Completed messages are passed to the message callback.
+         */
+        void receiveDatagram(const char *data, size_t size, double now);
+
+        /**
+         * @brief Resends unacknowledged reliable fragments and sends acknowledgements and keepalives as needed.
+         *
+         * Call this regularly, a few ms apart.
+         */
+        void update(double now);
+
+
+    private:
+
+        struct SentDatagram
+        {
+            SentDatagram();
+
+            uint16_t sequence;
+            bool valid;
+            bool acked;
+            double sendTime;
+            std::vector<uint16_t> reliableIds;
+        };
+
+        struct OutgoingReliable
+        {
+            uint16_t id;
+            bool isLastFragment;
+            bool acked;
+            double lastSendTime; // negative if never sent
+            std::vector<char> data;
+        };
+
+        struct IncomingReliable
+        {
+            bool received;
+            bool isLastFragment;
+            std::vector<char> data;
+        };
+
+        struct FragmentGroup
+        {
+            uint16_t groupId;
+            size_t receivedCount;
+            std::vector<bool> received;
+            std::vector<std::vector<char>> fragments;
+        };
+
+        void _close(const char *reason);
+        double _getResendTimeout() const;
+
+        void _beginDatagram();
+        void _writeUnreliableChunk(uint16_t groupId, uint8_t index, uint8_t count, const char *data, size_t size);
+        bool _writeDueReliableChunks(double now);
+        void _endDatagram(double now);
+
+        /**
+         * @brief Sends as many datagrams as needed to get all due reliable fragments out. Returns true if anything was sent.
+         */
+        bool _sendDueReliables(double now);
+
+        /**
+         * @brief Updates the received sequence bookkeeping. Returns false if the datagram is a duplicate or too old to be acknowledged.
+         */
+        bool _registerReceivedSequence(uint16_t sequence);
+
+        void _processAcks(uint16_t ack, uint32_t ackBits, double now);
+        void _ackDatagram(uint16_t sequence, double now);
+        void _receiveReliableFragment(uint16_t id, bool isLastFragment, const char *data, size_t size);
+        void _receiveUnreliableFragment(uint16_t groupId, uint8_t index, uint8_t count, const char *data, size_t size);
+
+        DatagramCallback mDatagramCallback;
+        MessageCallback mMessageCallback;
+
+        size_t mMtu;
+        bool mClosed;
+
+        // outgoing datagrams
+        uint16_t mLocalSequence;
+        double mLastSendTime;
+        std::vector<SentDatagram> mSentDatagrams; // ring indexed by sequence
+        std::vector<char> mDatagram;
+        std::vector<uint16_t> mDatagramReliableIds;
+
+        // incoming datagrams
+        bool mHasReceived;
+        uint16_t mRemoteSequence;
+        uint32_t mReceivedBits; // bit n set means mRemoteSequence-n-1 was received
+        bool mAckPending;
+
+        double mRoundTripTime;
+
+        // reliable channel. the outgoing queue is ordered by ID, starting at the oldest unacknowledged fragment
+        uint16_t mNextReliableId;
+        std::deque<OutgoingReliable> mOutgoingReliable;
+        uint16_t mNextExpectedReliableId;
+        std::vector<IncomingReliable> mIncomingReliable; // ring indexed by ID
+        std::vector<char> mReliableReassemblyBuffer;
+
+        // unreliable channel
+        uint16_t mNextFragmentGroupId;
+        std::deque<FragmentGroup> mFragmentGroups;
+        std::vector<char> mUnreliableReassemblyBuffer;
+
+        size_t mSentDatagramCount;
+        size_t mReceivedDatagramCount;
+        size_t mResentFragmentCount;
+
+    };
+
+}
+
+#endif
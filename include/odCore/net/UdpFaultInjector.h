@@ -0,0 +1,66 @@
+
+#ifndef INCLUDE_ODCORE_NET_UDPFAULTINJECTOR_H_
+#define INCLUDE_ODCORE_NET_UDPFAULTINJECTOR_H_
+
+#include <functional>
+#include <random>
+#include <vector>
+
+#include <odCore/net/Socket.h>
+
+namespace odNet
+{
+
+    /**
+     * @brief Simulates an unreliable network by dropping, duplicating and reordering outgoing datagrams.
+     *
+     * Sits between a transport and it's socket, so the full UDP path can be exercised over loopback with
+     * reproducible faults. The same seed and the same sequence of datagrams always give the same faults.
+     */
+    class UdpFaultInjector
+    {
+    public:
+
+        using OutputCallback = std::function<void(const UdpEndpoint &to, const char *data, size_t size)>;
+
+        explicit UdpFaultInjector(uint32_t seed);
+
+        inline void setDropRate(double rate) { mDropRate = rate; }
+        inline void setDuplicateRate(double rate) { mDuplicateRate = rate; }
+
+        /**
+         * @brief Sets the probability of a datagram being held back and sent after the next one.
+         */
+        inline void setReorderRate(double rate) { mReorderRate = rate; }
+
+        /**
+         * @brief Passes the datagram to the output zero or more times, possibly after the ones that follow it.
+         */
+        void process(const UdpEndpoint &to, const char *data, size_t size, const OutputCallback &output);
+
+        /**
+         * @brief Sends a datagram that is being held back for reordering, if any. Call this regularly so it isn't held forever.
+         */
+        void releaseHeld(const OutputCallback &output);
+
+
+    private:
+
+        bool _roll(double rate);
+
+        std::minstd_rand mRandom;
+        std::uniform_real_distribution<double> mDistribution;
+
+        double mDropRate;
+        double mDuplicateRate;
+        double mReorderRate;
+
+        bool mHasHeld;
+        UdpEndpoint mHeldEndpoint;
+        std::vector<char> mHeldDatagram;
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,171 @@
+
+#ifndef INCLUDE_ODCORE_NET_UDPTRANSPORT_H_
+#define INCLUDE_ODCORE_NET_UDPTRANSPORT_H_
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <odCore/net/PacketBuilder.h>
+#include <odCore/net/PacketParser.h>
+#include <odCore/net/Socket.h>
+#include <odCore/net/UdpConnection.h>
+#include <odCore/net/UdpFaultInjector.h>
+
+namespace odNet
+{
+    class DownlinkConnector;
+    class UplinkConnector;
+
+    /**
+     * @brief Connects clients and servers over UDP.
+     *
+     * Like the LocalTunnel, this sits behind the DownlinkConnector/UplinkConnector interfaces: packets built from
+     * the connector calls are sent over a UdpConnection per remote, and received packets are parsed into calls of
+     * the output connectors. Packets the PacketBuilder marks as reliable (events, messages, level loading) use the
+     * reliable, ordered channel. Everything else (snapshots, acknowledgements) goes over the unreliable one.
+     *
+     * A network thread receives datagrams and drives resends. Output connectors are called from that thread, so
+     * they must be synchronized. The queued connectors used by Client and Server are.
+     *
+     * Before a listening transport talks to a new remote, the remote has to complete a handshake: It asks for a
+     * challenge, and we answer with a cookie derived from it's address and a secret. Only once the remote echoes
+     * the cookie back do we create a connection and call the accept callback. We keep no state for remotes that
+     * didn't complete the handshake, so spoofed or abandoned connection attempts cost us nothing. Accepted remotes
+     * we don't hear from for LINK_TIMEOUT seconds are torn down, as are links whose connection closed itself because
+     * the remote exceeded one of it's limits.
+     */
+    class UdpTransport
+    {
+    public:
+
+        /**
+         * @brief Called when a new remote connects to a listening transport.
+         *
+         * Receives the downlink input for the new remote (to be assigned to the server's client) and returns the
+         * uplink connector which receives everything that remote sends, or nullptr to ignore the remote.
+         */
+        using AcceptCallback = std::function<std::shared_ptr<UplinkConnector>(const UdpEndpoint &remote, std::shared_ptr<DownlinkConnector> downlinkInput)>;
+
+        /**
+         * @brief Called when the connection to an accepted remote timed out or closed and was torn down.
+         *
+         * The downlink input handed to the accept callback stays valid, but everything sent to it is dropped.
+         */
+        using DisconnectCallback = std::function<void(const UdpEndpoint &remote)>;
+
+        static constexpr double UPDATE_INTERVAL = 0.005; ///< How often the network thread drives resends, in seconds
+        static constexpr double HANDSHAKE_INTERVAL = 0.25; ///< How often connecting transports repeat handshake datagrams, in seconds
+        static constexpr double LINK_TIMEOUT = 10.0; ///< Accepted remotes that are silent for this long are torn down, in seconds
+
+        static constexpr uint16_t HANDSHAKE_PROTOCOL_ID = 0x4448; // "DH"
+        static constexpr size_t HANDSHAKE_DATAGRAM_SIZE = 11; // protocol ID, type, cookie. all types have the same size, so replies can't amplify
+
+        UdpTransport();
+        UdpTransport(const UdpTransport &t) = delete;
+        ~UdpTransport();
+
+        /**
+         * @brief Sets the max. datagram size for connections created from now on.
+         */
+        inline void setMtu(size_t mtu) { mMtu = mtu; }
+
+        /**
+         * @brief Routes all outgoing datagrams through the given fault injector. Must be called before listen() or connect().
+         */
+        void setFaultInjector(std::unique_ptr<UdpFaultInjector> injector);
+
+        /**
+         * @brief Server side: binds to the given local address and accepts remotes that complete the handshake.
+         *
+         * Both callbacks are called from the network thread.
+         */
+        void listen(const IpV4Address &address, uint16_t port, const AcceptCallback &acceptCallback, const DisconnectCallback &disconnectCallback = nullptr);
+
+        /**
+         * @brief Client side: binds to an ephemeral port and connects to a listening transport.
+         *
+         * Returns right away. The handshake is repeated until the server answers, and anything sent before that is
+         * only delivered if it was sent reliably.
+         *
+         * @param downlinkOutput  Receives everything the server sends.
+         * @return The uplink connector the client should send to.
+         */
+        std::shared_ptr<UplinkConnector> connect(const IpV4Address &address, uint16_t port, std::shared_ptr<DownlinkConnector> downlinkOutput);
+
+        inline uint16_t getLocalPort() const { return mSocket.getLocalPort(); }
+
+        /**
+         * @brief Returns the number of remotes this transport has connections to.
+         */
+        size_t getConnectionCount();
+
+
+    private:
+
+        enum class HandshakeType : uint8_t
+        {
+            REQUEST,
+            CHALLENGE,
+            RESPONSE
+        };
+
+        struct Link
+        {
+            UdpEndpoint remote;
+
+            // only touched by the network thread
+            bool accepted; // created by a listening transport. only these time out
+            bool established; // the remote completed the handshake. for connecting transports, when the server first talked to us
+            double lastReceiveTime;
+            double lastHandshakeSendTime;
+            uint64_t cookie; // connecting transports: the cookie the server challenged us with, 0 if we have none yet
+
+            std::mutex mutex; // guards everything below
+            std::unique_ptr<UdpConnection> connection;
+            std::shared_ptr<PacketBuilder> packetBuilder;
+            std::unique_ptr<PacketParser> packetParser;
+        };
+
+        double _now() const;
+        Link &_createLink(const UdpEndpoint &remote, bool accepted);
+        void _connectLink(Link &link, std::shared_ptr<DownlinkConnector> downlinkOutput, std::shared_ptr<UplinkConnector> uplinkOutput);
+        uint64_t _getCookie(const UdpEndpoint &remote) const;
+        void _sendHandshake(const UdpEndpoint &to, HandshakeType type, uint64_t cookie);
+        void _receiveHandshake(const UdpEndpoint &from, Link *link, const char *data, size_t size, double now);
+        void _sendDatagram(const UdpEndpoint &to, const char *data, size_t size);
+        void _startNetworkThread();
+        void _networkThreadFunc();
+        void _updateLinks(double now);
+
+        UdpSocket mSocket;
+        size_t mMtu;
+        std::chrono::steady_clock::time_point mStartTime;
+        uint64_t mHandshakeSecret;
+
+        AcceptCallback mAcceptCallback;
+        DisconnectCallback mDisconnectCallback;
+
+        // packet builders only hold weak references to their link, so links can be torn down while they are in use
+        std::unordered_map<UdpEndpoint, std::shared_ptr<Link>, UdpEndpoint::Hash> mLinks;
+        std::mutex mLinksMutex;
+        std::vector<Link*> mTempLinkUpdateList;
+        std::vector<std::shared_ptr<Link>> mTempRemovedLinks;
+
+        std::unique_ptr<UdpFaultInjector> mFaultInjector;
+        std::mutex mFaultInjectorMutex;
+
+        std::thread mNetworkThread;
+        std::atomic_bool mTerminateNetworkThread;
+        std::vector<char> mReceiveBuffer;
+
+    };
+
+}
+
+#endif
@@ -39,6 +39,13 @@ namespace odNet
 
         virtual void acknowledgeSnapshot(odState::TickNumber tick) = 0;
 
+        /**
+         * @brief Passes on anything this connector buffered. Called by the client once per frame.
+         *
+         * Does nothing by default.
+         */
+        virtual void flush() {}
+
     };
 
 }
@@ -22,11 +22,26 @@ namespace odPhysics
 
 	class PhysicsSystem;
 	class ObjectHandle;
-
+	struct SweepTestResult;
+
+	/**
+	 * @brief Kinematic controller that moves a character through the world using capsule sweeps.
+	 *
+	 * The character is an upright capsule standing on the object's position. Movement passed to moveRelative() is
+	 * collected and applied on the next update(): The character steps up, moves horizontally while sliding along
+	 * anything it hits, then steps back down, snapping to ground that is at most a step below it. Ground steeper than
+	 * the slope limit can't be stood on and is slid down instead. Characters without ground below them fall.
+	 *
+	 * An update performs a small, bounded number of sweeps and never allocates.
+	 */
 	class CharacterController : public odAnim::BoneAccumulator
 	{
 	public:
 
+		/**
+		 * @param handle  The character's own physics handle, which is ignored by sweeps. May be nullptr
+		 * @param height  Total height of the character, including both caps of the capsule
+		 */
 		CharacterController(PhysicsSystem &physicsSystem, std::shared_ptr<ObjectHandle> handle, od::LevelObject &charObject, float radius, float height);
 
 		// implement odAnim::BoneAccumulator
@@ -34,21 +49,28 @@ namespace odPhysics
 
 		void update(float relTime);
 
+		inline bool isOnGround() const { return !mIsFalling; }
+
 
 	private:
 
-		bool _step(float stepHeight); // returns true if object was hit during stepping
+		/**
+		 * @brief Sweeps the character from feet position from towards to, stopping a small distance before any hit.
+		 *
+		 * @param reachedOut  Where the character could move. May alias from
+		 * @return true if something was hit. hitOut is only written in that case
+		 */
+		bool _sweep(const glm::vec3 &from, const glm::vec3 &to, glm::vec3 &reachedOut, SweepTestResult &hitOut);
+
+		bool _isWalkable(const glm::vec3 &normal) const;
 
         PhysicsSystem &mPhysicsSystem;
 		od::LevelObject &mCharObject;
 		std::shared_ptr<ObjectHandle> mObjectHandle;
-		glm::vec3 mCurrentPosition;
+		float mRadius;
+		float mHeight;
 		glm::vec3 mUp;
-		glm::vec3 mRelativeLowPoint;
-		glm::vec3 mRelativeHighPoint;
-		glm::vec3 mVelocity;
-		glm::vec3 mDesiredDirection;
-		glm::vec3 mDesiredPosition;
+		glm::vec3 mDesiredMove;
 
 		bool mIsFalling;
 		float mFallingVelocity;
@@ -13,12 +13,17 @@
 #include <glm/vec3.hpp>
 #include <glm/gtc/quaternion.hpp>
 
+#include <odCore/BoundingSphere.h>
+
 namespace od
 {
     class LevelObject;
     class Layer;
     class Light;
     class LightCallback;
+
+    template <typename T>
+    class SpatialHashGrid;
 }
 
 namespace odPhysics
@@ -116,10 +121,20 @@ namespace odPhysics
     };
 
 
-    class LightHandle : public Handle
+    /**
+     * @brief A light's sphere of effect.
+     *
+     * Lights are only ever tested against spheres and boxes, so they don't need to be part of the physics
+     * backend's collision world. Instead, the physics system keeps them in a grid of their own. Moving a
+     * light just updates it's entry there.
+     */
+    class LightHandle final : public Handle
     {
     public:
 
+        LightHandle(const od::Light &light, od::SpatialHashGrid<LightHandle*> &lightGrid);
+        ~LightHandle();
+
         virtual LightHandle *asLightHandle() override;
         virtual Type getHandleType() override;
 
@@ -134,7 +149,7 @@ namespace odPhysics
          *
          * @param modifyLight  If true, the underlying light source will also adopt this value.
          */
-        virtual void setRadius(float radius, bool modifyLight = true) = 0;
+        void setRadius(float radius, bool modifyLight = true);
 
         /**
          * @brief Sets the position/center of this light.
@@ -147,7 +162,7 @@ namespace odPhysics
          *
          * @param modifyLight  If true, the underlying light source will also adopt this value.
          */
-        virtual void setPosition(const glm::vec3 &pos, bool modifyLight = true) = 0;
+        void setPosition(const glm::vec3 &pos, bool modifyLight = true);
 
         /**
          * @brief Returns the internal light source that determines how this LightHandle will be rendered.
@@ -155,7 +170,12 @@ namespace odPhysics
          * Changes of the returned reference's properties will be reflected by the renderer. Note that
          * changing the returned object's position or radius will *not* cause light affection to be updated.
          */
-        virtual std::shared_ptr<od::Light> getLight() = 0;
+        inline std::shared_ptr<od::Light> getLight() { return mLight; }
+
+        /**
+         * @brief Returns the sphere in which this light affects objects.
+         */
+        inline const od::BoundingSphere &getBoundingSphere() const { return mBoundingSphere; }
 
         /**
          * @brief Registers the passed handle as being affected by this light.
@@ -173,6 +193,12 @@ namespace odPhysics
 
     private:
 
+        void _updateGridEntry();
+
+        std::shared_ptr<od::Light> mLight;
+        od::SpatialHashGrid<LightHandle*> &mLightGrid;
+        od::BoundingSphere mBoundingSphere;
+
         std::vector<std::weak_ptr<Handle>> mAffectedHandles;
 
     };
@@ -14,6 +14,7 @@
 #include <glm/vec3.hpp>
 
 #include <odCore/Light.h>
+#include <odCore/SpatialHashGrid.h>
 
 #include <odCore/physics/Handles.h>
 
@@ -22,6 +23,7 @@ namespace od
     class LevelObject;
     class Layer;
     class Light;
+    class ThreadPool;
 }
 
 namespace odDb
@@ -64,6 +66,45 @@ namespace odPhysics
     typedef std::vector<RayTestResult> RayTestResultVector;
 
 
+    /**
+     * @brief One ray of a batched closest hit test.
+     */
+    struct RayQuery
+    {
+        glm::vec3 from;
+        glm::vec3 to;
+        PhysicsTypeMasks::Mask typeMask;
+        Handle *exclude; ///< Handle to ignore. May be nullptr
+    };
+
+    /**
+     * @brief Closest hit of a RayQuery.
+     *
+     * Unlike RayTestResult, this does not keep the hit handle alive. It is only valid as long as the caller
+     * makes sure the handle is not destroyed.
+     */
+    struct RayQueryResult
+    {
+        bool hasHit;
+        float hitFraction;
+        glm::vec3 hitPoint;
+        glm::vec3 hitNormal;
+        Handle *handle;
+    };
+
+
+    /**
+     * @brief Closest hit of a sweep test. Like RayQueryResult, this does not keep the hit handle alive.
+     */
+    struct SweepTestResult
+    {
+        float hitFraction;
+        glm::vec3 hitPoint;
+        glm::vec3 hitNormal;
+        Handle *handle;
+    };
+
+
     struct ContactTestResult
     {
         std::shared_ptr<Handle> handle;
@@ -79,13 +120,43 @@ namespace odPhysics
     {
     public:
 
+        /// Edge length of the cells of the light grid, in lu. Most lights cover only a few of them
+        static constexpr float LIGHT_GRID_CELL_SIZE = 8.0f;
+
+        PhysicsSystem();
         virtual ~PhysicsSystem() = default;
 
         virtual size_t rayTest(const glm::vec3 &from, const glm::vec3 &to, PhysicsTypeMasks::Mask typeMask, RayTestResultVector &resultsOut) = 0;
         virtual bool rayTestClosest(const glm::vec3 &from, const glm::vec3 &to, PhysicsTypeMasks::Mask typeMask, std::shared_ptr<Handle> exclude, RayTestResult &resultOut) = 0;
 
+        /**
+         * @brief Performs a closest hit test for each of the count rays in queries, writing results to the same index in resultsOut.
+         *
+         * This is much cheaper than calling rayTestClosest() for each ray, as rays share a traversal of the broadphase
+         * and no handles are locked. If pool is non-null, large batches are split across it's workers. Nothing may be
+         * added to, removed from or moved within the physics system during the call.
+         */
+        virtual void rayTestClosestBatch(const RayQuery *queries, RayQueryResult *resultsOut, size_t count, od::ThreadPool *pool = nullptr) = 0;
+
+        /**
+         * @brief Sweeps an upright capsule from one center position to another and finds the closest hit.
+         *
+         * height is the total height of the capsule, including both caps. Hits on surfaces the capsule is moving away
+         * from are ignored, so a capsule resting on or touching something can always leave it. This never allocates,
+         * so it is suitable for calling many times per update.
+         *
+         * @param exclude  Handle to ignore. May be nullptr
+         * @return true if something was hit. resultOut is only written in that case
+         */
+        virtual bool capsuleSweepTestClosest(const glm::vec3 &from, const glm::vec3 &to, float radius, float height, PhysicsTypeMasks::Mask typeMask, Handle *exclude, SweepTestResult &resultOut) = 0;
+
         virtual size_t contactTest(std::shared_ptr<Handle> handle, odPhysics::PhysicsTypeMasks::Mask typeMask, ContactTestResultVector &resultsOut) = 0;
 
+        /**
+         * @brief Checks whether the two handles touch or penetrate. Cheaper than contactTest() as the broadphase is not involved.
+         */
+        virtual bool contactPairTest(Handle &a, Handle &b) = 0;
+
         /**
          * @brief Finds all collision objects within a sphere of given radius around a given point.
          *
@@ -95,7 +166,11 @@ namespace odPhysics
 
         virtual std::shared_ptr<ObjectHandle> createObjectHandle(od::LevelObject &obj, bool isDetector) = 0;
         virtual std::shared_ptr<LayerHandle>  createLayerHandle(od::Layer &layer) = 0;
-        virtual std::shared_ptr<LightHandle>  createLightHandle(const od::Light &light) = 0;
+
+        /**
+         * @brief Creates a handle for dispatching the given light. Lights are kept separate from the backend's collision world.
+         */
+        std::shared_ptr<LightHandle> createLightHandle(const od::Light &light);
 
         virtual std::shared_ptr<ModelShape> createModelShape(std::shared_ptr<odDb::Model> model) = 0;
 
@@ -110,6 +185,9 @@ namespace odPhysics
          * If handle is a LightHandle, this will search for layers and objects that intersect the light and
          * update them accordingly. If handle is something different, this will search all lights intersecting
          * the handle and update the handle accordingly.
+         *
+         * The latter only looks up the light grid, comparing light spheres with an object's bounding sphere or a
+         * layer's bounding box, and never touches the collision world.
          */
         void dispatchLighting(std::shared_ptr<Handle> handle);
 
@@ -118,6 +196,12 @@ namespace odPhysics
         inline void toggleDebugDrawing() { setEnableDebugDrawing(!isDebugDrawingEnabled()); }
 
         virtual void update(float relTime) = 0;
+
+
+    private:
+
+        od::SpatialHashGrid<LightHandle*> mLightGrid;
+
     };
 
 }
@@ -0,0 +1,125 @@
+
+#ifndef INCLUDE_ODCORE_PHYSICS_TRIGGERMANAGER_H_
+#define INCLUDE_ODCORE_PHYSICS_TRIGGERMANAGER_H_
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <odCore/BoundingSphere.h>
+#include <odCore/IdTypes.h>
+#include <odCore/SpatialHashGrid.h>
+
+namespace od
+{
+    class LevelObject;
+}
+
+namespace odPhysics
+{
+    class PhysicsSystem;
+    class ObjectHandle;
+
+    class TriggerCallback
+    {
+    public:
+
+        virtual ~TriggerCallback() = default;
+
+        virtual void onActivatorEntered(od::LevelObjectId activatorId) = 0;
+        virtual void onActivatorLeft(od::LevelObjectId activatorId) = 0;
+
+    };
+
+
+    /**
+     * @brief Tracks which activators (usually players) are inside which trigger volumes (like detectors).
+     *
+     * Triggers are kept in a spatial hash grid by their bounding sphere. Each update, every activator only looks at
+     * the triggers in the cells it's bounding sphere touches, and only pairs whose bounding spheres intersect get an
+     * exact contact test in the physics system. Thus, the cost grows with the number of activators and the triggers
+     * near them, not with the number of triggers in the level.
+     *
+     * Events are collected first and dispatched at the end of update(), so callbacks may freely add or remove triggers
+     * and activators. Removing a trigger drops all it's events silently. Removing an activator makes it leave all
+     * triggers it was in, which is reported during the next update().
+     */
+    class TriggerManager
+    {
+    public:
+
+        /// Edge length of the cells of the trigger grid, in lu
+        static constexpr float TRIGGER_GRID_CELL_SIZE = 16.0f;
+
+        explicit TriggerManager(PhysicsSystem &physicsSystem);
+        TriggerManager(const TriggerManager &tm) = delete;
+
+        /**
+         * @brief Registers obj as a trigger volume.
+         *
+         * @param handle    Handle used for exact tests. If nullptr, the trigger's bounding sphere is used as it's volume
+         * @param callback  Receives enter/leave events. Must stay valid until the trigger is removed
+         */
+        void addTrigger(od::LevelObject &obj, std::shared_ptr<ObjectHandle> handle, TriggerCallback &callback);
+        void removeTrigger(od::LevelObject &obj);
+
+        /**
+         * @brief Registers obj as something that can set off triggers. Exact tests use the object's own physics handle.
+         */
+        void addActivator(od::LevelObject &obj);
+        void removeActivator(od::LevelObject &obj);
+
+        /**
+         * @brief Returns the number of activators that were inside the trigger registered for obj as of the last update.
+         */
+        size_t getActivatorCountInside(od::LevelObject &obj) const;
+
+        void update();
+
+
+    private:
+
+        struct Trigger
+        {
+            od::LevelObject *obj;
+            std::shared_ptr<ObjectHandle> handle;
+            TriggerCallback *callback;
+            od::BoundingSphere sphere;
+        };
+
+        struct Event
+        {
+            od::LevelObjectId triggerId;
+            od::LevelObjectId activatorId;
+            bool entered;
+        };
+
+        // overlaps are stored as trigger ID in the upper and activator ID in the lower half, so sorting groups them by trigger
+        static inline uint64_t _makeOverlapKey(od::LevelObjectId triggerId, od::LevelObjectId activatorId)
+        {
+            return (static_cast<uint64_t>(triggerId) << 32) | activatorId;
+        }
+
+        static inline od::LevelObjectId _getTriggerId(uint64_t key) { return static_cast<od::LevelObjectId>(key >> 32); }
+        static inline od::LevelObjectId _getActivatorId(uint64_t key) { return static_cast<od::LevelObjectId>(key & 0xffffffff); }
+
+        bool _testOverlap(Trigger &trigger, od::LevelObject &activator, const od::BoundingSphere &activatorSphere);
+
+        PhysicsSystem &mPhysicsSystem;
+
+        std::unordered_map<od::LevelObjectId, Trigger> mTriggers; // node based, so the grid can point to triggers
+        std::unordered_map<od::LevelObjectId, od::LevelObject*> mActivators;
+        od::SpatialHashGrid<Trigger*> mTriggerGrid;
+
+        // sorted. reused between updates so steady state needs no allocations
+        std::vector<uint64_t> mOverlaps;
+        std::vector<uint64_t> mNewOverlaps;
+
+        std::vector<Event> mPendingEvents;
+        std::vector<Event> mDispatchedEvents;
+
+    };
+
+}
+
+#endif /* INCLUDE_ODCORE_PHYSICS_TRIGGERMANAGER_H_ */
@@ -68,6 +68,45 @@ namespace odBulletPhysics
     };
 
 
+    /**
+     * @brief Closest hit callback for one ray of a batch. Reports hits without locking their handles.
+     */
+    class BatchRayCallback final : public btCollisionWorld::RayResultCallback
+    {
+    public:
+
+        BatchRayCallback(const btVector3 &start, const btVector3 &end, const odPhysics::RayQuery &query, odPhysics::RayQueryResult &result);
+
+        virtual btScalar addSingleResult(btCollisionWorld::LocalRayResult& rayResult, bool normalInWorldSpace) override;
+
+
+    private:
+
+        odPhysics::RayQueryResult &mResult;
+        btVector3 mStart;
+        btVector3 mEnd;
+        odPhysics::Handle *mExclude;
+    };
+
+
+    /**
+     * @brief Closest hit callback for sweep tests. Ignores surfaces the swept shape is moving away from.
+     */
+    class ClosestSweepCallback final : public btCollisionWorld::ClosestConvexResultCallback
+    {
+    public:
+
+        ClosestSweepCallback(const btVector3 &from, const btVector3 &to, odPhysics::PhysicsTypeMasks::Mask mask, odPhysics::Handle *exclude);
+
+        virtual btScalar addSingleResult(btCollisionWorld::LocalConvexResult& convexResult, bool normalInWorldSpace) override;
+
+
+    private:
+
+        odPhysics::Handle *mExclude;
+    };
+
+
     class ContactResultCallback final : public btCollisionWorld::ContactResultCallback
     {
     public:
@@ -88,6 +127,26 @@ namespace odBulletPhysics
         const btCollisionObject* mLastObject;
     };
 
+
+    /**
+     * @brief Contact callback for a pair test. Only records whether any contact point had the objects touch or penetrate.
+     */
+    class PairContactCallback final : public btCollisionWorld::ContactResultCallback
+    {
+    public:
+
+        PairContactCallback();
+
+        inline bool hasContact() const { return mHasContact; }
+
+        virtual btScalar addSingleResult(btManifoldPoint& cp, const btCollisionObjectWrapper* colObj0Wrap, int partId0, int index0, const btCollisionObjectWrapper* colObj1Wrap, int partId1, int index1) override;
+
+
+    private:
+
+        bool mHasContact;
+    };
+
 }
 
 
@@ -48,14 +48,17 @@ namespace odBulletPhysics
 
         virtual size_t rayTest(const glm::vec3 &from, const glm::vec3 &to, odPhysics::PhysicsTypeMasks::Mask typeMask, odPhysics::RayTestResultVector &resultsOut) override;
         virtual bool rayTestClosest(const glm::vec3 &from, const glm::vec3 &to, odPhysics::PhysicsTypeMasks::Mask typeMask, std::shared_ptr<odPhysics::Handle> exclude, odPhysics::RayTestResult &resultOut) override;
+        virtual void rayTestClosestBatch(const odPhysics::RayQuery *queries, odPhysics::RayQueryResult *resultsOut, size_t count, od::ThreadPool *pool) override;
+
+        virtual bool capsuleSweepTestClosest(const glm::vec3 &from, const glm::vec3 &to, float radius, float height, odPhysics::PhysicsTypeMasks::Mask typeMask, odPhysics::Handle *exclude, odPhysics::SweepTestResult &resultOut) override;
 
         virtual size_t contactTest(std::shared_ptr<odPhysics::Handle> handle, odPhysics::PhysicsTypeMasks::Mask typeMask, odPhysics::ContactTestResultVector &resultsOut) override;
+        virtual bool contactPairTest(odPhysics::Handle &a, odPhysics::Handle &b) override;
 
         virtual void sphereTest(const glm::vec3 &position, float radius, odPhysics::PhysicsTypeMasks::Mask typeMask, odPhysics::ContactTestResultVector &resultsOut) override;
 
         virtual std::shared_ptr<odPhysics::ObjectHandle> createObjectHandle(od::LevelObject &obj, bool isDetector) override;
         virtual std::shared_ptr<odPhysics::LayerHandle>  createLayerHandle(od::Layer &layer) override;
-        virtual std::shared_ptr<odPhysics::LightHandle>  createLightHandle(const od::Light &light) override;
 
         virtual std::shared_ptr<odPhysics::ModelShape> createModelShape(std::shared_ptr<odDb::Model> model) override;
 
@@ -67,6 +70,8 @@ namespace odBulletPhysics
 
     private:
 
+        btCollisionObject *_getBulletObject(odPhysics::Handle &handle);
+
         // order is important since bullet never takes ownership!
         //  mCollisionWorld needs to be initialized last and destroyed first
         std::unique_ptr<btBroadphaseInterface> mBroadphase;
@@ -12,7 +12,6 @@
 
 #include <BulletCollision/CollisionDispatch/btCollisionWorld.h>
 #include <BulletCollision/CollisionDispatch/btCollisionObject.h>
-#include <BulletCollision/CollisionShapes/btTriangleMesh.h>
 #include <BulletCollision/CollisionShapes/btCollisionShape.h>
 
 #include <odCore/physics/Handles.h>
@@ -39,12 +38,9 @@ namespace odBulletPhysics
 
     private:
 
-        void _buildCollisionShape();
-
         od::Layer &mLayer;
         btCollisionWorld *mCollisionWorld;
 
-        std::unique_ptr<btTriangleMesh> mTriMesh;
         std::unique_ptr<btCollisionShape> mShape;
         std::unique_ptr<btCollisionObject> mCollisionObject;
     };
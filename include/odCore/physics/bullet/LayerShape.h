@@ -0,0 +1,75 @@
+
+#ifndef INCLUDE_ODCORE_PHYSICS_BULLET_LAYERSHAPE_H_
+#define INCLUDE_ODCORE_PHYSICS_BULLET_LAYERSHAPE_H_
+
+#include <vector>
+
+#include <BulletCollision/CollisionShapes/btConcaveShape.h>
+
+#include <odCore/Layer.h>
+
+class btTriangleRaycastCallback;
+
+namespace odBulletPhysics
+{
+
+    /**
+     * @brief A concave shape that collides directly with a layer's height grid.
+     *
+     * Unlike a btBvhTriangleMeshShape, this needs no copy of the layer's vertices and no acceleration
+     * structure. Since the grid is regular, the cells overlapping an AABB can be found by simple division,
+     * and rays are walked through the grid cell by cell, so both are O(cells touched).
+     *
+     * Triangles are produced exactly like the layer's geometry, including the division direction of each cell.
+     * Triangles with a hole texture are skipped. Invisible triangles still collide.
+     *
+     * The shape references the layer's vertex and cell vectors, so the layer must not be reloaded while it exists.
+     */
+    class LayerShape final : public btConcaveShape
+    {
+    public:
+
+        explicit LayerShape(od::Layer &layer);
+
+        virtual void getAabb(const btTransform &t, btVector3 &aabbMin, btVector3 &aabbMax) const override;
+        virtual void processAllTriangles(btTriangleCallback *callback, const btVector3 &aabbMin, const btVector3 &aabbMax) const override;
+
+        virtual void setLocalScaling(const btVector3 &scaling) override;
+        virtual const btVector3 &getLocalScaling() const override;
+        virtual void calculateLocalInertia(btScalar mass, btVector3 &inertia) const override;
+
+        virtual const char *getName() const override;
+
+
+    private:
+
+        /**
+         * @brief Passes the non-hole triangles of the cell at (x, z) to callback if it's height range overlaps [minY, maxY].
+         */
+        void _processCell(btTriangleCallback *callback, uint32_t x, uint32_t z, btScalar minY, btScalar maxY) const;
+
+        /**
+         * @brief Walks the cells under the callback's ray in the order the ray passes them.
+         *
+         * Stops as soon as the callback has found a hit closer than the next cell.
+         */
+        void _processRay(btTriangleRaycastCallback *callback) const;
+
+        inline btVector3 _getVertex(uint32_t x, uint32_t z) const
+        {
+            return btVector3(x, mVertices[x + (mWidth+1)*z].heightOffsetLu, z) * mLocalScaling;
+        }
+
+        const std::vector<od::Layer::Vertex> &mVertices;
+        const std::vector<od::Layer::Cell> &mCells;
+        uint32_t mWidth;
+        uint32_t mHeight;
+
+        btScalar mMinHeight;
+        btScalar mMaxHeight;
+        btVector3 mLocalScaling;
+    };
+
+}
+
+#endif /* INCLUDE_ODCORE_PHYSICS_BULLET_LAYERSHAPE_H_ */
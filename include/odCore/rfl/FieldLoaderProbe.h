@@ -4,6 +4,8 @@
 
 #include <vector>
 
+#include <odCore/db/AssetRef.h>
+
 #include <odCore/rfl/FieldProbe.h>
 
 namespace od
@@ -36,6 +38,12 @@ namespace odRfl
             std::string fieldName;
         };
 
+        struct AssetRefEntry
+        {
+            uint32_t fieldType;
+            odDb::AssetRef ref;
+        };
+
         FieldLoaderProbe();
         FieldLoaderProbe(FieldLoaderProbe &&p) = default;
 
@@ -47,6 +55,13 @@ namespace odRfl
          */
         void loadFromRecord(od::DataReader &dr, RecordFormat format);
 
+        /**
+         * @brief Appends all non-null asset references stored in the record (including array elements) to \p refs.
+         *
+         * This works on the raw record, so unlike probing an RFL class, it works for unimplemented classes, too.
+         */
+        void getAssetRefs(std::vector<AssetRefEntry> &refs) const;
+
         FieldLoaderProbe &operator=(FieldLoaderProbe &&p) = default;
 
         /// Resets internal index counter so this builder can be used to build another class.
@@ -0,0 +1,126 @@
+
+#ifndef INCLUDE_ODCORE_STATE_CLIENTINTEREST_H_
+#define INCLUDE_ODCORE_STATE_CLIENTINTEREST_H_
+
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include <odCore/IdTypes.h>
+
+#include <odCore/state/Tick.h>
+
+namespace od
+{
+    class Layer;
+    class Level;
+    class LevelObject;
+}
+
+namespace odState
+{
+
+    /**
+     * @brief Decides which objects are sent to a single client, and in which order.
+     *
+     * An object is relevant to a client if it is associated with a layer in the PVS of the layer the client's
+     * viewpoint object is associated with, and not further away from the viewpoint than the relevance distance.
+     * Objects without an associated layer are only culled by distance. Without a viewpoint object, everything is
+     * relevant.
+     *
+     * Relevant objects with changes accumulate priority every snapshot, more so the closer they are to the
+     * viewpoint. If there are more of them than fit into a snapshot, the ones with the highest accumulated priority
+     * are sent and the others keep accumulating, so nothing is starved forever.
+     *
+     * Objects that had changes the client didn't receive (because they were culled or deferred) are stale: the
+     * client's copy at it's acknowledged tick can't be used for delta-encoding them. These are sent with their
+     * full states once they are relevant again, until the client acknowledges a snapshot containing them. Objects
+     * leaving relevance get one last update, then they keep their states on the client until they enter again.
+     */
+    class ClientInterest
+    {
+    public:
+
+        static constexpr float RELEVANCE_HYSTERESIS = 1.1f; ///< Relevant objects stay so up to this factor beyond the relevance distance
+        static constexpr float PRIORITY_FALLOFF_DISTANCE = 16.0f; ///< In length units. Objects this far from the viewpoint gain half the priority of ones right at it
+
+        ClientInterest(od::Level &level);
+
+        inline od::Level &getLevel() { return mLevel; }
+
+        void setViewpointObject(od::LevelObjectId id);
+        void clearViewpointObject();
+        inline bool hasViewpointObject() const { return mHasViewpoint; }
+
+        /**
+         * @brief Sets the maximum distance from the viewpoint at which objects are relevant, in length units. Infinite by default.
+         */
+        void setRelevanceDistance(float distance);
+        inline float getRelevanceDistance() const { return mRelevanceDistance; }
+
+        /**
+         * @brief Limits how many objects are sent per snapshot. 0 means unlimited (the default).
+         */
+        inline void setMaxObjectsPerSnapshot(size_t count) { mMaxObjectsPerSnapshot = count; }
+        inline size_t getMaxObjectsPerSnapshot() const { return mMaxObjectsPerSnapshot; }
+
+        /**
+         * @brief Picks the objects to send in a snapshot, highest priority first.
+         *
+         * @param referenceTick   The tick the snapshot is delta-encoded against, or INVALID_TICK if it is a full one.
+         * @param changedObjects  Objects that have changes to send. Stale objects are considered in addition to these.
+         * @param selected        Receives the objects to send. Candidates not selected are marked stale.
+         */
+        void selectObjects(TickNumber referenceTick, const std::unordered_set<od::LevelObjectId> &changedObjects, std::vector<od::LevelObjectId> &selected);
+
+        /**
+         * @brief Returns true if the given object must be sent with all it's states instead of delta-encoded.
+         */
+        bool needsFullStates(od::LevelObjectId id) const;
+
+        /**
+         * @brief Reports that the given object was sent in the snapshot with the given tick.
+         */
+        void objectSent(od::LevelObjectId id, TickNumber tick);
+
+
+    private:
+
+        struct Candidate
+        {
+            od::LevelObjectId id;
+            float priority;
+        };
+
+        void _updateViewpoint();
+        bool _isInPvs(od::Layer *layer) const;
+        bool _checkRelevance(od::LevelObjectId id, float &distance);
+
+        od::Level &mLevel;
+
+        bool mHasViewpoint;
+        od::LevelObjectId mViewpointId;
+        glm::vec3 mViewpointPosition;
+        od::Layer *mViewpointLayer;
+        std::unordered_set<od::LayerId> mPvsLayers;
+
+        float mRelevanceDistance;
+        size_t mMaxObjectsPerSnapshot;
+
+        std::unordered_set<od::LevelObjectId> mRelevantObjects;
+        std::unordered_map<od::LevelObjectId, float> mAccumulatedPriorities;
+
+        // stale objects, mapped to the tick of the latest snapshot that carried their full states (INVALID_TICK if none did yet)
+        std::unordered_map<od::LevelObjectId, TickNumber> mStaleObjects;
+
+        std::vector<Candidate> mCandidates;
+
+    };
+
+}
+
+#endif
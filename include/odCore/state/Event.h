@@ -15,6 +15,8 @@
 
 #include <variant>
 #include <memory>
+#include <optional>
+#include <type_traits>
 
 #include <glm/vec3.hpp>
 
@@ -61,6 +63,8 @@ namespace odState
 
         void serialize(od::DataWriter &dw) const;
 
+        static constexpr size_t SERIALIZED_SIZE = sizeof(odInput::ActionCode) + 1;
+
         odInput::ActionCode actionCode;
         bool keyDown;
     };
@@ -73,6 +77,9 @@ namespace odState
 
         void serialize(od::DataWriter &dw) const;
 
+        // object, animation, channel, speed, start and transition time, flags
+        static constexpr size_t SERIALIZED_SIZE = sizeof(od::LevelObjectId) + sizeof(od::RecordId) + sizeof(odDb::GlobalDatabaseIndex) + sizeof(int32_t) + 3*sizeof(float) + 1;
+
         od::LevelObjectId objectId;
         odDb::GlobalAssetRef animRef;
         std::shared_ptr<odDb::Animation> anim;
@@ -87,6 +94,8 @@ namespace odState
 
         void serialize(od::DataWriter &dw) const;
 
+        static constexpr size_t SERIALIZED_SIZE = 2*sizeof(od::LevelObjectId) + sizeof(std::underlying_type_t<od::Message>);
+
         od::LevelObjectId senderObjectId;
         od::LevelObjectId receiverObjectId;
         od::Message message;
@@ -109,7 +118,13 @@ namespace odState
     struct EventVariantSerializer
     {
         static void serialize(const EventVariant &e, od::DataWriter &dw);
-        static EventVariant deserialize(od::DataReader &dr);
+
+        /**
+         * @brief Reads an event written by serialize() from a memory-backed reader.
+         *
+         * Returns nothing if the event type is unknown or the reader holds too little data for it.
+         */
+        static std::optional<EventVariant> deserialize(od::DataReader &dr);
     };
 
 
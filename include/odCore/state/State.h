@@ -32,6 +32,10 @@ namespace odState
         constexpr Type NOT_SAVED     = (1 << 0);
         constexpr Type NOT_NETWORKED = (1 << 1);
         constexpr Type LERPED        = (1 << 2);
+
+        // quantization hints for the network encoding. see StateQuantization
+        constexpr Type POSITION      = (1 << 3); ///< A glm::vec3 world position, encoded relative to the level bounds
+        constexpr Type UNIT_INTERVAL = (1 << 4); ///< A float in the range [0, 1]
     }
 
 
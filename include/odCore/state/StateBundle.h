@@ -19,9 +19,16 @@ namespace odState
         virtual void assign(const StateBundleBase &bundle) = 0;
         virtual void merge(const StateBundleBase &lhs, const StateBundleBase &rhs) = 0;
         virtual void lerp(const StateBundleBase &lhs, const StateBundleBase &rhs, float delta) = 0;
+        virtual void extrapolate(const StateBundleBase &lhs, const StateBundleBase &rhs, float delta) = 0;
         virtual void deltaEncode(const StateBundleBase &reference, const StateBundleBase &toEncode) = 0;
         virtual void serialize(od::DataWriter &writer, StateSerializationPurpose purpose) const = 0;
         virtual void deserialize(od::DataReader &reader, StateSerializationPurpose purpose) = 0;
+
+        /**
+         * @brief Bit-packed, lossy serialization for sending states over the network. Only networked states are written.
+         */
+        virtual void serializeQuantized(od::BitWriter &writer, const StateQuantization &quantization) const = 0;
+        virtual void deserializeQuantized(od::BitReader &reader, const StateQuantization &quantization) = 0;
         virtual std::unique_ptr<StateBundleBase> clone() const = 0;
         virtual std::shared_ptr<StateBundleBase> cloneShared() const = 0;
     };
@@ -86,6 +93,25 @@ namespace odState
             lerp(lhs, rhs, delta);
         }
 
+        /**
+         * @brief Continues lerped states past rhs, assuming they keep changing at the rate they did from lhs to rhs.
+         *
+         * delta is relative to the interval between lhs and rhs, so 1.0 yields rhs. States that are not lerped are taken from rhs.
+         */
+        void extrapolate(const _Bundle &lhs, const _Bundle &rhs, float delta)
+        {
+            auto &result = static_cast<_Bundle&>(*this);
+            detail::StateExtrapolateOp<_Bundle> op(lhs, rhs, result, delta);
+            _Bundle::stateOp(op);
+        }
+
+        virtual void extrapolate(const StateBundleBase &left, const StateBundleBase &right, float delta) override final
+        {
+            auto &lhs = *(od::downcast<const _Bundle>(&left));
+            auto &rhs = *(od::downcast<const _Bundle>(&right));
+            extrapolate(lhs, rhs, delta);
+        }
+
         void deltaEncode(const _Bundle &reference, const _Bundle &toEncode)
         {
             auto &result = static_cast<_Bundle&>(*this);
@@ -114,6 +140,20 @@ namespace odState
             _Bundle::stateOp(op);
         }
 
+        virtual void serializeQuantized(od::BitWriter &writer, const StateQuantization &quantization) const override final
+        {
+            auto &bundle = static_cast<const _Bundle&>(*this);
+            detail::StateQuantizedSerializeOp<_Bundle> op(bundle, writer, quantization);
+            _Bundle::stateOp(op);
+        }
+
+        virtual void deserializeQuantized(od::BitReader &reader, const StateQuantization &quantization) override final
+        {
+            auto &bundle = static_cast<_Bundle&>(*this);
+            detail::StateQuantizedDeserializeOp<_Bundle> op(bundle, reader, quantization);
+            _Bundle::stateOp(op);
+        }
+
         virtual std::unique_ptr<StateBundleBase> clone() const override final
         {
             auto &thisBundle = static_cast<const _Bundle&>(*this);
@@ -12,16 +12,19 @@
 #ifndef INCLUDE_ODCORE_STATE_STATEBUNDLEDETAIL_H_
 #define INCLUDE_ODCORE_STATE_STATEBUNDLEDETAIL_H_
 
+#include <algorithm>
 #include <utility>
 #include <type_traits>
 
 #include <glm/vec3.hpp>
 #include <glm/gtc/quaternion.hpp>
 
+#include <odCore/BitStream.h>
 #include <odCore/Logger.h>
 #include <odCore/DataStream.h>
 
 #include <odCore/state/State.h>
+#include <odCore/state/StateQuantization.h>
 
 namespace odState
 {
@@ -181,6 +184,49 @@ namespace odState
         };
 
 
+        /**
+         * Like StateLerpOp, but meant for deltas >= 1: lerped states continue along the line from
+         * left to right, while all other states are taken from the right bundle.
+         */
+        template <typename _Bundle>
+        class StateExtrapolateOp
+        {
+        public:
+
+            StateExtrapolateOp(const _Bundle &left, const _Bundle &right, _Bundle &result, float delta)
+            : mLeftBundle(left)
+            , mRightBundle(right)
+            , mResultBundle(result)
+            , mDelta(delta)
+            {
+            }
+
+            template <typename _StateType>
+            StateExtrapolateOp &operator()(State<_StateType> _Bundle::* state, StateFlags::Type flags)
+            {
+                if((flags & StateFlags::LERPED) && (mLeftBundle.*state).hasValue() && (mRightBundle.*state).hasValue() && !(mRightBundle.*state).isJump())
+                {
+                    StateLerp<_StateType> lerper;
+                    mResultBundle.*state = lerper((mLeftBundle.*state).get(), (mRightBundle.*state).get(), mDelta);
+
+                }else
+                {
+                    mResultBundle.*state = (mRightBundle.*state);
+                }
+
+                return *this;
+            }
+
+
+        private:
+
+            const _Bundle &mLeftBundle;
+            const _Bundle &mRightBundle;
+            _Bundle &mResultBundle;
+            float mDelta;
+        };
+
+
         template <typename _Bundle>
         class StateDeltaEncOp
         {
@@ -394,6 +440,151 @@ namespace odState
             MaskType mJumpMask;
         };
 
+
+        // ========== quantized network serialization & deserialization ===========
+
+        template <typename _StateType>
+        void quantizedStateValueWrite(od::BitWriter &writer, const StateQuantization &quantization, StateFlags::Type flags, const _StateType &value)
+        {
+            static_assert(std::is_integral<_StateType>::value, "No quantized encoding for this state type. Add a specialization of quantizedStateValueWrite/Read");
+
+            using UnsignedType = typename std::make_unsigned<_StateType>::type;
+            uint64_t v = static_cast<UnsignedType>(value);
+            for(size_t bit = 0; bit < sizeof(_StateType)*8; bit += 32)
+            {
+                writer.write(static_cast<uint32_t>(v >> bit), std::min<size_t>(32, sizeof(_StateType)*8 - bit));
+            }
+        }
+
+        template <>
+        void quantizedStateValueWrite<bool>(od::BitWriter &writer, const StateQuantization &quantization, StateFlags::Type flags, const bool &value);
+
+        template <>
+        void quantizedStateValueWrite<float>(od::BitWriter &writer, const StateQuantization &quantization, StateFlags::Type flags, const float &value);
+
+        template <>
+        void quantizedStateValueWrite<glm::vec3>(od::BitWriter &writer, const StateQuantization &quantization, StateFlags::Type flags, const glm::vec3 &value);
+
+        template <>
+        void quantizedStateValueWrite<glm::quat>(od::BitWriter &writer, const StateQuantization &quantization, StateFlags::Type flags, const glm::quat &value);
+
+        template <typename _StateType>
+        void quantizedStateValueRead(od::BitReader &reader, const StateQuantization &quantization, StateFlags::Type flags, _StateType &value)
+        {
+            static_assert(std::is_integral<_StateType>::value, "No quantized encoding for this state type. Add a specialization of quantizedStateValueWrite/Read");
+
+            using UnsignedType = typename std::make_unsigned<_StateType>::type;
+            uint64_t v = 0;
+            for(size_t bit = 0; bit < sizeof(_StateType)*8; bit += 32)
+            {
+                v |= static_cast<uint64_t>(reader.read(std::min<size_t>(32, sizeof(_StateType)*8 - bit))) << bit;
+            }
+
+            value = static_cast<_StateType>(static_cast<UnsignedType>(v));
+        }
+
+        template <>
+        void quantizedStateValueRead<bool>(od::BitReader &reader, const StateQuantization &quantization, StateFlags::Type flags, bool &value);
+
+        template <>
+        void quantizedStateValueRead<float>(od::BitReader &reader, const StateQuantization &quantization, StateFlags::Type flags, float &value);
+
+        template <>
+        void quantizedStateValueRead<glm::vec3>(od::BitReader &reader, const StateQuantization &quantization, StateFlags::Type flags, glm::vec3 &value);
+
+        template <>
+        void quantizedStateValueRead<glm::quat>(od::BitReader &reader, const StateQuantization &quantization, StateFlags::Type flags, glm::quat &value);
+
+
+        /**
+         * Writes one change bit per networked state. States that have a value follow their change bit,
+         * preceded by a jump bit if they are lerped. States flagged NOT_NETWORKED take up no bits at all,
+         * since both ends know the bundle layout.
+         */
+        template <typename _Bundle>
+        class StateQuantizedSerializeOp
+        {
+        public:
+
+            StateQuantizedSerializeOp(const _Bundle &bundle, od::BitWriter &writer, const StateQuantization &quantization)
+            : mBundle(bundle)
+            , mWriter(writer)
+            , mQuantization(quantization)
+            {
+            }
+
+            template <typename _StateType>
+            StateQuantizedSerializeOp &operator()(State<_StateType> _Bundle::* state, StateFlags::Type flags)
+            {
+                if(!shouldBeIncludedInSerialization(StateSerializationPurpose::NETWORK, flags))
+                {
+                    return *this;
+                }
+
+                auto &s = mBundle.*state;
+                mWriter.writeBool(s.hasValue());
+
+                if(s.hasValue())
+                {
+                    if(flags & StateFlags::LERPED)
+                    {
+                        mWriter.writeBool(s.isJump());
+                    }
+
+                    quantizedStateValueWrite(mWriter, mQuantization, flags, s.get());
+                }
+
+                return *this;
+            }
+
+
+        private:
+
+            const _Bundle &mBundle;
+            od::BitWriter &mWriter;
+            const StateQuantization &mQuantization;
+        };
+
+
+        template <typename _Bundle>
+        class StateQuantizedDeserializeOp
+        {
+        public:
+
+            StateQuantizedDeserializeOp(_Bundle &bundle, od::BitReader &reader, const StateQuantization &quantization)
+            : mBundle(bundle)
+            , mReader(reader)
+            , mQuantization(quantization)
+            {
+            }
+
+            template <typename _StateType>
+            StateQuantizedDeserializeOp &operator()(State<_StateType> _Bundle::* state, StateFlags::Type flags)
+            {
+                if(!shouldBeIncludedInSerialization(StateSerializationPurpose::NETWORK, flags) || !mReader.readBool())
+                {
+                    return *this;
+                }
+
+                bool isJump = (flags & StateFlags::LERPED) && mReader.readBool();
+
+                _StateType value;
+                quantizedStateValueRead(mReader, mQuantization, flags, value);
+
+                (mBundle.*state) = value;
+                (mBundle.*state).setJump(isJump);
+
+                return *this;
+            }
+
+
+        private:
+
+            _Bundle &mBundle;
+            od::BitReader &mReader;
+            const StateQuantization &mQuantization;
+        };
+
     }
 
 }
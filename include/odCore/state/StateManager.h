@@ -7,8 +7,11 @@
 #ifndef INCLUDE_ODCORE_STATE_STATEMANAGER_H_
 #define INCLUDE_ODCORE_STATE_STATEMANAGER_H_
 
+#include <map>
 #include <unordered_map>
+#include <unordered_set>
 #include <deque>
+#include <vector>
 #include <glm/vec3.hpp>
 #include <glm/gtc/quaternion.hpp>
 
@@ -17,12 +20,14 @@
 
 #include <odCore/input/Keys.h>
 
+#include <odCore/state/StateQuantization.h>
 #include <odCore/state/Tick.h>
 
 namespace od
 {
     class Level;
     class LevelObject;
+    class ThreadPool;
 }
 
 namespace odNet
@@ -34,6 +39,8 @@ namespace odNet
 namespace odState
 {
 
+    class ClientInterest;
+
     class StateManager
     {
     public:
@@ -45,6 +52,32 @@ namespace odState
          */
         void setUplinkConnector(std::shared_ptr<odNet::UplinkConnector> c);
 
+        /**
+         * @brief Sets the quantization used to encode and decode extra states.
+         *
+         * Defaults to one derived from the level bounds. Clients should use the one the server sent them.
+         */
+        void setQuantization(const StateQuantization &quantization);
+        inline const StateQuantization &getQuantization() const { return mQuantization; }
+
+        /**
+         * @brief Sets how far apply() may extrapolate past the latest snapshot, in seconds. 0 disables extrapolation (the default).
+         *
+         * When the requested time is later than the latest snapshot (e.g. because snapshots are late or were dropped), lerped
+         * states are continued at the rate they changed between the two latest snapshots, for at most this long. Past that,
+         * objects stop where the extrapolation ended.
+         */
+        void setMaxExtrapolationTime(double t);
+        inline double getMaxExtrapolationTime() const { return mMaxExtrapolationTime; }
+
+        /**
+         * @brief Sets over how many seconds the error of extrapolated positions and rotations is faded out once the actual snapshot arrives.
+         *
+         * 0 makes objects snap to the correct states right away.
+         */
+        void setErrorCorrectionTime(double t);
+        inline double getErrorCorrectionTime() const { return mErrorCorrectionTime; }
+
         TickNumber getLatestTick();
 
         /**
@@ -68,6 +101,14 @@ namespace odState
          */
         void commit(double realtime);
 
+        /**
+         * @brief Applies the states at the given time to all objects, interpolating between snapshots.
+         *
+         * This is incremental: only objects that changed in any snapshot between the ones applied in the previous
+         * call and the ones applied now, or that had their states changed locally since then, are touched. All
+         * other objects still hold the values applied before. If the snapshots in question don't carry complete
+         * change information, everything is applied.
+         */
         void apply(double realtime);
 
         /**
@@ -82,9 +123,26 @@ namespace odState
          * snapshot. If the snapshot is no longer being held in memory, a full
          * snapshot will be sent as well.
          *
+         * If an interest is given, only the objects it selects are sent, and objects it considers stale are sent with
+         * their full states instead of delta-encoded. The change count sent with the snapshot only covers what was
+         * actually sent.
+         *
+         * Encodings are cached per (reference, tick) pair, so clients that acknowledged the same snapshot share the
+         * work of delta-encoding. Use prepareSnapshotEncodings() to fill the cache in parallel before sending to many
+         * clients.
+         *
          * @param referenceSnapshot  The tick number to be used for delta encoding (INVALID_TICK if no delta-encoding desired).
+         * @param interest           The client's interest, or nullptr to send every object.
+         */
+        void sendSnapshotToClient(TickNumber tickToSend, odNet::DownlinkConnector &c, TickNumber referenceSnapshot, ClientInterest *interest = nullptr);
+
+        /**
+         * @brief Encodes the snapshot with the given tick against each of the given reference snapshots, so sending it is cheap.
+         *
+         * Each distinct reference is encoded only once. If a pool is given, distinct references are encoded in
+         * parallel on it, otherwise on the calling thread. Nothing may modify the timeline while this runs.
          */
-        void sendSnapshotToClient(TickNumber tickToSend, odNet::DownlinkConnector &c, TickNumber referenceSnapshot);
+        void prepareSnapshotEncodings(TickNumber tickToSend, const std::vector<TickNumber> &referenceSnapshots, od::ThreadPool *pool);
 
 
     private:
@@ -96,6 +154,7 @@ namespace odState
             size_t countStatesWithValue() const;
             void merge(const CombinedStates &lhs, const CombinedStates &rhs);
             void lerp(const CombinedStates &lhs, const CombinedStates &rhs, float delta);
+            void extrapolate(const CombinedStates &lhs, const CombinedStates &rhs, float delta);
             void deltaEncode(const CombinedStates &reference, const CombinedStates &toEncode);
 
             void makeExtraStatesUnique();
@@ -106,14 +165,17 @@ namespace odState
         };
 
         using StatesMap = std::unordered_map<od::LevelObjectId, CombinedStates>;
+        using ObjectIdSet = std::unordered_set<od::LevelObjectId>;
 
         struct Snapshot
         {
             Snapshot(TickNumber t)
             : tick(t)
             , realtime(0.0)
+            , isFull(false)
             , targetDiscreteChangeCount(0)
             , confirmed(false)
+            , referenceSnapshot(INVALID_TICK)
             {
             }
 
@@ -121,10 +183,18 @@ namespace odState
             Snapshot(const Snapshot &s) = delete;
             Snapshot &operator=(Snapshot &&) = default;
 
+            /**
+             * For snapshots in the timeline, this only holds the objects that changed since the preceding
+             * snapshot, with their complete states. For incoming snapshots, these are the delta-encoded changes
+             * against the reference snapshot.
+             */
             StatesMap statesMap;
             TickNumber tick;
             double realtime;
 
+            // if true, statesMap lists every tracked object, so looking up states never has to go past this snapshot
+            bool isFull;
+
             // bookkeeping for incoming snapshots. unused otherwise
             size_t targetDiscreteChangeCount;
             bool confirmed;
@@ -133,41 +203,185 @@ namespace odState
 
         using SnapshotIterator = std::deque<Snapshot>::iterator;
 
+        struct EncodedObject
+        {
+            EncodedObject()
+            : basicChangeCount(0)
+            , extraChangeCount(0)
+            {
+            }
+
+            od::ObjectStates basicStates;
+            size_t basicChangeCount;
+            std::vector<char> extraStates; // bit-packed
+            size_t extraChangeCount;
+        };
+
+        /**
+         * A snapshot, encoded for sending against a given reference (or INVALID_TICK for a full snapshot). Only lists
+         * objects that have anything to send.
+         */
+        struct EncodedSnapshot
+        {
+            ObjectIdSet objects;
+            std::unordered_map<od::LevelObjectId, EncodedObject> encodedObjects;
+        };
+
+        using EncodingKey = std::pair<TickNumber, TickNumber>; // (reference tick, tick)
+
+        static constexpr size_t NO_SNAPSHOT = static_cast<size_t>(-1);
+
         /**
-         * @brief Searches for a snapshot with the given tick. Optionally creates one at the appropriate position.
+         * @brief Searches for an incoming snapshot with the given tick. Optionally creates one at the appropriate position.
          */
         SnapshotIterator _getSnapshot(TickNumber tick, std::deque<Snapshot> &snapshots, bool createIfNotFound);
         void _commitIncomingIfComplete(TickNumber tick, SnapshotIterator incomingSnapshot);
         void _panicIfStateUpdatesDisallowed();
 
+        // timeline access. indices are logical, with 0 being the oldest snapshot in the ring
+        inline Snapshot &_getTimelineSnapshot(size_t index) { return mTimeline[(mTimelineStart + index) % mTimeline.size()]; }
+        size_t _findTimelineSnapshot(TickNumber tick);
+        size_t _findFirstTimelineSnapshotAfterTick(TickNumber tick);
+        size_t _findFirstTimelineSnapshotAfter(double realtime);
+
+        /**
+         * @brief Inserts an empty snapshot into the timeline, keeping it sorted by tick.
+         *
+         * If the ring is full, the oldest snapshot is folded into the baseline and it's slot reused.
+         */
+        Snapshot &_insertTimelineSnapshot(TickNumber tick);
+
+        /**
+         * @brief Returns the states of an object at the timeline snapshot with the given index, or nullptr if it has none.
+         *
+         * Walks back from that snapshot to the nearest one listing the object. Pass NO_SNAPSHOT to look up the baseline only.
+         */
+        CombinedStates *_resolveStates(od::LevelObjectId id, size_t index);
+
+        /**
+         * @brief Adds all objects that changed in snapshots with ticks in (fromTick, toTick] to the given set.
+         *
+         * Returns false if that can't be determined, because the snapshot with fromTick is not in the timeline anymore.
+         */
+        bool _collectChangedObjects(TickNumber fromTick, TickNumber toTick, ObjectIdSet &objects);
+
+        /**
+         * @brief Adds all objects that have states at the timeline snapshot with the given index to the given set.
+         */
+        void _collectAllObjects(size_t index, ObjectIdSet &objects);
+
+        /**
+         * @brief Returns the index of the given reference snapshot if it can be used to delta-encode the snapshot at toSend, or NO_SNAPSHOT.
+         */
+        size_t _findReferenceSnapshot(TickNumber referenceTick, size_t toSend);
+
+        /**
+         * @brief Encodes states against the given reference states (full if nullptr). Returns false if there is nothing to send.
+         *
+         * Only reads from the timeline, so this can be called from multiple threads at once.
+         */
+        bool _encodeObject(const CombinedStates &states, const CombinedStates *referenceStates, EncodedObject &result) const;
+        void _encodeSnapshot(size_t toSend, size_t reference, EncodedSnapshot &result);
+
+        /**
+         * @brief Discards cached encodings if they are for a different tick than the given one.
+         */
+        void _invalidateEncodings(TickNumber tickToSend);
+
+        EncodedSnapshot &_getEncodedSnapshot(TickNumber tickToSend, size_t toSend, size_t reference);
+        const EncodedObject *_getFullObjectEncoding(od::LevelObjectId id, size_t toSend);
+
+        /**
+         * @brief Picks the timeline snapshots to blend for the given time. Returns true if the result is an extrapolation past b.
+         *
+         * The timeline must not be empty.
+         */
+        bool _selectSnapshots(double realtime, size_t &a, size_t &b, double &delta);
+
+        /**
+         * @brief Blends the given states (either of which may be nullptr) into result. Returns false if both are nullptr.
+         */
+        bool _blendStates(const CombinedStates *statesA, const CombinedStates *statesB, float delta, bool extrapolate, CombinedStates &result);
+
+        void _applyObjectStates(od::LevelObjectId id, size_t a, size_t b, float delta, bool extrapolate, double realtime);
+
+        /**
+         * @brief Compares what we extrapolated during the last apply() with what the timeline says now, and starts fading out the difference.
+         */
+        void _beginErrorCorrection(double realtime);
+
+        void _applyErrorCorrection(od::LevelObjectId id, double realtime, od::ObjectStates &states);
+
         od::Level &mLevel;
 
         bool mDisallowStateUpdates;
 
+        StateQuantization mQuantization;
+
         /**
          * During the update loop, all changes first go here. This map is never
          * cleared, so after every update loop, this represents a full snapshot.
+         * Committing only copies the entries that changed. Extra states are shared
+         * with the snapshots until they are changed again (copy-on-write).
          *
          * On both clients and servers, this is only used locally.
          */
         StatesMap mCurrentUpdateStatesMap;
 
-        std::deque<Snapshot> mSnapshots;
+        // objects that had their states changed locally since the last commit/apply
+        ObjectIdSet mChangedSinceCommit;
+        ObjectIdSet mChangedSinceApply;
+
+        // the ticks of the snapshots applied by the last apply() call. both are INVALID_TICK if nothing was applied yet
+        TickNumber mLastAppliedLowerTick;
+        TickNumber mLastAppliedUpperTick;
+        double mLastAppliedRealtime;
+        ObjectIdSet mObjectsToApply;
+
+        struct ErrorCorrection
+        {
+            glm::vec3 positionError;
+            glm::quat rotationError;
+            double startTime;
+        };
+
+        double mMaxExtrapolationTime;
+        double mErrorCorrectionTime;
+
+        // basic states applied to objects that were extrapolated during the last apply(), with corrections included
+        std::unordered_map<od::LevelObjectId, od::ObjectStates> mExtrapolatedStates;
+        std::unordered_map<od::LevelObjectId, ErrorCorrection> mErrorCorrections;
+        // cached snapshot encodings. these are all for the same tick, so once we send a newer one, all are discarded
+        TickNumber mEncodingTick;
+        std::map<EncodingKey, EncodedSnapshot> mEncodedSnapshots;
+        std::unordered_map<od::LevelObjectId, EncodedObject> mFullObjectEncodings;
+        std::vector<od::LevelObjectId> mSelectedObjects;
+
+        /**
+         * The timeline: a preallocated ring of snapshots, sorted by tick. Each snapshot only stores the objects that
+         * changed since it's predecessor. Object states that are not changed in any snapshot are found in the baseline,
+         * which holds the states of all objects as of the last snapshot that dropped out of the ring.
+         *
+         * Looking up states at a tick resolves through this chain. This way, the cost of a tick is proportional to the
+         * number of changes, not to the number of objects in the level.
+         */
+        std::vector<Snapshot> mTimeline;
+        size_t mTimelineStart;
+        size_t mTimelineSize;
+        StatesMap mBaseline;
 
         /**
          * A list of incoming snapshots. The client uses this to store changes
          * coming from the server. Since server packets can arrive out of order,
          * snapshots are kept here until they are complete.
          *
-         * In contrast to all other snapshots in the StateManager, these are
-         * "delta-encoded", i.e. they only list changes that happened since a
-         * given reference snapshot (the last one that was acknowledged).
+         * These are "delta-encoded" against a given reference snapshot (the last
+         * one that was acknowledged), not against their predecessor like the ones
+         * in the timeline.
          */
         std::deque<Snapshot> mIncomingSnapshots;
 
         std::shared_ptr<odNet::UplinkConnector> mUplinkConnectorForAck;
-
-        std::vector<char> mExtraStateSerializationBuffer;
     };
 
 }
@@ -0,0 +1,91 @@
+
+#ifndef INCLUDE_ODCORE_STATE_STATEQUANTIZATION_H_
+#define INCLUDE_ODCORE_STATE_STATEQUANTIZATION_H_
+
+#include <glm/vec3.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <odCore/BitStream.h>
+#include <odCore/BoundingBox.h>
+
+namespace odState
+{
+
+    /**
+     * @brief Parameters and codecs for the quantized, bit-packed network encoding of states.
+     *
+     * Positions (states flagged with StateFlags::POSITION) are encoded as fixed-point offsets into a box around
+     * the level, using only as many bits per axis as the box' extent needs at the given resolution. Positions
+     * outside that box fall back to full floats. Rotations use the smallest-three encoding, and floats flagged
+     * with StateFlags::UNIT_INTERVAL are encoded as 16 bit fixed-point numbers.
+     *
+     * Both ends of a connection must use the same parameters, so the server sends it's quantization to clients
+     * when telling them to load a level.
+     */
+    class StateQuantization
+    {
+    public:
+
+        static constexpr float DEFAULT_POSITION_RESOLUTION = 1.0f/1024; ///< In length units
+        static constexpr float LEVEL_BOUNDS_MARGIN = 64.0f; ///< In length units
+        static constexpr size_t ROTATION_COMPONENT_BITS = 10;
+        static constexpr size_t UNIT_INTERVAL_BITS = 16;
+
+        /**
+         * @brief Creates a quantization without position bounds. Positions are always encoded as full floats.
+         */
+        StateQuantization();
+
+        /**
+         * @brief Creates a quantization with position bounds. Panics if the parameters are not valid as per areValidBounds().
+         */
+        StateQuantization(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, float positionResolution);
+
+        /**
+         * @brief Returns true if the parameters describe a finite, non-inverted box and a positive, finite resolution.
+         *
+         * Use this to check parameters received from the network before constructing a quantization from them.
+         */
+        static bool areValidBounds(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, float positionResolution);
+
+        /**
+         * @brief Creates a quantization for a level with the given bounds, padded by LEVEL_BOUNDS_MARGIN.
+         *
+         * Empty bounds yield a quantization without position bounds.
+         */
+        static StateQuantization forLevelBounds(const od::AxisAlignedBoundingBox &levelBounds);
+
+        inline bool hasPositionBounds() const { return mHasPositionBounds; }
+        inline const glm::vec3 &getBoundsMin() const { return mBoundsMin; }
+        inline const glm::vec3 &getBoundsMax() const { return mBoundsMax; }
+        inline float getPositionResolution() const { return mPositionResolution; }
+
+        void writePosition(od::BitWriter &writer, const glm::vec3 &position) const;
+        glm::vec3 readPosition(od::BitReader &reader) const;
+
+        static void writeRotation(od::BitWriter &writer, const glm::quat &rotation);
+        static glm::quat readRotation(od::BitReader &reader);
+
+        /**
+         * @brief Writes a float in the range [0, 1]. Values outside that range are clamped.
+         */
+        static void writeUnitInterval(od::BitWriter &writer, float value);
+        static float readUnitInterval(od::BitReader &reader);
+
+
+    private:
+
+        bool mHasPositionBounds;
+        glm::vec3 mBoundsMin;
+        glm::vec3 mBoundsMax;
+        float mPositionResolution;
+
+        // per axis
+        size_t mPositionBits[3];
+        float mPositionStep[3];
+
+    };
+
+}
+
+#endif
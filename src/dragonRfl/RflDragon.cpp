@@ -72,12 +72,39 @@ namespace dragonRfl
             obj.setRflClassInstance(std::move(newHumanControl));
             obj.spawn();
 
+            localServer.setClientViewpointObject(clientId, obj.getObjectId());
+
             // TODO: make this a broadcast
             localServer.getMessageDispatcherForClient(clientId).sendGlobalMessage(MessageChannel::HUMANCONTROL_CREATED)
                 << clientId << obj.getObjectId();
         }
     }
 
+    void DragonRfl::despawnHumanControlForPlayer(od::Server &localServer, odNet::ClientId clientId)
+    {
+        if(localServer.getLevel() == nullptr)
+        {
+            return;
+        }
+
+        std::vector<std::shared_ptr<od::LevelObject>> foundObjects;
+        localServer.getLevel()->findObjectsOfType(HumanControl::classId(), foundObjects);
+        for(auto &obj : foundObjects)
+        {
+            // the object may hold any of the human control classes, or one spawned for another client
+            auto humanControl = dynamic_cast<HumanControl_Sv*>(obj->getClassInstance());
+            if(humanControl != nullptr && humanControl->getClientId() == clientId)
+            {
+                // give the object back the instance the level created for it, so it stops being this client's player.
+                //  despawning alone would keep it updating, asking the server for input of a client that no longer exists
+                obj->despawn();
+                obj->setEnableUpdate(false);
+                obj->setRflClassInstance(obj->getClass()->makeInstance(obj->getLevel().getEngine()));
+                obj->spawn();
+            }
+        }
+    }
+
     const char *DragonRfl::getName() const
     {
         return "dragon";
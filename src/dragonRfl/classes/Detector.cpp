@@ -8,13 +8,14 @@
 #include <dragonRfl/classes/Detector.h>
 
 #include <dragonRfl/RflDragon.h>
-#include <dragonRfl/classes/HumanControl.h>
 
 #include <odCore/Server.h>
 #include <odCore/LevelObject.h>
 
 #include <odCore/rfl/Rfl.h>
 
+#include <odCore/physics/PhysicsSystem.h>
+
 namespace dragonRfl
 {
 
@@ -63,46 +64,38 @@ namespace dragonRfl
 
     void Detector_Sv::onSpawned()
     {
-        getLevelObject().setEnableUpdate(true);
-
         mPhysicsHandle = getServer().getPhysicsSystem().createObjectHandle(getLevelObject(), true);
         mPhysicsHandle->setEnableCollision(false);
-    }
 
-    void Detector_Sv::onUpdate(float relTime)
-    {
-        if(mFields.task != DetectorFields::Task::TRIGGER_ONLY || mPhysicsHandle == nullptr)
+        // the trigger manager only tests us against nearby players and tells us when they come or go, so no update needed
+        if(mFields.task == DetectorFields::Task::TRIGGER_ONLY)
         {
-            return;
+            getServer().getTriggerManager().addTrigger(getLevelObject(), mPhysicsHandle, *this);
         }
+    }
 
-        od::LevelObject &obj = getLevelObject();
+    void Detector_Sv::onDespawned()
+    {
+        getServer().getTriggerManager().removeTrigger(getLevelObject());
 
-        // TODO: since we currently only can detect the player (no definition of "NPC" exists yet), we could speed things up a bit by only
-        //  performing the costly contact test if the player position is inside our bounding sphere. later we should further improve this
-        //  by using a "single contact test" for the methods that only detect the player.
+        mPhysicsHandle = nullptr;
+    }
 
-        mResultCache.clear();
-        getServer().getPhysicsSystem().contactTest(mPhysicsHandle, odPhysics::PhysicsTypeMasks::LevelObject, mResultCache);
+    void Detector_Sv::onActivatorEntered(od::LevelObjectId activatorId)
+    {
+        _updatePlayerIsIn();
+    }
 
-        bool playerIsIn = false;
-        for(auto &result : mResultCache)
-        {
-            odPhysics::ObjectHandle *objectHandle = result.handle->asObjectHandle();
-            if(objectHandle == nullptr)
-            {
-                continue;
-            }
-
-            // the server has no notion on what a "player" is, yet. to not break the detector, we check whether the
-            //  object in question is of the HumanControl class
-            odRfl::ClassId objectClassId = objectHandle->getLevelObject().getClass()->getRflClassId();
-            if(objectClassId == HumanControl::classId())
-            {
-                playerIsIn = true;
-                break;
-            }
-        }
+    void Detector_Sv::onActivatorLeft(od::LevelObjectId activatorId)
+    {
+        _updatePlayerIsIn();
+    }
+
+    void Detector_Sv::_updatePlayerIsIn()
+    {
+        // the server has no notion on what a "player" is, yet. only HumanControl objects register as activators, so
+        //  any activator counts as a player. with more than one, a player leaving doesn't count while another one is inside
+        bool playerIsIn = getServer().getTriggerManager().getActivatorCountInside(getLevelObject()) > 0;
 
         bool triggered = false;
         switch(mFields.detectMethod)
@@ -116,12 +109,12 @@ namespace dragonRfl
             break;
         }
 
+        mPlayerWasIn = playerIsIn;
+
         if(triggered)
         {
-            obj.messageAllLinkedObjects(mFields.triggerMessage);
+            getLevelObject().messageAllLinkedObjects(mFields.triggerMessage);
         }
-
-        mPlayerWasIn = playerIsIn;
     }
 
 }
@@ -131,6 +131,13 @@ namespace dragonRfl
 
     void DynamicLight_Cl::onTransformChanged()
     {
+        if(mLightHandle == nullptr)
+        {
+            return;
+        }
+
+        // moving the handle only updates it's grid entry, so this is cheap enough to do every frame
+        mLightHandle->setPosition(getLevelObject().getPosition());
         getClient().getPhysicsSystem().dispatchLighting(mLightHandle);
     }
 
@@ -28,6 +28,7 @@
 #include <odCore/audio/SoundSystem.h>
 
 #include <odCore/physics/PhysicsSystem.h>
+#include <odCore/physics/TriggerManager.h>
 
 #include <odCore/render/Renderer.h>
 
@@ -117,6 +118,14 @@ namespace dragonRfl
         }
 
     	obj.setEnableUpdate(true);
+
+        // until the server knows what a player is, human controls are the only things that can set off detectors
+        getServer().getTriggerManager().addActivator(obj);
+    }
+
+    void HumanControl_Sv::onDespawned()
+    {
+        getServer().getTriggerManager().removeActivator(getLevelObject());
     }
 
     void HumanControl_Sv::onUpdate(float relTime)
@@ -0,0 +1,118 @@
+
+#include <odCore/BitStream.h>
+
+#include <cstring>
+
+#include <odCore/Panic.h>
+
+namespace od
+{
+
+    BitWriter::BitWriter(std::vector<char> &buffer)
+    : mBuffer(buffer)
+    , mPendingBits(0)
+    , mPendingBitCount(0)
+    , mBitCount(0)
+    {
+    }
+
+    BitWriter::~BitWriter()
+    {
+        if(mPendingBitCount > 0)
+        {
+            flush();
+        }
+    }
+
+    void BitWriter::write(uint32_t value, size_t bits)
+    {
+        if(bits > 32)
+        {
+            OD_PANIC() << "Can't write more than 32 bits at once";
+        }
+
+        uint64_t mask = (static_cast<uint64_t>(1) << bits) - 1;
+        mPendingBits |= (static_cast<uint64_t>(value) & mask) << mPendingBitCount;
+        mPendingBitCount += bits;
+        mBitCount += bits;
+
+        while(mPendingBitCount >= 8)
+        {
+            mBuffer.push_back(static_cast<char>(mPendingBits & 0xff));
+            mPendingBits >>= 8;
+            mPendingBitCount -= 8;
+        }
+    }
+
+    void BitWriter::writeFloat(float f)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &f, sizeof(bits));
+        write(bits, 32);
+    }
+
+    void BitWriter::flush()
+    {
+        if(mPendingBitCount > 0)
+        {
+            mBuffer.push_back(static_cast<char>(mPendingBits & 0xff));
+            mBitCount += 8 - mPendingBitCount;
+            mPendingBits = 0;
+            mPendingBitCount = 0;
+        }
+    }
+
+
+    BitReader::BitReader(const char *data, size_t size)
+    : mPos(reinterpret_cast<const uint8_t*>(data))
+    , mEnd(reinterpret_cast<const uint8_t*>(data) + size)
+    , mPendingBits(0)
+    , mPendingBitCount(0)
+    , mFailed(false)
+    {
+        if(data == nullptr && size > 0)
+        {
+            OD_PANIC() << "Constructed BitReader with null memory block of non-zero size";
+        }
+    }
+
+    uint32_t BitReader::read(size_t bits)
+    {
+        if(bits > 32)
+        {
+            OD_PANIC() << "Can't read more than 32 bits at once";
+        }
+
+        while(mPendingBitCount < bits)
+        {
+            if(mPos >= mEnd)
+            {
+                // whatever is left can't be trusted anymore, so don't hand out any of it
+                mFailed = true;
+                mPendingBits = 0;
+                mPendingBitCount = 0;
+                return 0;
+            }
+
+            mPendingBits |= static_cast<uint64_t>(*mPos) << mPendingBitCount;
+            mPendingBitCount += 8;
+            ++mPos;
+        }
+
+        uint64_t mask = (static_cast<uint64_t>(1) << bits) - 1;
+        uint32_t value = static_cast<uint32_t>(mPendingBits & mask);
+        mPendingBits >>= bits;
+        mPendingBitCount -= bits;
+
+        return value;
+    }
+
+    float BitReader::readFloat()
+    {
+        uint32_t bits = read(32);
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        return f;
+    }
+
+}
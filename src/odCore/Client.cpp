@@ -85,12 +85,13 @@ namespace od
             }
         }
 
-        virtual void loadLevel(const std::string &path, size_t loadedDatabaseCount) override
+        virtual void loadLevel(const std::string &path, size_t loadedDatabaseCount, const odState::StateQuantization &quantization) override
         {
             mClient.mGlobalDbIndexMap.reserve(loadedDatabaseCount);
 
             od::FilePath lvlPath(path, mClient.getEngineRootDir());
             mClient.loadLevel(lvlPath);
+            mClient.getStateManager().setQuantization(quantization);
         }
 
         virtual void objectStatesChanged(odState::TickNumber tick, od::LevelObjectId id, const od::ObjectStates &states) override
@@ -140,6 +141,7 @@ namespace od
     , mSoundSystem(soundSystem)
     , mEngineRoot(".")
     , mIsDone(false)
+    , mMaxExtrapolationTime(0.2)
     {
         mPhysicsSystem = std::make_unique<odBulletPhysics::BulletPhysicsSystem>(&renderer);
         mInputManager = std::make_unique<odInput::InputManager>();
@@ -193,6 +195,7 @@ namespace od
         // TODO: all the subsytems whose existence depends on the level could be very elegantly moved to the level class itself
         mStateManager = std::make_unique<odState::StateManager>(*mLevel);
         mStateManager->setUplinkConnector(mAssignedUplinkConnector);
+        mStateManager->setMaxExtrapolationTime(mMaxExtrapolationTime);
 
         mEventQueue = std::make_unique<odState::EventQueue>(mDbManager, *mLevel);
 
@@ -255,6 +258,12 @@ namespace od
                 mEventQueue->cleanup();
             }
 
+            // acknowledgements and actions of this frame go out together
+            if(mAssignedUplinkConnector != nullptr)
+            {
+                mAssignedUplinkConnector->flush();
+            }
+
             mRenderer.frame(relTime);
         }
 
@@ -8,6 +8,7 @@
 #include <odCore/DataStream.h>
 
 #include <string>
+#include <limits>
 
 #include <odCore/Panic.h>
 
@@ -22,11 +23,17 @@ namespace od
 
     DataReader::DataReader()
     : mStream(nullptr)
+    , mBufferBegin(nullptr)
+    , mBufferPos(nullptr)
+    , mBufferEnd(nullptr)
     {
     }
 
 	DataReader::DataReader(std::istream &stream)
 	: mStream(&stream)
+	, mBufferBegin(nullptr)
+	, mBufferPos(nullptr)
+	, mBufferEnd(nullptr)
 	{
 		if(mStream == nullptr || mStream->bad())
 		{
@@ -34,27 +41,121 @@ namespace od
 		}
 	}
 
+	DataReader::DataReader(const char *data, size_t size)
+	: mStream(nullptr)
+	, mBufferBegin(data)
+	, mBufferPos(data)
+	, mBufferEnd(data + size)
+	{
+	    if(data == nullptr)
+	    {
+	        if(size != 0)
+	        {
+	            OD_PANIC() << "Constructed DataReader with null memory block of non-zero size";
+	        }
+
+	        // empty vectors may give us nullptr. we need a non-null pointer to mark this reader as memory-backed
+	        static const char emptyBlock = 0;
+	        mBufferBegin = mBufferPos = mBufferEnd = &emptyBlock;
+	    }
+	}
+
 	DataReader::DataReader(const DataReader &dr)
 	: mStream(dr.mStream)
+	, mBufferBegin(dr.mBufferBegin)
+	, mBufferPos(dr.mBufferPos)
+	, mBufferEnd(dr.mBufferEnd)
 	{
 	}
 
 	DataReader &DataReader::operator=(const DataReader &dr)
 	{
 	    mStream = dr.mStream;
+	    mBufferBegin = dr.mBufferBegin;
+	    mBufferPos = dr.mBufferPos;
+	    mBufferEnd = dr.mBufferEnd;
 
 	    return *this;
 	}
 
+	void DataReader::setStream(std::istream &stream)
+	{
+	    mStream = &stream;
+	    mBufferBegin = nullptr;
+	    mBufferPos = nullptr;
+	    mBufferEnd = nullptr;
+	}
+
 	std::istream &DataReader::getStream()
 	{
+	    if(isMemoryBacked())
+	    {
+	        OD_PANIC() << "Tried to get stream of a memory-backed DataReader";
+	    }
+
 	    _checkStream();
 
 	    return *mStream;
 	}
 
+	DataReader DataReader::readBlock(size_t size, std::vector<char> &storage)
+	{
+	    if(isMemoryBacked())
+	    {
+	        if(size > static_cast<size_t>(mBufferEnd - mBufferPos))
+	        {
+	            OD_PANIC() << "Unexpected EOF while reading block of data";
+	        }
+
+	        DataReader blockReader(mBufferPos, size);
+	        mBufferPos += size;
+	        return blockReader;
+	    }
+
+	    storage.resize(size);
+	    this->read(storage.data(), size);
+
+	    return DataReader(storage.data(), size);
+	}
+
+	const char *DataReader::peekBuffer(size_t size)
+	{
+	    if(!isMemoryBacked())
+	    {
+	        OD_PANIC() << "Can't peek into buffer of stream-backed reader";
+	    }
+
+	    if(size > static_cast<size_t>(mBufferEnd - mBufferPos))
+	    {
+	        OD_PANIC() << "Unexpected EOF while peeking into buffer";
+	    }
+
+	    return mBufferPos;
+	}
+
+	size_t DataReader::getRemainingSize() const
+	{
+	    if(!isMemoryBacked())
+	    {
+	        OD_PANIC() << "Can't get remaining size of stream-backed reader";
+	    }
+
+	    return static_cast<size_t>(mBufferEnd - mBufferPos);
+	}
+
 	void DataReader::ignore(size_t n)
 	{
+	    if(isMemoryBacked())
+	    {
+	        if(n > static_cast<size_t>(mBufferEnd - mBufferPos))
+	        {
+	            OD_PANIC() << "Unexpected EOF while ignoring characters";
+	        }
+
+	        mBufferPos += n;
+	        return;
+	    }
+
         _checkStream();
 
         mStream->ignore(n);
@@ -70,6 +171,17 @@ namespace od
 
 	void DataReader::seek(size_t offset)
 	{
+	    if(isMemoryBacked())
+	    {
+	        if(offset > static_cast<size_t>(mBufferEnd - mBufferBegin))
+	        {
+	            OD_PANIC() << "Tried to seek past end of memory block";
+	        }
+
+	        mBufferPos = mBufferBegin + offset;
+	        return;
+	    }
+
 	    _checkStream();
 
 		mStream->seekg(offset);
@@ -77,6 +189,11 @@ namespace od
 
 	size_t DataReader::tell()
 	{
+	    if(isMemoryBacked())
+	    {
+	        return mBufferPos - mBufferBegin;
+	    }
+
 		_checkStream();
 
 		return mStream->tellg();
@@ -84,6 +201,18 @@ namespace od
 
 	void DataReader::read(char *data, size_t size)
 	{
+	    if(isMemoryBacked())
+	    {
+	        if(size > static_cast<size_t>(mBufferEnd - mBufferPos))
+	        {
+	            OD_PANIC() << "Unexpected EOF while reading block of data";
+	        }
+
+	        std::memcpy(data, mBufferPos, size);
+	        mBufferPos += size;
+	        return;
+	    }
+
         _checkStream();
 
 		mStream->read(data, size);
@@ -100,8 +229,6 @@ namespace od
 
     void DataReader::readTyped(const Ignore &i)
     {
-        _checkStream();
-
 	    this->ignore(i.getCount());
     }
 
@@ -170,13 +297,13 @@ namespace od
     template <>
 	void DataReader::readTyped<int8_t>(int8_t &v)
     {
-		this->read(reinterpret_cast<char*>(v), 1);
+		this->read(reinterpret_cast<char*>(&v), 1);
 	}
 
     template <>
 	void DataReader::readTyped<char>(char &v)
 	{
-		this->read(reinterpret_cast<char*>(v), 1);
+		this->read(&v, 1);
 	}
 
     template <>
@@ -219,7 +346,7 @@ namespace od
 
     void DataReader::_checkStream()
     {
-        if(mStream == nullptr)
+        if(mStream == nullptr && !isMemoryBacked())
 	    {
 	        OD_PANIC() << "Tried to use a DataReader without assigned stream";
 	    }
@@ -312,6 +439,19 @@ namespace od
         this->write(valuePtr, sizeof(v));
     }
 
+    template <>
+    void DataWriter::writeTyped<std::string>(const std::string &s)
+    {
+        // same format as DataReader expects: 16 bit length followed by the characters, without terminator
+        if(s.size() > std::numeric_limits<uint16_t>::max())
+        {
+            OD_PANIC() << "String too long to be written with 16 bit length field";
+        }
+
+        *this << static_cast<uint16_t>(s.size());
+        this->write(s.data(), s.size());
+    }
+
     void DataWriter::write(const char *data, size_t size)
     {
         if(mStream == nullptr) OD_PANIC() << "Invalid stream";
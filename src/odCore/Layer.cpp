@@ -28,6 +28,10 @@ namespace od
     const odDb::AssetRef Layer::HoleTextureRef(0xffff, 0xffff);
     const odDb::AssetRef Layer::InvisibleTextureRef(0xfffe, 0xffff);
 
+    // sizes of the fixed-size records in the layer poly data
+    static constexpr size_t VERTEX_RECORD_SIZE = 4;
+    static constexpr size_t CELL_RECORD_SIZE = 26;
+
 
     Layer::Layer(Level &level)
     : mLevel(level)
@@ -105,19 +109,30 @@ namespace od
         }
     }
 
+    size_t Layer::getPolyDataSize() const
+    {
+        return (mWidth+1)*(mHeight+1)*VERTEX_RECORD_SIZE + mWidth*mHeight*CELL_RECORD_SIZE;
+    }
+
     void Layer::loadPolyData(DataReader &dr)
     {
-        mVertices.reserve((mWidth+1)*(mHeight+1));
+        // vertex and cell records are fixed-size, so we read each array in one go and decode it from memory
+        std::vector<char> blockStorage;
+
+        size_t vertexCount = (mWidth+1)*(mHeight+1);
+        DataReader vertexReader = dr.readBlock(vertexCount*VERTEX_RECORD_SIZE, blockStorage);
+
+        mVertices.reserve(vertexCount);
         float lowestHeightOffset = std::numeric_limits<float>::max();
         float maxHeightOffset = std::numeric_limits<float>::lowest();
-        for(size_t i = 0; i < (mWidth+1)*(mHeight+1); ++i)
+        for(size_t i = 0; i < vertexCount; ++i)
         {
             uint8_t vertexType;
             uint16_t heightOffsetBiased;
 
-            dr >> vertexType
-               >> DataReader::Ignore(1)
-               >> heightOffsetBiased;
+            vertexReader >> vertexType
+                         >> DataReader::Ignore(1)
+                         >> heightOffsetBiased;
 
             Vertex v;
             v.type = vertexType;
@@ -142,19 +157,19 @@ namespace od
         glm::vec3 max(mOriginX+mWidth, mMaxHeight, mOriginZ+mHeight);
         mBoundingBox = AxisAlignedBoundingBox(min, max);
 
-        mCells.reserve(mWidth*mHeight);
-        for(size_t i = 0; i < mWidth*mHeight; ++i)
+        size_t cellCount = mWidth*mHeight;
+        DataReader cellReader = dr.readBlock(cellCount*CELL_RECORD_SIZE, blockStorage);
+
+        mCells.reserve(cellCount);
+        for(size_t i = 0; i < cellCount; ++i)
         {
             Cell c;
 
-            dr >> c.flags
-               >> c.leftTextureRef
-               >> c.rightTextureRef;
+            cellReader >> c.flags
+                       >> c.leftTextureRef
+                       >> c.rightTextureRef;
 
-            for(size_t j = 0; j < 8; ++j)
-            {
-                dr >> c.texCoords[j];
-            }
+            cellReader.readArray(c.texCoords, 8);
 
             mCells.push_back(c);
 
@@ -9,6 +9,14 @@
 #include <odCore/Level.h>
 
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <future>
+#include <limits>
+#include <random>
+#include <string_view>
 
 #include <odCore/Client.h>
 #include <odCore/SrscRecordTypes.h>
@@ -19,6 +27,9 @@
 #include <odCore/Layer.h>
 #include <odCore/LevelObject.h>
 #include <odCore/BoundingBox.h>
+#include <odCore/ThreadPool.h>
+#include <odCore/LevelAssetManifest.h>
+#include <odCore/Units.h>
 
 #include <odCore/physics/PhysicsSystem.h>
 #include <odCore/physics/Handles.h>
@@ -26,6 +37,34 @@
 namespace od
 {
 
+    static double _msSince(std::chrono::steady_clock::time_point start)
+    {
+        return 1e-6 * std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    template <typename F>
+    static void _writeSyntheticRecord(std::vector<char> &buffer, const F &writeFunc)
+    {
+        buffer.clear();
+
+        VectorOutputBuffer outputBuffer(buffer);
+        std::ostream out(&outputBuffer);
+        DataWriter dw(out);
+        writeFunc(dw);
+        out.flush();
+    }
+
+
+    SyntheticLevelParameters::SyntheticLevelParameters()
+    : layerGridSize(4)
+    , layerSize(64)
+    , terrainAmplitude(4.0f)
+    , objectCount(1000)
+    , seed(0)
+    {
+    }
+
+
     Level::Level(Engine engine)
     : mEngine(engine)
     , mPhysicsSystem(engine.getPhysicsSystem())
@@ -55,14 +94,230 @@ namespace od
     {
         Logger::info() << "Loading level " << levelPath.str();
 
-        SrscFile file(levelPath);
+        auto loadStart = std::chrono::steady_clock::now();
+
+        SrscFile file(levelPath, SrscFile::AccessMode::MEMORY_MAPPED);
 
+        auto stageStart = std::chrono::steady_clock::now();
         _loadNameAndDeps(file, dbManager);
-        _loadLayers(file);
+        double depsMs = _msSince(stageStart);
+
+        // if we have a manifest from an earlier load, start loading assets right away so they load alongside the layers
+        LevelAssetManifest manifest(dbManager);
+        FilePath manifestPath = levelPath.ext(".odm");
+        uint64_t contentStamp = _getContentStamp(file);
+        manifest.readFromFile(manifestPath, contentStamp);
+
+        stageStart = std::chrono::steady_clock::now();
+        _loadLayers(file, dbManager.getLoaderPool());
+        double layersMs = _msSince(stageStart);
+
         //_loadLayerGroups(file); unnecessary, as this is probably just an editor thing
-        _loadObjects(file, dbManager);
 
-        Logger::info() << "Level loaded successfully";
+        stageStart = std::chrono::steady_clock::now();
+        _loadObjects(file, manifest);
+        double objectsMs = _msSince(stageStart);
+
+        stageStart = std::chrono::steady_clock::now();
+        mPrefetchedAssets = manifest.waitForAll();
+        double assetsMs = _msSince(stageStart);
+
+        Logger::info() << "Level loaded successfully in " << _msSince(loadStart) << "ms (dependencies: " << depsMs
+                       << "ms, layers: " << layersMs << "ms, objects: " << objectsMs << "ms, waiting for assets: " << assetsMs << "ms)";
+        Logger::verbose() << "Prefetched " << mPrefetchedAssets.size() << " of " << manifest.getRequestCount() << " requested assets";
+
+        if(dbManager.isLevelManifestWritingEnabled() && manifest.differsFromFile())
+        {
+            manifest.writeToFile(manifestPath, contentStamp);
+        }
+
+        auto retentionStats = dbManager.getRetentionCache().getStats();
+        Logger::verbose() << "Asset retention cache holds " << retentionStats.retainedCount << " assets (" << retentionStats.retainedBytes
+                          << " of " << retentionStats.budget << " bytes, peak " << retentionStats.peakRetainedBytes << "). "
+                          << retentionStats.evictionCount << " evictions so far (" << retentionStats.evictedBytes << " bytes)";
+    }
+
+    void Level::loadSyntheticLevel(const SyntheticLevelParameters &params)
+    {
+        if(params.layerGridSize == 0 || params.layerSize == 0)
+        {
+            OD_PANIC() << "Synthetic level needs at least one layer with at least one cell";
+        }
+
+        // object records are referenced by 16 bit indices
+        if(params.objectCount > std::numeric_limits<uint16_t>::max())
+        {
+            OD_PANIC() << "Synthetic level can't have more than " << std::numeric_limits<uint16_t>::max() << " objects";
+        }
+
+        auto loadStart = std::chrono::steady_clock::now();
+
+        uint32_t gridSize = params.layerGridSize;
+        uint32_t layerSize = params.layerSize;
+        uint32_t layerCount = gridSize*gridSize;
+
+        mLevelName = "Synthetic level";
+        mMaxWidth = gridSize*layerSize;
+        mMaxHeight = gridSize*layerSize;
+
+        std::minstd_rand random(params.seed);
+        std::uniform_real_distribution<float> unitDistribution(0.0f, 1.0f);
+
+        // the terrain is a sum of a few plane waves, so it's smooth and continuous across layer borders
+        std::array<glm::vec3, 4> waves; // x and z of the wave vector, phase
+        for(auto &wave : waves)
+        {
+            float direction = unitDistribution(random) * 2*M_PI;
+            float wavelength = 8.0f + unitDistribution(random) * 32.0f;
+            float phase = unitDistribution(random) * 2*M_PI;
+            wave = glm::vec3(std::cos(direction), std::sin(direction), 0.0f) * float(2*M_PI/wavelength);
+            wave.z = phase;
+        }
+
+        auto terrainHeight = [&waves, &params](float x, float z)
+        {
+            float height = 0.0f;
+            for(auto &wave : waves)
+            {
+                height += std::sin(wave.x*x + wave.y*z + wave.z);
+            }
+
+            return height * params.terrainAmplitude / waves.size();
+        };
+
+        std::vector<char> recordBuffer;
+        _writeSyntheticRecord(recordBuffer, [&](DataWriter &dw)
+        {
+            for(uint32_t i = 0; i < layerCount; ++i)
+            {
+                int32_t gridX = i % gridSize;
+                int32_t gridZ = i / gridSize;
+
+                dw << static_cast<LayerId>(i + 1)
+                   << layerSize
+                   << layerSize
+                   << static_cast<uint32_t>(Layer::TYPE_FLOOR)
+                   << static_cast<uint32_t>(gridX*layerSize)
+                   << static_cast<uint32_t>(gridZ*layerSize)
+                   << 0.0f // world height
+                   << ("Synthetic layer " + std::to_string(i))
+                   << static_cast<uint32_t>(0) // flags
+                   << 0.8f // light direction
+                   << 0.9f // light ascension
+                   << static_cast<uint32_t>(0xffffff) // light color
+                   << static_cast<uint32_t>(0x404040) // ambient color
+                   << static_cast<uint32_t>(Layer::DROPOFF_NONE);
+
+                std::vector<uint32_t> visibleLayers;
+                for(int32_t z = gridZ-1; z <= gridZ+1; ++z)
+                {
+                    for(int32_t x = gridX-1; x <= gridX+1; ++x)
+                    {
+                        bool inGrid = (x >= 0 && z >= 0 && x < static_cast<int32_t>(gridSize) && z < static_cast<int32_t>(gridSize));
+                        if(inGrid && (x != gridX || z != gridZ))
+                        {
+                            visibleLayers.push_back(x + z*gridSize);
+                        }
+                    }
+                }
+
+                dw << static_cast<uint32_t>(visibleLayers.size());
+                for(auto index : visibleLayers)
+                {
+                    dw << index;
+                }
+            }
+        });
+
+        DataReader layerReader(recordBuffer.data(), recordBuffer.size());
+        mLayers.reserve(layerCount);
+        for(uint32_t i = 0; i < layerCount; ++i)
+        {
+            auto layer = std::make_unique<Layer>(*this);
+            layer->loadDefinition(layerReader);
+            mLayers.push_back(std::move(layer));
+        }
+
+        odDb::AssetRef groundTexture(1, odDb::AssetRef::SELF_DBINDEX);
+        for(auto &layer : mLayers)
+        {
+            _writeSyntheticRecord(recordBuffer, [&](DataWriter &dw)
+            {
+                for(uint32_t z = 0; z <= layerSize; ++z)
+                {
+                    for(uint32_t x = 0; x <= layerSize; ++x)
+                    {
+                        float height = terrainHeight(layer->getOriginX() + x, layer->getOriginZ() + z);
+                        float biasedHeight = 0x8000 + Units::lenthUnitsToWorldUnits(height)/2;
+                        biasedHeight = std::max(0.0f, std::min(biasedHeight, float(0xffff)));
+
+                        dw << static_cast<uint8_t>(0) // vertex type
+                           << static_cast<uint8_t>(0)
+                           << static_cast<uint16_t>(biasedHeight);
+                    }
+                }
+
+                for(uint32_t z = 0; z < layerSize; ++z)
+                {
+                    for(uint32_t x = 0; x < layerSize; ++x)
+                    {
+                        uint16_t flags = ((x + z) % 2 == 0) ? OD_LAYER_FLAG_DIV_BACKSLASH : 0;
+                        dw << flags
+                           << groundTexture
+                           << groundTexture;
+
+                        for(size_t i = 0; i < 8; ++i)
+                        {
+                            dw << static_cast<uint16_t>(0);
+                        }
+                    }
+                }
+            });
+
+            DataReader polyReader(recordBuffer.data(), recordBuffer.size());
+            layer->loadPolyData(polyReader);
+        }
+
+        _calculateBounds();
+
+        float levelExtent = gridSize*layerSize;
+        _writeSyntheticRecord(recordBuffer, [&](DataWriter &dw)
+        {
+            for(size_t i = 0; i < params.objectCount; ++i)
+            {
+                float x = (0.01f + 0.98f*unitDistribution(random)) * levelExtent;
+                float z = (0.01f + 0.98f*unitDistribution(random)) * levelExtent;
+                glm::vec3 position(x, terrainHeight(x, z), z);
+                uint16_t yaw = static_cast<uint16_t>(unitDistribution(random) * 360);
+
+                dw << static_cast<LevelObjectId>(i + 1)
+                   << odDb::AssetRef::NULL_REF
+                   << static_cast<LayerId>(0) // lighting layer
+                   << Units::lenthUnitsToWorldUnits(position)
+                   << ObjectRecordData::FLAG_OBJECT_FLAG_VISIBLE
+                   << static_cast<uint16_t>(0) // initial event count
+                   << static_cast<uint16_t>(0) // linked object count
+                   << static_cast<uint16_t>(0)
+                   << yaw
+                   << static_cast<uint16_t>(0)
+                   << static_cast<uint32_t>(0) // field data dwords
+                   << static_cast<uint32_t>(0); // fields
+            }
+        });
+
+        DataReader objectReader(recordBuffer.data(), recordBuffer.size());
+        mObjectRecords.reserve(params.objectCount);
+        mLevelObjects.reserve(params.objectCount);
+        for(size_t i = 0; i < params.objectCount; ++i)
+        {
+            mObjectRecords.emplace_back(objectReader);
+
+            auto &record = mObjectRecords.back();
+            mLevelObjects[record.getObjectId()] = std::make_shared<LevelObject>(*this, static_cast<uint16_t>(i), record, record.getObjectId(), nullptr);
+        }
+
+        Logger::info() << "Generated synthetic level with " << layerCount << " layers of " << layerSize << "x" << layerSize
+                       << " cells and " << params.objectCount << " objects in " << _msSince(loadStart) << "ms";
     }
 
     void Level::addToDestructionQueue(LevelObjectId objId)
@@ -289,9 +544,20 @@ namespace od
             layerHandles.push_back(mPhysicsSystem.createLayerHandle(*layer));
         }
 
+        std::vector<odPhysics::RayQuery> queries(mLevelObjects.size());
+        size_t queryIndex = 0;
+        for(auto &obj : mLevelObjects)
+        {
+            obj.second->getAssociatedLayerRayQuery(queries[queryIndex++]);
+        }
+
+        std::vector<odPhysics::RayQueryResult> results(queries.size());
+        mPhysicsSystem.rayTestClosestBatch(queries.data(), results.data(), queries.size());
+
+        size_t resultIndex = 0;
         for(auto &obj : mLevelObjects)
         {
-            obj.second->updateAssociatedLayer(false);
+            obj.second->updateAssociatedLayer(results[resultIndex++], false);
         }
     }
 
@@ -327,10 +593,21 @@ namespace od
         }
     }
 
-    void Level::_loadLayers(SrscFile &file)
+    void Level::_loadLayers(SrscFile &file, ThreadPool &pool)
     {
     	auto cursor = file.getFirstRecordOfType(SrscRecordType::LEVEL_LAYERS);
-    	DataReader dr = cursor.getReader();
+    	if(!cursor.isValid())
+    	{
+    	    OD_PANIC() << "Level has no layer record";
+    	}
+
+    	// the level file is mapped, so we can read the record directly from memory. this lets us hand out the
+    	//  compressed poly data of each layer to the decoding jobs without copying it
+    	auto dirIt = cursor.getDirIterator();
+    	const char *recordData = file.getMappedRecordData(dirIt);
+    	DataReader dr(recordData, dirIt->dataSize);
+
+    	auto readStart = std::chrono::steady_clock::now();
 
     	uint32_t layerCount;
     	dr >> layerCount;
@@ -349,31 +626,80 @@ namespace od
 
     	dr >> DataReader::Expect<uint32_t>(1);
 
-    	float minHeight = std::numeric_limits<float>::max();
-    	float maxHeight = std::numeric_limits<float>::lowest();
-
+    	// first pass: locate the compressed poly data blobs. these are stored back to back, each prefixed by it's size
+    	std::vector<std::pair<const char*, size_t>> compressedBlobs;
+    	compressedBlobs.reserve(layerCount);
+    	size_t totalCompressedSize = 0;
     	for(size_t i = 0; i < layerCount; ++i)
     	{
     		uint32_t compressedDataSize;
 			dr >> compressedDataSize;
 
-			ZStream zstr(dr.getStream(), compressedDataSize, ZStreamBuffer::DefaultBufferSize);
-			DataReader zdr(zstr);
-			mLayers[i]->loadPolyData(zdr);
-			zstr.seekToEndOfZlib();
+			compressedBlobs.emplace_back(recordData + dr.tell(), compressedDataSize);
+			dr.ignore(compressedDataSize); // panics if the blob exceeds the record
+			totalCompressedSize += compressedDataSize;
+    	}
+
+    	double readMs = _msSince(readStart);
+    	auto decodeStart = std::chrono::steady_clock::now();
 
-			if(mLayers[i]->getMinHeight() < minHeight)
-			{
-			    minHeight = mLayers[i]->getMinHeight();
-			}
+    	// second pass: inflate and parse all layers concurrently. layers don't share any state during this
+    	std::vector<std::future<void>> decodeJobs;
+    	decodeJobs.reserve(layerCount);
+    	for(size_t i = 0; i < layerCount; ++i)
+    	{
+    	    Layer *layer = mLayers[i].get();
+    	    auto blob = compressedBlobs[i];
+    	    decodeJobs.push_back(pool.async([layer, blob]()
+    	    {
+    	        MemoryInputBuffer blobBuffer(blob.first, blob.second);
+    	        std::istream blobStream(&blobBuffer);
+
+    	        // the poly data size follows from the layer dimensions, so we inflate straight into one block
+    	        //  and parse that. we stream here since the blob might contain more data than we parse
+    	        std::vector<char> polyData(layer->getPolyDataSize());
+    	        ZStream zstr(blobStream, blob.second, 0);
+    	        zstr.inflateInto(polyData.data(), polyData.size());
+
+    	        DataReader zdr(polyData.data(), polyData.size());
+    	        layer->loadPolyData(zdr);
+    	    }));
+    	}
 
-			if(mLayers[i]->getMaxHeight() > maxHeight)
-			{
-			    maxHeight = mLayers[i]->getMaxHeight();
-			}
+    	for(auto &job : decodeJobs)
+    	{
+    	    job.get();
     	}
 
-    	mVerticalExtent = maxHeight - minHeight;
+    	double decodeMs = _msSince(decodeStart);
+
+    	_calculateBounds();
+
+    	Logger::verbose() << "Read " << layerCount << " layer definitions and " << totalCompressedSize << " bytes of compressed poly data in "
+    	                  << readMs << "ms, decoded poly data in " << decodeMs << "ms on " << pool.getThreadCount() << " threads";
+    }
+
+    void Level::_calculateBounds()
+    {
+        float minHeight = std::numeric_limits<float>::max();
+        float maxHeight = std::numeric_limits<float>::lowest();
+        for(auto &layer : mLayers)
+        {
+            if(layer->getMinHeight() < minHeight)
+            {
+                minHeight = layer->getMinHeight();
+            }
+
+            if(layer->getMaxHeight() > maxHeight)
+            {
+                maxHeight = layer->getMaxHeight();
+            }
+
+            mBoundingBox.expandBy(layer->getBoundingBox().min());
+            mBoundingBox.expandBy(layer->getBoundingBox().max());
+        }
+
+        mVerticalExtent = maxHeight - minHeight;
     }
 
     void Level::_loadLayerGroups(SrscFile &file)
@@ -402,7 +728,7 @@ namespace od
     	}
     }
 
-    void Level::_loadObjects(SrscFile &file, odDb::DbManager &dbManager)
+    void Level::_loadObjects(SrscFile &file, LevelAssetManifest &manifest)
     {
     	Logger::verbose() << "Loading level objects";
 
@@ -425,6 +751,15 @@ namespace od
             mObjectRecords.emplace_back(dr);
         }
 
+        // request every distinct asset the objects depend on once and let the loader pool load them concurrently.
+        //  this waits for the classes only. everything else keeps loading while we construct the objects
+        auto prefetchStart = std::chrono::steady_clock::now();
+
+        manifest.walkObjects(mObjectRecords, *mDependencyTable);
+
+        double prefetchMs = _msSince(prefetchStart);
+        auto constructStart = std::chrono::steady_clock::now();
+
     	mLevelObjects.reserve(objectCount);
         for(size_t i = 0; i < objectCount; ++i)
     	{
@@ -456,5 +791,29 @@ namespace od
 
             ptrInMap = std::move(newObject);
     	}
+
+        Logger::verbose() << "Found " << manifest.getWalkedCount() << " assets the objects depend on and loaded their classes in " << prefetchMs
+                          << "ms, constructed objects in " << _msSince(constructStart) << "ms";
+    }
+
+    uint64_t Level::_getContentStamp(SrscFile &file)
+    {
+        // the manifest depends on which databases the level references and on the object records. hashing
+        //  the raw records is cheap compared to parsing them, so this is done up front
+        uint64_t stamp = 0;
+        for(auto type : { SrscRecordType::LEVEL_NAME, SrscRecordType::LEVEL_OBJECTS })
+        {
+            auto cursor = file.getFirstRecordOfType(type);
+            if(!cursor.isValid())
+            {
+                continue;
+            }
+
+            auto dirIt = cursor.getDirIterator();
+            std::string_view record(file.getMappedRecordData(dirIt), dirIt->dataSize);
+            stamp = (stamp * 31) ^ std::hash<std::string_view>()(record) ^ dirIt->dataSize;
+        }
+
+        return stamp;
     }
 }
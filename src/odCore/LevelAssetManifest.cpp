@@ -0,0 +1,424 @@
+
+#include <odCore/LevelAssetManifest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+#include <odCore/DataStream.h>
+#include <odCore/Logger.h>
+#include <odCore/ObjectRecord.h>
+
+#include <odCore/db/Animation.h>
+#include <odCore/db/Class.h>
+#include <odCore/db/Database.h>
+#include <odCore/db/DbManager.h>
+#include <odCore/db/DependencyTable.h>
+#include <odCore/db/Model.h>
+#include <odCore/db/Sequence.h>
+#include <odCore/db/Sound.h>
+#include <odCore/db/Texture.h>
+
+#include <odCore/rfl/Field.h>
+
+namespace od
+{
+
+    static const char MANIFEST_MAGIC[4] = { 'O', 'D', 'L', 'M' };
+    static constexpr uint32_t MANIFEST_FORMAT_VERSION = 1;
+
+    // magic, format version, content stamp, database count
+    static constexpr size_t MANIFEST_HEADER_SIZE = 4 + 4 + 8 + 4;
+
+
+    /**
+     * @brief Checks that the body holds dbCount complete database sections, so reading it can't run past the end.
+     *
+     * Takes the reader by value. Copies of memory-backed readers have their own position.
+     */
+    static bool _validateBody(DataReader dr, uint32_t dbCount)
+    {
+        static constexpr size_t ENTRY_SIZE = sizeof(RecordType) + sizeof(RecordId);
+
+        for(size_t i = 0; i < dbCount; ++i)
+        {
+            uint16_t pathLength;
+            if(dr.getRemainingSize() < sizeof(pathLength))
+            {
+                return false;
+            }
+            dr >> pathLength;
+
+            uint32_t entryCount;
+            if(dr.getRemainingSize() < pathLength + sizeof(entryCount))
+            {
+                return false;
+            }
+            dr.ignore(pathLength);
+            dr >> entryCount;
+
+            if(dr.getRemainingSize() / ENTRY_SIZE < entryCount)
+            {
+                return false;
+            }
+            dr.ignore(entryCount*ENTRY_SIZE);
+        }
+
+        return true;
+    }
+
+
+    LevelAssetManifest::LevelAssetManifest(odDb::DbManager &dbManager)
+    : mDbManager(dbManager)
+    , mReadFromFile(false)
+    {
+    }
+
+    bool LevelAssetManifest::readFromFile(const FilePath &path, uint64_t contentStamp)
+    {
+        std::ifstream in(path.str(), std::ios::in | std::ios::binary);
+        if(in.fail())
+        {
+            Logger::debug() << "No asset manifest found at " << path;
+            return false;
+        }
+
+        std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        if(data.size() < MANIFEST_HEADER_SIZE)
+        {
+            Logger::warn() << "Ignoring truncated asset manifest " << path;
+            return false;
+        }
+
+        DataReader dr(data.data(), data.size());
+
+        char magic[4];
+        uint32_t formatVersion;
+        uint64_t fileContentStamp;
+        uint32_t dbCount;
+        dr.read(magic, sizeof(magic));
+        dr >> formatVersion
+           >> fileContentStamp
+           >> dbCount;
+
+        if(!std::equal(magic, magic + sizeof(magic), MANIFEST_MAGIC) || formatVersion != MANIFEST_FORMAT_VERSION)
+        {
+            Logger::warn() << "Ignoring asset manifest " << path << " with unknown format";
+            return false;
+        }
+
+        if(fileContentStamp != contentStamp)
+        {
+            Logger::verbose() << "Ignoring stale asset manifest " << path;
+            return false;
+        }
+
+        // check everything before requesting anything, so a corrupt manifest doesn't leave us with half of it
+        if(!_validateBody(dr, dbCount))
+        {
+            Logger::warn() << "Ignoring truncated asset manifest " << path;
+            return false;
+        }
+
+        size_t requested = 0;
+        size_t unresolved = 0;
+        for(size_t i = 0; i < dbCount; ++i)
+        {
+            std::string dbPath;
+            uint32_t entryCount;
+            dr >> dbPath
+               >> entryCount;
+
+            // the level's dependencies are loaded at this point. if the database isn't, the manifest is outdated
+            auto db = mDbManager.getDatabaseByPath(FilePath(dbPath));
+
+            for(size_t j = 0; j < entryCount; ++j)
+            {
+                RecordType type;
+                RecordId id;
+                dr >> type
+                   >> id;
+
+                if(db == nullptr || !_requestByType(db, type, id))
+                {
+                    ++unresolved;
+                    continue;
+                }
+
+                mFileKeys.insert(Key(db.get(), type, id));
+                ++requested;
+            }
+        }
+
+        mReadFromFile = true;
+
+        Logger::verbose() << "Requested " << requested << " assets listed in asset manifest " << path << " (" << unresolved << " unresolved)";
+
+        return true;
+    }
+
+    void LevelAssetManifest::writeToFile(const FilePath &path, uint64_t contentStamp)
+    {
+        // group keys by database. the key set is ordered by database first, so entries of one database are adjacent
+        std::vector<std::pair<const Request*, std::vector<Key>>> groups;
+        for(auto &key : mWalkedKeys)
+        {
+            if(groups.empty() || std::get<0>(groups.back().second.front()) != std::get<0>(key))
+            {
+                groups.emplace_back(&mRequests.at(key), std::vector<Key>());
+            }
+
+            groups.back().second.push_back(key);
+        }
+
+        // write to a temporary file first, so concurrent loads of the same level never see a partial manifest
+        std::string tmpPath = path.str() + ".tmp";
+
+        {
+            std::ofstream out(tmpPath, std::ios::out | std::ios::binary | std::ios::trunc);
+            if(out.fail())
+            {
+                Logger::warn() << "Could not write asset manifest " << path;
+                return;
+            }
+
+            DataWriter dw(out);
+            dw.write(MANIFEST_MAGIC, sizeof(MANIFEST_MAGIC));
+            dw << MANIFEST_FORMAT_VERSION
+               << contentStamp
+               << static_cast<uint32_t>(groups.size());
+
+            for(auto &group : groups)
+            {
+                dw << group.first->database->getDbFilePath().str()
+                   << static_cast<uint32_t>(group.second.size());
+
+                for(auto &key : group.second)
+                {
+                    dw << std::get<1>(key)
+                       << std::get<2>(key);
+                }
+            }
+        }
+
+        std::remove(path.str().c_str());
+        if(std::rename(tmpPath.c_str(), path.str().c_str()) != 0)
+        {
+            Logger::warn() << "Could not move asset manifest into place at " << path;
+            std::remove(tmpPath.c_str());
+            return;
+        }
+
+        Logger::verbose() << "Wrote asset manifest with " << mWalkedKeys.size() << " assets to " << path;
+    }
+
+    bool LevelAssetManifest::differsFromFile() const
+    {
+        return !mReadFromFile || mWalkedKeys != mFileKeys;
+    }
+
+    void LevelAssetManifest::walkObjects(std::vector<ObjectRecordData> &records, odDb::DependencyTable &levelDependencies)
+    {
+        // request all classes before walking any, so they load concurrently while we inspect those that are done
+        std::vector<std::shared_future<std::shared_ptr<odDb::Class>>> objectClasses;
+        objectClasses.reserve(records.size());
+        for(auto &record : records)
+        {
+            objectClasses.push_back(_requestRef<odDb::Class>(levelDependencies, record.getClassRef()));
+        }
+
+        for(size_t i = 0; i < records.size(); ++i)
+        {
+            auto dbClass = objectClasses[i].valid() ? objectClasses[i].get() : nullptr;
+            if(dbClass == nullptr || dbClass->getDependencyTable() == nullptr)
+            {
+                continue;
+            }
+
+            _walkClass(*dbClass);
+
+            // object fields override class fields, so their references are relative to the class' database, too
+            _walkFields(records[i].getFieldLoader(), *dbClass->getDependencyTable());
+        }
+
+        // classes referenced by fields are queued while walking. walk them, and whatever they reference, breadth-first
+        while(!mClassQueue.empty())
+        {
+            auto dbClass = mClassQueue.front().get();
+            mClassQueue.pop_front();
+
+            if(dbClass != nullptr)
+            {
+                _walkClass(*dbClass);
+            }
+        }
+
+        mWalkedClasses.clear();
+    }
+
+    std::vector<std::shared_ptr<odDb::Asset>> LevelAssetManifest::waitForAll()
+    {
+        std::vector<std::shared_ptr<odDb::Asset>> assets;
+        assets.reserve(mRequests.size());
+        for(auto &request : mRequests)
+        {
+            auto asset = request.second.get();
+            if(asset != nullptr)
+            {
+                assets.push_back(std::move(asset));
+            }
+        }
+
+        return assets;
+    }
+
+    template <typename T>
+    std::shared_future<std::shared_ptr<T>> LevelAssetManifest::_request(const std::shared_ptr<odDb::Database> &db, RecordId id, bool walked)
+    {
+        // stale manifests or broken references may name containers the database doesn't have (anymore). loading
+        //  from those would panic, while we only want to prefetch
+        if(!db->hasAssetContainer(odDb::AssetTraits<T>::baseType()))
+        {
+            Logger::debug() << "Asset manifest skips " << odDb::AssetTraits<T>::name() << " " << id << " in database "
+                            << db->getShortName() << ", which has no " << odDb::AssetTraits<T>::name() << " container";
+            return {};
+        }
+
+        Key key(db.get(), odDb::AssetTraits<T>::baseType(), id);
+        if(walked)
+        {
+            mWalkedKeys.insert(key);
+        }
+
+        auto it = mRequests.find(key);
+        if(it != mRequests.end())
+        {
+            return std::any_cast<std::shared_future<std::shared_ptr<T>>>(it->second.future);
+        }
+
+        auto future = db->loadAssetAsync<T>(id);
+
+        Request &request = mRequests[key];
+        request.database = db;
+        request.future = future;
+        request.get = [future](){ return std::static_pointer_cast<odDb::Asset>(future.get()); };
+
+        return future;
+    }
+
+    template <typename T>
+    std::shared_future<std::shared_ptr<T>> LevelAssetManifest::_requestRef(odDb::DependencyTable &deps, const odDb::AssetRef &ref)
+    {
+        if(ref.isNull())
+        {
+            return {};
+        }
+
+        auto db = deps.getDependency(ref.dbIndex);
+        if(db == nullptr)
+        {
+            Logger::debug() << "Asset manifest skips reference " << ref << " to unknown dependency";
+            return {};
+        }
+
+        return _request<T>(db, ref.assetId, true);
+    }
+
+    bool LevelAssetManifest::_requestByType(const std::shared_ptr<odDb::Database> &db, RecordType type, RecordId id)
+    {
+        if(type == odDb::AssetTraits<odDb::Class>::baseType())
+        {
+            return _request<odDb::Class>(db, id, false).valid();
+
+        }else if(type == odDb::AssetTraits<odDb::Model>::baseType())
+        {
+            return _request<odDb::Model>(db, id, false).valid();
+
+        }else if(type == odDb::AssetTraits<odDb::Texture>::baseType())
+        {
+            return _request<odDb::Texture>(db, id, false).valid();
+
+        }else if(type == odDb::AssetTraits<odDb::Sound>::baseType())
+        {
+            return _request<odDb::Sound>(db, id, false).valid();
+
+        }else if(type == odDb::AssetTraits<odDb::Animation>::baseType())
+        {
+            return _request<odDb::Animation>(db, id, false).valid();
+
+        }else if(type == odDb::AssetTraits<odDb::Sequence>::baseType())
+        {
+            return _request<odDb::Sequence>(db, id, false).valid();
+        }
+
+        return false;
+    }
+
+    void LevelAssetManifest::_walkClass(odDb::Class &dbClass)
+    {
+        if(!mWalkedClasses.insert(&dbClass).second)
+        {
+            return;
+        }
+
+        auto deps = dbClass.getDependencyTable();
+        if(deps == nullptr)
+        {
+            return;
+        }
+
+        if(dbClass.hasModel())
+        {
+            _requestRef<odDb::Model>(*deps, dbClass.getModelRef());
+        }
+
+        _walkFields(dbClass.getFieldLoader(), *deps);
+    }
+
+    void LevelAssetManifest::_walkFields(const odRfl::FieldLoaderProbe &fields, odDb::DependencyTable &deps)
+    {
+        mRefBuffer.clear();
+        fields.getAssetRefs(mRefBuffer);
+
+        for(auto &entry : mRefBuffer)
+        {
+            switch(static_cast<odRfl::Field::Type>(entry.fieldType))
+            {
+            case odRfl::Field::Type::CLASS:
+                {
+                    auto future = _requestRef<odDb::Class>(deps, entry.ref);
+                    if(future.valid())
+                    {
+                        mClassQueue.push_back(std::move(future));
+                    }
+                }
+                break;
+
+            case odRfl::Field::Type::MODEL:
+                _requestRef<odDb::Model>(deps, entry.ref);
+                break;
+
+            case odRfl::Field::Type::SOUND:
+                _requestRef<odDb::Sound>(deps, entry.ref);
+                break;
+
+            case odRfl::Field::Type::ANIMATION:
+                _requestRef<odDb::Animation>(deps, entry.ref);
+                break;
+
+            case odRfl::Field::Type::SEQUENCE:
+                _requestRef<odDb::Sequence>(deps, entry.ref);
+                break;
+
+            case odRfl::Field::Type::TEXTURE:
+                _requestRef<odDb::Texture>(deps, entry.ref);
+                break;
+
+            default:
+                break;
+            }
+        }
+    }
+
+}
@@ -505,19 +505,31 @@ namespace od
 
     void LevelObject::updateAssociatedLayer(bool callChangedHook)
     {
-        odPhysics::PhysicsSystem &ps = mLevel.getPhysicsSystem();
+        odPhysics::RayQuery query;
+        getAssociatedLayerRayQuery(query);
 
+        odPhysics::RayQueryResult result;
+        mLevel.getPhysicsSystem().rayTestClosestBatch(&query, &result, 1);
+
+        updateAssociatedLayer(result, callChangedHook);
+    }
+
+    void LevelObject::getAssociatedLayerRayQuery(odPhysics::RayQuery &query)
+    {
         // a slight upwards offset fixes many association issues with objects whose origin is exactly on the ground
-        glm::vec3 rayStart = getPosition() + (mAssociateWithCeiling ? glm::vec3(0, -0.1, 0) : glm::vec3(0, 0.1, 0));
+        query.from = getPosition() + (mAssociateWithCeiling ? glm::vec3(0, -0.1, 0) : glm::vec3(0, 0.1, 0));
 
         float heightOffset =  mLevel.getVerticalExtent() * (mAssociateWithCeiling ? 1 : -1);
-        glm::vec3 rayEnd = getPosition() + glm::vec3(0, heightOffset, 0);
+        query.to = getPosition() + glm::vec3(0, heightOffset, 0);
 
-        odPhysics::RayTestResult hitResult;
-        ps.rayTestClosest(rayStart, rayEnd, odPhysics::PhysicsTypeMasks::Layer, nullptr, hitResult);
+        query.typeMask = odPhysics::PhysicsTypeMasks::Layer;
+        query.exclude = nullptr;
+    }
 
+    void LevelObject::updateAssociatedLayer(const odPhysics::RayQueryResult &result, bool callChangedHook)
+    {
         od::Layer *oldLayer = mAssociatedLayer;
-        od::Layer *newLayer = (hitResult.handle == nullptr) ? nullptr : &hitResult.handle->asLayerHandle()->getLayer();
+        od::Layer *newLayer = (result.handle == nullptr) ? nullptr : &result.handle->asLayerHandle()->getLayer();
 
         if(oldLayer != newLayer)
         {
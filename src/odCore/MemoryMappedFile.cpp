@@ -0,0 +1,173 @@
+
+#include <odCore/MemoryMappedFile.h>
+
+#if defined (__WIN32__)
+#   include <windows.h>
+#else
+extern "C"
+{
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+}
+#endif
+
+#include <odCore/Panic.h>
+
+namespace od
+{
+
+    MemoryMappedFile::MemoryMappedFile(const FilePath &path)
+    : MemoryMappedFile()
+    {
+        const char *error = _map(path);
+        if(error != nullptr)
+        {
+            OD_PANIC() << error << " '" << path.str() << "'";
+        }
+    }
+
+    std::unique_ptr<MemoryMappedFile> MemoryMappedFile::tryOpen(const FilePath &path)
+    {
+        std::unique_ptr<MemoryMappedFile> file(new MemoryMappedFile());
+        if(file->_map(path) != nullptr)
+        {
+            return nullptr;
+        }
+
+        return file;
+    }
+
+#if defined (__WIN32__)
+
+    MemoryMappedFile::MemoryMappedFile()
+    : mData(nullptr)
+    , mSize(0)
+    , mFileHandle(INVALID_HANDLE_VALUE)
+    , mMappingHandle(nullptr)
+    {
+    }
+
+    const char *MemoryMappedFile::_map(const FilePath &path)
+    {
+        mFileHandle = CreateFileA(path.str().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if(mFileHandle == INVALID_HANDLE_VALUE)
+        {
+            return "Could not open file for mapping";
+        }
+
+        LARGE_INTEGER fileSize;
+        if(!GetFileSizeEx(mFileHandle, &fileSize))
+        {
+            CloseHandle(mFileHandle);
+            mFileHandle = INVALID_HANDLE_VALUE;
+            return "Could not determine size of file";
+        }
+
+        mSize = static_cast<size_t>(fileSize.QuadPart);
+        if(mSize == 0)
+        {
+            // can't map empty files. leave mData at nullptr
+            return nullptr;
+        }
+
+        mMappingHandle = CreateFileMappingA(mFileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if(mMappingHandle == nullptr)
+        {
+            CloseHandle(mFileHandle);
+            mFileHandle = INVALID_HANDLE_VALUE;
+            mSize = 0;
+            return "Could not create mapping for file";
+        }
+
+        mData = static_cast<const char*>(MapViewOfFile(mMappingHandle, FILE_MAP_READ, 0, 0, 0));
+        if(mData == nullptr)
+        {
+            CloseHandle(mMappingHandle);
+            CloseHandle(mFileHandle);
+            mMappingHandle = nullptr;
+            mFileHandle = INVALID_HANDLE_VALUE;
+            mSize = 0;
+            return "Could not map file";
+        }
+
+        return nullptr;
+    }
+
+    MemoryMappedFile::~MemoryMappedFile()
+    {
+        if(mData != nullptr)
+        {
+            UnmapViewOfFile(mData);
+        }
+
+        if(mMappingHandle != nullptr)
+        {
+            CloseHandle(mMappingHandle);
+        }
+
+        if(mFileHandle != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(mFileHandle);
+        }
+    }
+
+#else
+
+    MemoryMappedFile::MemoryMappedFile()
+    : mData(nullptr)
+    , mSize(0)
+    {
+    }
+
+    const char *MemoryMappedFile::_map(const FilePath &path)
+    {
+        int fd = ::open(path.str().c_str(), O_RDONLY);
+        if(fd < 0)
+        {
+            return "Could not open file for mapping";
+        }
+
+        struct stat fileStat;
+        if(::fstat(fd, &fileStat) != 0)
+        {
+            ::close(fd);
+            return "Could not determine size of file";
+        }
+
+        size_t size = static_cast<size_t>(fileStat.st_size);
+        if(size == 0)
+        {
+            // can't map empty files. leave mData at nullptr
+            ::close(fd);
+            return nullptr;
+        }
+
+        void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        // the mapping keeps it's own reference to the file, so we don't need the descriptor anymore
+        ::close(fd);
+
+        if(mapping == MAP_FAILED)
+        {
+            return "Could not map file";
+        }
+
+        mData = static_cast<const char*>(mapping);
+        mSize = size;
+
+        return nullptr;
+    }
+
+    MemoryMappedFile::~MemoryMappedFile()
+    {
+        if(mData != nullptr)
+        {
+            ::munmap(const_cast<char*>(mData), mSize);
+        }
+    }
+
+#endif
+
+}
@@ -9,6 +9,7 @@
 
 #include <thread>
 #include <chrono>
+#include <limits>
 
 #include <odCore/Level.h>
 
@@ -16,11 +17,13 @@
 #include <odCore/net/DownlinkConnector.h>
 #include <odCore/net/MessageDispatcher.h>
 
+#include <odCore/physics/TriggerManager.h>
 #include <odCore/physics/bullet/BulletPhysicsSystem.h>
 
 #include <odCore/rfl/Rfl.h>
 #include <odCore/rfl/RflManager.h>
 
+#include <odCore/state/ClientInterest.h>
 #include <odCore/state/StateManager.h>
 #include <odCore/state/EventQueue.h>
 
@@ -93,8 +96,13 @@ namespace od
     , mRflManager(rflManager)
     , mIsDone(false)
     , mNextClientId(1)
+    , mClientRelevanceDistance(std::numeric_limits<float>::infinity())
+    , mMaxObjectsPerSnapshot(0)
+    , mSnapshotEncoderPool(ThreadPool::getDefaultThreadCount(), "snap encoder")
+    , mServerTime(0.0)
     {
         mPhysicsSystem = std::make_unique<odBulletPhysics::BulletPhysicsSystem>(nullptr);
+        mTriggerManager = std::make_unique<odPhysics::TriggerManager>(*mPhysicsSystem);
     }
 
     Server::~Server()
@@ -112,6 +120,11 @@ namespace od
         clientData->inputManager = std::make_unique<odInput::InputManager>();
         clientData->messageDispatcher = std::make_unique<odNet::DownlinkMessageDispatcher>();
 
+        if(mLevel != nullptr)
+        {
+            _createClientInterest(*clientData);
+        }
+
         mClients[newClientId] = std::move(clientData);
 
         return newClientId;
@@ -123,6 +136,17 @@ namespace od
 
         client.downlinkConnector = connector;
         client.messageDispatcher->setDownlinkConnector(connector);
+
+        if(mLevel != nullptr)
+        {
+            _sendLevelToClient(client);
+        }
+    }
+
+    void Server::removeClient(odNet::ClientId id)
+    {
+        std::lock_guard<std::mutex> lock(mClientsMutex);
+        mClients.erase(id);
     }
 
     std::shared_ptr<odNet::QueuedUplinkConnector> Server::getUplinkConnectorForClient(odNet::ClientId clientId)
@@ -145,6 +169,45 @@ namespace od
         return *(_getClientData(id).messageDispatcher);
     }
 
+    void Server::setClientViewpointObject(odNet::ClientId id, od::LevelObjectId objectId)
+    {
+        auto &client = _getClientData(id);
+        if(client.interest == nullptr)
+        {
+            OD_PANIC() << "Can't set client viewpoint without a loaded level";
+        }
+
+        client.interest->setViewpointObject(objectId);
+    }
+
+    void Server::setClientRelevanceDistance(float distance)
+    {
+        mClientRelevanceDistance = distance;
+
+        std::lock_guard<std::mutex> lock(mClientsMutex);
+        for(auto &client : mClients)
+        {
+            if(client.second->interest != nullptr)
+            {
+                client.second->interest->setRelevanceDistance(distance);
+            }
+        }
+    }
+
+    void Server::setMaxObjectsPerSnapshot(size_t count)
+    {
+        mMaxObjectsPerSnapshot = count;
+
+        std::lock_guard<std::mutex> lock(mClientsMutex);
+        for(auto &client : mClients)
+        {
+            if(client.second->interest != nullptr)
+            {
+                client.second->interest->setMaxObjectsPerSnapshot(count);
+            }
+        }
+    }
+
     LagCompensationGuard Server::compensateLag(odNet::ClientId id)
     {
         double predictedClientViewTime = mServerTime - getEstimatedClientLag(id);
@@ -170,11 +233,6 @@ namespace od
         mLevel = std::make_unique<Level>(engine);
         mLevel->loadLevel(lvlPath.adjustCase(), mDbManager);
 
-        mStateManager = std::make_unique<odState::StateManager>(*mLevel);
-        mEventQueue = std::make_unique<odState::EventQueue>(mDbManager, *mLevel);
-
-        mLevel->spawnAllObjects();
-
         // in order for clients to be able to load the level, we have to give them
         //  a level path that does not depend on the engine root. for levels that are
         //  stored under the engine root, we can just trim off that part of the path.
@@ -182,40 +240,22 @@ namespace od
         //  client where they might find that particular file on their system, so we
         //  fall back to providing the full path, which will work fine for local clients.
         //  networked clients will probably not be used with out-of-tree-levels, anyway.
-        auto relLevelPath = lvlPath.removePrefix(getEngineRootDir()).str();
-
-        // copy clients into temporary vector of pointers which we don't have to synchronize (to prevent deadlocks on recursive accesses to clients)
-        //  TODO: this is duplicate code, see update loop
-        {
-            std::lock_guard<std::mutex> lock(mClientsMutex);
-            mTempClientUpdateList.clear();
-            mTempClientUpdateList.reserve(mClients.size());
-            for(auto &client : mClients)
-            {
-                mTempClientUpdateList.push_back(client.second.get());
-            }
-        }
+        _onLevelLoaded(lvlPath.removePrefix(getEngineRootDir()).str());
+    }
 
-        for(auto client : mTempClientUpdateList)
-        {
-            if(client->downlinkConnector != nullptr)
-            {
-                auto dbCount = mDbManager.getLoadedDatabaseCount();
+    void Server::loadSyntheticLevel(const SyntheticLevelParameters &params)
+    {
+        Logger::verbose() << "Server generating synthetic level";
 
-                client->downlinkConnector->loadLevel(relLevelPath, dbCount);
+        Engine engine(*this);
 
-                mDbManager.forEachLoadedDatabase([this, client](auto db)
-                {
-                    auto relDbPath = db->getDbFilePath().removePrefix(getEngineRootDir()).str();
-                    client->downlinkConnector->globalDatabaseTableEntry(db->getGlobalIndex(), relDbPath);
-                });
-            }
-        }
+        mLevel = std::make_unique<Level>(engine);
+        mLevel->loadSyntheticLevel(params);
 
-        mRflManager.forEachLoadedRfl([this](odRfl::Rfl &rfl){ rfl.onLevelLoaded(*this); });
+        _onLevelLoaded(SYNTHETIC_LEVEL_PATH);
     }
 
-    void Server::run()
+    void Server::run(const std::function<void()> &tickHook)
     {
         Logger::info() << "OpenDrakan server starting...";
 
@@ -232,75 +272,118 @@ namespace od
             double relTime = 1e-9 * std::chrono::duration_cast<std::chrono::nanoseconds>(loopStart - lastUpdateStartTime).count();
             lastUpdateStartTime = loopStart;
 
-            mServerTime += relTime;
-            mEventQueue->setCurrentTime(mServerTime);
-
-            if(mLevel != nullptr)
+            if(tickHook != nullptr)
             {
-                mLevel->update(relTime);
+                tickHook();
             }
 
-            mPhysicsSystem->update(relTime);
+            step(relTime);
 
-            // copy clients into temporary vector of pointers which we don't have to synchronize (to prevent deadlocks on recursive accesses to clients)
+            auto loopEnd = std::chrono::high_resolution_clock::now();
+            auto loopTime = loopEnd - loopStart;
+            if(loopTime < targetUpdateInterval)
             {
-                std::lock_guard<std::mutex> lock(mClientsMutex);
-                mTempClientUpdateList.clear();
-                mTempClientUpdateList.reserve(mClients.size());
-                for(auto &client : mClients)
-                {
-                    mTempClientUpdateList.push_back(client.second.get());
-                }
-            }
+                std::this_thread::sleep_for(targetUpdateInterval - loopTime);
 
-            // update per-client subsystems and process received packets
-            for(auto client : mTempClientUpdateList)
+            }else
             {
-                LocalUplinkConnector localConnector(*this, *client);
-                client->uplinkConnector->flushQueue(localConnector);
+                float loopTimeMs = 1e-3 * std::chrono::duration_cast<std::chrono::microseconds>(loopTime).count();
+                Logger::warn() << "Server tick took too long (" << loopTimeMs << "ms, target was " << (targetUpdateIntervalNs*1e-6)
+                               << "ms. level update: " << mLastTickTimings.levelUpdate << "ms, physics: " << mLastTickTimings.physics
+                               << "ms, clients: " << mLastTickTimings.clients << "ms, commit: " << mLastTickTimings.commit
+                               << "ms, send: " << mLastTickTimings.send << "ms)";
+            }
+        }
+
+        Logger::info() << "Shutting down server gracefully";
+    }
+
+    void Server::step(double relTime)
+    {
+        auto tickStart = std::chrono::steady_clock::now();
+        auto phaseStart = tickStart;
+        auto endPhase = [&phaseStart](double &phaseTime)
+        {
+            auto now = std::chrono::steady_clock::now();
+            phaseTime = 1e-6 * std::chrono::duration_cast<std::chrono::nanoseconds>(now - phaseStart).count();
+            phaseStart = now;
+        };
+
+        mServerTime += relTime;
+        mEventQueue->setCurrentTime(mServerTime);
+
+        if(mLevel != nullptr)
+        {
+            mLevel->update(relTime);
+        }
+        endPhase(mLastTickTimings.levelUpdate);
+
+        mPhysicsSystem->update(relTime);
+        mTriggerManager->update();
+        endPhase(mLastTickTimings.physics);
+
+        _copyClientsToUpdateList();
 
-                client->inputManager->update(relTime);
+        // update per-client subsystems and process received packets
+        for(auto client : mTempClientUpdateList)
+        {
+            LocalUplinkConnector localConnector(*this, *client);
+            client->uplinkConnector->flushQueue(localConnector);
+
+            client->inputManager->update(relTime);
+        }
+        endPhase(mLastTickTimings.clients);
+
+        // commit update
+        mStateManager->commit(mServerTime);
+        mEventQueue->dispatch(mServerTime);
+        endPhase(mLastTickTimings.commit);
+
+        // send update to clients. encode for all the different ticks clients acknowledged at once, so clients
+        //  at the same tick share the work and the rest is spread over the encoder pool
+        odState::TickNumber latestTick = mStateManager->getLatestTick();
+        mTempReferenceTicks.clear();
+        for(auto client : mTempClientUpdateList)
+        {
+            if(latestTick >= client->nextTickToSend && client->downlinkConnector != nullptr)
+            {
+                mTempReferenceTicks.push_back(client->lastAcknowledgedTick);
             }
+        }
 
-            // commit update
-            mStateManager->commit(mServerTime);
-            mEventQueue->dispatch(mServerTime);
+        if(!mTempReferenceTicks.empty())
+        {
+            mStateManager->prepareSnapshotEncodings(latestTick, mTempReferenceTicks, &mSnapshotEncoderPool);
+        }
 
-            // send update to clients
-            odState::TickNumber latestTick = mStateManager->getLatestTick();
-            for(auto client : mTempClientUpdateList)
+        for(auto client : mTempClientUpdateList)
+        {
+            if(latestTick >= client->nextTickToSend)
             {
-                if(latestTick >= client->nextTickToSend)
+                if(client->downlinkConnector != nullptr)
                 {
-                    if(client->downlinkConnector != nullptr)
-                    {
-                        mStateManager->sendSnapshotToClient(latestTick, *client->downlinkConnector, client->lastAcknowledgedTick);
-                    }
-
-                    // for now, send with fixed rate. later, we'd likely adapt the rate with which we send snapshots based on the client's network speed
-                    client->nextTickToSend = latestTick+3;
+                    mStateManager->sendSnapshotToClient(latestTick, *client->downlinkConnector, client->lastAcknowledgedTick, client->interest.get());
                 }
 
-                mEventQueue->sendEventsToClient(*client->downlinkConnector, mServerTime);
+                // for now, send with fixed rate. later, we'd likely adapt the rate with which we send snapshots based on the client's network speed
+                client->nextTickToSend = latestTick+3;
             }
 
-            mEventQueue->markAsSent(mServerTime);
-            mEventQueue->cleanup();
-
-            auto loopEnd = std::chrono::high_resolution_clock::now();
-            auto loopTime = loopEnd - loopStart;
-            if(loopTime < targetUpdateInterval)
+            // clients accepted by a network thread may not have a connector until the next tick
+            if(client->downlinkConnector != nullptr)
             {
-                std::this_thread::sleep_for(targetUpdateInterval - loopTime);
+                mEventQueue->sendEventsToClient(*client->downlinkConnector, mServerTime);
 
-            }else
-            {
-                float loopTimeMs = 1e-3 * std::chrono::duration_cast<std::chrono::microseconds>(loopTime).count();
-                Logger::warn() << "Server tick took too long (" << loopTimeMs << "ms, target was " << (targetUpdateIntervalNs*1e-6) << "ms)";
+                // everything for this tick is out, so connectors that coalesce packets can send them now
+                client->downlinkConnector->flush();
             }
         }
 
-        Logger::info() << "Shutting down server gracefully";
+        mEventQueue->markAsSent(mServerTime);
+        mEventQueue->cleanup();
+        endPhase(mLastTickTimings.send);
+
+        mLastTickTimings.total = 1e-6 * std::chrono::duration_cast<std::chrono::nanoseconds>(phaseStart - tickStart).count();
     }
 
     Server::ClientData &Server::_getClientData(odNet::ClientId id)
@@ -316,6 +399,75 @@ namespace od
         return *it->second;
     }
 
+    void Server::_createClientInterest(ClientData &client)
+    {
+        client.interest = std::make_unique<odState::ClientInterest>(*mLevel);
+        client.interest->setRelevanceDistance(mClientRelevanceDistance);
+        client.interest->setMaxObjectsPerSnapshot(mMaxObjectsPerSnapshot);
+    }
+
+    void Server::_onLevelLoaded(const std::string &clientLevelPath)
+    {
+        mClientLevelPath = clientLevelPath;
+
+        mStateManager = std::make_unique<odState::StateManager>(*mLevel);
+        mEventQueue = std::make_unique<odState::EventQueue>(mDbManager, *mLevel);
+
+        mLevel->spawnAllObjects();
+
+        _copyClientsToUpdateList();
+
+        for(auto client : mTempClientUpdateList)
+        {
+            _createClientInterest(*client);
+            _sendLevelToClient(*client);
+        }
+
+        mRflManager.forEachLoadedRfl([this](odRfl::Rfl &rfl){ rfl.onLevelLoaded(*this); });
+    }
+
+    void Server::_sendLevelToClient(ClientData &client)
+    {
+        if(client.downlinkConnector == nullptr)
+        {
+            return;
+        }
+
+        auto dbCount = mDbManager.getLoadedDatabaseCount();
+
+        client.downlinkConnector->loadLevel(mClientLevelPath, dbCount, mStateManager->getQuantization());
+
+        mDbManager.forEachLoadedDatabase([this, &client](auto db)
+        {
+            auto relDbPath = db->getDbFilePath().removePrefix(getEngineRootDir()).str();
+            client.downlinkConnector->globalDatabaseTableEntry(db->getGlobalIndex(), relDbPath);
+        });
+
+        client.downlinkConnector->flush();
+    }
+
+    void Server::_copyClientsToUpdateList()
+    {
+        // copy clients into temporary vector of pointers which we don't have to synchronize (to prevent deadlocks on recursive accesses to clients)
+        std::lock_guard<std::mutex> lock(mClientsMutex);
+        mTempClientUpdateList.clear();
+        mTempClientUpdateList.reserve(mClients.size());
+        for(auto &client : mClients)
+        {
+            mTempClientUpdateList.push_back(client.second.get());
+        }
+    }
+
+    Server::TickTimings::TickTimings()
+    : levelUpdate(0.0)
+    , physics(0.0)
+    , clients(0.0)
+    , commit(0.0)
+    , send(0.0)
+    , total(0.0)
+    {
+    }
+
     Server::ClientData::ClientData()
     : nextTickToSend(odState::FIRST_TICK)
     , lastAcknowledgedTick(odState::INVALID_TICK)
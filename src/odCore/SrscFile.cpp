@@ -15,6 +15,7 @@
 #include <algorithm>
 
 #include <odCore/DataStream.h>
+#include <odCore/MemoryMappedFile.h>
 #include <odCore/Panic.h>
 
 namespace od
@@ -46,14 +47,18 @@ namespace od
         return false;
     }
 
-    SrscFile::RecordInputCursor::RecordInputCursor(SrscFile &file, std::mutex &mutex, DirIterator &dirIt)
+    SrscFile::RecordInputCursor::RecordInputCursor(SrscFile &file, DirIterator &dirIt)
     : mFile(file)
     , mDirIterator(dirIt)
-    , mLock(mutex, std::try_to_lock)
     {
-        if(!mLock.owns_lock())
+        // mapped files are immutable, so cursors on them don't need to lock anything
+        if(mFile.getAccessMode() == AccessMode::STREAM)
         {
-            OD_PANIC() << "Created input cursor for SrscFile when file was still locked (probably by another cursor)";
+            mLock = std::unique_lock<std::mutex>(mFile.mMutex, std::try_to_lock);
+            if(!mLock.owns_lock())
+            {
+                OD_PANIC() << "Created input cursor for SrscFile when file was still locked (probably by another cursor)";
+            }
         }
     }
 
@@ -64,6 +69,10 @@ namespace od
     {
     }
 
+    SrscFile::RecordInputCursor::~RecordInputCursor()
+    {
+    }
+
     DataReader SrscFile::RecordInputCursor::getReader()
     {
         if(!isValid())
@@ -71,15 +80,20 @@ namespace od
             OD_PANIC() << "Tried to access record using invalid cursor";
         }
 
-        //size_t availableBytes = mDirIterator->dataSize;
-        //return DataReader(mFile.getStreamForRecord(*mDirIterator), availableBytes);
+        if(mFile.getAccessMode() == AccessMode::MEMORY_MAPPED)
+        {
+            // memory-backed readers let decoders work on the mapping directly (e.g. inflating whole blocks in one call)
+            const char *data = mFile.getMappedRecordData(mDirIterator);
+            return DataReader(data, mDirIterator->dataSize);
+        }
 
         return DataReader(mFile.getStreamForRecord(mDirIterator));
     }
 
     bool SrscFile::RecordInputCursor::isValid()
     {
-        return (mDirIterator != mFile.getDirectoryEnd()) && mLock.owns_lock();
+        bool hasAccess = (mFile.getAccessMode() == AccessMode::MEMORY_MAPPED) || mLock.owns_lock();
+        return (mDirIterator != mFile.getDirectoryEnd()) && hasAccess;
     }
 
     bool SrscFile::RecordInputCursor::next()
@@ -118,8 +132,9 @@ namespace od
     }
 
 
-	SrscFile::SrscFile(const FilePath &filePath)
+	SrscFile::SrscFile(const FilePath &filePath, AccessMode accessMode)
 	: mFilePath(filePath)
+	, mAccessMode(accessMode)
 	{
 		mInputStream.open(mFilePath.str().c_str(), std::ios::in | std::ios::binary);
 		if(mInputStream.fail())
@@ -128,6 +143,12 @@ namespace od
 		}
 
 		_readHeaderAndDirectory();
+
+		if(mAccessMode == AccessMode::MEMORY_MAPPED)
+		{
+		    // we keep the ifstream open anyway, so the low level stream interface remains usable in both modes
+		    mMappedFile = std::make_unique<MemoryMappedFile>(mFilePath);
+		}
 	}
 
 	SrscFile::~SrscFile()
@@ -153,28 +174,55 @@ namespace od
 		return mInputStream;
 	}
 
+	const char *SrscFile::getMappedRecordData(const DirIterator &dirIt)
+	{
+	    _checkDirIterator(dirIt);
+
+	    if(mMappedFile == nullptr)
+	    {
+	        OD_PANIC() << "Tried to access mapped record data of SRSC file that was not opened in memory mapped mode";
+	    }
+
+	    size_t recordEnd = static_cast<size_t>(dirIt->dataOffset) + dirIt->dataSize;
+	    if(recordEnd > mMappedFile->getSize())
+	    {
+	        OD_PANIC() << "Record " << dirIt->index << " exceeds bounds of SRSC file '" << mFilePath.str() << "'";
+	    }
+
+	    return mMappedFile->getData() + dirIt->dataOffset;
+	}
+
+	SrscFile::DirIterator SrscFile::findFirstRecordOfType(RecordType type)
+	{
+	    return _lookupIndex(mFirstOfTypeIndex, type);
+	}
+
+	SrscFile::DirIterator SrscFile::findFirstRecordOfId(RecordId id)
+	{
+	    return _lookupIndex(mFirstOfIdIndex, id);
+	}
+
+	SrscFile::DirIterator SrscFile::findFirstRecordOfTypeId(RecordType type, RecordId id)
+	{
+	    return _lookupIndex(mFirstOfTypeIdIndex, _typeIdKey(type, id));
+	}
+
 	SrscFile::RecordInputCursor SrscFile::getFirstRecordOfType(RecordType type)
 	{
-	    auto pred = [type](const SrscFile::DirEntry &d) { return d.type == type; }; // TODO: duplicate predicate (see RecordInputCursor)
-	    auto it = std::find_if(getDirectoryBegin(), getDirectoryEnd(), pred);
-	    return RecordInputCursor(*this, mMutex, it);
+	    auto it = findFirstRecordOfType(type);
+	    return RecordInputCursor(*this, it);
 	}
 
     SrscFile::RecordInputCursor SrscFile::getFirstRecordOfId(RecordId id)
     {
-        // TODO: we could create a map indexing the first record of every ID, thus speeding up finding assets in a file immensely
-        //  or maybe let the asset containers do that. IDK
-
-        auto pred = [id](const SrscFile::DirEntry &d) { return d.recordId == id; };
-        auto it = std::find_if(getDirectoryBegin(), getDirectoryEnd(), pred);
-        return RecordInputCursor(*this, mMutex, it);
+        auto it = findFirstRecordOfId(id);
+        return RecordInputCursor(*this, it);
     }
 
     SrscFile::RecordInputCursor SrscFile::getFirstRecordOfTypeId(RecordType type, RecordId id)
     {
-        auto pred = [type, id](const SrscFile::DirEntry &d) { return d.type == type && d.recordId == id; };
-        auto it = std::find_if(getDirectoryBegin(), getDirectoryEnd(), pred);
-        return RecordInputCursor(*this, mMutex, it);
+        auto it = findFirstRecordOfTypeId(type, id);
+        return RecordInputCursor(*this, it);
     }
 
 	void SrscFile::decompressAll(const od::FilePath &outputDir, bool extractRaw)
@@ -253,6 +301,39 @@ namespace od
 
 			mDirectory[i] = entry;
 		}
+
+		_buildDirectoryIndex();
+	}
+
+	void SrscFile::_buildDirectoryIndex()
+	{
+	    mFirstOfTypeIndex.clear();
+	    mFirstOfIdIndex.clear();
+	    mFirstOfTypeIdIndex.clear();
+
+	    mFirstOfIdIndex.reserve(mDirectory.size());
+	    mFirstOfTypeIdIndex.reserve(mDirectory.size());
+
+	    // emplace won't overwrite existing keys, so iterating in directory order leaves us with the first occurrences
+	    for(size_t i = 0; i < mDirectory.size(); ++i)
+	    {
+	        const DirEntry &entry = mDirectory[i];
+	        mFirstOfTypeIndex.emplace(entry.type, i);
+	        mFirstOfIdIndex.emplace(entry.recordId, i);
+	        mFirstOfTypeIdIndex.emplace(_typeIdKey(entry.type, entry.recordId), i);
+	    }
+	}
+
+	template <typename K>
+	SrscFile::DirIterator SrscFile::_lookupIndex(const std::unordered_map<K, size_t> &index, K key)
+	{
+	    auto it = index.find(key);
+	    if(it == index.end())
+	    {
+	        return getDirectoryEnd();
+	    }
+
+	    return getDirectoryBegin() + it->second;
 	}
 
     void SrscFile::_checkDirIterator(const DirIterator &dirIt)
@@ -0,0 +1,87 @@
+
+#include <odCore/ThreadPool.h>
+
+#include <odCore/Panic.h>
+#include <odCore/ThreadUtils.h>
+
+namespace od
+{
+
+    size_t ThreadPool::getDefaultThreadCount()
+    {
+        size_t count = std::thread::hardware_concurrency();
+        return (count > 0) ? count : 1;
+    }
+
+    ThreadPool::ThreadPool(size_t threadCount, const char *name)
+    : mTerminate(false)
+    {
+        if(threadCount == 0)
+        {
+            OD_PANIC() << "Thread pool needs at least one worker";
+        }
+
+        mWorkers.reserve(threadCount);
+        for(size_t i = 0; i < threadCount; ++i)
+        {
+            mWorkers.emplace_back(&ThreadPool::_workerFunc, this);
+            ThreadUtils::setThreadName(mWorkers.back(), name);
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mQueueMutex);
+            mTerminate = true;
+        }
+        mQueueCondition.notify_all();
+
+        for(auto &worker : mWorkers)
+        {
+            if(worker.joinable())
+            {
+                worker.join();
+            }
+        }
+    }
+
+    void ThreadPool::submit(std::function<void()> job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mQueueMutex);
+            if(mTerminate)
+            {
+                OD_PANIC() << "Submitted job to thread pool that is shutting down";
+            }
+
+            mQueue.push_back(std::move(job));
+        }
+        mQueueCondition.notify_one();
+    }
+
+    void ThreadPool::_workerFunc()
+    {
+        for(;;)
+        {
+            std::function<void()> job;
+
+            {
+                std::unique_lock<std::mutex> lock(mQueueMutex);
+                mQueueCondition.wait(lock, [this](){ return mTerminate || !mQueue.empty(); });
+
+                // drain the queue before terminating so nobody is left waiting on a job that never runs
+                if(mQueue.empty())
+                {
+                    return;
+                }
+
+                job = std::move(mQueue.front());
+                mQueue.pop_front();
+            }
+
+            job();
+        }
+    }
+
+}
@@ -7,6 +7,14 @@
 
 #include <odCore/ZStream.h>
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#if defined(OD_HAVE_LIBDEFLATE)
+#   include <libdeflate.h>
+#endif
+
 #include <odCore/Panic.h>
 
 namespace od
@@ -59,14 +67,46 @@ namespace od
     	mStreamEnded = false;
     }
 
+    void ZStreamBuffer::inflateInto(char *dest, size_t size)
+    {
+        // hand out whatever is left in the output buffer first
+        size_t buffered = std::min(static_cast<size_t>(egptr() - gptr()), size);
+        if(buffered > 0)
+        {
+            std::memcpy(dest, gptr(), buffered);
+            setg(eback(), gptr() + buffered, egptr());
+        }
+
+        size_t remaining = size - buffered;
+        if(remaining > 0)
+        {
+            size_t produced = _inflate(reinterpret_cast<Bytef*>(dest + buffered), remaining);
+            if(produced != remaining)
+            {
+                OD_PANIC() << "Zlib data ended after " << (buffered + produced) << " bytes while inflating block of " << size << " bytes";
+            }
+        }
+    }
+
     ZStreamBuffer::int_type ZStreamBuffer::underflow()
     {
-    	if(mStreamEnded)
+        size_t produced = _inflate(mOutputBuffer.data(), mOutputBuffer.size());
+
+        char *outputStart = reinterpret_cast<char*>(mOutputBuffer.data());
+        char *outputEnd = outputStart + produced;
+        setg(outputStart, outputStart, outputEnd);
+
+        return (outputStart == outputEnd) ? traits_type::eof() : traits_type::to_int_type(*gptr());
+    }
+
+    size_t ZStreamBuffer::_inflate(Bytef *dest, size_t size)
+    {
+    	if(mStreamEnded || size == 0)
     	{
-    		return traits_type::eof();
+    		return 0;
     	}
 
-    	if(!mStreamActive && !mStreamEnded)
+    	if(!mStreamActive)
     	{
     		//Logger::debug() << "Zstream not yet active. Activating";
 
@@ -75,6 +115,8 @@ namespace od
     		mZStream.zalloc = Z_NULL;
     		mZStream.zfree = Z_NULL;
     		mZStream.opaque = Z_NULL;
+    		mZStream.next_in = Z_NULL;
+    		mZStream.avail_in = 0;
 
     		int ret = inflateInit(&mZStream);
 			if(ret != Z_OK)
@@ -85,14 +127,13 @@ namespace od
 			mStreamActive = true;
     	}
 
-        // decompress
-        mOutputEnd = mOutputBuffer.data();
-        do
+        mZStream.next_out = dest;
+        mZStream.avail_out = size;
+        while(mZStream.avail_out > 0)
         {
         	// fill input buffer if no input available anymore
 			if(mInputStart == mInputEnd)
 			{
-				//Logger::debug() << "Filling input buffer";
 				mInputStart = mInputBuffer.data();
 				mInputStream.read(reinterpret_cast<char*>(mInputBuffer.data()), mInputBuffer.size());
 				mInputEnd = mInputBuffer.data() + mInputStream.gcount();
@@ -100,23 +141,12 @@ namespace od
 				if(mInputEnd == mInputStart)
 				{
 					// no input was read. can't produce more output -> EOF
-					return traits_type::eof();
+					break;
 				}
 			}
 
-			/*if(initialRun)
-			{
-				Logger::debug() << "First call to inflate. Header: " << std::hex << (int)(*mInputStart) << " " << (int)(*mInputStart+1) << std::dec;
-
-			}else
-			{
-				Logger::debug() << "Repeated call to inflate";
-			}*/
-
 			mZStream.next_in = mInputStart;
 			mZStream.avail_in = mInputEnd - mInputStart;
-			mZStream.next_out = mOutputBuffer.data();
-			mZStream.avail_out = mOutputBuffer.size();
 			int ret = inflate(&mZStream, Z_NO_FLUSH);
 			if(ret != Z_OK && ret != Z_STREAM_END)
 			{
@@ -125,35 +155,24 @@ namespace od
 
 			mInputStart = mZStream.next_in;
 			mInputEnd = mInputStart + mZStream.avail_in;
-			mOutputEnd = mZStream.next_out;
 
 			if(ret == Z_STREAM_END)
 			{
 				// all zlib data has been decompressed. avail_in contains the amount of bytes
 				//  read from stream that we didn't use
-
-				//Logger::debug() << "Zstream has ended";
-
 				mInputStream.clear(); // important!! tellg tells rubbish otherwise
 				mZlibDataEnd = (int)mInputStream.tellg() - mZStream.avail_in;
-				//Logger::debug() << "We have " << mZStream.avail_in << " bytes left in input buffer. ZlibEnd is at " << mZlibDataEnd;
 				mStreamActive = false;
 				mStreamEnded = true;
 				inflateEnd(&mZStream);
 				break;
 			}
+        }
 
-			// keep looping while until inflate() produced output or tells us the stream has ended
-        } while(mOutputEnd == mOutputBuffer.data());
-
-        char *outputStart = reinterpret_cast<char*>(mOutputBuffer.data());
-        char *outputEnd = reinterpret_cast<char*>(mOutputEnd);
-        setg(outputStart, outputStart, outputEnd);
-
-        return (outputStart == outputEnd) ? traits_type::eof() : traits_type::to_int_type(*gptr());
+        return size - mZStream.avail_out;
     }
 
-    void ZStreamBuffer::_error(int zlibError)
+    static const char *_zlibErrorName(int zlibError)
     {
         const char *msg = "";
     	switch(zlibError)
@@ -183,7 +202,12 @@ namespace od
             break;
         }
 
-        OD_PANIC() << mZStream.msg << " (" << msg << ")";
+        return msg;
+    }
+
+    void ZStreamBuffer::_error(int zlibError)
+    {
+        OD_PANIC() << mZStream.msg << " (" << _zlibErrorName(zlibError) << ")";
     }
 
 
@@ -209,4 +233,125 @@ namespace od
     	delete rdbuf();
     }
 
+    /**
+     * @brief Inflates src into dest using zlib. Output beyond destSize is inflated into a scratch buffer and dropped,
+     * so we still know where the zlib data ends.
+     */
+    static size_t _inflateBufferWithZlib(const char *src, size_t srcSize, char *dest, size_t destSize)
+    {
+        z_stream zs;
+        zs.zalloc = Z_NULL;
+        zs.zfree = Z_NULL;
+        zs.opaque = Z_NULL;
+        zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(src));
+        zs.avail_in = srcSize;
+
+        int ret = inflateInit(&zs);
+        if(ret != Z_OK)
+        {
+            OD_PANIC() << "Could not initialize zlib (" << _zlibErrorName(ret) << ")";
+        }
+
+        zs.next_out = reinterpret_cast<Bytef*>(dest);
+        zs.avail_out = destSize;
+        ret = inflate(&zs, Z_FINISH);
+
+        size_t produced = destSize - zs.avail_out;
+
+        // if dest is full but the stream hasn't ended, zlib returns Z_OK or Z_BUF_ERROR. keep going until it ends
+        Bytef scratch[1024];
+        while(produced == destSize && (ret == Z_OK || ret == Z_BUF_ERROR) && zs.avail_in > 0)
+        {
+            uInt availIn = zs.avail_in;
+            zs.next_out = scratch;
+            zs.avail_out = sizeof(scratch);
+            ret = inflate(&zs, Z_FINISH);
+            if(zs.avail_in == availIn && zs.avail_out == sizeof(scratch))
+            {
+                break;
+            }
+        }
+
+        size_t consumed = srcSize - zs.avail_in;
+        inflateEnd(&zs);
+
+        // errors in the dropped output don't matter. only too little output does
+        if(produced != destSize)
+        {
+            OD_PANIC() << "Failed to inflate zlib block of " << srcSize << " bytes into " << destSize << " bytes. Got only " << produced << " bytes (" << _zlibErrorName(ret) << ")";
+        }
+
+        return consumed;
+    }
+
+#if defined(OD_HAVE_LIBDEFLATE)
+
+    size_t ZStream::inflateBuffer(const char *src, size_t srcSize, char *dest, size_t destSize)
+    {
+        // decompressors are not thread safe, but cheap to keep around. give each thread it's own
+        struct Decompressor
+        {
+            Decompressor() : d(libdeflate_alloc_decompressor()) {}
+            ~Decompressor() { libdeflate_free_decompressor(d); }
+            libdeflate_decompressor *d;
+        };
+        static thread_local Decompressor decompressor;
+
+        if(decompressor.d == nullptr)
+        {
+            OD_PANIC() << "Could not allocate libdeflate decompressor";
+        }
+
+        size_t consumed = 0;
+        size_t produced = 0;
+        libdeflate_result result = libdeflate_zlib_decompress_ex(decompressor.d, src, srcSize, dest, destSize, &consumed, &produced);
+        if(result == LIBDEFLATE_INSUFFICIENT_SPACE)
+        {
+            // the block holds more than we asked for. libdeflate can't stop early, so let zlib deal with that rare case
+            return _inflateBufferWithZlib(src, srcSize, dest, destSize);
+        }
+
+        if(result != LIBDEFLATE_SUCCESS || produced != destSize)
+        {
+            OD_PANIC() << "Failed to inflate zlib block of " << srcSize << " bytes into " << destSize << " bytes (libdeflate result " << result << ")";
+        }
+
+        return consumed;
+    }
+
+#else
+
+    size_t ZStream::inflateBuffer(const char *src, size_t srcSize, char *dest, size_t destSize)
+    {
+        return _inflateBufferWithZlib(src, srcSize, dest, destSize);
+    }
+
+#endif
+
+    void ZStream::inflateFromReader(DataReader &dr, size_t compressedSize, char *dest, size_t destSize)
+    {
+        if(dr.isMemoryBacked())
+        {
+            // stored compressed sizes aren't always exact. offer everything that's left and let zlib find the end
+            size_t available = dr.getRemainingSize();
+            size_t consumed = inflateBuffer(dr.peekBuffer(available), available, dest, destSize);
+            dr.ignore(consumed);
+
+        }else
+        {
+            // everything goes straight to dest, so the output buffer is only needed for dropping excess output. the
+            //  compressed size only serves as a hint for the input buffer, as the stream refills it as needed
+            size_t inputBufferSize = std::max<size_t>(1, std::min(ZStreamBuffer::DefaultBufferSize, compressedSize));
+            ZStream zstr(dr.getStream(), inputBufferSize, 1024);
+            zstr.inflateInto(dest, destSize);
+
+            // drop any output beyond destSize, so we find the end of the zlib data
+            zstr.ignore(std::numeric_limits<std::streamsize>::max());
+            if(zstr.hasStreamEnded())
+            {
+                zstr.seekToEndOfZlib();
+            }
+        }
+    }
+
 }
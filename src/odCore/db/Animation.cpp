@@ -53,6 +53,11 @@ namespace odDb
         _loadFrameLookup(cursor.getReader());
     }
 
+    size_t Animation::getMemoryFootprint() const
+    {
+        return sizeof(Animation) + mKeyframes.capacity()*sizeof(Keyframe) + mFrameLookup.capacity()*sizeof(FrameLookupEntry);
+    }
+
 	std::pair<Animation::KfIterator, Animation::KfIterator> Animation::getKeyframesForNode(int32_t nodeId)
 	{
 		if(nodeId < 0 || (size_t)nodeId >= mFrameLookup.size())
@@ -148,12 +153,17 @@ namespace odDb
         uint16_t frameCount;
         dr >> frameCount;
 
+        // each keyframe is a float time followed by a 3x4 matrix of floats
+        static constexpr size_t KEYFRAME_RECORD_SIZE = 13*sizeof(float);
+        std::vector<char> frameStorage;
+        od::DataReader frameReader = dr.readBlock(frameCount*KEYFRAME_RECORD_SIZE, frameStorage);
+
         mKeyframes.reserve(frameCount);
         for(size_t i = 0; i < frameCount; ++i)
         {
             Keyframe kf;
-            dr >> kf.time
-               >> kf.xform;
+            frameReader >> kf.time
+                        >> kf.xform;
 
             mMinTime = std::min(mMinTime, kf.time);
             mMaxTime = std::max(mMaxTime, kf.time);
@@ -36,4 +36,9 @@ namespace odDb
 	{
 	}
 
+	size_t Asset::getMemoryFootprint() const
+	{
+	    return sizeof(Asset);
+	}
+
 }
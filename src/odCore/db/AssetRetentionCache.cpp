@@ -0,0 +1,130 @@
+
+#include <odCore/db/AssetRetentionCache.h>
+
+#include <algorithm>
+
+#include <odCore/Logger.h>
+
+#include <odCore/db/Asset.h>
+
+namespace odDb
+{
+
+    AssetRetentionCache::AssetRetentionCache(size_t budget)
+    : mStats({budget, 0, 0, 0, 0, 0})
+    {
+    }
+
+    AssetRetentionCache::~AssetRetentionCache()
+    {
+        // release everything while our members are still intact. destroying an asset might destroy it's
+        //  database, whose factories will call release() on us
+        setBudget(0);
+    }
+
+    void AssetRetentionCache::setBudget(size_t budget)
+    {
+        LruList evicted;
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStats.budget = budget;
+            _evictToBudget(evicted);
+        }
+    }
+
+    AssetRetentionCache::Stats AssetRetentionCache::getStats()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mStats;
+    }
+
+    void AssetRetentionCache::touch(const std::shared_ptr<Asset> &asset)
+    {
+        if(asset == nullptr)
+        {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto it = mEntryMap.find(asset.get());
+            if(it != mEntryMap.end())
+            {
+                mLruList.splice(mLruList.begin(), mLruList, it->second);
+                return;
+            }
+
+            if(mStats.budget == 0)
+            {
+                return;
+            }
+        }
+
+        // the footprint is queried outside the lock, as it might be expensive to calculate
+        size_t size = asset->getMemoryFootprint();
+
+        LruList evicted;
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            if(size > mStats.budget || mEntryMap.find(asset.get()) != mEntryMap.end())
+            {
+                return;
+            }
+
+            mLruList.push_front(Entry{asset, size});
+            mEntryMap[asset.get()] = mLruList.begin();
+            mStats.retainedBytes += size;
+            mStats.retainedCount += 1;
+            mStats.peakRetainedBytes = std::max(mStats.peakRetainedBytes, mStats.retainedBytes);
+
+            _evictToBudget(evicted);
+        }
+
+        // evicted assets die here, outside the lock, as their destructors might release other assets
+    }
+
+    void AssetRetentionCache::release(const Asset *asset)
+    {
+        LruList released;
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            auto it = mEntryMap.find(asset);
+            if(it == mEntryMap.end())
+            {
+                return;
+            }
+
+            mStats.retainedBytes -= it->second->size;
+            mStats.retainedCount -= 1;
+            released.splice(released.begin(), mLruList, it->second);
+            mEntryMap.erase(it);
+        }
+    }
+
+    void AssetRetentionCache::_evictToBudget(LruList &evicted)
+    {
+        while(mStats.retainedBytes > mStats.budget && !mLruList.empty())
+        {
+            auto last = std::prev(mLruList.end());
+
+            mStats.retainedBytes -= last->size;
+            mStats.retainedCount -= 1;
+            mStats.evictionCount += 1;
+            mStats.evictedBytes += last->size;
+
+            mEntryMap.erase(last->asset.get());
+            evicted.splice(evicted.begin(), mLruList, last);
+        }
+
+        if(!evicted.empty())
+        {
+            Logger::debug() << "Evicted " << evicted.size() << " assets from retention cache. " << mStats.retainedBytes << " of " << mStats.budget << " bytes in use";
+        }
+    }
+
+}
@@ -30,8 +30,12 @@ namespace odDb
         od::FilePath path = mDbFilePath.ext(extension);
         if(path.exists())
         {
-            containerPtr = std::make_unique<od::SrscFile>(path);
+            // asset containers are mapped so assets from the same container can be loaded concurrently
+            containerPtr = std::make_unique<od::SrscFile>(path, od::SrscFile::AccessMode::MEMORY_MAPPED);
             factoryPtr = std::make_unique<T>(mDependencyTable, *containerPtr);
+            factoryPtr->setLoaderPool(&mDbManager.getLoaderPool());
+            factoryPtr->setDecodedAssetCache(&mDbManager.getDecodedAssetCache());
+            factoryPtr->setRetentionCache(&mDbManager.getRetentionCache());
 
             Logger::verbose() << AssetTraits<typename T::AssetType>::name() << " container of database opened";
 
@@ -42,6 +46,28 @@ namespace odDb
     }
 
 
+    template <typename T>
+    void Database::_waitForPendingLoads(std::unique_ptr<T> &factoryPtr)
+    {
+        if(factoryPtr != nullptr)
+        {
+            factoryPtr->waitForPendingLoads();
+        }
+    }
+
+
+    template <typename T>
+    std::shared_future<std::shared_ptr<typename T::AssetType>> Database::_loadAssetAsync(std::unique_ptr<T> &factoryPtr, od::RecordId recordId)
+    {
+        if(factoryPtr == nullptr)
+        {
+            OD_PANIC() << "Can't load " << AssetTraits<typename T::AssetType>::name() << ". Database has no " << AssetTraits<typename T::AssetType>::name() << " container";
+        }
+
+        return factoryPtr->getAssetAsync(recordId);
+    }
+
+
 	Database::Database(const od::FilePath &dbFilePath, DbManager &dbManager, GlobalDatabaseIndex globalIndex)
 	: mDbFilePath(dbFilePath)
 	, mDbManager(dbManager)
@@ -53,6 +79,13 @@ namespace odDb
 
 	Database::~Database()
 	{
+	    // queued loads refer to the factories, so they must be settled before any factory is destroyed
+	    _waitForPendingLoads(mTextureFactory);
+	    _waitForPendingLoads(mModelFactory);
+	    _waitForPendingLoads(mClassFactory);
+	    _waitForPendingLoads(mAnimFactory);
+	    _waitForPendingLoads(mSoundFactory);
+	    _waitForPendingLoads(mSequenceFactory);
 	}
 
 	void Database::loadDbFileAndDependencies(size_t dependencyDepth)
@@ -192,6 +225,72 @@ namespace odDb
         return this->loadSound(id);
     }
 
+    template<>
+    std::shared_future<std::shared_ptr<Texture>> Database::loadAssetAsync<Texture>(od::RecordId id)
+    {
+        return _loadAssetAsync(mTextureFactory, id);
+    }
+
+    template<>
+    std::shared_future<std::shared_ptr<Class>> Database::loadAssetAsync<Class>(od::RecordId id)
+    {
+        return _loadAssetAsync(mClassFactory, id);
+    }
+
+    template<>
+    std::shared_future<std::shared_ptr<Model>> Database::loadAssetAsync<Model>(od::RecordId id)
+    {
+        return _loadAssetAsync(mModelFactory, id);
+    }
+
+    template<>
+    std::shared_future<std::shared_ptr<Sequence>> Database::loadAssetAsync<Sequence>(od::RecordId id)
+    {
+        return _loadAssetAsync(mSequenceFactory, id);
+    }
+
+    template<>
+    std::shared_future<std::shared_ptr<Animation>> Database::loadAssetAsync<Animation>(od::RecordId id)
+    {
+        return _loadAssetAsync(mAnimFactory, id);
+    }
+
+    template<>
+    std::shared_future<std::shared_ptr<Sound>> Database::loadAssetAsync<Sound>(od::RecordId id)
+    {
+        return _loadAssetAsync(mSoundFactory, id);
+    }
+
+    bool Database::hasAssetContainer(od::RecordType baseType) const
+    {
+        if(baseType == AssetTraits<Texture>::baseType())
+        {
+            return mTextureFactory != nullptr;
+
+        }else if(baseType == AssetTraits<Class>::baseType())
+        {
+            return mClassFactory != nullptr;
+
+        }else if(baseType == AssetTraits<Model>::baseType())
+        {
+            return mModelFactory != nullptr;
+
+        }else if(baseType == AssetTraits<Sequence>::baseType())
+        {
+            return mSequenceFactory != nullptr;
+
+        }else if(baseType == AssetTraits<Animation>::baseType())
+        {
+            return mAnimFactory != nullptr;
+
+        }else if(baseType == AssetTraits<Sound>::baseType())
+        {
+            return mSoundFactory != nullptr;
+        }
+
+        return false;
+    }
+
 	std::shared_ptr<Texture> Database::loadTexture(od::RecordId recordId)
 	{
 		if(mTextureFactory == nullptr)
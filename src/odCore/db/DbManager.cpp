@@ -18,9 +18,13 @@ namespace odDb
 {
 
     static constexpr size_t MAX_DEPENDENCY_DEPTH{100};
+    static constexpr size_t DEFAULT_RETENTION_BUDGET{128 * 1024 * 1024};
 
 
     DbManager::DbManager()
+    : mLevelManifestWritingEnabled(false)
+    , mRetentionCache(DEFAULT_RETENTION_BUDGET)
+    , mLoaderPool(od::ThreadPool::getDefaultThreadCount(), "asset loader")
     {
     }
 
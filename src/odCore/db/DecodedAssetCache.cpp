@@ -0,0 +1,273 @@
+
+#include <odCore/db/DecodedAssetCache.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+#if defined (__WIN32__)
+#   include <windows.h>
+#endif
+extern "C"
+{
+#   include <sys/stat.h>
+}
+
+#include <odCore/Logger.h>
+#include <odCore/MemoryMappedFile.h>
+
+namespace odDb
+{
+
+    static const char CACHE_ENTRY_MAGIC[4] = { 'O', 'D', 'A', 'C' };
+    static constexpr uint32_t CACHE_FORMAT_VERSION = 1;
+    static constexpr size_t PAYLOAD_ALIGNMENT = 16;
+
+    // magic, format version, decoder version, record type, record id, container mtime, container size, payload offset, payload size
+    static constexpr size_t FIXED_HEADER_SIZE = 4 + 4 + 4 + 2 + 2 + 8 + 8 + 4 + 8;
+
+
+    static bool _statFile(const std::string &path, int64_t &mtime, uint64_t &size)
+    {
+        struct stat fileStat;
+        if(::stat(path.c_str(), &fileStat) != 0)
+        {
+            return false;
+        }
+
+        mtime = static_cast<int64_t>(fileStat.st_mtime);
+        size = static_cast<uint64_t>(fileStat.st_size);
+        return true;
+    }
+
+    static uint64_t _fnv1a(uint64_t hash, const void *data, size_t size)
+    {
+        const uint8_t *bytes = static_cast<const uint8_t*>(data);
+        for(size_t i = 0; i < size; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 0x100000001b3;
+        }
+
+        return hash;
+    }
+
+
+    DecodedAssetCache::DecodedAssetCache()
+    : mEnabled(false)
+    , mHitCount(0)
+    , mMissCount(0)
+    {
+    }
+
+    void DecodedAssetCache::setCacheDirectory(const od::FilePath &dir)
+    {
+#if defined (__WIN32__)
+        bool created = CreateDirectoryA(dir.str().c_str(), nullptr) || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+        bool created = (::mkdir(dir.str().c_str(), 0755) == 0) || errno == EEXIST;
+#endif
+        if(!created)
+        {
+            Logger::warn() << "Could not create decoded asset cache directory " << dir << ". Decoded asset cache stays disabled";
+            return;
+        }
+
+        mCacheDirectory = dir;
+        mEnabled = true;
+
+        Logger::info() << "Caching decoded assets in " << dir;
+    }
+
+    bool DecodedAssetCache::loadAsset(od::SrscFile &container, od::RecordType type, od::RecordId id, DecodedCacheable &asset)
+    {
+        uint32_t decoderVersion = asset.getDecoderVersion();
+        if(!mEnabled)
+        {
+            return false;
+        }
+
+        ContainerStamp stamp;
+        if(!_getContainerStamp(container, stamp))
+        {
+            return false;
+        }
+
+        std::string containerPath = container.getFilePath().str();
+        od::FilePath entryPath = _getEntryPath(containerPath, stamp, type, id, decoderVersion);
+
+        // another process may evict or replace the entry at any time, so missing or unmappable entries are just misses
+        auto entryFile = od::MemoryMappedFile::tryOpen(entryPath);
+        if(entryFile == nullptr || entryFile->getSize() < FIXED_HEADER_SIZE + 2)
+        {
+            ++mMissCount;
+            return false;
+        }
+
+        const od::MemoryMappedFile &entry = *entryFile;
+        od::DataReader dr(entry.getData(), entry.getSize());
+
+        char magic[4];
+        uint32_t formatVersion;
+        uint32_t entryDecoderVersion;
+        od::RecordType entryType;
+        od::RecordId entryId;
+        int64_t entryContainerMtime;
+        uint64_t entryContainerSize;
+        uint32_t payloadOffset;
+        uint64_t payloadSize;
+        uint16_t pathLength;
+
+        dr.read(magic, sizeof(magic));
+        dr >> formatVersion
+           >> entryDecoderVersion
+           >> entryType
+           >> entryId
+           >> entryContainerMtime
+           >> entryContainerSize
+           >> payloadOffset
+           >> payloadSize
+           >> pathLength;
+
+        bool keyMatches = std::equal(magic, magic + sizeof(magic), CACHE_ENTRY_MAGIC)
+                && formatVersion == CACHE_FORMAT_VERSION
+                && entryDecoderVersion == decoderVersion
+                && entryType == type
+                && entryId == id
+                && entryContainerMtime == stamp.mtime
+                && entryContainerSize == stamp.size
+                && pathLength == containerPath.size()
+                && FIXED_HEADER_SIZE + 2 + pathLength <= payloadOffset
+                && payloadOffset <= entry.getSize()
+                && payloadSize <= entry.getSize() - payloadOffset;
+
+        // the path is compared last, as we can only read it after we know it's length is within bounds
+        if(!keyMatches || containerPath.compare(0, pathLength, entry.getData() + FIXED_HEADER_SIZE + 2, pathLength) != 0)
+        {
+            Logger::debug() << "Ignoring stale or colliding decoded asset cache entry " << entryPath;
+            ++mMissCount;
+            return false;
+        }
+
+        od::DataReader payloadReader(entry.getData() + payloadOffset, payloadSize);
+        if(!asset.loadDecoded(payloadReader))
+        {
+            Logger::warn() << "Ignoring malformed decoded asset cache entry " << entryPath << ". Asset will be decoded again";
+            ++mMissCount;
+            return false;
+        }
+
+        ++mHitCount;
+        return true;
+    }
+
+    void DecodedAssetCache::storeAsset(od::SrscFile &container, od::RecordType type, od::RecordId id, DecodedCacheable &asset)
+    {
+        uint32_t decoderVersion = asset.getDecoderVersion();
+        if(!mEnabled)
+        {
+            return;
+        }
+
+        ContainerStamp stamp;
+        if(!_getContainerStamp(container, stamp))
+        {
+            return;
+        }
+
+        std::string containerPath = container.getFilePath().str();
+        if(containerPath.size() > 0xffff)
+        {
+            return;
+        }
+
+        od::FilePath entryPath = _getEntryPath(containerPath, stamp, type, id, decoderVersion);
+
+        // assemble the entry in memory. DataWriter panics on write errors, which we can't afford for a mere cache
+        std::ostringstream entryData(std::ios::out | std::ios::binary);
+        od::DataWriter dw(entryData);
+
+        size_t pathEnd = FIXED_HEADER_SIZE + 2 + containerPath.size();
+        uint32_t payloadOffset = ((pathEnd + PAYLOAD_ALIGNMENT - 1) / PAYLOAD_ALIGNMENT) * PAYLOAD_ALIGNMENT;
+
+        dw.write(CACHE_ENTRY_MAGIC, sizeof(CACHE_ENTRY_MAGIC));
+        dw << CACHE_FORMAT_VERSION
+           << decoderVersion
+           << type
+           << id
+           << stamp.mtime
+           << stamp.size
+           << payloadOffset
+           << static_cast<uint64_t>(0) // payload size. patched below
+           << containerPath;
+
+        const char padding[PAYLOAD_ALIGNMENT] = {};
+        dw.write(padding, payloadOffset - pathEnd);
+
+        asset.saveDecoded(dw);
+
+        uint64_t payloadSize = static_cast<uint64_t>(dw.tell()) - payloadOffset;
+        dw.seek(FIXED_HEADER_SIZE - 8);
+        dw << payloadSize;
+        if(entryData.fail())
+        {
+            Logger::warn() << "Could not assemble decoded asset cache entry " << entryPath;
+            return;
+        }
+
+        // write to a file private to this thread, then move it into place so readers only ever see complete entries
+        std::ostringstream tmpPathStr;
+        tmpPathStr << entryPath.str() << ".tmp" << std::hex << std::hash<std::thread::id>()(std::this_thread::get_id());
+        std::string tmpPath = tmpPathStr.str();
+
+        std::ofstream out(tmpPath, std::ios::out | std::ios::binary | std::ios::trunc);
+        if(out.fail())
+        {
+            Logger::warn() << "Could not write decoded asset cache entry " << entryPath;
+            return;
+        }
+
+        const std::string &entryBytes = entryData.str();
+        out.write(entryBytes.data(), entryBytes.size());
+        out.close();
+        if(out.fail())
+        {
+            Logger::warn() << "Could not write decoded asset cache entry " << entryPath;
+            std::remove(tmpPath.c_str());
+            return;
+        }
+
+        if(std::rename(tmpPath.c_str(), entryPath.str().c_str()) != 0)
+        {
+            // on some platforms, rename fails if the target exists. that means another thread beat us to it, which is fine
+            std::remove(tmpPath.c_str());
+        }
+    }
+
+    bool DecodedAssetCache::_getContainerStamp(od::SrscFile &container, ContainerStamp &stamp)
+    {
+        return _statFile(container.getFilePath().str(), stamp.mtime, stamp.size);
+    }
+
+    od::FilePath DecodedAssetCache::_getEntryPath(const std::string &containerPath, const ContainerStamp &stamp, od::RecordType type, od::RecordId id, uint32_t decoderVersion)
+    {
+        uint64_t hash = 0xcbf29ce484222325;
+        hash = _fnv1a(hash, containerPath.data(), containerPath.size());
+        hash = _fnv1a(hash, &stamp.mtime, sizeof(stamp.mtime));
+        hash = _fnv1a(hash, &stamp.size, sizeof(stamp.size));
+        hash = _fnv1a(hash, &type, sizeof(type));
+        hash = _fnv1a(hash, &id, sizeof(id));
+        hash = _fnv1a(hash, &decoderVersion, sizeof(decoderVersion));
+
+        std::ostringstream name;
+        name << std::hex << std::setw(16) << std::setfill('0') << hash << ".odac";
+
+        return od::FilePath(name.str(), mCacheDirectory);
+    }
+
+}
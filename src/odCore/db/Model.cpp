@@ -97,6 +97,21 @@ namespace odDb
         }
 	}
 
+	size_t Model::getMemoryFootprint() const
+	{
+	    size_t size = sizeof(Model);
+	    size += mVertices.capacity()*sizeof(glm::vec3);
+	    size += mPolygons.capacity()*sizeof(Polygon);
+	    size += mTextureRefs.capacity()*sizeof(AssetRef);
+	    size += mAnimationRefs.capacity()*sizeof(AssetRef);
+	    for(auto &lod : mLodMeshInfos)
+	    {
+	        size += sizeof(LodMeshInfo) + lod.boneAffections.capacity()*sizeof(BoneAffection);
+	    }
+
+	    return size;
+	}
+
 	void Model::_loadNameAndShading(od::DataReader dr)
     {
         dr >> mModelName;
@@ -128,10 +143,13 @@ namespace odDb
         uint16_t vertexCount;
         dr >> vertexCount;
 
+        std::vector<float> coords(vertexCount*3);
+        dr.readArray(coords.data(), coords.size());
+
         mVertices.resize(vertexCount);
         for(size_t i = 0; i < vertexCount; ++i)
         {
-            dr >> mVertices[i];
+            mVertices[i] = glm::vec3(coords[i*3], coords[i*3+1], coords[i*3+2]);
 
             mCalculatedBoundingBox.expandBy(mVertices[i]);
             mCalculatedBoundingSphere.expandBy(mVertices[i]);
@@ -68,17 +68,81 @@ namespace odDb
         	OD_PANIC() << "Unsupported bit count per sample " << mBits;
         }
 
-        std::unique_ptr<od::ZStream> zstr;
-        od::DataReader sampleReader(dr);
+        mDataBuffer.resize(mDecompressedSize);
         if(mCompressionLevel != 0)
         {
-            size_t outputBufferSize = std::min(od::ZStreamBuffer::DefaultBufferSize, (size_t)mDecompressedSize);
-            zstr = std::make_unique<od::ZStream>(dr.getStream(), compressedSize, outputBufferSize);
-            sampleReader.setStream(*zstr);
+            od::ZStream::inflateFromReader(dr, compressedSize, reinterpret_cast<char*>(mDataBuffer.data()), mDecompressedSize);
+
+        }else
+        {
+            dr.read(reinterpret_cast<char*>(mDataBuffer.data()), mDecompressedSize);
+        }
+    }
+
+    uint32_t Sound::getDecoderVersion() const
+    {
+        return 1;
+    }
+
+    void Sound::saveDecoded(od::DataWriter &dw)
+    {
+        dw << mSoundName
+           << mFlags
+           << mChannels
+           << mBits
+           << mFrequency
+           << mVolume
+           << mDropoff
+           << mPriority
+           << mDecompressedSize
+           << mCompressionLevel;
+
+        dw.write(reinterpret_cast<const char*>(mDataBuffer.data()), mDataBuffer.size());
+    }
+
+    bool Sound::loadDecoded(od::DataReader &dr)
+    {
+        // everything saveDecoded() writes between the name and the samples
+        static constexpr size_t FIELDS_SIZE = 4 + 2 + 2 + 4 + 4 + 4 + 4 + 4 + 4;
+
+        // the name is length-prefixed. peek at the length using a copy, as copies of memory-backed readers don't share positions
+        uint16_t nameLength;
+        if(dr.getRemainingSize() < sizeof(nameLength))
+        {
+            return false;
+        }
+        od::DataReader lengthReader(dr);
+        lengthReader >> nameLength;
+        if(dr.getRemainingSize() < sizeof(nameLength) + nameLength + FIELDS_SIZE)
+        {
+            return false;
+        }
+
+        dr >> mSoundName
+           >> mFlags
+           >> mChannels
+           >> mBits
+           >> mFrequency
+           >> mVolume
+           >> mDropoff
+           >> mPriority
+           >> mDecompressedSize
+           >> mCompressionLevel;
+
+        if(mDecompressedSize != dr.getRemainingSize())
+        {
+            return false;
         }
 
         mDataBuffer.resize(mDecompressedSize);
-        sampleReader.read(reinterpret_cast<char*>(mDataBuffer.data()), mDecompressedSize);
+        dr.readArray(mDataBuffer.data(), mDecompressedSize);
+
+        return true;
+    }
+
+    size_t Sound::getMemoryFootprint() const
+    {
+        return sizeof(Sound) + mDataBuffer.capacity();
     }
 
     float Sound::getLinearGain() const
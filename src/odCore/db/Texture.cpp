@@ -7,7 +7,7 @@
 
 #include <odCore/db/Texture.h>
 
-#include <functional>
+#include <algorithm>
 
 #include <odCore/Logger.h>
 #include <odCore/Panic.h>
@@ -113,6 +113,93 @@ namespace odDb
         }
     }
 
+    uint32_t Texture::getDecoderVersion() const
+    {
+        return 1;
+    }
+
+    void Texture::saveDecoded(od::DataWriter &dw)
+    {
+        dw << mWidth
+           << mHeight
+           << mBitsPerPixel
+           << mAlphaBitsPerPixel
+           << mColorKey
+           << mNextMipMapRef
+           << mAlternateRef
+           << mBumpMapRef
+           << mAnimationFps
+           << mFlags
+           << mMipMapNumber
+           << mMaterialClassRef
+           << mUsageCount
+           << mCompressionLevel
+           << mCompressedSize
+           << static_cast<uint32_t>(mAnimFrameCount)
+           << static_cast<uint8_t>(mHasAlphaChannel);
+
+        dw.write(reinterpret_cast<const char*>(mRgba8888Data.get()), mWidth*mHeight*4);
+    }
+
+    bool Texture::loadDecoded(od::DataReader &dr)
+    {
+        // everything saveDecoded() writes before the pixels
+        static constexpr size_t FIELDS_SIZE = 4 + 4 + 2 + 2 + 4 + 3*4 + 1 + 1 + 2 + 4 + 4 + 4 + 4 + 4 + 1;
+        if(dr.getRemainingSize() < FIELDS_SIZE)
+        {
+            return false;
+        }
+
+        uint32_t animFrameCount;
+        uint8_t hasAlphaChannel;
+
+        dr >> mWidth
+           >> mHeight
+           >> mBitsPerPixel
+           >> mAlphaBitsPerPixel
+           >> mColorKey
+           >> mNextMipMapRef
+           >> mAlternateRef
+           >> mBumpMapRef
+           >> mAnimationFps
+           >> mFlags
+           >> mMipMapNumber
+           >> mMaterialClassRef
+           >> mUsageCount
+           >> mCompressionLevel
+           >> mCompressedSize
+           >> animFrameCount
+           >> hasAlphaChannel;
+
+        // the product can't overflow in 64 bits
+        uint64_t rgbaSize = static_cast<uint64_t>(mWidth)*mHeight*4;
+        if(rgbaSize != dr.getRemainingSize())
+        {
+            return false;
+        }
+
+        mIsNextFrame = mFlags & OD_TEX_FLAG_NEXTFRAME;
+        mAnimFrameCount = animFrameCount;
+        mHasAlphaChannel = hasAlphaChannel;
+
+        mRgba8888Data = std::make_unique<uint8_t[]>(rgbaSize);
+        dr.readArray(mRgba8888Data.get(), rgbaSize);
+
+        return true;
+    }
+
+    size_t Texture::getMemoryFootprint() const
+    {
+        // animation frames and the material class are accounted for by their own factories
+        size_t size = sizeof(Texture);
+        if(mRgba8888Data != nullptr)
+        {
+            size += mWidth*mHeight*4;
+        }
+
+        return size;
+    }
+
     void Texture::_loadFromRecord(od::DataReader &dr)
     {
         Logger::debug() << "Loading texture " << std::hex << this->getAssetId() << std::dec;
@@ -168,195 +255,200 @@ namespace odDb
 
         mHasAlphaChannel = (mAlphaBitsPerPixel != 0) || hasColorKey;
 
-        std::unique_ptr<od::ZStream> zstr;
-        od::DataReader zdr(dr);
-        if(mCompressionLevel != 0)
+        if(mBitsPerPixel != 8 && mBitsPerPixel != 16 && mBitsPerPixel != 24 && mBitsPerPixel != 32)
         {
-            // choose efficient output buffer sizes. ideally as much as we need exactly, but not more that what we'd use by default
-            size_t uncompressedSize = mWidth*mHeight*(mBitsPerPixel/8) + mHeight*trailingBytes;
-            size_t outputBufferSize = std::min(od::ZStreamBuffer::DefaultBufferSize, uncompressedSize);
-
-            zstr = std::make_unique<od::ZStream>(dr.getStream(), mCompressedSize, outputBufferSize);
-            zdr.setStream(*zstr);
+            OD_PANIC() << "Invalid BPP: " << mBitsPerPixel;
         }
 
-        std::function<void(unsigned char &red, unsigned char &green, unsigned char &blue, unsigned char &alpha)> pixelReaderFunc;
-        if(mBitsPerPixel == 8)
+        if(mBitsPerPixel == 16 && hasColorKey)
         {
-            pixelReaderFunc = [this, &zdr, hasColorKey, keyRed, keyGreen, keyBlue](unsigned char &red, unsigned char &green, unsigned char &blue, unsigned char &alpha)
-            {
-                uint8_t palIndex;
-                zdr >> palIndex;
-
-                TextureFactory::PaletteColor palColor = mTextureFactory.getPaletteColor(palIndex);
-
-                red = palColor.red;
-                green = palColor.green;
-                blue = palColor.blue;
-
-                if(hasColorKey && red == keyRed && green == keyGreen && blue == keyBlue)
-                {
-                    alpha = 0;
+            Logger::info() << "Found color key on 16 bpp texture. This is unsupported and will be ignored";
+        }
 
-                }else
-                {
-                    alpha = OD_TEX_OPAQUE_ALPHA;
-                }
-            };
+        // read the whole image in one go, then convert it in batch. this is way faster than pulling
+        //  every pixel through the DataReader
+        size_t pixelCount = mWidth*mHeight;
+        size_t rawImageSize = pixelCount*(mBitsPerPixel/8);
+        std::vector<uint8_t> rawImage(rawImageSize);
+        if(mCompressionLevel != 0)
+        {
+            od::ZStream::inflateFromReader(dr, mCompressedSize, reinterpret_cast<char*>(rawImage.data()), rawImageSize);
 
-        }else if(mBitsPerPixel == 16)
+        }else
         {
-            /*
-             * ABPP    R:G:B+A bits   Bit pattern (LE adjusted!)
-             * 0       5:6:5+0        RRRRRGGG GGGBBBBB
-             * 1       5:5:5+1        ARRRRRGG GGGBBBBB
-             * 4       4:4:4+4        AAAARRRR GGGGBBBB
-             * 8       3:3:2+8        AAAAAAAA RRRGGGBB
-             */
+            dr.readArray(rawImage.data(), rawImageSize);
+        }
 
-            if(hasColorKey)
+        // translate whatever is stored in texture into 8-bit RGBA format
+        mRgba8888Data = std::make_unique<uint8_t[]>(pixelCount*4);
+        uint8_t *rgba = mRgba8888Data.get();
+        if(mBitsPerPixel == 8)
+        {
+            // the color key only depends on the palette entry, so we can bake it into the lookup table
+            uint8_t paletteLut[256*4];
+            for(size_t i = 0; i < 256; ++i)
             {
-                Logger::info() << "Found color key on 16 bpp texture. This is unsupported and will be ignored";
-            }
-
-            uint8_t rBits;
-            uint8_t rShift;
-
-            uint8_t gBits;
-            uint8_t gShift;
-
-            uint8_t bBits;
-            uint8_t bShift;
+                TextureFactory::PaletteColor palColor = mTextureFactory.getPaletteColor(i);
 
-            uint8_t aBits;
-            uint8_t aShift;
+                bool isKey = hasColorKey && palColor.red == keyRed && palColor.green == keyGreen && palColor.blue == keyBlue;
 
-            aBits = (mFlags & OD_TEX_FLAG_ALPHACHANNEL) ? mAlphaBitsPerPixel : 0;
-
-            switch(aBits)
-            {
-            case 0:
-                rBits = 5;
-                gBits = 6;
-                bBits = 5;
-                break;
-
-            case 1:
-                rBits = 5;
-                gBits = 5;
-                bBits = 5;
-                break;
-
-            case 4:
-                rBits = 4;
-                gBits = 4;
-                bBits = 4;
-                break;
-
-            case 8:
-                rBits = 3;
-                gBits = 3;
-                bBits = 2;
-                break;
-
-            default:
-                OD_PANIC() << "Invalid alpha BPP count: " << aBits;
+                paletteLut[i*4]   = palColor.red;
+                paletteLut[i*4+1] = palColor.green;
+                paletteLut[i*4+2] = palColor.blue;
+                paletteLut[i*4+3] = isKey ? 0 : OD_TEX_OPAQUE_ALPHA;
             }
 
-            aShift = rBits + gBits + bBits;
-            rShift = gBits + bBits;
-            gShift = bBits;
-            bShift = 0;
-
-            uint32_t rMask = (1 << rBits) - 1;
-            uint32_t gMask = (1 << gBits) - 1;
-            uint32_t bMask = (1 << bBits) - 1;
-            uint32_t aMask = aBits != 0 ? (1 << aBits) - 1 : 0;
+            _convertPalette8(rawImage.data(), pixelCount, paletteLut, rgba);
 
-            pixelReaderFunc = [this, &zdr, rMask, rShift, gMask, gShift, bMask, bShift, aMask, aShift](unsigned char &red, unsigned char &green, unsigned char &blue, unsigned char &alpha)
-            {
-                uint16_t c;
-                zdr >> c;
-
-                red = _filter16BitChannel(c, rMask, rShift);
-                green = _filter16BitChannel(c, gMask, gShift);
-                blue = _filter16BitChannel(c, bMask, bShift);
-                alpha = aMask ? _filter16BitChannel(c, aMask, aShift) : OD_TEX_OPAQUE_ALPHA;
-            };
+        }else if(mBitsPerPixel == 16)
+        {
+            uint8_t aBits = (mFlags & OD_TEX_FLAG_ALPHACHANNEL) ? mAlphaBitsPerPixel : 0;
+            _convert16(rawImage.data(), pixelCount, aBits, rgba);
 
         }else if(mBitsPerPixel == 24)
         {
-            pixelReaderFunc = [&zdr, hasColorKey, keyRed, keyGreen, keyBlue](unsigned char &red, unsigned char &green, unsigned char &blue, unsigned char &alpha)
-            {
-                zdr >> red
-                    >> green
-                    >> blue;
-
-                if(hasColorKey && red == keyRed && green == keyGreen && blue == keyBlue)
-                {
-                    alpha = 0;
+            _convert24(rawImage.data(), pixelCount, rgba);
 
-                }else
-                {
-                    alpha = OD_TEX_OPAQUE_ALPHA;
-                }
-            };
+            if(hasColorKey)
+            {
+                _applyColorKey(rgba, pixelCount, keyRed, keyGreen, keyBlue);
+            }
 
         }else if(mBitsPerPixel == 32)
         {
-            pixelReaderFunc = [&zdr, this](unsigned char &red, unsigned char &green, unsigned char &blue, unsigned char &alpha)
-            {
-                // FIXME: the byte order created by the editor's convert function is RGBA, the one expected by the engine seems to be BGRA.
-                //  since it is not entirely clear whether a level created for later versions of the Riot Engine would use RGBA or BGRA,
-                //  we might need to change this order or make it depend on the SRSC version of the texture container.
-                //  for now, stick with what seems to be expected by the engine.
+            _convert32(rawImage.data(), pixelCount, mAlphaBitsPerPixel == 8, rgba);
+        }
 
-                zdr >> blue
-                    >> green
-                    >> red
-                    >> alpha;
+        Logger::debug() << "Texture successfully loaded";
+    }
 
-                if(mAlphaBitsPerPixel != 8)
-                {
-                    alpha = OD_TEX_OPAQUE_ALPHA;
-                }
-            };
+    void Texture::_convertPalette8(const uint8_t *src, size_t pixelCount, const uint8_t *paletteLut, uint8_t *dest)
+    {
+        for(size_t i = 0; i < pixelCount; ++i)
+        {
+            const uint8_t *color = paletteLut + src[i]*4;
+            dest[i*4]   = color[0];
+            dest[i*4+1] = color[1];
+            dest[i*4+2] = color[2];
+            dest[i*4+3] = color[3];
+        }
+    }
 
-        }else
+    void Texture::_convert16(const uint8_t *src, size_t pixelCount, uint8_t alphaBits, uint8_t *dest)
+    {
+        /*
+         * ABPP    R:G:B+A bits   Bit pattern (LE adjusted!)
+         * 0       5:6:5+0        RRRRRGGG GGGBBBBB
+         * 1       5:5:5+1        ARRRRRGG GGGBBBBB
+         * 4       4:4:4+4        AAAARRRR GGGGBBBB
+         * 8       3:3:2+8        AAAAAAAA RRRGGGBB
+         */
+
+        uint8_t rBits;
+        uint8_t gBits;
+        uint8_t bBits;
+
+        switch(alphaBits)
         {
-            OD_PANIC() << "Invalid BPP: " << mBitsPerPixel;
+        case 0:
+            rBits = 5;
+            gBits = 6;
+            bBits = 5;
+            break;
+
+        case 1:
+            rBits = 5;
+            gBits = 5;
+            bBits = 5;
+            break;
+
+        case 4:
+            rBits = 4;
+            gBits = 4;
+            bBits = 4;
+            break;
+
+        case 8:
+            rBits = 3;
+            gBits = 3;
+            bBits = 2;
+            break;
+
+        default:
+            OD_PANIC() << "Invalid alpha BPP count: " << alphaBits;
         }
 
-        // translate whatever is stored in texture into 8-bit RGBA format
-        mRgba8888Data = std::make_unique<uint8_t[]>(mWidth*mHeight*4);
-        for(size_t i = 0; i < mWidth*mHeight*4; i += 4)
+        uint8_t aShift = rBits + gBits + bBits;
+        uint8_t rShift = gBits + bBits;
+        uint8_t gShift = bBits;
+        uint8_t bShift = 0;
+
+        uint32_t rMask = (1 << rBits) - 1;
+        uint32_t gMask = (1 << gBits) - 1;
+        uint32_t bMask = (1 << bBits) - 1;
+        uint32_t aMask = alphaBits != 0 ? (1 << alphaBits) - 1 : 0;
+
+        // expanding a channel to 8 bits needs a division. no channel has more than 8 bits, so we can
+        //  precompute all possible results and keep the per-pixel loop free of divisions and branches
+        uint8_t rLut[256];
+        uint8_t gLut[256];
+        uint8_t bLut[256];
+        uint8_t aLut[256];
+        for(uint32_t v = 0; v < 256; ++v)
         {
-            uint8_t red;
-            uint8_t green;
-            uint8_t blue;
-            uint8_t alpha;
+            rLut[v] = ((v & rMask)*0xff)/rMask;
+            gLut[v] = ((v & gMask)*0xff)/gMask;
+            bLut[v] = ((v & bMask)*0xff)/bMask;
+            aLut[v] = aMask ? ((v & aMask)*0xff)/aMask : OD_TEX_OPAQUE_ALPHA;
+        }
 
-            pixelReaderFunc(red, green, blue, alpha);
+        for(size_t i = 0; i < pixelCount; ++i)
+        {
+            uint16_t c = src[i*2] | (src[i*2+1] << 8);
 
-            mRgba8888Data[i]   = red;
-            mRgba8888Data[i+1] = green;
-            mRgba8888Data[i+2] = blue;
-            mRgba8888Data[i+3] = alpha;
+            dest[i*4]   = rLut[(c >> rShift) & rMask];
+            dest[i*4+1] = gLut[(c >> gShift) & gMask];
+            dest[i*4+2] = bLut[(c >> bShift) & bMask];
+            dest[i*4+3] = aLut[(c >> aShift) & 0xff];
         }
+    }
 
-        if(zstr != nullptr)
+    void Texture::_convert24(const uint8_t *src, size_t pixelCount, uint8_t *dest)
+    {
+        for(size_t i = 0; i < pixelCount; ++i)
         {
-            zstr->seekToEndOfZlib();
+            dest[i*4]   = src[i*3];
+            dest[i*4+1] = src[i*3+1];
+            dest[i*4+2] = src[i*3+2];
+            dest[i*4+3] = OD_TEX_OPAQUE_ALPHA;
         }
-
-        Logger::debug() << "Texture successfully loaded";
     }
 
-    unsigned char Texture::_filter16BitChannel(uint16_t color, uint32_t mask, uint32_t shift)
+    void Texture::_convert32(const uint8_t *src, size_t pixelCount, bool useAlpha, uint8_t *dest)
     {
-        uint32_t channel = (color >> shift) & mask;
+        // FIXME: the byte order created by the editor's convert function is RGBA, the one expected by the engine seems to be BGRA.
+        //  since it is not entirely clear whether a level created for later versions of the Riot Engine would use RGBA or BGRA,
+        //  we might need to change this order or make it depend on the SRSC version of the texture container.
+        //  for now, stick with what seems to be expected by the engine.
 
-        return (channel*0xff)/mask;
+        uint8_t alphaOverride = useAlpha ? 0x00 : OD_TEX_OPAQUE_ALPHA;
+        for(size_t i = 0; i < pixelCount; ++i)
+        {
+            dest[i*4]   = src[i*4+2];
+            dest[i*4+1] = src[i*4+1];
+            dest[i*4+2] = src[i*4];
+            dest[i*4+3] = src[i*4+3] | alphaOverride;
+        }
+    }
+
+    void Texture::_applyColorKey(uint8_t *rgba, size_t pixelCount, uint8_t keyRed, uint8_t keyGreen, uint8_t keyBlue)
+    {
+        for(size_t i = 0; i < pixelCount; ++i)
+        {
+            uint8_t *pixel = rgba + i*4;
+            bool isKey = (pixel[0] == keyRed) & (pixel[1] == keyGreen) & (pixel[2] == keyBlue);
+            pixel[3] = isKey ? 0 : pixel[3];
+        }
     }
 
 }
@@ -8,18 +8,21 @@
 #include <odCore/net/IpAddress.h>
 #include <sstream>
 
+#include <odCore/Panic.h>
+
 namespace odNet
 {
 
-    IpParseException::IpParseException(const std::string &msg)
-    : od::Exception(msg)
-    {
-    }
-
-
     IpV4Address::IpV4Address(const std::array<int, 4> &addr)
     : mAddress(addr)
     {
+        for(auto octet : mAddress)
+        {
+            if(octet < 0 || octet > 255)
+            {
+                OD_PANIC() << "IPv4 address octet out of range: " << octet;
+            }
+        }
     }
 
     IpV4Address::IpV4Address(const char *addrStr)
@@ -28,12 +31,23 @@ namespace odNet
         for(size_t i = 0; i < 4; ++i)
         {
             iss >> mAddress[i];
-            if(iss.fail()) throw IpParseException(addrStr);
+            if(iss.fail() || mAddress[i] < 0 || mAddress[i] > 255) OD_PANIC() << "Invalid IPv4 address: " << addrStr;
 
-            if((i < 3) && (iss.get() != '.')) throw IpParseException(addrStr);
+            if((i < 3) && (iss.get() != '.')) OD_PANIC() << "Invalid IPv4 address: " << addrStr;
         }
     }
 
-}
+    IpV4Address::IpV4Address(uint32_t addr)
+    : mAddress{ static_cast<int>((addr >> 24) & 0xff), static_cast<int>((addr >> 16) & 0xff), static_cast<int>((addr >> 8) & 0xff), static_cast<int>(addr & 0xff) }
+    {
+    }
 
+    uint32_t IpV4Address::toUint32() const
+    {
+        return (static_cast<uint32_t>(mAddress[0]) << 24)
+             | (static_cast<uint32_t>(mAddress[1]) << 16)
+             | (static_cast<uint32_t>(mAddress[2]) << 8)
+             | static_cast<uint32_t>(mAddress[3]);
+    }
 
+}
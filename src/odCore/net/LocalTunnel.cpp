@@ -2,23 +2,85 @@
 #include <odCore/net/LocalTunnel.h>
 
 #include <algorithm>
-#include <random>
+#include <cmath>
 
+#include <odCore/Logger.h>
+#include <odCore/Panic.h>
 #include <odCore/ThreadUtils.h>
 
 namespace odNet
 {
 
-    static thread_local std::random_device seedSource;
-    static thread_local std::minstd_rand randomEngine(seedSource());
-    static thread_local std::uniform_real_distribution<double> dropDistribution(0.0, 1.0);
+    static void checkRate(double rate, const char *name)
+    {
+        if(!(rate >= 0.0 && rate <= 1.0))
+        {
+            OD_PANIC() << "Invalid " << name << " " << rate << ". Must be in range [0, 1]";
+        }
+    }
+
+    static void checkNonNegative(double value, const char *name)
+    {
+        if(!(value >= 0.0))
+        {
+            OD_PANIC() << "Invalid " << name << " " << value << ". Must not be negative";
+        }
+    }
+
+
+    LocalTunnel::LinkConditions::LinkConditions()
+    : latency(0.0)
+    , jitter(0.0)
+    , jitterDistribution(JitterDistribution::UNIFORM)
+    , reorderRate(0.0)
+    , duplicateRate(0.0)
+    , lossRate(0.0)
+    , burstLossRate(0.0)
+    , burstStartRate(0.0)
+    , burstEndRate(1.0)
+    , bandwidth(0.0)
+    , maxQueueDelay(0.0)
+    {
+    }
+
+    bool LocalTunnel::LinkConditions::delaysPackets() const
+    {
+        return latency > 0.0 || jitter > 0.0 || bandwidth > 0.0;
+    }
+
+
+    LocalTunnel::LinkStatistics::LinkStatistics()
+    : packetsSent(0)
+    , bytesSent(0)
+    , packetsDelivered(0)
+    , bytesDelivered(0)
+    , packetsLost(0)
+    , packetsQueueDropped(0)
+    , packetsDuplicated(0)
+    , packetsReordered(0)
+    , totalDelay(0.0)
+    , maxDelay(0.0)
+    {
+    }
+
+
+    LocalTunnel::LinkState::LinkState()
+    : inBurst(false)
+    , nextSequenceNumber(0)
+    , lastDeliveredSequenceNumber(0)
+    , hasDelivered(false)
+    , queueFreeAt(0.0)
+    , lastArrival(0.0)
+    {
+    }
+
 
     LocalTunnel::LocalTunnel(std::shared_ptr<DownlinkConnector> downlinkOutput, std::shared_ptr<UplinkConnector> uplinkOutput)
     : mDownlinkPacketParser(downlinkOutput, nullptr)
     , mUplinkPacketParser(nullptr, uplinkOutput)
-    , mLatencyMin(0.0)
-    , mLatencyMax(0.0)
-    , mDropRate(0.0)
+    , mStartTime(std::chrono::steady_clock::now())
+    , mUseManualClock(false)
+    , mManualClock(0.0)
     , mDispatchThreadStarted(false)
     , mTerminateDispatchThread(false)
     {
@@ -33,6 +95,12 @@ namespace odNet
             _addPacket(data, size, linkType, true);
         };
         mUplinkPacketBuilder = std::make_shared<PacketBuilder>(uplinkPacketCallback);
+
+        // coalesce packets the same way a network transport would. each datagram still fits a tunnel packet
+        mDownlinkPacketBuilder->setCoalescing(MAX_PAYLOAD_SIZE);
+        mUplinkPacketBuilder->setCoalescing(MAX_PAYLOAD_SIZE);
+
+        setSeed(DEFAULT_SEED);
     }
 
     LocalTunnel::~LocalTunnel()
@@ -45,6 +113,64 @@ namespace odNet
         }
     }
 
+    void LocalTunnel::setSeed(uint64_t seed)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        // seed_seq is fully specified by the standard, so this gives the same engine states everywhere
+        uint32_t seedLow = static_cast<uint32_t>(seed);
+        uint32_t seedHigh = static_cast<uint32_t>(seed >> 32);
+        std::seed_seq downlinkSeed{ seedLow, seedHigh, 0u };
+        std::seed_seq uplinkSeed{ seedLow, seedHigh, 1u };
+        mDownlinkState.randomEngine.seed(downlinkSeed);
+        mUplinkState.randomEngine.seed(uplinkSeed);
+
+        mDownlinkState.inBurst = false;
+        mUplinkState.inBurst = false;
+    }
+
+    void LocalTunnel::setConditions(const LinkConditions &conditions)
+    {
+        setConditions(Direction::DOWNLINK, conditions);
+        setConditions(Direction::UPLINK, conditions);
+    }
+
+    void LocalTunnel::setConditions(Direction direction, const LinkConditions &conditions)
+    {
+        checkNonNegative(conditions.latency, "latency");
+        checkNonNegative(conditions.jitter, "jitter");
+        checkNonNegative(conditions.bandwidth, "bandwidth");
+        checkNonNegative(conditions.maxQueueDelay, "max. queue delay");
+        checkRate(conditions.reorderRate, "reorder rate");
+        checkRate(conditions.duplicateRate, "duplicate rate");
+        checkRate(conditions.lossRate, "loss rate");
+        checkRate(conditions.burstLossRate, "burst loss rate");
+        checkRate(conditions.burstStartRate, "burst start rate");
+        checkRate(conditions.burstEndRate, "burst end rate");
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        _getLinkState(direction).conditions = conditions;
+
+        _startDispatchThreadIfNeeded();
+    }
+
+    LocalTunnel::LinkConditions LocalTunnel::getConditions(Direction direction)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return _getLinkState(direction).conditions;
+    }
+
+    void LocalTunnel::setDropRate(double dropRate)
+    {
+        for(auto direction : { Direction::DOWNLINK, Direction::UPLINK })
+        {
+            LinkConditions conditions = getConditions(direction);
+            conditions.lossRate = dropRate;
+            setConditions(direction, conditions);
+        }
+    }
+
     void LocalTunnel::setLatency(double min, double max)
     {
         if(min < 0 || min > max)
@@ -52,11 +178,104 @@ namespace odNet
             OD_PANIC() << "Invalid latency range [" << min << ", " << max << "]";
         }
 
-        mLatencyMin = min;
-        mLatencyMax = max;
+        for(auto direction : { Direction::DOWNLINK, Direction::UPLINK })
+        {
+            LinkConditions conditions = getConditions(direction);
+            conditions.latency = min;
+            conditions.jitter = max - min;
+            conditions.jitterDistribution = JitterDistribution::UNIFORM;
+            setConditions(direction, conditions);
+        }
+    }
+
+    LocalTunnel::LinkStatistics LocalTunnel::getStatistics(Direction direction)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return _getLinkState(direction).statistics;
+    }
+
+    void LocalTunnel::useManualClock()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        if(mDownlinkState.nextSequenceNumber > 0 || mUplinkState.nextSequenceNumber > 0)
+        {
+            OD_PANIC() << "Can't switch tunnel to manual clock after packets have been sent";
+        }
+
+        if(mDispatchThreadStarted)
+        {
+            OD_PANIC() << "Can't switch tunnel to manual clock after the dispatch thread has been started";
+        }
+
+        mUseManualClock = true;
+        mManualClock = 0.0;
+    }
+
+    void LocalTunnel::advanceClock(double seconds)
+    {
+        checkNonNegative(seconds, "clock advance");
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        if(!mUseManualClock)
+        {
+            OD_PANIC() << "Tunnel does not use a manual clock";
+        }
+
+        mManualClock += seconds;
+        _deliverDuePackets(mManualClock);
+    }
+
+    double LocalTunnel::_now()
+    {
+        if(mUseManualClock)
+        {
+            return mManualClock;
+        }
+
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - mStartTime).count();
+    }
+
+    double LocalTunnel::_random(LinkState &link)
+    {
+        // the standard distributions are implementation-defined, so we build our own on top of the engine's raw
+        //  output, which is specified. 53 random bits fill the mantissa of a double in [0, 1)
+        return (link.randomEngine() >> 11) * (1.0/9007199254740992.0);
+    }
+
+    double LocalTunnel::_randomJitter(LinkState &link)
+    {
+        double jitter = link.conditions.jitter;
+        if(jitter <= 0.0)
+        {
+            return 0.0;
+        }
+
+        switch(link.conditions.jitterDistribution)
+        {
+        case JitterDistribution::NORMAL:
+            {
+                // Box-Muller transform. u1 must not be 0
+                double u1 = 1.0 - _random(link);
+                double u2 = _random(link);
+                double z = std::sqrt(-2.0*std::log(u1)) * std::cos(2.0*M_PI*u2);
+                return std::abs(z) * jitter;
+            }
+
+        case JitterDistribution::EXPONENTIAL:
+            return -std::log(1.0 - _random(link)) * jitter;
 
+        case JitterDistribution::UNIFORM:
+        default:
+            return _random(link) * jitter;
+        }
+    }
+
+    void LocalTunnel::_startDispatchThreadIfNeeded()
+    {
         // we only start the dispatch thread on demand (it is never stopped, though)
-        if(!mDispatchThreadStarted && (mLatencyMin > 0 || mLatencyMax > 0))
+        if(!mDispatchThreadStarted && !mUseManualClock && (mDownlinkState.conditions.delaysPackets() || mUplinkState.conditions.delaysPackets()))
         {
             mTerminateDispatchThread = false;
             mDispatchThread = std::thread([this](){ this->_dispatchThreadWorkerFunc(); });
@@ -65,78 +284,176 @@ namespace odNet
         }
     }
 
-    bool LocalTunnel::_shouldDrop()
+    size_t LocalTunnel::_schedulePacket(LinkState &link, const char *data, size_t size, PacketBuilder::LinkType linkType, bool isUplink)
     {
-        return dropDistribution(randomEngine) < mDropRate;
-    }
+        const LinkConditions &conditions = link.conditions;
+        bool isReliable = (linkType == PacketBuilder::LinkType::RELIABLE);
+        double now = _now();
 
-    double LocalTunnel::_getRandomLatency()
-    {
-        double r = dropDistribution(randomEngine);
-        return r*(mLatencyMax - mLatencyMin) + mLatencyMin;
-    }
+        size_t sequenceNumber = link.nextSequenceNumber++;
+        link.statistics.packetsSent++;
+        link.statistics.bytesSent += size;
 
-    void LocalTunnel::_addPacket(const char *data, size_t size, PacketBuilder::LinkType linkType, bool isUplink)
-    {
-        if(size > MAX_PAYLOAD_SIZE)
+        // the loss model describes the channel, not the traffic on it, so reliable packets step it, too
+        if(link.inBurst)
         {
-            Logger::warn() << "Packet payload size " << size << " exceeds payload size limit of " << MAX_PAYLOAD_SIZE << ". Dropping packet";
-            return;
+            link.inBurst = !(_random(link) < conditions.burstEndRate);
+
+        }else
+        {
+            link.inBurst = (_random(link) < conditions.burstStartRate);
         }
 
-        if(linkType == PacketBuilder::LinkType::UNRELIABLE && _shouldDrop())
+        double lossRate = link.inBurst ? conditions.burstLossRate : conditions.lossRate;
+        if(!isReliable && _random(link) < lossRate)
         {
-            return;
+            link.statistics.packetsLost++;
+            return 0;
         }
 
-        double latency = _getRandomLatency();
-        if(latency > 0.0)
+        double departure = now;
+        if(conditions.bandwidth > 0.0)
         {
-            std::lock_guard<std::mutex> lock(mPacketBufferMutex);
+            double queueDelay = std::max(0.0, link.queueFreeAt - now);
+            if(!isReliable && conditions.maxQueueDelay > 0.0 && queueDelay > conditions.maxQueueDelay)
+            {
+                link.statistics.packetsQueueDropped++;
+                return 0;
+            }
+
+            departure = now + queueDelay + size/conditions.bandwidth;
+            link.queueFreeAt = departure;
+        }
 
-            auto arriveBy = std::chrono::high_resolution_clock::now() + std::chrono::nanoseconds(static_cast<long int>(latency*1e9));
+        size_t copies = 1;
+        if(!isReliable && _random(link) < conditions.duplicateRate)
+        {
+            link.statistics.packetsDuplicated++;
+            copies = 2;
+        }
 
-            // maintain ascending order in packet buffer!
-            if(!mPacketBuffer.empty() && mPacketBuffer.back().arriveBy > arriveBy)
+        // without any delay, we can bypass the buffer and let the caller parse the packet directly. packets still
+        //  in the buffer from earlier conditions must arrive first, though
+        if(!mUseManualClock && !conditions.delaysPackets() && mPacketBuffer.empty())
+        {
+            for(size_t i = 0; i < copies; ++i)
             {
-                arriveBy = mPacketBuffer.back().arriveBy;
+                _countDelivery(link, sequenceNumber, size, 0.0);
             }
 
-            mPacketBuffer.emplace_back();
-            auto &packet = mPacketBuffer.back();
+            return copies;
+        }
 
-            std::copy_n(data, size, packet.data.begin());
-            packet.size = size;
-            packet.arriveBy = arriveBy;
-            packet.isUplink = isUplink;
+        for(size_t i = 0; i < copies; ++i)
+        {
+            // duplicates happen behind the bottleneck, so each copy gets it's own delay, but they share the departure
+            double arriveBy = departure + conditions.latency + _randomJitter(link);
 
-            if(mPacketBuffer.size() == 1)
+            bool mayReorder = !isReliable && _random(link) < conditions.reorderRate;
+            if(!mayReorder)
             {
-                // if this is the only packet in the buffer, that means the
-                //  buffer was empty before, which means the dispatch thread is
-                //  waiting indefinitely until notified.
-                mDispatchCondition.notify_all();
+                arriveBy = std::max(arriveBy, link.lastArrival);
             }
+            link.lastArrival = std::max(link.lastArrival, arriveBy);
+
+            _queuePacket(link, data, size, sequenceNumber, now, arriveBy, isUplink);
+        }
+
+        return 0;
+    }
+
+    void LocalTunnel::_queuePacket(LinkState &link, const char *data, size_t size, size_t sequenceNumber, double sentAt, double arriveBy, bool isUplink)
+    {
+        // maintain ascending order in packet buffer! packets with equal arrival times stay in the order they were sent
+        auto pred = [](double t, const Packet &p) { return t < p.arriveBy; };
+        auto it = std::upper_bound(mPacketBuffer.begin(), mPacketBuffer.end(), arriveBy, pred);
+        bool isNewFront = (it == mPacketBuffer.begin());
+
+        it = mPacketBuffer.emplace(it);
+        Packet &packet = *it;
+        std::copy_n(data, size, packet.data.begin());
+        packet.size = size;
+        packet.sequenceNumber = sequenceNumber;
+        packet.sentAt = sentAt;
+        packet.arriveBy = arriveBy;
+        packet.isUplink = isUplink;
+
+        if(isNewFront)
+        {
+            // the dispatch thread is waiting either indefinitely or for a packet that arrives later than this one
+            mDispatchCondition.notify_all();
+        }
+    }
+
+    void LocalTunnel::_countDelivery(LinkState &link, size_t sequenceNumber, size_t size, double delay)
+    {
+        LinkStatistics &stats = link.statistics;
+        stats.packetsDelivered++;
+        stats.bytesDelivered += size;
+        stats.totalDelay += delay;
+        stats.maxDelay = std::max(stats.maxDelay, delay);
+
+        if(link.hasDelivered && sequenceNumber < link.lastDeliveredSequenceNumber)
+        {
+            stats.packetsReordered++;
 
         }else
         {
-            // no latency. bypass the buffer and parse packet directly.
+            link.lastDeliveredSequenceNumber = sequenceNumber;
+            link.hasDelivered = true;
+        }
+    }
+
+    void LocalTunnel::_addPacket(const char *data, size_t size, PacketBuilder::LinkType linkType, bool isUplink)
+    {
+        if(size > MAX_PAYLOAD_SIZE)
+        {
+            Logger::warn() << "Packet payload size " << size << " exceeds payload size limit of " << MAX_PAYLOAD_SIZE << ". Dropping packet";
+            return;
+        }
+
+        size_t directCopies;
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            directCopies = _schedulePacket(_getLinkState(isUplink), data, size, linkType, isUplink);
+        }
+
+        for(size_t i = 0; i < directCopies; ++i)
+        {
             _parsePacket(data, size, isUplink);
         }
     }
 
     void LocalTunnel::_parsePacket(const char *data, size_t size, bool isUplink)
     {
-        size_t usedBytes = isUplink ? mUplinkPacketParser.parse(data, size) : mDownlinkPacketParser.parse(data, size);
-        if(usedBytes != size)
+        auto result = isUplink ? mUplinkPacketParser.parse(data, size) : mDownlinkPacketParser.parse(data, size);
+        if(result.remainingBytes != 0)
         {
             OD_PANIC() << "Parser did not use all packet bytes, but it should have";
         }
     }
 
+    void LocalTunnel::_deliverDuePackets(double now)
+    {
+        while(!mPacketBuffer.empty())
+        {
+            auto &packet = mPacketBuffer.front();
+            if(packet.arriveBy > now)
+            {
+                break;
+            }
+
+            _countDelivery(_getLinkState(packet.isUplink), packet.sequenceNumber, packet.size, packet.arriveBy - packet.sentAt);
+            _parsePacket(packet.data.data(), packet.size, packet.isUplink);
+
+            mPacketBuffer.pop_front();
+        }
+    }
+
     void LocalTunnel::_dispatchThreadWorkerFunc()
     {
-        std::unique_lock<std::mutex> lock(mPacketBufferMutex);
+        std::unique_lock<std::mutex> lock(mMutex);
 
         while(!mTerminateDispatchThread.load(std::memory_order_acquire))
         {
@@ -144,28 +461,14 @@ namespace odNet
             {
                 mDispatchCondition.wait(lock);
 
-            }else
+            }else if(mPacketBuffer.front().arriveBy > _now())
             {
-                if(mPacketBuffer.front().arriveBy > std::chrono::high_resolution_clock::now())
-                {
-                    mDispatchCondition.wait_until(lock, mPacketBuffer.front().arriveBy);
-                }
+                auto arrivalTime = mStartTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(mPacketBuffer.front().arriveBy));
+                mDispatchCondition.wait_until(lock, arrivalTime);
             }
 
             // dispatch all packets that should have arrived by now
-            auto now = std::chrono::high_resolution_clock::now();
-            while(!mPacketBuffer.empty())
-            {
-                auto &packet = mPacketBuffer.front();
-                if(packet.arriveBy > now)
-                {
-                    break;
-                }
-
-                _parsePacket(packet.data.data(), packet.size, packet.isUplink);
-
-                mPacketBuffer.pop_front();
-            }
+            _deliverDuePackets(_now());
         }
     }
 
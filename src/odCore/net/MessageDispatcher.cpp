@@ -31,9 +31,7 @@ namespace odNet
             auto listener = weakListener.lock();
             if(listener != nullptr)
             {
-                od::MemoryInputBuffer streamBuffer(data, size);
-                std::istream stream(&streamBuffer);
-                od::DataReader dr(stream);
+                od::DataReader dr(data, size);
 
                 listener->triggerCallback(dr);
             }
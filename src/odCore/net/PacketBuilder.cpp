@@ -4,6 +4,8 @@
 #include <algorithm>
 #include <type_traits>
 
+#include <odCore/BitStream.h>
+
 #include <odCore/anim/AnimModes.h>
 
 namespace odNet
@@ -14,9 +16,18 @@ namespace odNet
     , mStreamBuffer(mPacketBuffer)
     , mOutputStream(&mStreamBuffer)
     , mWriter(mOutputStream)
+    , mMaxDatagramSize(0)
     {
     }
 
+    void PacketBuilder::setCoalescing(size_t maxDatagramSize)
+    {
+        // don't let anything collected with the old setting linger
+        flush();
+
+        mMaxDatagramSize = maxDatagramSize;
+    }
+
     void PacketBuilder::globalDatabaseTableEntry(odDb::GlobalDatabaseIndex dbIndex, const std::string &path)
     {
         _beginPacket(PacketType::GLOBAL_DB_TABLE_ENTRY);
@@ -25,15 +36,21 @@ namespace odNet
         _endPacket(LinkType::RELIABLE);
     }
 
-    void PacketBuilder::loadLevel(const std::string &path, size_t loadedDatabaseCount)
+    void PacketBuilder::loadLevel(const std::string &path, size_t loadedDatabaseCount, const odState::StateQuantization &quantization)
     {
         if(loadedDatabaseCount > std::numeric_limits<uint32_t>::max())
         {
             OD_PANIC() << "Entry count out of bounds";
         }
 
+        // all states we send from now on are for the new level
+        mQuantization = quantization;
+
         _beginPacket(PacketType::LOAD_LEVEL);
-        mWriter << static_cast<uint32_t>(loadedDatabaseCount);
+        mWriter << static_cast<uint32_t>(loadedDatabaseCount)
+                << quantization.getBoundsMin()
+                << quantization.getBoundsMax()
+                << (quantization.hasPositionBounds() ? quantization.getPositionResolution() : 0.0f);
         mWriter.write(path.data(), path.size());
         _endPacket(LinkType::RELIABLE);
     }
@@ -43,7 +60,13 @@ namespace odNet
         _beginPacket(PacketType::OBJECT_STATES_CHANGED);
         mWriter << tick
                 << id;
-        states.serialize(mWriter, odState::StateSerializationPurpose::NETWORK);
+
+        mBitBuffer.clear();
+        od::BitWriter bitWriter(mBitBuffer);
+        states.serializeQuantized(bitWriter, mQuantization);
+        bitWriter.flush();
+        mWriter.write(mBitBuffer.data(), mBitBuffer.size());
+
         _endPacket(LinkType::UNRELIABLE);
     }
 
@@ -103,6 +126,12 @@ namespace odNet
         _endPacket(LinkType::UNRELIABLE);
     }
 
+    void PacketBuilder::flush()
+    {
+        _flushDatagram(LinkType::RELIABLE);
+        _flushDatagram(LinkType::UNRELIABLE);
+    }
+
     void PacketBuilder::_beginPacket(PacketType type)
     {
         mPacketBuffer.clear();
@@ -126,10 +155,42 @@ namespace odNet
         mWriter << static_cast<uint16_t>(payloadSize);
         mWriter.seek(p);
 
+        if(mMaxDatagramSize == 0 || mPacketBuffer.size() > mMaxDatagramSize)
+        {
+            // keep the order of packets on the same link intact
+            _flushDatagram(linkType);
+
+            if(mPacketCallback != nullptr)
+            {
+                mPacketCallback(mPacketBuffer.data(), mPacketBuffer.size(), linkType);
+            }
+
+            return;
+        }
+
+        auto &datagram = mDatagrams[static_cast<size_t>(linkType)];
+        if(datagram.size() + mPacketBuffer.size() > mMaxDatagramSize)
+        {
+            _flushDatagram(linkType);
+        }
+
+        datagram.insert(datagram.end(), mPacketBuffer.begin(), mPacketBuffer.end());
+    }
+
+    void PacketBuilder::_flushDatagram(LinkType linkType)
+    {
+        auto &datagram = mDatagrams[static_cast<size_t>(linkType)];
+        if(datagram.empty())
+        {
+            return;
+        }
+
         if(mPacketCallback != nullptr)
         {
-            mPacketCallback(mPacketBuffer.data(), mPacketBuffer.size(), linkType);
+            mPacketCallback(datagram.data(), datagram.size(), linkType);
         }
+
+        datagram.clear();
     }
 
 
@@ -1,6 +1,11 @@
 
 #include <odCore/net/PacketParser.h>
 
+#include <limits>
+
+#include <odCore/BitStream.h>
+#include <odCore/Panic.h>
+
 #include <odCore/anim/AnimModes.h>
 
 #include <odCore/db/IdTypes.h>
@@ -12,6 +17,65 @@
 namespace odNet
 {
 
+    /**
+     * @brief Returns the smallest and largest valid payload size for the given packet type, or false if the type is unknown.
+     */
+    static bool _getPayloadSizeLimits(PacketType type, size_t &minSize, size_t &maxSize)
+    {
+        // most packets with variable-size data start with a fixed header. packets without any are fixed-size
+        minSize = 0;
+        maxSize = std::numeric_limits<uint16_t>::max();
+        switch(type)
+        {
+        case PacketType::GLOBAL_DB_TABLE_ENTRY:
+            minSize = sizeof(odDb::GlobalDatabaseIndex);
+            break;
+
+        case PacketType::LOAD_LEVEL:
+            minSize = PacketConstants::LOAD_LEVEL_HEADER_SIZE;
+            break;
+
+        case PacketType::OBJECT_STATES_CHANGED:
+            minSize = PacketConstants::OBJECT_STATES_HEADER_SIZE;
+            break;
+
+        case PacketType::OBJECT_EXTRA_STATES_CHANGED:
+            minSize = PacketConstants::EXTRA_STATES_HEADER_SIZE;
+            break;
+
+        case PacketType::CONFIRM_SNAPSHOT:
+            minSize = maxSize = 2*sizeof(odState::TickNumber) + sizeof(double) + sizeof(uint32_t);
+            break;
+
+        case PacketType::GLOBAL_MESSAGE:
+            minSize = PacketConstants::GLOBAL_MESSAGE_HEADER_SIZE;
+            break;
+
+        case PacketType::EVENT:
+            // the event itself is checked while deserializing it
+            minSize = sizeof(double);
+            break;
+
+        case PacketType::ACKNOWLEDGE_SNAPSHOT:
+            minSize = maxSize = sizeof(odState::TickNumber);
+            break;
+
+        case PacketType::ACTION_TRIGGERED:
+            minSize = maxSize = sizeof(odInput::ActionCode) + sizeof(uint8_t);
+            break;
+
+        case PacketType::ANALOG_ACTION_TRIGGERED:
+            minSize = maxSize = sizeof(odInput::ActionCode) + 2*sizeof(float);
+            break;
+
+        default:
+            return false;
+        }
+
+        return true;
+    }
+
+
     PacketParser::PacketParser(std::shared_ptr<DownlinkConnector> downlinkOutput, std::shared_ptr<UplinkConnector> uplinkOutput)
     : mDownlinkOutput(downlinkOutput)
     , mUplinkOutput(uplinkOutput)
@@ -23,46 +87,62 @@ namespace odNet
     {
     }
 
-    size_t PacketParser::parse(const char *data, size_t size)
+    PacketParser::ParseResult PacketParser::parse(const char *data, size_t size)
     {
-        if(size < PacketConstants::HEADER_SIZE)
-        {
-            // no need to parse anything when we don't even have a full header yet
-            return 0;
-        }
-
-        od::MemoryInputBuffer buf(data, size);
-        std::istream dataStr(&buf);
-        od::DataReader dr(dataStr);
-
-        uint8_t type;
-        uint16_t length;
-        dr >> type >> length;
+        ParseResult result = { 0, 0, 0 };
 
-        // is the packet available in full?
-        if(size >= length + PacketConstants::HEADER_SIZE)
+        while(size - result.consumedBytes >= PacketConstants::HEADER_SIZE)
         {
-            const char *rawPayload = data + PacketConstants::HEADER_SIZE;
+            const char *packet = data + result.consumedBytes;
 
-            //try
-            //{
-                _parsePacket(type, length, dr, rawPayload);
+            od::DataReader headerReader(packet, PacketConstants::HEADER_SIZE);
+            uint8_t type;
+            uint16_t length;
+            headerReader >> type >> length;
 
-            //}catch(od::IoException &e) // kinda ugly to use this to detect an underrun condition. this could cause us to miss actually bad states in the data reader
-            //{
-            //    _badPacket("unexpected size");
-            //}
+            // is the packet available in full?
+            size_t packetSize = length + PacketConstants::HEADER_SIZE;
+            if(size - result.consumedBytes < packetSize)
+            {
+                break;
+            }
 
-            return length + PacketConstants::HEADER_SIZE; // TODO: consume more than one packet
+            // the reader only sees this packet's payload, so a malformed packet can't read into the next one
+            const char *rawPayload = packet + PacketConstants::HEADER_SIZE;
+            od::DataReader dr(rawPayload, length);
+            _parsePacket(type, length, dr, rawPayload);
 
-        }else
-        {
-            return 0;
+            result.consumedBytes += packetSize;
+            result.packetCount++;
         }
+
+        result.remainingBytes = size - result.consumedBytes;
+
+        return result;
     }
 
     void PacketParser::_parsePacket(uint8_t type, uint16_t length, od::DataReader &dr, const char *rawPayload)
     {
+        // checking sizes up front means nothing below can read past the payload, and subtracting header sizes from
+        //  the length can't underflow
+        size_t minSize;
+        size_t maxSize;
+        if(!_getPayloadSizeLimits(static_cast<PacketType>(type), minSize, maxSize))
+        {
+            _badPacket("unknown packet type");
+            return;
+
+        }else if(length < minSize)
+        {
+            _badPacket("payload too short");
+            return;
+
+        }else if(length > maxSize)
+        {
+            _badPacket("payload too long");
+            return;
+        }
+
         switch(static_cast<PacketType>(type))
         {
         case PacketType::OBJECT_STATES_CHANGED:
@@ -71,8 +151,15 @@ namespace odNet
                 odState::TickNumber tick;
                 od::LevelObjectId id;
                 dr >> tick >> id;
+                od::BitReader bitReader(rawPayload + PacketConstants::OBJECT_STATES_HEADER_SIZE, length - PacketConstants::OBJECT_STATES_HEADER_SIZE);
                 od::ObjectStates states;
-                states.deserialize(dr, odState::StateSerializationPurpose::NETWORK);
+                states.deserializeQuantized(bitReader, mQuantization);
+                if(bitReader.hasFailed())
+                {
+                    _badPacket("truncated object states");
+                    break;
+                }
+
                 mDownlinkOutput->objectStatesChanged(tick, id, states);
             }
             break;
@@ -113,9 +200,28 @@ namespace odNet
             if(mDownlinkOutput != nullptr)
             {
                 uint32_t loadedDatabaseCount;
-                dr >> loadedDatabaseCount;
-                std::string level(rawPayload + sizeof(loadedDatabaseCount), static_cast<size_t>(length) - sizeof(loadedDatabaseCount));
-                mDownlinkOutput->loadLevel(level, loadedDatabaseCount);
+                glm::vec3 boundsMin;
+                glm::vec3 boundsMax;
+                float positionResolution;
+                dr >> loadedDatabaseCount >> boundsMin >> boundsMax >> positionResolution;
+
+                // a resolution of 0 means the server sends positions without bounds
+                if(positionResolution == 0.0f)
+                {
+                    mQuantization = odState::StateQuantization();
+
+                }else if(odState::StateQuantization::areValidBounds(boundsMin, boundsMax, positionResolution))
+                {
+                    mQuantization = odState::StateQuantization(boundsMin, boundsMax, positionResolution);
+
+                }else
+                {
+                    _badPacket("invalid quantization bounds");
+                    break;
+                }
+
+                std::string level(rawPayload + PacketConstants::LOAD_LEVEL_HEADER_SIZE, static_cast<size_t>(length) - PacketConstants::LOAD_LEVEL_HEADER_SIZE);
+                mDownlinkOutput->loadLevel(level, loadedDatabaseCount, mQuantization);
             }
             break;
 
@@ -134,7 +240,18 @@ namespace odNet
                 double realtime;
                 dr >> realtime;
                 auto event = odState::EventVariantSerializer::deserialize(dr);
-                mDownlinkOutput->event(event, realtime);
+                if(!event.has_value())
+                {
+                    _badPacket("malformed event");
+                    break;
+
+                }else if(dr.getRemainingSize() != 0)
+                {
+                    _badPacket("trailing data after event");
+                    break;
+                }
+
+                mDownlinkOutput->event(*event, realtime);
             }
             break;
 
@@ -171,10 +288,8 @@ namespace odNet
             break;
 
         default:
-            // unknown packet type
-            Logger::error() << "Bad packet: unknown packet type " << type;
-            mBadPacketCount++;
-            break;
+            // unknown types were rejected above
+            OD_UNREACHABLE();
         }
     }
 
@@ -28,7 +28,7 @@ namespace odNet
 
             void operator()(const LoadLevel &l)
             {
-                connector.loadLevel(l.path, l.loadedDatabaseCount);
+                connector.loadLevel(l.path, l.loadedDatabaseCount, l.quantization);
             }
 
             void operator()(const ObjectStatesChanged &o)
@@ -77,10 +77,10 @@ namespace odNet
         mCalls.emplace_back(GlobalDatabaseTableEntry{dbIndex, path});
     }
 
-    void QueuedDownlinkConnector::loadLevel(const std::string &path, size_t loadedDatabaseCount)
+    void QueuedDownlinkConnector::loadLevel(const std::string &path, size_t loadedDatabaseCount, const odState::StateQuantization &quantization)
     {
         lock_guard lock(mMutex);
-        mCalls.emplace_back(LoadLevel{loadedDatabaseCount, path});
+        mCalls.emplace_back(LoadLevel{loadedDatabaseCount, path, quantization});
     }
 
     void QueuedDownlinkConnector::objectStatesChanged(odState::TickNumber tick, od::LevelObjectId id, const od::ObjectStates &states)
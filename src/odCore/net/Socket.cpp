@@ -0,0 +1,262 @@
+
+#include <odCore/net/Socket.h>
+
+#if defined (__WIN32__)
+#   include <winsock2.h>
+#   include <ws2tcpip.h>
+#else
+extern "C"
+{
+#   include <sys/socket.h>
+#   include <netinet/in.h>
+#   include <arpa/inet.h>
+#   include <fcntl.h>
+#   include <poll.h>
+#   include <unistd.h>
+}
+#endif
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include <odCore/Logger.h>
+#include <odCore/Panic.h>
+
+namespace odNet
+{
+
+    UdpEndpoint::UdpEndpoint()
+    : mAddress(0)
+    , mPort(0)
+    {
+    }
+
+    UdpEndpoint::UdpEndpoint(const IpV4Address &address, uint16_t port)
+    : mAddress(address.toUint32())
+    , mPort(port)
+    {
+    }
+
+
+#if defined (__WIN32__)
+
+    using SocketHandle = SOCKET;
+    using TransferSize = int;
+    static const SocketHandle INVALID_SOCKET_HANDLE = INVALID_SOCKET;
+
+    /**
+     * @brief Initializes Winsock on first use and cleans it up when the program exits.
+     */
+    static void _initSockets()
+    {
+        struct WinsockInit
+        {
+            WinsockInit()
+            {
+                WSADATA wsaData;
+                int error = WSAStartup(MAKEWORD(2, 2), &wsaData);
+                if(error != 0)
+                {
+                    OD_PANIC() << "Failed to initialize Winsock: error " << error;
+                }
+            }
+
+            ~WinsockInit()
+            {
+                WSACleanup();
+            }
+        };
+
+        static WinsockInit init;
+    }
+
+    static int _getLastError() { return WSAGetLastError(); }
+    static bool _isWouldBlock(int error) { return error == WSAEWOULDBLOCK; }
+    static bool _isInterrupted(int error) { return error == WSAEINTR; }
+
+    // Windows reports unreachable ports of earlier sends this way
+    static bool _isConnectionRefused(int error) { return error == WSAECONNRESET || error == WSAECONNREFUSED; }
+
+    static std::string _getErrorString(int error) { return "error " + std::to_string(error); }
+
+    static bool _setNonBlocking(SocketHandle s)
+    {
+        u_long nonBlocking = 1;
+        return ::ioctlsocket(s, FIONBIO, &nonBlocking) == 0;
+    }
+
+    static void _closeSocket(SocketHandle s)
+    {
+        ::closesocket(s);
+    }
+
+#else
+
+    using SocketHandle = int;
+    using TransferSize = ssize_t;
+    static const SocketHandle INVALID_SOCKET_HANDLE = -1;
+
+    static void _initSockets()
+    {
+    }
+
+    static int _getLastError() { return errno; }
+    static bool _isWouldBlock(int error) { return error == EAGAIN || error == EWOULDBLOCK; }
+    static bool _isInterrupted(int error) { return error == EINTR; }
+
+    // reported after sending to a closed port on loopback
+    static bool _isConnectionRefused(int error) { return error == ECONNREFUSED; }
+
+    static std::string _getErrorString(int error) { return std::strerror(error); }
+
+    static bool _setNonBlocking(SocketHandle s)
+    {
+        int flags = ::fcntl(s, F_GETFL, 0);
+        return flags >= 0 && ::fcntl(s, F_SETFL, flags | O_NONBLOCK) == 0;
+    }
+
+    static void _closeSocket(SocketHandle s)
+    {
+        ::close(s);
+    }
+
+#endif
+
+    static sockaddr_in _toSockaddr(const UdpEndpoint &endpoint)
+    {
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(endpoint.getAddress().toUint32());
+        addr.sin_port = htons(endpoint.getPort());
+        return addr;
+    }
+
+    UdpSocket::UdpSocket()
+    : mSocket(INVALID_SOCKET_HANDLE)
+    {
+        _initSockets();
+
+        SocketHandle s = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if(s == INVALID_SOCKET_HANDLE)
+        {
+            OD_PANIC() << "Failed to create UDP socket: " << _getErrorString(_getLastError());
+        }
+
+        if(!_setNonBlocking(s))
+        {
+            int error = _getLastError();
+            _closeSocket(s);
+            OD_PANIC() << "Failed to make UDP socket non-blocking: " << _getErrorString(error);
+        }
+
+        mSocket = s;
+    }
+
+    UdpSocket::~UdpSocket()
+    {
+        if(mSocket != INVALID_SOCKET_HANDLE)
+        {
+            _closeSocket(mSocket);
+        }
+    }
+
+    void UdpSocket::bind(const IpV4Address &address, uint16_t port)
+    {
+        sockaddr_in addr = _toSockaddr(UdpEndpoint(address, port));
+        if(::bind(mSocket, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+        {
+            OD_PANIC() << "Failed to bind UDP socket to port " << port << ": " << _getErrorString(_getLastError());
+        }
+    }
+
+    uint16_t UdpSocket::getLocalPort() const
+    {
+        sockaddr_in addr;
+        socklen_t addrLen = sizeof(addr);
+        if(::getsockname(mSocket, reinterpret_cast<sockaddr*>(&addr), &addrLen) != 0)
+        {
+            return 0;
+        }
+
+        return ntohs(addr.sin_port);
+    }
+
+    bool UdpSocket::send(const UdpEndpoint &to, const char *data, size_t size)
+    {
+        sockaddr_in addr = _toSockaddr(to);
+        TransferSize sent = ::sendto(mSocket, data, size, 0, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        if(sent < 0)
+        {
+            int error = _getLastError();
+            if(!_isWouldBlock(error))
+            {
+                Logger::warn() << "Failed to send UDP datagram: " << _getErrorString(error);
+            }
+
+            return false;
+        }
+
+        return static_cast<size_t>(sent) == size;
+    }
+
+    size_t UdpSocket::receive(char *buffer, size_t bufferSize, UdpEndpoint &from)
+    {
+        // a datagram can be empty, so loop until we get one that isn't or the queue is drained
+        for(;;)
+        {
+            sockaddr_in addr;
+            socklen_t addrLen = sizeof(addr);
+            TransferSize received = ::recvfrom(mSocket, buffer, bufferSize, 0, reinterpret_cast<sockaddr*>(&addr), &addrLen);
+            if(received < 0)
+            {
+                // refused connections are expected while peers come and go
+                int error = _getLastError();
+                if(_isInterrupted(error) || _isConnectionRefused(error))
+                {
+                    continue;
+                }
+
+                if(!_isWouldBlock(error))
+                {
+                    Logger::warn() << "Failed to receive UDP datagram: " << _getErrorString(error);
+                }
+
+                return 0;
+            }
+
+            if(received > 0)
+            {
+                from = UdpEndpoint(IpV4Address(static_cast<uint32_t>(ntohl(addr.sin_addr.s_addr))), ntohs(addr.sin_port));
+                return static_cast<size_t>(received);
+            }
+        }
+    }
+
+    bool UdpSocket::waitForData(double timeout)
+    {
+#if defined (__WIN32__)
+        // WSAPoll needs Vista headers, which not all MinGW setups provide. select() is enough for a single socket
+        fd_set readSet;
+        FD_ZERO(&readSet);
+        FD_SET(mSocket, &readSet);
+
+        timeval tv;
+        tv.tv_sec = static_cast<long>(timeout);
+        tv.tv_usec = static_cast<long>((timeout - tv.tv_sec)*1e6);
+
+        int result = ::select(0, &readSet, nullptr, nullptr, &tv);
+        return result > 0 && FD_ISSET(mSocket, &readSet);
+#else
+        pollfd pfd;
+        pfd.fd = mSocket;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+
+        int result = ::poll(&pfd, 1, static_cast<int>(timeout*1000));
+        return result > 0 && (pfd.revents & POLLIN);
+#endif
+    }
+
+}
@@ -0,0 +1,593 @@
+
+#include <odCore/net/UdpConnection.h>
+
+#include <algorithm>
+
+#include <odCore/DataStream.h>
+#include <odCore/Logger.h>
+#include <odCore/Panic.h>
+
+namespace odNet
+{
+
+    static constexpr size_t SENT_DATAGRAM_HISTORY = 1024;
+
+    enum class ChunkType : uint8_t
+    {
+        UNRELIABLE_FRAGMENT,
+        RELIABLE_FRAGMENT
+    };
+
+    static const uint8_t DATAGRAM_FLAG_HAS_ACK = 1;
+    static const uint8_t RELIABLE_FLAG_LAST_FRAGMENT = 1;
+
+    static void _append8(std::vector<char> &v, uint8_t i)
+    {
+        v.push_back(static_cast<char>(i));
+    }
+
+    static void _append16(std::vector<char> &v, uint16_t i)
+    {
+        v.push_back(static_cast<char>(i & 0xff));
+        v.push_back(static_cast<char>(i >> 8));
+    }
+
+    static void _append32(std::vector<char> &v, uint32_t i)
+    {
+        _append16(v, static_cast<uint16_t>(i & 0xffff));
+        _append16(v, static_cast<uint16_t>(i >> 16));
+    }
+
+    /**
+     * @brief Returns true if sequence number a is more recent than b, taking wrap-around into account.
+     */
+    static bool _isMoreRecent(uint16_t a, uint16_t b)
+    {
+        return static_cast<uint16_t>(a - b) != 0 && static_cast<uint16_t>(a - b) < 0x8000;
+    }
+
+
+    UdpConnection::SentDatagram::SentDatagram()
+    : sequence(0)
+    , valid(false)
+    , acked(false)
+    , sendTime(0.0)
+    {
+    }
+
+    bool UdpConnection::isConnectionDatagram(const char *data, size_t size)
+    {
+        if(size < DATAGRAM_HEADER_SIZE)
+        {
+            return false;
+        }
+
+        uint16_t protocolId;
+        od::DataReader dr(data, size);
+        dr >> protocolId;
+        return protocolId == PROTOCOL_ID;
+    }
+
+    UdpConnection::UdpConnection(const DatagramCallback &datagramCallback, const MessageCallback &messageCallback)
+    : mDatagramCallback(datagramCallback)
+    , mMessageCallback(messageCallback)
+    , mMtu(DEFAULT_MTU)
+    , mClosed(false)
+    , mLocalSequence(0)
+    , mLastSendTime(-KEEPALIVE_INTERVAL)
+    , mSentDatagrams(SENT_DATAGRAM_HISTORY)
+    , mHasReceived(false)
+    , mRemoteSequence(0)
+    , mReceivedBits(0)
+    , mAckPending(false)
+    , mRoundTripTime(0.0)
+    , mNextReliableId(0)
+    , mNextExpectedReliableId(0)
+    , mIncomingReliable(RELIABLE_WINDOW)
+    , mNextFragmentGroupId(0)
+    , mSentDatagramCount(0)
+    , mReceivedDatagramCount(0)
+    , mResentFragmentCount(0)
+    {
+        mDatagram.reserve(mMtu);
+    }
+
+    void UdpConnection::setMtu(size_t mtu)
+    {
+        // we need room for at least one byte of payload in every chunk type
+        if(mtu <= DATAGRAM_HEADER_SIZE + std::max(UNRELIABLE_CHUNK_HEADER_SIZE, RELIABLE_CHUNK_HEADER_SIZE))
+        {
+            OD_PANIC() << "MTU of " << mtu << " bytes is too small";
+        }
+
+        if(mtu > 0xffff)
+        {
+            OD_PANIC() << "MTU of " << mtu << " bytes exceeds chunk size field limits";
+        }
+
+        mMtu = mtu;
+    }
+
+    void UdpConnection::send(const char *data, size_t size, Channel channel, double now)
+    {
+        if(mClosed)
+        {
+            return;
+        }
+
+        if(channel == Channel::RELIABLE)
+        {
+            size_t maxFragmentSize = mMtu - DATAGRAM_HEADER_SIZE - RELIABLE_CHUNK_HEADER_SIZE;
+            size_t fragmentCount = std::max<size_t>(1, (size + maxFragmentSize - 1) / maxFragmentSize);
+            if(mOutgoingReliable.size() + fragmentCount > MAX_QUEUED_RELIABLE_FRAGMENTS)
+            {
+                // the peer stopped acknowledging. we can't drop reliable messages, and can't keep them forever either
+                _close("too many unacknowledged reliable fragments");
+                return;
+            }
+
+            size_t offset = 0;
+            do
+            {
+                size_t fragmentSize = std::min(maxFragmentSize, size - offset);
+
+                mOutgoingReliable.emplace_back();
+                auto &fragment = mOutgoingReliable.back();
+                fragment.id = mNextReliableId++;
+                fragment.isLastFragment = (offset + fragmentSize == size);
+                fragment.acked = false;
+                fragment.lastSendTime = -1.0;
+                fragment.data.assign(data + offset, data + offset + fragmentSize);
+
+                offset += fragmentSize;
+
+            }while(offset < size);
+
+            _sendDueReliables(now);
+
+        }else
+        {
+            size_t maxFragmentSize = mMtu - DATAGRAM_HEADER_SIZE - UNRELIABLE_CHUNK_HEADER_SIZE;
+            size_t fragmentCount = std::max<size_t>(1, (size + maxFragmentSize - 1) / maxFragmentSize);
+            if(fragmentCount > MAX_FRAGMENT_COUNT)
+            {
+                Logger::warn() << "Unreliable message of " << size << " bytes needs too many fragments. Dropping it";
+                return;
+            }
+
+            uint16_t groupId = mNextFragmentGroupId++;
+            for(size_t i = 0; i < fragmentCount; ++i)
+            {
+                size_t offset = i*maxFragmentSize;
+                size_t fragmentSize = std::min(maxFragmentSize, size - offset);
+
+                // due reliable fragments ride along if there is space left
+                _beginDatagram();
+                _writeUnreliableChunk(groupId, static_cast<uint8_t>(i), static_cast<uint8_t>(fragmentCount), data + offset, fragmentSize);
+                _writeDueReliableChunks(now);
+                _endDatagram(now);
+            }
+        }
+    }
+
+    void UdpConnection::receiveDatagram(const char *data, size_t size, double now)
+    {
+        if(mClosed || !isConnectionDatagram(data, size))
+        {
+            return;
+        }
+
+        od::DataReader dr(data, size);
+
+        uint16_t protocolId;
+        uint16_t sequence;
+        uint8_t flags;
+        uint16_t ack;
+        uint32_t ackBits;
+        dr >> protocolId >> sequence >> flags >> ack >> ackBits;
+
+        // acks are valid even if the rest of the datagram is a duplicate
+        if(flags & DATAGRAM_FLAG_HAS_ACK)
+        {
+            _processAcks(ack, ackBits, now);
+        }
+
+        if(!_registerReceivedSequence(sequence))
+        {
+            return;
+        }
+
+        mReceivedDatagramCount++;
+        mAckPending = true;
+
+        size_t offset = DATAGRAM_HEADER_SIZE;
+        while(offset < size && !mClosed)
+        {
+            size_t remaining = size - offset;
+            od::DataReader chunkReader(data + offset, remaining);
+
+            uint8_t type;
+            chunkReader >> type;
+
+            if(type == static_cast<uint8_t>(ChunkType::UNRELIABLE_FRAGMENT) && remaining >= UNRELIABLE_CHUNK_HEADER_SIZE)
+            {
+                uint16_t groupId;
+                uint8_t index;
+                uint8_t count;
+                uint16_t chunkSize;
+                chunkReader >> groupId >> index >> count >> chunkSize;
+                if(remaining - UNRELIABLE_CHUNK_HEADER_SIZE < chunkSize)
+                {
+                    break;
+                }
+
+                _receiveUnreliableFragment(groupId, index, count, data + offset + UNRELIABLE_CHUNK_HEADER_SIZE, chunkSize);
+                offset += UNRELIABLE_CHUNK_HEADER_SIZE + chunkSize;
+
+            }else if(type == static_cast<uint8_t>(ChunkType::RELIABLE_FRAGMENT) && remaining >= RELIABLE_CHUNK_HEADER_SIZE)
+            {
+                uint16_t id;
+                uint8_t chunkFlags;
+                uint16_t chunkSize;
+                chunkReader >> id >> chunkFlags >> chunkSize;
+                if(remaining - RELIABLE_CHUNK_HEADER_SIZE < chunkSize)
+                {
+                    break;
+                }
+
+                _receiveReliableFragment(id, chunkFlags & RELIABLE_FLAG_LAST_FRAGMENT, data + offset + RELIABLE_CHUNK_HEADER_SIZE, chunkSize);
+                offset += RELIABLE_CHUNK_HEADER_SIZE + chunkSize;
+
+            }else
+            {
+                break;
+            }
+        }
+
+        if(offset != size && !mClosed)
+        {
+            Logger::warn() << "Malformed chunk in datagram " << sequence << ". Ignoring rest of datagram";
+        }
+    }
+
+    void UdpConnection::update(double now)
+    {
+        if(mClosed || _sendDueReliables(now))
+        {
+            return;
+        }
+
+        bool ackDue = mAckPending && (now - mLastSendTime >= ACK_DELAY);
+        bool keepaliveDue = (now - mLastSendTime >= KEEPALIVE_INTERVAL);
+        if(ackDue || keepaliveDue)
+        {
+            _beginDatagram();
+            _endDatagram(now);
+        }
+    }
+
+    void UdpConnection::_close(const char *reason)
+    {
+        Logger::error() << "Closing UDP connection: " << reason;
+
+        mClosed = true;
+        mOutgoingReliable.clear();
+        mReliableReassemblyBuffer.clear();
+        mFragmentGroups.clear();
+    }
+
+    double UdpConnection::_getResendTimeout() const
+    {
+        if(mRoundTripTime <= 0.0)
+        {
+            return INITIAL_RESEND_TIMEOUT;
+        }
+
+        return std::max(MIN_RESEND_TIMEOUT, 1.5*mRoundTripTime);
+    }
+
+    void UdpConnection::_beginDatagram()
+    {
+        mDatagram.clear();
+        mDatagramReliableIds.clear();
+
+        _append16(mDatagram, PROTOCOL_ID);
+        _append16(mDatagram, mLocalSequence);
+        _append8(mDatagram, mHasReceived ? DATAGRAM_FLAG_HAS_ACK : 0);
+        _append16(mDatagram, mRemoteSequence);
+        _append32(mDatagram, mReceivedBits);
+    }
+
+    void UdpConnection::_writeUnreliableChunk(uint16_t groupId, uint8_t index, uint8_t count, const char *data, size_t size)
+    {
+        _append8(mDatagram, static_cast<uint8_t>(ChunkType::UNRELIABLE_FRAGMENT));
+        _append16(mDatagram, groupId);
+        _append8(mDatagram, index);
+        _append8(mDatagram, count);
+        _append16(mDatagram, static_cast<uint16_t>(size));
+        mDatagram.insert(mDatagram.end(), data, data + size);
+    }
+
+    bool UdpConnection::_writeDueReliableChunks(double now)
+    {
+        double resendTimeout = _getResendTimeout();
+        size_t window = std::min(mOutgoingReliable.size(), RELIABLE_WINDOW);
+
+        bool wroteAny = false;
+        for(size_t i = 0; i < window; ++i)
+        {
+            auto &fragment = mOutgoingReliable[i];
+            if(fragment.acked || (fragment.lastSendTime >= 0.0 && now - fragment.lastSendTime < resendTimeout))
+            {
+                continue;
+            }
+
+            if(mDatagram.size() + RELIABLE_CHUNK_HEADER_SIZE + fragment.data.size() > mMtu)
+            {
+                continue;
+            }
+
+            _append8(mDatagram, static_cast<uint8_t>(ChunkType::RELIABLE_FRAGMENT));
+            _append16(mDatagram, fragment.id);
+            _append8(mDatagram, fragment.isLastFragment ? RELIABLE_FLAG_LAST_FRAGMENT : 0);
+            _append16(mDatagram, static_cast<uint16_t>(fragment.data.size()));
+            mDatagram.insert(mDatagram.end(), fragment.data.begin(), fragment.data.end());
+
+            if(fragment.lastSendTime >= 0.0)
+            {
+                mResentFragmentCount++;
+            }
+
+            fragment.lastSendTime = now;
+            mDatagramReliableIds.push_back(fragment.id);
+            wroteAny = true;
+        }
+
+        return wroteAny;
+    }
+
+    void UdpConnection::_endDatagram(double now)
+    {
+        auto &record = mSentDatagrams[mLocalSequence % SENT_DATAGRAM_HISTORY];
+        record.sequence = mLocalSequence;
+        record.valid = true;
+        record.acked = false;
+        record.sendTime = now;
+        record.reliableIds.swap(mDatagramReliableIds);
+        mDatagramReliableIds.clear();
+
+        if(mDatagramCallback != nullptr)
+        {
+            mDatagramCallback(mDatagram.data(), mDatagram.size());
+        }
+
+        mLocalSequence++;
+        mLastSendTime = now;
+        mAckPending = false;
+        mSentDatagramCount++;
+    }
+
+    bool UdpConnection::_sendDueReliables(double now)
+    {
+        bool sentAny = false;
+        for(;;)
+        {
+            _beginDatagram();
+            if(!_writeDueReliableChunks(now))
+            {
+                break;
+            }
+
+            _endDatagram(now);
+            sentAny = true;
+        }
+
+        return sentAny;
+    }
+
+    bool UdpConnection::_registerReceivedSequence(uint16_t sequence)
+    {
+        if(!mHasReceived)
+        {
+            mHasReceived = true;
+            mRemoteSequence = sequence;
+            mReceivedBits = 0;
+            return true;
+        }
+
+        if(_isMoreRecent(sequence, mRemoteSequence))
+        {
+            uint16_t shift = sequence - mRemoteSequence;
+            if(shift < 32)
+            {
+                mReceivedBits = (mReceivedBits << shift) | (1u << (shift - 1));
+
+            }else if(shift == 32)
+            {
+                mReceivedBits = 1u << 31;
+
+            }else
+            {
+                mReceivedBits = 0;
+            }
+
+            mRemoteSequence = sequence;
+            return true;
+        }
+
+        uint16_t age = mRemoteSequence - sequence;
+        if(age == 0 || age > 32)
+        {
+            return false;
+        }
+
+        uint32_t bit = 1u << (age - 1);
+        if(mReceivedBits & bit)
+        {
+            return false;
+        }
+
+        mReceivedBits |= bit;
+        return true;
+    }
+
+    void UdpConnection::_processAcks(uint16_t ack, uint32_t ackBits, double now)
+    {
+        _ackDatagram(ack, now);
+        for(uint16_t i = 0; i < 32; ++i)
+        {
+            if(ackBits & (1u << i))
+            {
+                _ackDatagram(ack - i - 1, now);
+            }
+        }
+
+        while(!mOutgoingReliable.empty() && mOutgoingReliable.front().acked)
+        {
+            mOutgoingReliable.pop_front();
+        }
+    }
+
+    void UdpConnection::_ackDatagram(uint16_t sequence, double now)
+    {
+        auto &record = mSentDatagrams[sequence % SENT_DATAGRAM_HISTORY];
+        if(!record.valid || record.acked || record.sequence != sequence)
+        {
+            return;
+        }
+
+        record.acked = true;
+
+        double sample = now - record.sendTime;
+        mRoundTripTime = (mRoundTripTime <= 0.0) ? sample : (mRoundTripTime + 0.1*(sample - mRoundTripTime));
+
+        if(mOutgoingReliable.empty())
+        {
+            return;
+        }
+
+        uint16_t firstId = mOutgoingReliable.front().id;
+        for(auto id : record.reliableIds)
+        {
+            uint16_t index = id - firstId;
+            if(index < mOutgoingReliable.size())
+            {
+                mOutgoingReliable[index].acked = true;
+            }
+        }
+    }
+
+    void UdpConnection::_receiveReliableFragment(uint16_t id, bool isLastFragment, const char *data, size_t size)
+    {
+        uint16_t distance = id - mNextExpectedReliableId;
+        if(distance >= RELIABLE_WINDOW)
+        {
+            // already delivered. the sender missed our ack, which it will get with this datagram's
+            return;
+        }
+
+        auto &slot = mIncomingReliable[id % RELIABLE_WINDOW];
+        if(slot.received)
+        {
+            return;
+        }
+
+        slot.received = true;
+        slot.isLastFragment = isLastFragment;
+        slot.data.assign(data, data + size);
+
+        // deliver everything that is complete and in order now
+        for(;;)
+        {
+            auto &next = mIncomingReliable[mNextExpectedReliableId % RELIABLE_WINDOW];
+            if(!next.received)
+            {
+                break;
+            }
+
+            // a peer that never sends the last fragment would otherwise make us buffer forever
+            if(mReliableReassemblyBuffer.size() + next.data.size() > MAX_RELIABLE_MESSAGE_SIZE)
+            {
+                _close("reliable message exceeds size limit");
+                return;
+            }
+
+            mReliableReassemblyBuffer.insert(mReliableReassemblyBuffer.end(), next.data.begin(), next.data.end());
+            if(next.isLastFragment)
+            {
+                if(mMessageCallback != nullptr)
+                {
+                    mMessageCallback(mReliableReassemblyBuffer.data(), mReliableReassemblyBuffer.size(), Channel::RELIABLE);
+                }
+
+                mReliableReassemblyBuffer.clear();
+            }
+
+            next.received = false;
+            next.data.clear();
+            mNextExpectedReliableId++;
+        }
+    }
+
+    void UdpConnection::_receiveUnreliableFragment(uint16_t groupId, uint8_t index, uint8_t count, const char *data, size_t size)
+    {
+        if(count == 0 || index >= count)
+        {
+            return;
+        }
+
+        if(count == 1)
+        {
+            if(mMessageCallback != nullptr)
+            {
+                mMessageCallback(data, size, Channel::UNRELIABLE);
+            }
+
+            return;
+        }
+
+        auto pred = [groupId](const FragmentGroup &g) { return g.groupId == groupId; };
+        auto it = std::find_if(mFragmentGroups.begin(), mFragmentGroups.end(), pred);
+        if(it == mFragmentGroups.end())
+        {
+            if(mFragmentGroups.size() >= MAX_PENDING_FRAGMENT_GROUPS)
+            {
+                // the oldest group is unlikely to ever complete
+                mFragmentGroups.pop_front();
+            }
+
+            mFragmentGroups.emplace_back();
+            it = mFragmentGroups.end() - 1;
+            it->groupId = groupId;
+            it->receivedCount = 0;
+            it->received.resize(count, false);
+            it->fragments.resize(count);
+        }
+
+        if(it->fragments.size() != count || it->received[index])
+        {
+            return;
+        }
+
+        it->received[index] = true;
+        it->fragments[index].assign(data, data + size);
+        it->receivedCount++;
+
+        if(it->receivedCount == count)
+        {
+            mUnreliableReassemblyBuffer.clear();
+            for(auto &fragment : it->fragments)
+            {
+                mUnreliableReassemblyBuffer.insert(mUnreliableReassemblyBuffer.end(), fragment.begin(), fragment.end());
+            }
+
+            mFragmentGroups.erase(it);
+
+            if(mMessageCallback != nullptr)
+            {
+                mMessageCallback(mUnreliableReassemblyBuffer.data(), mUnreliableReassemblyBuffer.size(), Channel::UNRELIABLE);
+            }
+        }
+    }
+
+}
@@ -0,0 +1,63 @@
+
+#include <odCore/net/UdpFaultInjector.h>
+
+namespace odNet
+{
+
+    UdpFaultInjector::UdpFaultInjector(uint32_t seed)
+    : mRandom(seed)
+    , mDistribution(0.0, 1.0)
+    , mDropRate(0.0)
+    , mDuplicateRate(0.0)
+    , mReorderRate(0.0)
+    , mHasHeld(false)
+    {
+    }
+
+    void UdpFaultInjector::process(const UdpEndpoint &to, const char *data, size_t size, const OutputCallback &output)
+    {
+        if(_roll(mDropRate))
+        {
+            return;
+        }
+
+        size_t copies = _roll(mDuplicateRate) ? 2 : 1;
+
+        bool hadHeld = mHasHeld;
+        if(!hadHeld && _roll(mReorderRate))
+        {
+            mHasHeld = true;
+            mHeldEndpoint = to;
+            mHeldDatagram.assign(data, data + size);
+            copies--;
+        }
+
+        for(size_t i = 0; i < copies; ++i)
+        {
+            output(to, data, size);
+        }
+
+        // whatever was held back before goes out after this one
+        if(hadHeld)
+        {
+            releaseHeld(output);
+        }
+    }
+
+    void UdpFaultInjector::releaseHeld(const OutputCallback &output)
+    {
+        if(!mHasHeld)
+        {
+            return;
+        }
+
+        mHasHeld = false;
+        output(mHeldEndpoint, mHeldDatagram.data(), mHeldDatagram.size());
+    }
+
+    bool UdpFaultInjector::_roll(double rate)
+    {
+        return rate > 0.0 && mDistribution(mRandom) < rate;
+    }
+
+}
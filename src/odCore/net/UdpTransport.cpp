@@ -0,0 +1,408 @@
+
+#include <odCore/net/UdpTransport.h>
+
+#include <random>
+
+#include <odCore/DataStream.h>
+#include <odCore/Logger.h>
+#include <odCore/Panic.h>
+#include <odCore/ThreadUtils.h>
+
+#include <odCore/net/DownlinkConnector.h>
+#include <odCore/net/UplinkConnector.h>
+
+namespace odNet
+{
+
+    static void _append8(std::vector<char> &v, uint8_t i)
+    {
+        v.push_back(static_cast<char>(i));
+    }
+
+    static void _append16(std::vector<char> &v, uint16_t i)
+    {
+        v.push_back(static_cast<char>(i & 0xff));
+        v.push_back(static_cast<char>(i >> 8));
+    }
+
+    static void _append64(std::vector<char> &v, uint64_t i)
+    {
+        for(size_t b = 0; b < 8; ++b)
+        {
+            v.push_back(static_cast<char>((i >> (8*b)) & 0xff));
+        }
+    }
+
+    /**
+     * @brief The splitmix64 finalizer. Spreads every input bit over the whole output.
+     */
+    static uint64_t _mix(uint64_t x)
+    {
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+        return x ^ (x >> 31);
+    }
+
+
+    UdpTransport::UdpTransport()
+    : mMtu(UdpConnection::DEFAULT_MTU)
+    , mStartTime(std::chrono::steady_clock::now())
+    , mHandshakeSecret(0)
+    , mTerminateNetworkThread(false)
+    , mReceiveBuffer(UdpSocket::MAX_DATAGRAM_SIZE)
+    {
+        std::random_device rd;
+        mHandshakeSecret = (static_cast<uint64_t>(rd()) << 32) ^ rd();
+    }
+
+    UdpTransport::~UdpTransport()
+    {
+        mTerminateNetworkThread.store(true, std::memory_order_release);
+        if(mNetworkThread.joinable())
+        {
+            mNetworkThread.join();
+        }
+    }
+
+    void UdpTransport::setFaultInjector(std::unique_ptr<UdpFaultInjector> injector)
+    {
+        if(mNetworkThread.joinable())
+        {
+            OD_PANIC() << "Fault injector must be set before the transport is started";
+        }
+
+        mFaultInjector = std::move(injector);
+    }
+
+    void UdpTransport::listen(const IpV4Address &address, uint16_t port, const AcceptCallback &acceptCallback, const DisconnectCallback &disconnectCallback)
+    {
+        mSocket.bind(address, port);
+        mAcceptCallback = acceptCallback;
+        mDisconnectCallback = disconnectCallback;
+
+        _startNetworkThread();
+
+        Logger::info() << "Listening for UDP connections on port " << getLocalPort();
+    }
+
+    std::shared_ptr<UplinkConnector> UdpTransport::connect(const IpV4Address &address, uint16_t port, std::shared_ptr<DownlinkConnector> downlinkOutput)
+    {
+        mSocket.bind(IpV4Address::any(), 0);
+
+        // the network thread starts the handshake on it's first update
+        Link &link = _createLink(UdpEndpoint(address, port), false);
+        _connectLink(link, downlinkOutput, nullptr);
+
+        _startNetworkThread();
+
+        return link.packetBuilder;
+    }
+
+    size_t UdpTransport::getConnectionCount()
+    {
+        std::lock_guard<std::mutex> lock(mLinksMutex);
+        return mLinks.size();
+    }
+
+    double UdpTransport::_now() const
+    {
+        return 1e-9 * std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - mStartTime).count();
+    }
+
+    UdpTransport::Link &UdpTransport::_createLink(const UdpEndpoint &remote, bool accepted)
+    {
+        auto link = std::make_shared<Link>();
+        link->remote = remote;
+        link->accepted = accepted;
+        link->established = accepted;
+        link->lastReceiveTime = _now();
+        link->lastHandshakeSendTime = -HANDSHAKE_INTERVAL;
+        link->cookie = 0;
+
+        Link *linkPtr = link.get();
+
+        auto datagramCallback = [this, linkPtr](const char *data, size_t size)
+        {
+            _sendDatagram(linkPtr->remote, data, size);
+        };
+
+        auto messageCallback = [linkPtr](const char *data, size_t size, UdpConnection::Channel channel)
+        {
+            if(linkPtr->packetParser == nullptr)
+            {
+                return;
+            }
+
+            auto result = linkPtr->packetParser->parse(data, size);
+            if(result.remainingBytes != 0)
+            {
+                Logger::warn() << "Received message with " << result.remainingBytes << " bytes of incomplete packets. Ignoring them";
+            }
+        };
+
+        link->connection = std::make_unique<UdpConnection>(datagramCallback, messageCallback);
+        link->connection->setMtu(mMtu);
+
+        // the builder is handed out and may outlive the link, so it must not keep it alive
+        std::weak_ptr<Link> weakLink = link;
+        auto packetCallback = [this, weakLink](const char *data, size_t size, PacketBuilder::LinkType linkType)
+        {
+            auto link = weakLink.lock();
+            if(link == nullptr)
+            {
+                return;
+            }
+
+            auto channel = (linkType == PacketBuilder::LinkType::RELIABLE) ? UdpConnection::Channel::RELIABLE : UdpConnection::Channel::UNRELIABLE;
+
+            std::lock_guard<std::mutex> lock(link->mutex);
+            link->connection->send(data, size, channel, _now());
+        };
+
+        link->packetBuilder = std::make_shared<PacketBuilder>(packetCallback);
+
+        // coalesced packets should fill, but not exceed a datagram, so they never need to be fragmented
+        link->packetBuilder->setCoalescing(mMtu - UdpConnection::DATAGRAM_HEADER_SIZE - UdpConnection::UNRELIABLE_CHUNK_HEADER_SIZE);
+
+        std::lock_guard<std::mutex> lock(mLinksMutex);
+        auto &entry = mLinks[remote];
+        entry = std::move(link);
+        return *entry;
+    }
+
+    void UdpTransport::_connectLink(Link &link, std::shared_ptr<DownlinkConnector> downlinkOutput, std::shared_ptr<UplinkConnector> uplinkOutput)
+    {
+        std::lock_guard<std::mutex> lock(link.mutex);
+        link.packetParser = std::make_unique<PacketParser>(downlinkOutput, uplinkOutput);
+    }
+
+    uint64_t UdpTransport::_getCookie(const UdpEndpoint &remote) const
+    {
+        // 0 means "no cookie" to connecting transports
+        uint64_t cookie = _mix(mHandshakeSecret ^ UdpEndpoint::Hash()(remote));
+        return (cookie != 0) ? cookie : 1;
+    }
+
+    void UdpTransport::_sendHandshake(const UdpEndpoint &to, HandshakeType type, uint64_t cookie)
+    {
+        std::vector<char> datagram;
+        datagram.reserve(HANDSHAKE_DATAGRAM_SIZE);
+        _append16(datagram, HANDSHAKE_PROTOCOL_ID);
+        _append8(datagram, static_cast<uint8_t>(type));
+        _append64(datagram, cookie);
+
+        _sendDatagram(to, datagram.data(), datagram.size());
+    }
+
+    void UdpTransport::_receiveHandshake(const UdpEndpoint &from, Link *link, const char *data, size_t size, double now)
+    {
+        uint16_t protocolId;
+        uint8_t type;
+        uint64_t cookie;
+        od::DataReader dr(data, size);
+        dr >> protocolId >> type >> cookie;
+
+        switch(static_cast<HandshakeType>(type))
+        {
+        case HandshakeType::REQUEST:
+            // stateless. whoever can read the challenge at the address it claims to have gets accepted
+            if(mAcceptCallback != nullptr && link == nullptr)
+            {
+                _sendHandshake(from, HandshakeType::CHALLENGE, _getCookie(from));
+            }
+            break;
+
+        case HandshakeType::CHALLENGE:
+            if(link != nullptr && !link->accepted && !link->established)
+            {
+                link->cookie = cookie;
+                link->lastHandshakeSendTime = now;
+                _sendHandshake(from, HandshakeType::RESPONSE, cookie);
+            }
+            break;
+
+        case HandshakeType::RESPONSE:
+            // repeated responses for links we already accepted are answered by the connection's next keepalive
+            if(mAcceptCallback == nullptr || link != nullptr)
+            {
+                break;
+            }
+
+            if(cookie != _getCookie(from))
+            {
+                // probably a challenge from before we restarted. just challenge again
+                _sendHandshake(from, HandshakeType::CHALLENGE, _getCookie(from));
+
+            }else
+            {
+                // remotes we don't want to talk to still get a link, so we don't ask again for every datagram they send
+                link = &_createLink(from, true);
+                auto uplinkOutput = mAcceptCallback(from, link->packetBuilder);
+                _connectLink(*link, nullptr, uplinkOutput);
+
+                Logger::info() << "Accepted UDP connection from port " << from.getPort();
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    void UdpTransport::_sendDatagram(const UdpEndpoint &to, const char *data, size_t size)
+    {
+        if(mFaultInjector != nullptr)
+        {
+            std::lock_guard<std::mutex> lock(mFaultInjectorMutex);
+            mFaultInjector->process(to, data, size, [this](const UdpEndpoint &to, const char *data, size_t size)
+            {
+                mSocket.send(to, data, size);
+            });
+
+        }else
+        {
+            mSocket.send(to, data, size);
+        }
+    }
+
+    void UdpTransport::_startNetworkThread()
+    {
+        if(mNetworkThread.joinable())
+        {
+            OD_PANIC() << "UDP transport was already started";
+        }
+
+        mNetworkThread = std::thread(&UdpTransport::_networkThreadFunc, this);
+        od::ThreadUtils::setThreadName(mNetworkThread, "udp transport");
+    }
+
+    void UdpTransport::_networkThreadFunc()
+    {
+        while(!mTerminateNetworkThread.load(std::memory_order_acquire))
+        {
+            if(mSocket.waitForData(UPDATE_INTERVAL))
+            {
+                UdpEndpoint from;
+                size_t size;
+                while((size = mSocket.receive(mReceiveBuffer.data(), mReceiveBuffer.size(), from)) > 0)
+                {
+                    Link *link = nullptr;
+
+                    {
+                        std::lock_guard<std::mutex> lock(mLinksMutex);
+                        auto it = mLinks.find(from);
+                        if(it != mLinks.end())
+                        {
+                            link = it->second.get();
+                        }
+                    }
+
+                    double now = _now();
+
+                    if(size == HANDSHAKE_DATAGRAM_SIZE && !UdpConnection::isConnectionDatagram(mReceiveBuffer.data(), size))
+                    {
+                        uint16_t protocolId;
+                        od::DataReader(mReceiveBuffer.data(), size) >> protocolId;
+                        if(protocolId == HANDSHAKE_PROTOCOL_ID)
+                        {
+                            _receiveHandshake(from, link, mReceiveBuffer.data(), size, now);
+                        }
+                        continue;
+                    }
+
+                    // remotes have to complete the handshake before we look at anything else they send
+                    if(link == nullptr || !UdpConnection::isConnectionDatagram(mReceiveBuffer.data(), size))
+                    {
+                        continue;
+                    }
+
+                    // the server only talks to us once it accepted our handshake
+                    link->established = true;
+                    link->lastReceiveTime = now;
+
+                    std::lock_guard<std::mutex> lock(link->mutex);
+                    link->connection->receiveDatagram(mReceiveBuffer.data(), size, now);
+                }
+            }
+
+            _updateLinks(_now());
+
+            if(mFaultInjector != nullptr)
+            {
+                std::lock_guard<std::mutex> lock(mFaultInjectorMutex);
+                mFaultInjector->releaseHeld([this](const UdpEndpoint &to, const char *data, size_t size)
+                {
+                    mSocket.send(to, data, size);
+                });
+            }
+        }
+    }
+
+    void UdpTransport::_updateLinks(double now)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mLinksMutex);
+            mTempLinkUpdateList.clear();
+            auto it = mLinks.begin();
+            while(it != mLinks.end())
+            {
+                Link &link = *it->second;
+                bool timedOut = link.accepted && now - link.lastReceiveTime > LINK_TIMEOUT;
+
+                bool closed;
+                {
+                    std::lock_guard<std::mutex> linkLock(link.mutex);
+                    closed = link.connection->isClosed();
+                }
+
+                if(timedOut || closed)
+                {
+                    mTempRemovedLinks.push_back(std::move(it->second));
+                    it = mLinks.erase(it);
+
+                }else
+                {
+                    mTempLinkUpdateList.push_back(&link);
+                    ++it;
+                }
+            }
+        }
+
+        // callbacks are made without holding the links mutex, so they may send or query the transport
+        for(auto &link : mTempRemovedLinks)
+        {
+            Logger::info() << "Dropped UDP connection with port " << link->remote.getPort();
+
+            if(link->accepted && mDisconnectCallback != nullptr)
+            {
+                mDisconnectCallback(link->remote);
+            }
+        }
+        mTempRemovedLinks.clear();
+
+        for(auto link : mTempLinkUpdateList)
+        {
+            if(!link->established)
+            {
+                // until the server accepts us, our connection would only talk into the void
+                if(now - link->lastHandshakeSendTime >= HANDSHAKE_INTERVAL)
+                {
+                    link->lastHandshakeSendTime = now;
+                    if(link->cookie == 0)
+                    {
+                        _sendHandshake(link->remote, HandshakeType::REQUEST, 0);
+
+                    }else
+                    {
+                        _sendHandshake(link->remote, HandshakeType::RESPONSE, link->cookie);
+                    }
+                }
+                continue;
+            }
+
+            std::lock_guard<std::mutex> lock(link->mutex);
+            link->connection->update(now);
+        }
+    }
+
+}
@@ -7,6 +7,10 @@
 
 #include <odCore/physics/CharacterController.h>
 
+#include <algorithm>
+
+#include <glm/geometric.hpp>
+
 #include <odCore/LevelObject.h>
 #include <odCore/Level.h>
 
@@ -18,66 +22,166 @@ namespace odPhysics
 
     static const float STEP_HEIGHT = 0.07f;
 
+    // cosine of the steepest slope a character can stand on (45°)
+    static const float MIN_GROUND_NORMAL_Y = 0.7071f;
+
+    // the player is about 0.3 lu tall, which puts a lu at roughly 6 m. this is earth's gravity at that scale
+    static const float GRAVITY = 1.6f;
+    static const float TERMINAL_VELOCITY = 8.0f;
+
+    // sweeps stop this far before a hit, so the next sweep doesn't start out touching or penetrating the surface
+    static const float SKIN_WIDTH = 0.002f;
+
+    // each iteration slides along one more surface. three are enough to get out of any corner
+    static const size_t MAX_SLIDE_ITERATIONS = 3;
+
+    static const float MIN_MOVE_LENGTH = 1e-5f;
+
+    static const PhysicsTypeMasks::Mask COLLISION_MASK = PhysicsTypeMasks::LevelObject | PhysicsTypeMasks::Layer;
+
 
 	CharacterController::CharacterController(PhysicsSystem &physicsSystem, std::shared_ptr<ObjectHandle> handle, od::LevelObject &charObject, float radius, float height)
 	: mPhysicsSystem(physicsSystem)
     , mCharObject(charObject)
 	, mObjectHandle(handle)
+	, mRadius(radius)
+	, mHeight(std::max(height, 2*radius))
 	, mUp(0, 1, 0)
-	, mVelocity(0, -1, 0)
+	, mDesiredMove(0, 0, 0)
 	, mIsFalling(false)
 	, mFallingVelocity(0.0f)
 	{
-		mCurrentPosition = mCharObject.getPosition();
-        mDesiredPosition = mCurrentPosition;
-
-		mRelativeLowPoint = mUp * (radius+height*(-0.5f));
-		mRelativeHighPoint = mUp * (radius+height*0.5f);
 	}
 
     void CharacterController::moveRelative(const glm::vec3 &relTranslation, float relTime)
     {
-        glm::vec3 moveDirection = mCharObject.getRotation()*relTranslation;
-        glm::vec3 moveTarget = moveDirection + mCharObject.getPosition();
-
-        mDesiredDirection = glm::normalize(moveDirection);
-        mDesiredPosition = moveTarget;
+        // the animation may move us several times per update. collect it all and resolve collisions once
+        mDesiredMove += mCharObject.getRotation()*relTranslation;
     }
 
 	void CharacterController::update(float relTime)
 	{
-	    // ignore slide collisions for now. just implement stepping. this whole thing needs rewriting anyway
-        mCurrentPosition = mDesiredPosition;
-
-        _step(STEP_HEIGHT); // step up
-        bool onGround = _step(-STEP_HEIGHT); // step down
-        mIsFalling = !onGround;
-        mFallingVelocity = 0.0f;
-
-        //ContactTestResultVector results;
-        //mPhysicsSystem.contactTest(mObjectHandle, PhysicsTypeMasks::LevelObject | PhysicsTypeMasks::Layer, results);
+	    glm::vec3 startPosition = mCharObject.getPosition();
+	    glm::vec3 position = startPosition;
+
+	    // vertical movement is up to gravity and stepping alone
+	    glm::vec3 move = mDesiredMove - mUp*glm::dot(mDesiredMove, mUp);
+	    mDesiredMove = glm::vec3(0, 0, 0);
+
+	    bool wasOnGround = !mIsFalling;
+	    if(mIsFalling)
+	    {
+	        mFallingVelocity = std::min(mFallingVelocity + GRAVITY*relTime, TERMINAL_VELOCITY);
+	    }
+	    float fallDistance = mFallingVelocity*relTime;
+
+	    bool isMoving = glm::dot(move, move) > MIN_MOVE_LENGTH*MIN_MOVE_LENGTH;
+
+	    // step up, so the horizontal move passes over anything lower than a step. falling characters can't climb
+	    SweepTestResult hit;
+	    float stepUp = 0.0f;
+	    if(wasOnGround && isMoving)
+	    {
+	        glm::vec3 beforeStep = position;
+	        _sweep(position, position + mUp*STEP_HEIGHT, position, hit);
+	        stepUp = glm::dot(position - beforeStep, mUp);
+	    }
+
+	    // move horizontally, sliding along whatever we hit
+	    glm::vec3 originalMove = move;
+	    for(size_t i = 0; i < MAX_SLIDE_ITERATIONS && isMoving; ++i)
+	    {
+	        glm::vec3 target = position + move;
+	        if(!_sweep(position, target, position, hit))
+	        {
+	            break;
+	        }
+
+	        // slopes we can stand on are walked up. anything steeper counts as a vertical wall, so sliding along it never lifts us
+	        glm::vec3 normal = hit.hitNormal;
+	        if(!_isWalkable(normal))
+	        {
+	            normal -= mUp*glm::dot(normal, mUp);
+	            if(glm::dot(normal, normal) < MIN_MOVE_LENGTH*MIN_MOVE_LENGTH)
+	            {
+	                break;
+	            }
+	            normal = glm::normalize(normal);
+	        }
+
+	        glm::vec3 remaining = target - position;
+	        move = remaining - normal*glm::dot(remaining, normal);
+
+	        // never slide back against the direction we wanted to go. that would make us jitter in corners
+	        isMoving = glm::dot(move, move) > MIN_MOVE_LENGTH*MIN_MOVE_LENGTH && glm::dot(move, originalMove) > 0;
+	    }
+
+	    // step down again. this undoes the step up, applies the fall, and while we are standing, snaps to ground up to a step below
+	    float fall = stepUp + fallDistance;
+	    float snap = wasOnGround ? STEP_HEIGHT : 0.0f;
+	    glm::vec3 beforeFall = position;
+	    glm::vec3 reached;
+	    bool hitGround = _sweep(beforeFall, beforeFall - mUp*(fall + snap), reached, hit);
+	    if(hitGround && _isWalkable(hit.hitNormal))
+	    {
+	        position = reached;
+	        mIsFalling = false;
+	        mFallingVelocity = 0.0f;
+
+	    }else
+	    {
+	        float fallen = glm::dot(beforeFall - reached, mUp);
+	        if(hitGround && fallen < fall)
+	        {
+	            // we fell onto ground that is too steep to stand on. slide down along it for the rest of the fall
+	            position = reached;
+	            glm::vec3 slide = mUp*(fallen - fall);
+	            slide -= hit.hitNormal*glm::dot(slide, hit.hitNormal);
+	            _sweep(position, position + slide, position, hit);
+
+	        }else
+	        {
+	            // don't snap to anything. what we found, if anything, is either too steep or further away than we fell
+	            position = beforeFall - mUp*fall;
+	        }
+
+	        mIsFalling = true;
+	    }
+
+	    if(position != startPosition)
+	    {
+	        mCharObject.setPosition(position);
+	    }
+	}
 
-        mCharObject.setPosition(mCurrentPosition);
+	bool CharacterController::_sweep(const glm::vec3 &from, const glm::vec3 &to, glm::vec3 &reachedOut, SweepTestResult &hitOut)
+	{
+	    glm::vec3 delta = to - from;
+	    float length = glm::length(delta);
+	    if(length < MIN_MOVE_LENGTH)
+	    {
+	        reachedOut = from;
+	        return false;
+	    }
+
+	    // the capsule is swept by it's center, while we track the character's feet
+	    glm::vec3 centerOffset = mUp*(0.5f*mHeight);
+	    Handle *exclude = mObjectHandle.get();
+	    if(!mPhysicsSystem.capsuleSweepTestClosest(from + centerOffset, to + centerOffset, mRadius, mHeight, COLLISION_MASK, exclude, hitOut))
+	    {
+	        reachedOut = to;
+	        return false;
+	    }
+
+	    float fraction = std::max(hitOut.hitFraction - SKIN_WIDTH/length, 0.0f);
+	    reachedOut = from + delta*fraction;
+
+	    return true;
 	}
 
-	bool CharacterController::_step(float stepHeight)
+	bool CharacterController::_isWalkable(const glm::vec3 &normal) const
 	{
-		/*glm::vec3 rayStart = mCurrentPosition + (stepHeight > 0 ? mRelativeHighPoint : mRelativeLowPoint);
-		glm::vec3 rayEnd = rayStart + mUp*stepHeight;
-		ClosestNotMeRayResultCallback callback(rayStart, rayEnd, CollisionGroups::ALL, mGhostObject.get());
-		mPhysicsManager.mDynamicsWorld->rayTest(rayStart, rayEnd, callback);
-		if(callback.hasHit() && _needsCollision(callback.m_collisionObject, mGhostObject.get()))
-		{
-			mCurrentPosition += mUp*callback.m_closestHitFraction*stepHeight;
-			return true;
-
-		}else
-		{
-			mCurrentPosition += mUp*stepHeight;
-			return false;
-		}*/
-
-		return false;
+	    return glm::dot(normal, mUp) >= MIN_GROUND_NORMAL_Y;
 	}
 
 }
@@ -7,7 +7,9 @@
 
 #include <odCore/physics/Handles.h>
 
+#include <odCore/Light.h>
 #include <odCore/LightCallback.h>
+#include <odCore/SpatialHashGrid.h>
 
 namespace odPhysics
 {
@@ -55,6 +57,19 @@ namespace odPhysics
     }
 
 
+    LightHandle::LightHandle(const od::Light &light, od::SpatialHashGrid<LightHandle*> &lightGrid)
+    : mLight(std::make_shared<od::Light>(light))
+    , mLightGrid(lightGrid)
+    , mBoundingSphere(light.getPosition(), light.getRadius())
+    {
+        _updateGridEntry();
+    }
+
+    LightHandle::~LightHandle()
+    {
+        mLightGrid.remove(this);
+    }
+
     LightHandle *LightHandle::asLightHandle()
     {
         return this;
@@ -65,6 +80,28 @@ namespace odPhysics
         return Type::Light;
     }
 
+    void LightHandle::setRadius(float radius, bool modifyLight)
+    {
+        mBoundingSphere = od::BoundingSphere(mBoundingSphere.center(), radius);
+        _updateGridEntry();
+
+        if(modifyLight)
+        {
+            mLight->setRadius(radius);
+        }
+    }
+
+    void LightHandle::setPosition(const glm::vec3 &pos, bool modifyLight)
+    {
+        mBoundingSphere = od::BoundingSphere(pos, mBoundingSphere.radius());
+        _updateGridEntry();
+
+        if(modifyLight)
+        {
+            mLight->setPosition(pos);
+        }
+    }
+
     void LightHandle::addAffectedHandle(std::shared_ptr<Handle> handle)
     {
         mAffectedHandles.push_back(handle);
@@ -86,4 +123,12 @@ namespace odPhysics
 
         mAffectedHandles.clear();
     }
+
+    void LightHandle::_updateGridEntry()
+    {
+        glm::vec3 center = mBoundingSphere.center();
+        glm::vec3 extent(mBoundingSphere.radius());
+        mLightGrid.insert(this, od::AxisAlignedBoundingBox(center - extent, center + extent));
+    }
+
 }
@@ -1,14 +1,39 @@
 
 #include <odCore/physics/PhysicsSystem.h>
 
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
 #include <odCore/Panic.h>
 #include <odCore/LightCallback.h>
+#include <odCore/LevelObject.h>
+#include <odCore/Layer.h>
 
 #include <odCore/db/Model.h>
 
 namespace odPhysics
 {
 
+    static bool sphereIntersectsSphere(const od::BoundingSphere &a, const od::BoundingSphere &b)
+    {
+        glm::vec3 delta = a.center() - b.center();
+        float radiusSum = a.radius() + b.radius();
+        return glm::dot(delta, delta) <= radiusSum*radiusSum;
+    }
+
+    static bool sphereIntersectsBox(const od::BoundingSphere &sphere, const od::AxisAlignedBoundingBox &box)
+    {
+        glm::vec3 closestPoint = glm::clamp(sphere.center(), box.min(), box.max());
+        glm::vec3 delta = sphere.center() - closestPoint;
+        return glm::dot(delta, delta) <= sphere.radius()*sphere.radius();
+    }
+
+
+    PhysicsSystem::PhysicsSystem()
+    : mLightGrid(LIGHT_GRID_CELL_SIZE)
+    {
+    }
+
     std::shared_ptr<ModelShape> PhysicsSystem::getOrCreateModelShape(std::shared_ptr<odDb::Model> model)
     {
         OD_CHECK_ARG_NONNULL(model);
@@ -25,6 +50,11 @@ namespace odPhysics
         return newShape;
     }
 
+    std::shared_ptr<LightHandle> PhysicsSystem::createLightHandle(const od::Light &light)
+    {
+        return std::make_shared<LightHandle>(light, mLightGrid);
+    }
+
     void PhysicsSystem::dispatchLighting(std::shared_ptr<Handle> handle)
     {
         OD_CHECK_ARG_NONNULL(handle);
@@ -34,9 +64,10 @@ namespace odPhysics
         {
             lightHandle->clearLightAffection();
 
+            auto &sphere = lightHandle->getBoundingSphere();
             PhysicsTypeMasks::Mask mask = PhysicsTypeMasks::LevelObject | PhysicsTypeMasks::Layer;
             ContactTestResultVector results;
-            this->contactTest(handle, mask, results);
+            this->sphereTest(sphere.center(), sphere.radius(), mask, results);
 
             for(auto &result : results)
             {
@@ -59,14 +90,38 @@ namespace odPhysics
 
             lightCallback->clearLightList();
 
-            PhysicsTypeMasks::Mask mask = PhysicsTypeMasks::Light;
-            ContactTestResultVector results;
-            this->contactTest(handle, mask, results);
-
-            for(auto &result : results)
+            switch(handle->getHandleType())
             {
-                auto lightHandle = result.handle->asLightHandle();
-                lightCallback->addAffectingLight(lightHandle->getLight());
+            case Handle::Type::Object:
+                {
+                    od::BoundingSphere sphere = handle->asObjectHandle()->getLevelObject().getBoundingSphere();
+                    glm::vec3 extent(sphere.radius());
+                    od::AxisAlignedBoundingBox sphereBox(sphere.center() - extent, sphere.center() + extent);
+                    mLightGrid.query(sphereBox, [lightCallback, &sphere](LightHandle *light, const od::AxisAlignedBoundingBox &lightBox)
+                    {
+                        if(sphereIntersectsSphere(light->getBoundingSphere(), sphere))
+                        {
+                            lightCallback->addAffectingLight(light->getLight());
+                        }
+                    });
+                }
+                break;
+
+            case Handle::Type::Layer:
+                {
+                    const od::AxisAlignedBoundingBox &layerBox = handle->asLayerHandle()->getLayer().getBoundingBox();
+                    mLightGrid.query(layerBox, [lightCallback, &layerBox](LightHandle *light, const od::AxisAlignedBoundingBox &lightBox)
+                    {
+                        if(sphereIntersectsBox(light->getBoundingSphere(), layerBox))
+                        {
+                            lightCallback->addAffectingLight(light->getLight());
+                        }
+                    });
+                }
+                break;
+
+            default:
+                break;
             }
         }
     }
@@ -0,0 +1,200 @@
+
+#include <odCore/physics/TriggerManager.h>
+
+#include <algorithm>
+
+#include <glm/geometric.hpp>
+
+#include <odCore/Panic.h>
+#include <odCore/LevelObject.h>
+
+#include <odCore/physics/PhysicsSystem.h>
+#include <odCore/physics/Handles.h>
+
+namespace odPhysics
+{
+
+    static od::AxisAlignedBoundingBox boxAroundSphere(const od::BoundingSphere &sphere)
+    {
+        glm::vec3 extent(sphere.radius());
+        return od::AxisAlignedBoundingBox(sphere.center() - extent, sphere.center() + extent);
+    }
+
+
+    TriggerManager::TriggerManager(PhysicsSystem &physicsSystem)
+    : mPhysicsSystem(physicsSystem)
+    , mTriggerGrid(TRIGGER_GRID_CELL_SIZE)
+    {
+    }
+
+    void TriggerManager::addTrigger(od::LevelObject &obj, std::shared_ptr<ObjectHandle> handle, TriggerCallback &callback)
+    {
+        auto it = mTriggers.find(obj.getObjectId());
+        if(it != mTriggers.end())
+        {
+            OD_PANIC() << "Object " << obj.getObjectId() << " already is a trigger";
+        }
+
+        Trigger &trigger = mTriggers[obj.getObjectId()];
+        trigger.obj = &obj;
+        trigger.handle = handle;
+        trigger.callback = &callback;
+        trigger.sphere = obj.getBoundingSphere();
+
+        mTriggerGrid.insert(&trigger, boxAroundSphere(trigger.sphere));
+    }
+
+    void TriggerManager::removeTrigger(od::LevelObject &obj)
+    {
+        od::LevelObjectId id = obj.getObjectId();
+
+        auto it = mTriggers.find(id);
+        if(it == mTriggers.end())
+        {
+            return;
+        }
+
+        mTriggerGrid.remove(&it->second);
+        mTriggers.erase(it);
+
+        auto begin = std::lower_bound(mOverlaps.begin(), mOverlaps.end(), _makeOverlapKey(id, 0));
+        auto end = std::upper_bound(begin, mOverlaps.end(), _makeOverlapKey(id, 0xffffffff));
+        mOverlaps.erase(begin, end);
+
+        auto eventIt = std::remove_if(mPendingEvents.begin(), mPendingEvents.end(), [id](const Event &e){ return e.triggerId == id; });
+        mPendingEvents.erase(eventIt, mPendingEvents.end());
+    }
+
+    void TriggerManager::addActivator(od::LevelObject &obj)
+    {
+        mActivators[obj.getObjectId()] = &obj;
+    }
+
+    void TriggerManager::removeActivator(od::LevelObject &obj)
+    {
+        od::LevelObjectId id = obj.getObjectId();
+        if(mActivators.erase(id) == 0)
+        {
+            return;
+        }
+
+        for(auto key : mOverlaps)
+        {
+            if(_getActivatorId(key) == id)
+            {
+                mPendingEvents.push_back({ _getTriggerId(key), id, false });
+            }
+        }
+
+        auto it = std::remove_if(mOverlaps.begin(), mOverlaps.end(), [id](uint64_t key){ return _getActivatorId(key) == id; });
+        mOverlaps.erase(it, mOverlaps.end());
+    }
+
+    size_t TriggerManager::getActivatorCountInside(od::LevelObject &obj) const
+    {
+        od::LevelObjectId id = obj.getObjectId();
+
+        auto begin = std::lower_bound(mOverlaps.begin(), mOverlaps.end(), _makeOverlapKey(id, 0));
+        auto end = std::upper_bound(begin, mOverlaps.end(), _makeOverlapKey(id, 0xffffffff));
+
+        return static_cast<size_t>(end - begin);
+    }
+
+    void TriggerManager::update()
+    {
+        // triggers rarely move, and re-entering an unmoved one into the grid doesn't relink it, so just refresh all
+        for(auto &t : mTriggers)
+        {
+            Trigger &trigger = t.second;
+            trigger.sphere = trigger.obj->getBoundingSphere();
+            mTriggerGrid.insert(&trigger, boxAroundSphere(trigger.sphere));
+        }
+
+        mNewOverlaps.clear();
+        for(auto &a : mActivators)
+        {
+            od::LevelObject &activator = *a.second;
+            od::BoundingSphere activatorSphere = activator.getBoundingSphere();
+
+            mTriggerGrid.query(boxAroundSphere(activatorSphere), [this, &activator, &activatorSphere](Trigger *trigger, const od::AxisAlignedBoundingBox &triggerBox)
+            {
+                if(_testOverlap(*trigger, activator, activatorSphere))
+                {
+                    mNewOverlaps.push_back(_makeOverlapKey(trigger->obj->getObjectId(), activator.getObjectId()));
+                }
+            });
+        }
+
+        std::sort(mNewOverlaps.begin(), mNewOverlaps.end());
+
+        // both lists are sorted, so one merge-like pass finds all entered and left pairs
+        auto oldIt = mOverlaps.begin();
+        auto newIt = mNewOverlaps.begin();
+        while(oldIt != mOverlaps.end() || newIt != mNewOverlaps.end())
+        {
+            if(newIt == mNewOverlaps.end() || (oldIt != mOverlaps.end() && *oldIt < *newIt))
+            {
+                mPendingEvents.push_back({ _getTriggerId(*oldIt), _getActivatorId(*oldIt), false });
+                ++oldIt;
+
+            }else if(oldIt == mOverlaps.end() || *newIt < *oldIt)
+            {
+                mPendingEvents.push_back({ _getTriggerId(*newIt), _getActivatorId(*newIt), true });
+                ++newIt;
+
+            }else
+            {
+                ++oldIt;
+                ++newIt;
+            }
+        }
+
+        mOverlaps.swap(mNewOverlaps);
+
+        // callbacks may add or remove triggers and activators, which can queue new events. those are left for the next update
+        mDispatchedEvents.swap(mPendingEvents);
+        for(auto &event : mDispatchedEvents)
+        {
+            auto it = mTriggers.find(event.triggerId);
+            if(it == mTriggers.end())
+            {
+                continue;
+            }
+
+            if(event.entered)
+            {
+                it->second.callback->onActivatorEntered(event.activatorId);
+
+            }else
+            {
+                it->second.callback->onActivatorLeft(event.activatorId);
+            }
+        }
+        mDispatchedEvents.clear();
+    }
+
+    bool TriggerManager::_testOverlap(Trigger &trigger, od::LevelObject &activator, const od::BoundingSphere &activatorSphere)
+    {
+        if(trigger.obj == &activator)
+        {
+            return false;
+        }
+
+        glm::vec3 delta = trigger.sphere.center() - activatorSphere.center();
+        float radiusSum = trigger.sphere.radius() + activatorSphere.radius();
+        if(glm::dot(delta, delta) > radiusSum*radiusSum)
+        {
+            return false;
+        }
+
+        // spheres intersect. only now is it worth asking the physics system
+        auto activatorHandle = activator.getPhysicsHandle();
+        if(trigger.handle == nullptr || activatorHandle == nullptr)
+        {
+            return true;
+        }
+
+        return mPhysicsSystem.contactPairTest(*trigger.handle, *activatorHandle);
+    }
+
+}
@@ -152,6 +152,95 @@ namespace odBulletPhysics
     }
 
 
+    BatchRayCallback::BatchRayCallback(const btVector3 &start, const btVector3 &end, const odPhysics::RayQuery &query, odPhysics::RayQueryResult &result)
+    : mResult(result)
+    , mStart(start)
+    , mEnd(end)
+    , mExclude(query.exclude)
+    {
+        m_collisionFilterGroup = odPhysics::PhysicsTypeMasks::Ray;
+        m_collisionFilterMask = query.typeMask;
+
+        mResult.hasHit = false;
+        mResult.hitFraction = 1.0f;
+        mResult.handle = nullptr;
+    }
+
+    btScalar BatchRayCallback::addSingleResult(btCollisionWorld::LocalRayResult& rayResult, bool normalInWorldSpace)
+    {
+        if(mExclude != nullptr && static_cast<odPhysics::Handle*>(rayResult.m_collisionObject->getUserPointer()) == mExclude)
+        {
+            return m_closestHitFraction;
+        }
+
+        m_closestHitFraction = rayResult.m_hitFraction;
+        m_collisionObject = rayResult.m_collisionObject;
+
+        btVector3 hitNormal;
+        if(normalInWorldSpace)
+        {
+            hitNormal = rayResult.m_hitNormalLocal;
+
+        } else
+        {
+            // need to transform normal into worldspace
+            hitNormal = rayResult.m_collisionObject->getWorldTransform().getBasis()*rayResult.m_hitNormalLocal;
+        }
+
+        btVector3 hitPoint;
+        hitPoint.setInterpolate3(mStart, mEnd, rayResult.m_hitFraction);
+
+        mResult.hasHit = true;
+        mResult.hitFraction = rayResult.m_hitFraction;
+        mResult.hitPoint = BulletAdapter::toGlm(hitPoint);
+        mResult.hitNormal = BulletAdapter::toGlm(hitNormal);
+        mResult.handle = static_cast<odPhysics::Handle*>(rayResult.m_collisionObject->getUserPointer());
+
+        return rayResult.m_hitFraction;
+    }
+
+
+    ClosestSweepCallback::ClosestSweepCallback(const btVector3 &from, const btVector3 &to, odPhysics::PhysicsTypeMasks::Mask mask, odPhysics::Handle *exclude)
+    : btCollisionWorld::ClosestConvexResultCallback(from, to)
+    , mExclude(exclude)
+    {
+        m_collisionFilterGroup = odPhysics::PhysicsTypeMasks::Ray;
+        m_collisionFilterMask = mask;
+    }
+
+    btScalar ClosestSweepCallback::addSingleResult(btCollisionWorld::LocalConvexResult& convexResult, bool normalInWorldSpace)
+    {
+        const btCollisionObject *object = convexResult.m_hitCollisionObject;
+        if(mExclude != nullptr && static_cast<odPhysics::Handle*>(object->getUserPointer()) == mExclude)
+        {
+            return m_closestHitFraction;
+        }
+
+        if(!object->hasContactResponse())
+        {
+            return m_closestHitFraction;
+        }
+
+        btVector3 hitNormal;
+        if(normalInWorldSpace)
+        {
+            hitNormal = convexResult.m_hitNormalLocal;
+
+        }else
+        {
+            hitNormal = object->getWorldTransform().getBasis()*convexResult.m_hitNormalLocal;
+        }
+
+        // the normal points towards the swept shape. if we are moving along or away from the surface, it can't block us
+        if(hitNormal.dot(m_convexToWorld - m_convexFromWorld) >= 0)
+        {
+            return m_closestHitFraction;
+        }
+
+        return ClosestConvexResultCallback::addSingleResult(convexResult, normalInWorldSpace);
+    }
+
+
     ContactResultCallback::ContactResultCallback(btCollisionObject *me, odPhysics::PhysicsTypeMasks::Mask mask, odPhysics::ContactTestResultVector &results)
     : mMe(me)
     , mResults(results)
@@ -194,4 +283,21 @@ namespace odBulletPhysics
         return 0.0;
     }
 
+
+    PairContactCallback::PairContactCallback()
+    : mHasContact(false)
+    {
+    }
+
+    btScalar PairContactCallback::addSingleResult(btManifoldPoint& cp, const btCollisionObjectWrapper* colObj0Wrap, int partId0, int index0, const btCollisionObjectWrapper* colObj1Wrap, int partId1, int index1)
+    {
+        // manifolds may contain points that are merely within the contact threshold
+        if(cp.getDistance() <= 0)
+        {
+            mHasContact = true;
+        }
+
+        return 0.0;
+    }
+
 }
@@ -7,19 +7,26 @@
 
 #include <odCore/physics/bullet/BulletPhysicsSystem.h>
 
+#include <algorithm>
+#include <exception>
+#include <future>
+#include <vector>
+
+#include <LinearMath/btAabbUtil2.h>
 #include <BulletCollision/BroadphaseCollision/btDbvtBroadphase.h>
 #include <BulletCollision/CollisionDispatch/btDefaultCollisionConfiguration.h>
 #include <BulletCollision/CollisionDispatch/btCollisionObject.h>
+#include <BulletCollision/CollisionShapes/btCapsuleShape.h>
 
 #include <odCore/Downcast.h>
 #include <odCore/LevelObject.h>
 #include <odCore/Layer.h>
 #include <odCore/Panic.h>
+#include <odCore/ThreadPool.h>
 
 #include <odCore/physics/bullet/BulletAdapter.h>
 #include <odCore/physics/bullet/LayerHandleImpl.h>
 #include <odCore/physics/bullet/ObjectHandleImpl.h>
-#include <odCore/physics/bullet/LightHandleImpl.h>
 #include <odCore/physics/bullet/ModelShapeImpl.h>
 #include <odCore/physics/bullet/BulletCallbacks.h>
 #include <odCore/physics/bullet/DebugDrawer.h>
@@ -27,6 +34,131 @@
 namespace odBulletPhysics
 {
 
+    // below this, splitting a batch costs more in synchronization than it saves
+    static constexpr size_t MIN_RAYS_PER_BATCH_CHUNK = 64;
+
+    /**
+     * @brief A part of a ray batch. Chunks traverse the broadphase independently, so they can run on different threads.
+     */
+    struct RayBatchChunk
+    {
+        struct Ray
+        {
+            btTransform fromTransform;
+            btTransform toTransform;
+            btVector3 inverseDirection;
+            unsigned int signs[3];
+        };
+
+        RayBatchChunk(const odPhysics::RayQuery *batchQueries, odPhysics::RayQueryResult *results, size_t count)
+        : queries(batchQueries)
+        {
+            rays.resize(count);
+            callbacks.reserve(count);
+            activeRays.resize(count);
+
+            for(size_t i = 0; i < count; ++i)
+            {
+                btVector3 from = BulletAdapter::toBullet(queries[i].from);
+                btVector3 to = BulletAdapter::toBullet(queries[i].to);
+
+                auto &ray = rays[i];
+                ray.fromTransform = btTransform(btQuaternion(0, 0, 0, 1), from);
+                ray.toTransform = btTransform(btQuaternion(0, 0, 0, 1), to);
+
+                // same as btDbvtBroadphase::rayTest does it, except that we don't normalize. that way, the lambdas
+                //  of the AABB test are hit fractions, and can be compared to the closest hit so far
+                btVector3 direction = to - from;
+                ray.inverseDirection.setValue(
+                        (direction[0] == 0) ? BT_LARGE_FLOAT : 1/direction[0],
+                        (direction[1] == 0) ? BT_LARGE_FLOAT : 1/direction[1],
+                        (direction[2] == 0) ? BT_LARGE_FLOAT : 1/direction[2]);
+                ray.signs[0] = ray.inverseDirection[0] < 0;
+                ray.signs[1] = ray.inverseDirection[1] < 0;
+                ray.signs[2] = ray.inverseDirection[2] < 0;
+
+                callbacks.emplace_back(from, to, queries[i], results[i]);
+                activeRays[i] = static_cast<uint32_t>(i);
+            }
+        }
+
+        /**
+         * @brief Tests the rays in activeRays[begin, end) against the subtree at node.
+         *
+         * Rays missing a node are partitioned out of the range before descending. The children reorder the
+         * range, but leave the set of rays in it intact, so both children can be passed the same range.
+         */
+        void traverse(const btDbvtNode *node, size_t begin, size_t end)
+        {
+            btVector3 bounds[2] = { node->volume.Mins(), node->volume.Maxs() };
+            auto hitsNode = [this, &bounds](uint32_t i)
+            {
+                btScalar tmin;
+                auto &ray = rays[i];
+                return btRayAabb2(ray.fromTransform.getOrigin(), ray.inverseDirection, ray.signs, bounds, tmin, 0, callbacks[i].m_closestHitFraction);
+            };
+            auto hitEnd = std::partition(activeRays.begin() + begin, activeRays.begin() + end, hitsNode);
+            end = hitEnd - activeRays.begin();
+            if(begin == end)
+            {
+                return;
+            }
+
+            if(node->isinternal())
+            {
+                traverse(node->childs[0], begin, end);
+                traverse(node->childs[1], begin, end);
+                return;
+            }
+
+            auto proxy = static_cast<const btBroadphaseProxy*>(node->data);
+            auto object = static_cast<btCollisionObject*>(proxy->m_clientObject);
+            bool acceptsRays = (proxy->m_collisionFilterMask & odPhysics::PhysicsTypeMasks::Ray);
+            if(!acceptsRays)
+            {
+                return;
+            }
+
+            for(size_t k = begin; k < end; ++k)
+            {
+                uint32_t i = activeRays[k];
+                auto &query = queries[i];
+                if(!(proxy->m_collisionFilterGroup & query.typeMask))
+                {
+                    continue;
+                }
+
+                if(query.exclude != nullptr && static_cast<odPhysics::Handle*>(object->getUserPointer()) == query.exclude)
+                {
+                    continue;
+                }
+
+                auto &ray = rays[i];
+                btCollisionWorld::rayTestSingle(ray.fromTransform, ray.toTransform, object, object->getCollisionShape(), object->getWorldTransform(), callbacks[i]);
+            }
+        }
+
+        const odPhysics::RayQuery *queries;
+        std::vector<Ray> rays;
+        std::vector<BatchRayCallback> callbacks;
+        std::vector<uint32_t> activeRays;
+    };
+
+    static void runRayBatchChunk(btDbvtBroadphase &broadphase, const odPhysics::RayQuery *queries, odPhysics::RayQueryResult *results, size_t count)
+    {
+        RayBatchChunk chunk(queries, results, count);
+
+        // objects live in either the dynamic or the fixed set
+        for(auto &set : broadphase.m_sets)
+        {
+            if(set.m_root != nullptr)
+            {
+                chunk.traverse(set.m_root, 0, count);
+            }
+        }
+    }
+
+
     BulletPhysicsSystem::BulletPhysicsSystem(odRender::Renderer *renderer)
     {
         mBroadphase = std::make_unique<btDbvtBroadphase>();
@@ -71,38 +203,124 @@ namespace odBulletPhysics
         return callback.hasHit();
     }
 
-    size_t BulletPhysicsSystem::contactTest(std::shared_ptr<odPhysics::Handle> handle, odPhysics::PhysicsTypeMasks::Mask typeMask, odPhysics::ContactTestResultVector &resultsOut)
+    void BulletPhysicsSystem::rayTestClosestBatch(const odPhysics::RayQuery *queries, odPhysics::RayQueryResult *resultsOut, size_t count, od::ThreadPool *pool)
     {
-        btCollisionObject *bulletObject;
-        switch(handle->getHandleType())
+        if(count == 0)
         {
-        case odPhysics::Handle::Type::Object:
-            bulletObject = od::confident_downcast<ObjectHandle>(handle)->getBulletObject();
-            break;
+            return;
 
-        case odPhysics::Handle::Type::Layer:
-            bulletObject = od::confident_downcast<LayerHandle>(handle)->getBulletObject();
-            break;
+        }else if(count == 1)
+        {
+            // nothing to share. Bullet's own traversal is just as good here, and needs no setup
+            btVector3 bStart = BulletAdapter::toBullet(queries[0].from);
+            btVector3 bEnd = BulletAdapter::toBullet(queries[0].to);
 
-        case odPhysics::Handle::Type::Light:
-            bulletObject = od::confident_downcast<LightHandle>(handle)->getBulletObject();
-            break;
+            BatchRayCallback callback(bStart, bEnd, queries[0], resultsOut[0]);
+            mCollisionWorld->rayTest(bStart, bEnd, callback);
+            return;
+        }
 
-        default:
-             OD_PANIC() << "Got physics handle of unknown type";
+        // we traverse the tree ourselves, since btDbvtBroadphase::rayTest takes one ray at a time and shares it's traversal stack between threads
+        auto &broadphase = *static_cast<btDbvtBroadphase*>(mBroadphase.get());
+
+        size_t chunkCount = (pool == nullptr) ? 1 : std::min(pool->getThreadCount() + 1, count / MIN_RAYS_PER_BATCH_CHUNK);
+        if(chunkCount <= 1)
+        {
+            runRayBatchChunk(broadphase, queries, resultsOut, count);
+            return;
         }
 
-        if(bulletObject == nullptr)
+        // the calling thread processes the first chunk while it waits for the pool to do the rest
+        size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+        std::vector<std::future<void>> chunkJobs;
+        chunkJobs.reserve(chunkCount - 1);
+        for(size_t begin = chunkSize; begin < count; begin += chunkSize)
         {
-            OD_PANIC() << "Handle for contact test contained nullptr bullet object";
+            size_t size = std::min(chunkSize, count - begin);
+            chunkJobs.push_back(pool->async([&broadphase, queries, resultsOut, begin, size]()
+            {
+                runRayBatchChunk(broadphase, queries + begin, resultsOut + begin, size);
+            }));
         }
 
+        // the jobs reference the caller's arrays, so we must not leave before all of them are done, even if we fail
+        std::exception_ptr error;
+        try
+        {
+            runRayBatchChunk(broadphase, queries, resultsOut, chunkSize);
+
+        }catch(...)
+        {
+            error = std::current_exception();
+        }
+
+        for(auto &job : chunkJobs)
+        {
+            job.wait();
+        }
+
+        if(error != nullptr)
+        {
+            std::rethrow_exception(error);
+        }
+
+        for(auto &job : chunkJobs)
+        {
+            job.get();
+        }
+    }
+
+    bool BulletPhysicsSystem::capsuleSweepTestClosest(const glm::vec3 &from, const glm::vec3 &to, float radius, float height, odPhysics::PhysicsTypeMasks::Mask typeMask, odPhysics::Handle *exclude, odPhysics::SweepTestResult &resultOut)
+    {
+        // bullet measures a capsule's height between the centers of it's caps. the shape is cheap to construct and
+        //  lives on the stack, so we don't need to cache shapes for every size that is swept
+        btScalar cylinderHeight = std::max(height - 2*radius, 0.0f);
+        btCapsuleShape capsule(radius, cylinderHeight);
+
+        btVector3 bFrom = BulletAdapter::toBullet(from);
+        btVector3 bTo = BulletAdapter::toBullet(to);
+        btTransform fromTransform(btQuaternion::getIdentity(), bFrom);
+        btTransform toTransform(btQuaternion::getIdentity(), bTo);
+
+        ClosestSweepCallback callback(bFrom, bTo, typeMask, exclude);
+        mCollisionWorld->convexSweepTest(&capsule, fromTransform, toTransform, callback);
+
+        if(!callback.hasHit())
+        {
+            return false;
+        }
+
+        resultOut.hitFraction = callback.m_closestHitFraction;
+        resultOut.hitPoint = BulletAdapter::toGlm(callback.m_hitPointWorld);
+        resultOut.hitNormal = BulletAdapter::toGlm(callback.m_hitNormalWorld);
+        resultOut.handle = static_cast<odPhysics::Handle*>(callback.m_hitCollisionObject->getUserPointer());
+
+        return true;
+    }
+
+    size_t BulletPhysicsSystem::contactTest(std::shared_ptr<odPhysics::Handle> handle, odPhysics::PhysicsTypeMasks::Mask typeMask, odPhysics::ContactTestResultVector &resultsOut)
+    {
+        OD_CHECK_ARG_NONNULL(handle);
+
+        btCollisionObject *bulletObject = _getBulletObject(*handle);
+
         ContactResultCallback callback(bulletObject, typeMask, resultsOut);
         mCollisionWorld->contactTest(bulletObject, callback);
 
         return callback.getContactCount();
     }
 
+    bool BulletPhysicsSystem::contactPairTest(odPhysics::Handle &a, odPhysics::Handle &b)
+    {
+        btCollisionObject *bulletObjectA = _getBulletObject(a);
+        btCollisionObject *bulletObjectB = _getBulletObject(b);
+
+        PairContactCallback callback;
+        mCollisionWorld->contactPairTest(bulletObjectA, bulletObjectB, callback);
+
+        return callback.hasContact();
+    }
+
     void BulletPhysicsSystem::sphereTest(const glm::vec3 &position, float radius, odPhysics::PhysicsTypeMasks::Mask typeMask, odPhysics::ContactTestResultVector &resultsOut)
     {
         if(mSphereObject == nullptr || mSphereShape == nullptr)
@@ -132,11 +350,6 @@ namespace odBulletPhysics
         return std::make_shared<LayerHandle>(layer, mCollisionWorld.get());
     }
 
-    std::shared_ptr<odPhysics::LightHandle> BulletPhysicsSystem::createLightHandle(const od::Light &light)
-    {
-        return std::make_shared<LightHandle>(light, mCollisionWorld.get());
-    }
-
     std::shared_ptr<odPhysics::ModelShape> BulletPhysicsSystem::createModelShape(std::shared_ptr<odDb::Model> model)
     {
         OD_CHECK_ARG_NONNULL(model);
@@ -174,4 +387,32 @@ namespace odBulletPhysics
         }
     }
 
+    btCollisionObject *BulletPhysicsSystem::_getBulletObject(odPhysics::Handle &handle)
+    {
+        btCollisionObject *bulletObject;
+        switch(handle.getHandleType())
+        {
+        case odPhysics::Handle::Type::Object:
+            bulletObject = od::confident_downcast<ObjectHandle>(&handle)->getBulletObject();
+            break;
+
+        case odPhysics::Handle::Type::Layer:
+            bulletObject = od::confident_downcast<LayerHandle>(&handle)->getBulletObject();
+            break;
+
+        case odPhysics::Handle::Type::Light:
+            OD_PANIC() << "Lights are not part of the collision world. Use a sphere test instead";
+
+        default:
+             OD_PANIC() << "Got physics handle of unknown type";
+        }
+
+        if(bulletObject == nullptr)
+        {
+            OD_PANIC() << "Handle for contact test contained nullptr bullet object";
+        }
+
+        return bulletObject;
+    }
+
 }
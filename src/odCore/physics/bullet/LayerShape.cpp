@@ -0,0 +1,283 @@
+
+#include <odCore/physics/bullet/LayerShape.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <LinearMath/btAabbUtil2.h>
+#include <BulletCollision/CollisionShapes/btTriangleCallback.h>
+#include <BulletCollision/NarrowPhaseCollision/btRaycastCallback.h>
+
+namespace odBulletPhysics
+{
+
+    // rays are culled against the height range of each cell they pass. this keeps rounding errors from culling grazing hits
+    static constexpr btScalar RAY_HEIGHT_TOLERANCE = 1e-3;
+
+    static uint32_t toCellIndex(btScalar coord, uint32_t cellCount)
+    {
+        if(coord <= 0)
+        {
+            return 0;
+
+        }else if(coord >= cellCount)
+        {
+            return cellCount - 1;
+        }
+
+        return static_cast<uint32_t>(coord);
+    }
+
+    /**
+     * Narrows [tEnter, tExit] down to the part of the ray origin + t*dir that lies within [0, size] on one axis.
+     * Returns false if nothing is left.
+     */
+    static bool clipToSlab(btScalar origin, btScalar dir, btScalar size, btScalar &tEnter, btScalar &tExit)
+    {
+        if(std::abs(dir) < SIMD_EPSILON)
+        {
+            return origin >= 0 && origin <= size;
+        }
+
+        btScalar t0 = (0 - origin)/dir;
+        btScalar t1 = (size - origin)/dir;
+        if(t0 > t1)
+        {
+            std::swap(t0, t1);
+        }
+
+        tEnter = std::max(tEnter, t0);
+        tExit = std::min(tExit, t1);
+
+        return tEnter <= tExit;
+    }
+
+
+    LayerShape::LayerShape(od::Layer &layer)
+    : mVertices(layer.getVertexVector())
+    , mCells(layer.getCellVector())
+    , mWidth(layer.getWidth())
+    , mHeight(layer.getHeight())
+    , mMinHeight(std::numeric_limits<btScalar>::max())
+    , mMaxHeight(std::numeric_limits<btScalar>::lowest())
+    , mLocalScaling(1, 1, 1)
+    {
+        m_shapeType = CUSTOM_CONCAVE_SHAPE_TYPE;
+
+        for(auto &vertex : mVertices)
+        {
+            mMinHeight = std::min(mMinHeight, static_cast<btScalar>(vertex.heightOffsetLu));
+            mMaxHeight = std::max(mMaxHeight, static_cast<btScalar>(vertex.heightOffsetLu));
+        }
+
+        if(mVertices.empty())
+        {
+            mMinHeight = 0;
+            mMaxHeight = 0;
+        }
+    }
+
+    void LayerShape::getAabb(const btTransform &t, btVector3 &aabbMin, btVector3 &aabbMax) const
+    {
+        btVector3 localMin = btVector3(0, mMinHeight, 0) * mLocalScaling;
+        btVector3 localMax = btVector3(mWidth, mMaxHeight, mHeight) * mLocalScaling;
+
+        btTransformAabb(localMin, localMax, getMargin(), t, aabbMin, aabbMax);
+    }
+
+    void LayerShape::processAllTriangles(btTriangleCallback *callback, const btVector3 &aabbMin, const btVector3 &aabbMax) const
+    {
+        if(mWidth == 0 || mHeight == 0)
+        {
+            return;
+        }
+
+        // Bullet tests rays against custom concave shapes by passing the ray's AABB here. for a diagonal ray, that
+        //  would cover many cells the ray never touches, so we recognize the ray callback and walk the grid instead
+        auto rayCallback = dynamic_cast<btTriangleRaycastCallback*>(callback);
+        if(rayCallback != nullptr)
+        {
+            _processRay(rayCallback);
+            return;
+        }
+
+        btVector3 gridMin = aabbMin / mLocalScaling;
+        btVector3 gridMax = aabbMax / mLocalScaling;
+        if(gridMax.x() < 0 || gridMax.z() < 0 || gridMin.x() > mWidth || gridMin.z() > mHeight
+                || gridMax.y() < mMinHeight || gridMin.y() > mMaxHeight)
+        {
+            return;
+        }
+
+        uint32_t xBegin = toCellIndex(gridMin.x(), mWidth);
+        uint32_t xEnd = toCellIndex(gridMax.x(), mWidth);
+        uint32_t zBegin = toCellIndex(gridMin.z(), mHeight);
+        uint32_t zEnd = toCellIndex(gridMax.z(), mHeight);
+
+        for(uint32_t z = zBegin; z <= zEnd; ++z)
+        {
+            for(uint32_t x = xBegin; x <= xEnd; ++x)
+            {
+                _processCell(callback, x, z, aabbMin.y(), aabbMax.y());
+            }
+        }
+    }
+
+    void LayerShape::setLocalScaling(const btVector3 &scaling)
+    {
+        mLocalScaling = scaling.absolute();
+    }
+
+    const btVector3 &LayerShape::getLocalScaling() const
+    {
+        return mLocalScaling;
+    }
+
+    void LayerShape::calculateLocalInertia(btScalar mass, btVector3 &inertia) const
+    {
+        // layers are always static
+        inertia.setValue(0, 0, 0);
+    }
+
+    const char *LayerShape::getName() const
+    {
+        return "LayerShape";
+    }
+
+    void LayerShape::_processCell(btTriangleCallback *callback, uint32_t x, uint32_t z, btScalar minY, btScalar maxY) const
+    {
+        size_t cellIndex = x + mWidth*z;
+        const od::Layer::Cell &cell = mCells[cellIndex];
+
+        // unlike when building geometry, we want to include invisible triangles here!
+        bool leftIsSolid = (cell.leftTextureRef != od::Layer::HoleTextureRef);
+        bool rightIsSolid = (cell.rightTextureRef != od::Layer::HoleTextureRef);
+        if(!leftIsSolid && !rightIsSolid)
+        {
+            return;
+        }
+
+        btVector3 a = _getVertex(x,   z);
+        btVector3 b = _getVertex(x+1, z);
+        btVector3 c = _getVertex(x,   z+1);
+        btVector3 d = _getVertex(x+1, z+1);
+
+        btScalar cellMinY = std::min(std::min(a.y(), b.y()), std::min(c.y(), d.y()));
+        btScalar cellMaxY = std::max(std::max(a.y(), b.y()), std::max(c.y(), d.y()));
+        if(cellMaxY < minY || cellMinY > maxY)
+        {
+            return;
+        }
+
+        // triangle indices count all triangles in the grid, holes included, so they can be mapped back to the cell
+        int leftTriangleIndex = static_cast<int>(cellIndex*2);
+        int rightTriangleIndex = leftTriangleIndex + 1;
+
+        btVector3 triangle[3];
+        if(!(cell.flags & OD_LAYER_FLAG_DIV_BACKSLASH))
+        {
+            if(leftIsSolid)
+            {
+                triangle[0] = c; triangle[1] = b; triangle[2] = a;
+                callback->processTriangle(triangle, 0, leftTriangleIndex);
+            }
+
+            if(rightIsSolid)
+            {
+                triangle[0] = c; triangle[1] = d; triangle[2] = b;
+                callback->processTriangle(triangle, 0, rightTriangleIndex);
+            }
+
+        }else // division = BACKSLASH
+        {
+            if(leftIsSolid)
+            {
+                triangle[0] = a; triangle[1] = c; triangle[2] = d;
+                callback->processTriangle(triangle, 0, leftTriangleIndex);
+            }
+
+            if(rightIsSolid)
+            {
+                triangle[0] = a; triangle[1] = d; triangle[2] = b;
+                callback->processTriangle(triangle, 0, rightTriangleIndex);
+            }
+        }
+    }
+
+    void LayerShape::_processRay(btTriangleRaycastCallback *callback) const
+    {
+        // x and z are walked in grid space, where cells have unit size. t is the same in both spaces
+        btVector3 from = callback->m_from / mLocalScaling;
+        btVector3 dir = callback->m_to / mLocalScaling - from;
+
+        btScalar tEnter = 0;
+        btScalar tExit = 1;
+        if(!clipToSlab(from.x(), dir.x(), mWidth, tEnter, tExit) || !clipToSlab(from.z(), dir.z(), mHeight, tEnter, tExit))
+        {
+            return;
+        }
+
+        btVector3 entry = from + dir*tEnter;
+        uint32_t x = toCellIndex(entry.x(), mWidth);
+        uint32_t z = toCellIndex(entry.z(), mHeight);
+
+        int stepX = (dir.x() > 0) ? 1 : ((dir.x() < 0) ? -1 : 0);
+        int stepZ = (dir.z() > 0) ? 1 : ((dir.z() < 0) ? -1 : 0);
+
+        // t at which the ray crosses the next cell border on each axis, and how much t advances per cell
+        btScalar tNextX = BT_LARGE_FLOAT;
+        btScalar tDeltaX = BT_LARGE_FLOAT;
+        if(stepX != 0)
+        {
+            tNextX = (static_cast<btScalar>(stepX > 0 ? x + 1 : x) - from.x()) / dir.x();
+            tDeltaX = std::abs(1 / dir.x());
+        }
+
+        btScalar tNextZ = BT_LARGE_FLOAT;
+        btScalar tDeltaZ = BT_LARGE_FLOAT;
+        if(stepZ != 0)
+        {
+            tNextZ = (static_cast<btScalar>(stepZ > 0 ? z + 1 : z) - from.z()) / dir.z();
+            tDeltaZ = std::abs(1 / dir.z());
+        }
+
+        btScalar fromY = callback->m_from.y();
+        btScalar dirY = callback->m_to.y() - fromY;
+        btScalar t = tEnter;
+        while(true)
+        {
+            btScalar tLeave = std::min(std::min(tNextX, tNextZ), tExit);
+
+            btScalar enterY = fromY + dirY*t;
+            btScalar leaveY = fromY + dirY*tLeave;
+            _processCell(callback, x, z, std::min(enterY, leaveY) - RAY_HEIGHT_TOLERANCE, std::max(enterY, leaveY) + RAY_HEIGHT_TOLERANCE);
+
+            // all cells after this one are further along the ray than any hit we already have
+            if(tLeave >= tExit || callback->m_hitFraction <= tLeave)
+            {
+                break;
+            }
+
+            if(tNextX < tNextZ)
+            {
+                x += stepX;
+                t = tNextX;
+                tNextX += tDeltaX;
+
+            }else
+            {
+                z += stepZ;
+                t = tNextZ;
+                tNextZ += tDeltaZ;
+            }
+
+            // stepping below zero wraps around, so this catches both borders
+            if(x >= mWidth || z >= mHeight)
+            {
+                break;
+            }
+        }
+    }
+
+}
@@ -85,9 +85,7 @@ namespace odRfl
 
         // field seems reasonable. let's fill it
 
-        od::MemoryInputBuffer buf(mFieldData.data(), mFieldData.size());
-        std::istream dataStr(&buf);
-        od::DataReader dr(dataStr);
+        od::DataReader dr(mFieldData.data(), mFieldData.size());
 
         dr.seek(entry.dataOffset);
         if(!entry.isArray)
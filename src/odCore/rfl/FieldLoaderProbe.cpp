@@ -70,6 +70,50 @@ namespace odRfl
         std::sort(mFieldEntries.begin(), mFieldEntries.end(), pred);
     }
 
+    void FieldLoaderProbe::getAssetRefs(std::vector<AssetRefEntry> &refs) const
+    {
+        for(auto &entry : mFieldEntries)
+        {
+            switch(static_cast<Field::Type>(entry.fieldType))
+            {
+            case Field::Type::CLASS:
+            case Field::Type::MODEL:
+            case Field::Type::SOUND:
+            case Field::Type::ANIMATION:
+            case Field::Type::SEQUENCE:
+            case Field::Type::TEXTURE:
+                break;
+
+            default:
+                continue;
+            }
+
+            od::DataReader dr(mFieldData.data(), mFieldData.size());
+            dr.seek(entry.dataOffset);
+
+            uint16_t count = 1;
+            if(entry.isArray)
+            {
+                uint16_t offset;
+                dr >> offset
+                   >> count;
+
+                dr.seek(offset*4);
+            }
+
+            for(size_t i = 0; i < count; ++i)
+            {
+                odDb::AssetRef ref;
+                dr >> ref;
+
+                if(!ref.isNull())
+                {
+                    refs.push_back({ entry.fieldType, ref });
+                }
+            }
+        }
+    }
+
     void FieldLoaderProbe::reset()
     {
         mRegistrationIndex = 0;
@@ -110,9 +154,7 @@ namespace odRfl
 
         // field seems reasonable. let's fill it
 
-        od::MemoryInputBuffer buf(mFieldData.data(), mFieldData.size());
-        std::istream dataStr(&buf);
-        od::DataReader dr(dataStr);
+        od::DataReader dr(mFieldData.data(), mFieldData.size());
 
         dr.seek(entry.dataOffset);
         if(!entry.isArray)
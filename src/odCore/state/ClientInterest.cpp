@@ -0,0 +1,218 @@
+
+#include <odCore/state/ClientInterest.h>
+
+#include <algorithm>
+
+#include <glm/geometric.hpp>
+
+#include <odCore/Layer.h>
+#include <odCore/Level.h>
+#include <odCore/LevelObject.h>
+#include <odCore/Panic.h>
+
+namespace odState
+{
+
+    ClientInterest::ClientInterest(od::Level &level)
+    : mLevel(level)
+    , mHasViewpoint(false)
+    , mViewpointId(0)
+    , mViewpointPosition(0.0f)
+    , mViewpointLayer(nullptr)
+    , mRelevanceDistance(std::numeric_limits<float>::infinity())
+    , mMaxObjectsPerSnapshot(0)
+    {
+    }
+
+    void ClientInterest::setViewpointObject(od::LevelObjectId id)
+    {
+        mHasViewpoint = true;
+        mViewpointId = id;
+    }
+
+    void ClientInterest::clearViewpointObject()
+    {
+        mHasViewpoint = false;
+        mViewpointLayer = nullptr;
+        mPvsLayers.clear();
+    }
+
+    void ClientInterest::setRelevanceDistance(float distance)
+    {
+        if(!(distance >= 0.0f))
+        {
+            OD_PANIC() << "Relevance distance must not be negative";
+        }
+
+        mRelevanceDistance = distance;
+    }
+
+    void ClientInterest::selectObjects(TickNumber referenceTick, const std::unordered_set<od::LevelObjectId> &changedObjects, std::vector<od::LevelObjectId> &selected)
+    {
+        selected.clear();
+
+        _updateViewpoint();
+
+        // objects whose full states the client has acknowledged can be delta-encoded again
+        for(auto it = mStaleObjects.begin(); it != mStaleObjects.end(); )
+        {
+            if(referenceTick != INVALID_TICK && it->second != INVALID_TICK && it->second <= referenceTick)
+            {
+                it = mStaleObjects.erase(it);
+
+            }else
+            {
+                ++it;
+            }
+        }
+
+        mCandidates.clear();
+        auto consider = [this, &changedObjects](od::LevelObjectId id)
+        {
+            float distance;
+            if(_checkRelevance(id, distance))
+            {
+                float &priority = mAccumulatedPriorities[id];
+                priority += 1.0f + PRIORITY_FALLOFF_DISTANCE/(PRIORITY_FALLOFF_DISTANCE + distance);
+                mCandidates.push_back({ id, priority });
+
+            }else
+            {
+                mAccumulatedPriorities.erase(id);
+                if(changedObjects.find(id) != changedObjects.end())
+                {
+                    mStaleObjects[id] = INVALID_TICK;
+                }
+            }
+        };
+
+        for(auto id : changedObjects)
+        {
+            consider(id);
+        }
+
+        for(auto &stale : mStaleObjects)
+        {
+            if(changedObjects.find(stale.first) == changedObjects.end())
+            {
+                consider(stale.first);
+            }
+        }
+
+        size_t selectedCount = mCandidates.size();
+        if(mMaxObjectsPerSnapshot > 0 && mCandidates.size() > mMaxObjectsPerSnapshot)
+        {
+            selectedCount = mMaxObjectsPerSnapshot;
+
+            auto pred = [](const Candidate &a, const Candidate &b) { return a.priority > b.priority; };
+            std::nth_element(mCandidates.begin(), mCandidates.begin() + selectedCount, mCandidates.end(), pred);
+
+            // deferred objects keep their accumulated priority. if they had changes, the client's copy is outdated now
+            for(auto it = mCandidates.begin() + selectedCount; it != mCandidates.end(); ++it)
+            {
+                if(changedObjects.find(it->id) != changedObjects.end())
+                {
+                    mStaleObjects[it->id] = INVALID_TICK;
+                }
+            }
+        }
+
+        selected.reserve(selectedCount);
+        for(size_t i = 0; i < selectedCount; ++i)
+        {
+            selected.push_back(mCandidates[i].id);
+            mAccumulatedPriorities.erase(mCandidates[i].id);
+        }
+    }
+
+    bool ClientInterest::needsFullStates(od::LevelObjectId id) const
+    {
+        return mStaleObjects.find(id) != mStaleObjects.end();
+    }
+
+    void ClientInterest::objectSent(od::LevelObjectId id, TickNumber tick)
+    {
+        auto it = mStaleObjects.find(id);
+        if(it != mStaleObjects.end())
+        {
+            it->second = tick;
+        }
+    }
+
+    void ClientInterest::_updateViewpoint()
+    {
+        if(!mHasViewpoint)
+        {
+            return;
+        }
+
+        auto viewpoint = mLevel.getLevelObjectById(mViewpointId);
+        if(viewpoint == nullptr)
+        {
+            // keep culling against the last known viewpoint
+            return;
+        }
+
+        mViewpointPosition = viewpoint->getPosition();
+
+        od::Layer *layer = viewpoint->getAssociatedLayer();
+        if(layer != mViewpointLayer)
+        {
+            mViewpointLayer = layer;
+            mPvsLayers.clear();
+            if(layer != nullptr)
+            {
+                mPvsLayers.insert(layer->getId());
+                for(auto index : layer->getVisibleLayerIndices())
+                {
+                    od::Layer *visibleLayer = mLevel.getLayerByIndex(index);
+                    if(visibleLayer != nullptr)
+                    {
+                        mPvsLayers.insert(visibleLayer->getId());
+                    }
+                }
+            }
+        }
+    }
+
+    bool ClientInterest::_isInPvs(od::Layer *layer) const
+    {
+        return layer == nullptr || mViewpointLayer == nullptr || mPvsLayers.find(layer->getId()) != mPvsLayers.end();
+    }
+
+    bool ClientInterest::_checkRelevance(od::LevelObjectId id, float &distance)
+    {
+        distance = 0.0f;
+
+        if(!mHasViewpoint || id == mViewpointId)
+        {
+            return true;
+        }
+
+        auto obj = mLevel.getLevelObjectById(id);
+        if(obj == nullptr)
+        {
+            return true;
+        }
+
+        distance = glm::distance(obj->getPosition(), mViewpointPosition);
+
+        bool wasRelevant = (mRelevantObjects.find(id) != mRelevantObjects.end());
+        float maxDistance = wasRelevant ? mRelevanceDistance*RELEVANCE_HYSTERESIS : mRelevanceDistance;
+        bool relevant = (distance <= maxDistance) && _isInPvs(obj->getAssociatedLayer());
+
+        if(relevant)
+        {
+            mRelevantObjects.insert(id);
+
+        }else if(wasRelevant)
+        {
+            // the object is leaving. send it once more so the client keeps it's latest states
+            mRelevantObjects.erase(id);
+            return true;
+        }
+
+        return relevant;
+    }
+
+}
@@ -115,9 +115,14 @@ namespace odState
     template <typename T>
     struct DeserializeConstructorWrapper
     {
-        T make(od::DataReader &dr) const
+        std::optional<EventVariant> make(od::DataReader &dr) const
         {
-            return T{dr};
+            if(dr.getRemainingSize() < T::SERIALIZED_SIZE)
+            {
+                return std::nullopt;
+            }
+
+            return EventVariant{T{dr}};
         }
     };
 
@@ -127,19 +132,28 @@ namespace odState
     };
 
     template <typename..._Types>
-    static EventVariant deserializeImpl(size_t index, od::DataReader &dr, DummyTag<std::variant<_Types...>>)
+    static std::optional<EventVariant> deserializeImpl(size_t index, od::DataReader &dr, DummyTag<std::variant<_Types...>>)
     {
         using WrapperVariant = std::variant<DeserializeConstructorWrapper<_Types>...>;
 
         static constexpr WrapperVariant wrappers[] = { DeserializeConstructorWrapper<_Types>()... };
 
-        auto visitor = [&dr](auto &w){ return EventVariant{ w.make(dr)}; };
+        if(index >= sizeof...(_Types))
+        {
+            return std::nullopt;
+        }
+
+        auto visitor = [&dr](auto &w){ return w.make(dr); };
         return std::visit(visitor, wrappers[index]);
     }
 
-    EventVariant EventVariantSerializer::deserialize(od::DataReader &dr)
+    std::optional<EventVariant> EventVariantSerializer::deserialize(od::DataReader &dr)
     {
         SerializedIndex index;
+        if(dr.getRemainingSize() < sizeof(index))
+        {
+            return std::nullopt;
+        }
         dr >> index;
 
         return deserializeImpl(static_cast<size_t>(index), dr, DummyTag<EventVariant>());
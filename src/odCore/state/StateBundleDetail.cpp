@@ -20,6 +20,86 @@ namespace odState
             value = (v != 0);
         }
 
+        template <>
+        void quantizedStateValueWrite<bool>(od::BitWriter &writer, const StateQuantization &quantization, StateFlags::Type flags, const bool &value)
+        {
+            writer.writeBool(value);
+        }
+
+        template <>
+        void quantizedStateValueWrite<float>(od::BitWriter &writer, const StateQuantization &quantization, StateFlags::Type flags, const float &value)
+        {
+            if(flags & StateFlags::UNIT_INTERVAL)
+            {
+                StateQuantization::writeUnitInterval(writer, value);
+
+            }else
+            {
+                writer.writeFloat(value);
+            }
+        }
+
+        template <>
+        void quantizedStateValueWrite<glm::vec3>(od::BitWriter &writer, const StateQuantization &quantization, StateFlags::Type flags, const glm::vec3 &value)
+        {
+            if(flags & StateFlags::POSITION)
+            {
+                quantization.writePosition(writer, value);
+
+            }else
+            {
+                writer.writeFloat(value.x);
+                writer.writeFloat(value.y);
+                writer.writeFloat(value.z);
+            }
+        }
+
+        template <>
+        void quantizedStateValueWrite<glm::quat>(od::BitWriter &writer, const StateQuantization &quantization, StateFlags::Type flags, const glm::quat &value)
+        {
+            StateQuantization::writeRotation(writer, value);
+        }
+
+        template <>
+        void quantizedStateValueRead<bool>(od::BitReader &reader, const StateQuantization &quantization, StateFlags::Type flags, bool &value)
+        {
+            value = reader.readBool();
+        }
+
+        template <>
+        void quantizedStateValueRead<float>(od::BitReader &reader, const StateQuantization &quantization, StateFlags::Type flags, float &value)
+        {
+            if(flags & StateFlags::UNIT_INTERVAL)
+            {
+                value = StateQuantization::readUnitInterval(reader);
+
+            }else
+            {
+                value = reader.readFloat();
+            }
+        }
+
+        template <>
+        void quantizedStateValueRead<glm::vec3>(od::BitReader &reader, const StateQuantization &quantization, StateFlags::Type flags, glm::vec3 &value)
+        {
+            if(flags & StateFlags::POSITION)
+            {
+                value = quantization.readPosition(reader);
+
+            }else
+            {
+                value.x = reader.readFloat();
+                value.y = reader.readFloat();
+                value.z = reader.readFloat();
+            }
+        }
+
+        template <>
+        void quantizedStateValueRead<glm::quat>(od::BitReader &reader, const StateQuantization &quantization, StateFlags::Type flags, glm::quat &value)
+        {
+            value = StateQuantization::readRotation(reader);
+        }
+
         bool shouldBeIncludedInSerialization(StateSerializationPurpose purpose, StateFlags::Type flags)
         {
             switch(purpose)
@@ -2,14 +2,19 @@
 #include <odCore/state/StateManager.h>
 
 #include <algorithm>
+#include <future>
 
+#include <odCore/BitStream.h>
 #include <odCore/Level.h>
 #include <odCore/LevelObject.h>
 #include <odCore/Panic.h>
+#include <odCore/ThreadPool.h>
 
 #include <odCore/net/DownlinkConnector.h>
 #include <odCore/net/UplinkConnector.h>
 
+#include <odCore/state/ClientInterest.h>
+
 namespace odState
 {
 
@@ -46,7 +51,21 @@ namespace odState
     StateManager::StateManager(od::Level &level)
     : mLevel(level)
     , mDisallowStateUpdates(false)
+    , mQuantization(StateQuantization::forLevelBounds(level.getBoundingBox()))
+    , mLastAppliedLowerTick(INVALID_TICK)
+    , mLastAppliedUpperTick(INVALID_TICK)
+    , mLastAppliedRealtime(0.0)
+    , mMaxExtrapolationTime(0.0)
+    , mErrorCorrectionTime(0.1)
+    , mEncodingTick(INVALID_TICK)
+    , mTimelineStart(0)
+    , mTimelineSize(0)
     {
+        mTimeline.reserve(TICK_CAPACITY);
+        for(size_t i = 0; i < TICK_CAPACITY; ++i)
+        {
+            mTimeline.emplace_back(INVALID_TICK);
+        }
     }
 
     void StateManager::setUplinkConnector(std::shared_ptr<odNet::UplinkConnector> c)
@@ -54,14 +73,29 @@ namespace odState
         mUplinkConnectorForAck = c;
     }
 
+    void StateManager::setQuantization(const StateQuantization &quantization)
+    {
+        mQuantization = quantization;
+    }
+
+    void StateManager::setMaxExtrapolationTime(double t)
+    {
+        mMaxExtrapolationTime = std::max(t, 0.0);
+    }
+
+    void StateManager::setErrorCorrectionTime(double t)
+    {
+        mErrorCorrectionTime = std::max(t, 0.0);
+    }
+
     TickNumber StateManager::getLatestTick()
     {
-        return mSnapshots.empty() ? INVALID_TICK : mSnapshots.back().tick;
+        return (mTimelineSize == 0) ? INVALID_TICK : _getTimelineSnapshot(mTimelineSize - 1).tick;
     }
 
     double StateManager::getLatestRealtime()
     {
-        return mSnapshots.empty() ? 0.0 : mSnapshots.back().realtime;
+        return (mTimelineSize == 0) ? 0.0 : _getTimelineSnapshot(mTimelineSize - 1).realtime;
     }
 
     void StateManager::objectStatesChanged(od::LevelObject &object, const od::ObjectStates &newStates)
@@ -70,6 +104,9 @@ namespace odState
 
         auto &storedStates = mCurrentUpdateStatesMap[object.getObjectId()].basicStates;
         storedStates.merge(storedStates, newStates);
+
+        mChangedSinceCommit.insert(object.getObjectId());
+        mChangedSinceApply.insert(object.getObjectId());
     }
 
     void StateManager::objectExtraStatesChanged(od::LevelObject &object, const StateBundleBase &newStates)
@@ -85,6 +122,9 @@ namespace odState
 
         // storedStates is nonnull and unique
         storedStates->merge(*storedStates, newStates);
+
+        mChangedSinceCommit.insert(object.getObjectId());
+        mChangedSinceApply.insert(object.getObjectId());
     }
 
     void StateManager::incomingObjectStatesChanged(TickNumber tick, od::LevelObjectId objectId, const od::ObjectStates &newStates)
@@ -102,10 +142,12 @@ namespace odState
         auto &states = snapshotIt->statesMap[objectId].extraStates;
         if(states == nullptr)
         {
+            // the ID comes from the network, so don't trust it
             auto obj = mLevel.getLevelObjectById(objectId);
             if(obj == nullptr || obj->getExtraStates() == nullptr)
             {
-                OD_PANIC() << "No states available to clone";
+                Logger::error() << "Ignoring extra states for object " << objectId << ", which has none";
+                return;
             }
 
             states = obj->getExtraStates()->cloneShared();
@@ -118,11 +160,16 @@ namespace odState
 
         states->clear();
 
-        od::MemoryInputBuffer buffer(data, size);
-        std::istream stream(&buffer);
-        od::DataReader reader(stream);
+        od::BitReader reader(data, size);
 
-        states->deserialize(reader, odState::StateSerializationPurpose::NETWORK);
+        states->deserializeQuantized(reader, mQuantization);
+        if(reader.hasFailed())
+        {
+            // the parser can't check these, as only we know the layout of the object's extra states
+            Logger::error() << "Ignoring truncated extra states for object " << objectId;
+            states = nullptr;
+            return;
+        }
 
         _commitIncomingIfComplete(tick, snapshotIt);
     }
@@ -140,147 +187,210 @@ namespace odState
 
     void StateManager::commit(double realtime)
     {
-        TickNumber nextTick = mSnapshots.empty() ? FIRST_TICK : mSnapshots.back().tick + 1;
+        TickNumber nextTick = (mTimelineSize == 0) ? FIRST_TICK : getLatestTick() + 1;
 
-        if(mSnapshots.size() >= TICK_CAPACITY)
-        {
-            // snapshot capacity reached. reclaim oldest snapshot so we don't have to reallocate the change map
-            auto oldSnapshot = std::move(mSnapshots.front());
-            mSnapshots.pop_front();
-            oldSnapshot.tick = nextTick;
-            oldSnapshot.realtime = realtime;
-            oldSnapshot.statesMap = mCurrentUpdateStatesMap;
-            mSnapshots.emplace_back(std::move(oldSnapshot));
+        Snapshot &snapshot = _insertTimelineSnapshot(nextTick);
+        snapshot.realtime = realtime;
 
-        }else
+        // the update loop reported every change since the last commit, so we only need to store those objects.
+        //  extra states are shared with the update map here. they are cloned as soon as either side changes
+        for(auto id : mChangedSinceCommit)
         {
-            mSnapshots.emplace_back(nextTick);
-            auto &newSnapshot = mSnapshots.back();
-            newSnapshot.statesMap = mCurrentUpdateStatesMap;
-            newSnapshot.realtime = realtime;
+            auto it = mCurrentUpdateStatesMap.find(id);
+            if(it != mCurrentUpdateStatesMap.end())
+            {
+                snapshot.statesMap.emplace(id, it->second);
+            }
         }
+
+        mChangedSinceCommit.clear();
     }
 
     void StateManager::apply(double realtime)
     {
         ApplyGuard applyGuard(*this);
 
-        // TODO: not all states change everytime! we should remember the last tick we applied and only process states that changed between the two.
-        //  right now we apply *every* tracked state every single frame even if it didn't change, and that wastes a lot of time
-
-        if(mSnapshots.empty())
+        if(mTimelineSize == 0)
         {
             // can't apply anything on an empty timeline. we are done right away.
             return;
         }
 
-        // find the first snapshots with a time later than the requested one
-        auto pred = [](double realtime, Snapshot &snapshot) { return realtime < snapshot.realtime; };
-        auto it = std::upper_bound(mSnapshots.begin(), mSnapshots.end(), realtime, pred);
+        size_t a;
+        size_t b;
+        double delta;
+        bool extrapolating = _selectSnapshots(realtime, a, b, delta);
 
-        if(it == mSnapshots.end())
+        TickNumber tickA = _getTimelineSnapshot(a).tick;
+        TickNumber tickB = _getTimelineSnapshot(b).tick;
+
+        // a new snapshot replaced the ones we extrapolated from. rather than snapping objects to where they really are,
+        //  we fade out whatever we guessed wrong
+        if(!mExtrapolatedStates.empty() && tickB != mLastAppliedUpperTick)
         {
-            // the latest snapshot is older than the requested time -> extrapolate
-            //  TODO: extrapolation not implemented. applying latest snapshot verbatim for now
-            for(auto &states : mSnapshots.back().statesMap)
-            {
-                auto obj = mLevel.getLevelObjectById(states.first);
-                if(obj == nullptr) continue;
+            _beginErrorCorrection(realtime);
+        }
 
-                states.second.applyToObject(*obj);
-            }
+        // an object can only end up with different values than we applied last time if it changed in any snapshot
+        //  between the ones we applied then and the ones we apply now, or if it was changed locally in the meantime.
+        //  all other objects still hold what we applied before and can be skipped
+        mObjectsToApply.clear();
+        bool incremental = false;
+        if(mLastAppliedLowerTick != INVALID_TICK)
+        {
+            TickNumber fromTick = std::min(mLastAppliedLowerTick, tickA);
+            TickNumber toTick = std::max(mLastAppliedUpperTick, tickB);
+            incremental = _collectChangedObjects(fromTick, toTick, mObjectsToApply);
+        }
 
-        }else if(it == mSnapshots.begin())
+        if(incremental)
         {
-            // we only have one snapshot in the timeline, and it's later than the requested time.
-            //  extrapolating here is probably unnecessary, so we just apply the snapshot as if it happened right now.
-            for(auto &states : it->statesMap)
-            {
-                auto obj = mLevel.getLevelObjectById(states.first);
-                if(obj == nullptr) continue;
+            mObjectsToApply.insert(mChangedSinceApply.begin(), mChangedSinceApply.end());
 
-                states.second.applyToObject(*obj);
-            }
+        }else
+        {
+            mObjectsToApply.clear();
+            _collectAllObjects(b, mObjectsToApply);
+        }
+
+        // objects with pending corrections move every frame, even when their states don't change
+        for(auto &correction : mErrorCorrections)
+        {
+            mObjectsToApply.insert(correction.first);
+        }
+
+        for(auto id : mObjectsToApply)
+        {
+            _applyObjectStates(id, a, b, delta, extrapolating, realtime);
+        }
+
+        mChangedSinceApply.clear();
+        mLastAppliedLowerTick = tickA;
+        mLastAppliedUpperTick = tickB;
+        mLastAppliedRealtime = realtime;
+    }
+
+    void StateManager::sendSnapshotToClient(TickNumber tickToSend, odNet::DownlinkConnector &c, TickNumber referenceSnapshot, ClientInterest *interest)
+    {
+        size_t toSend = _findTimelineSnapshot(tickToSend);
+        if(toSend == NO_SNAPSHOT)
+        {
+            OD_PANIC() << "Snapshot with given tick not available for sending";
+        }
+
+        size_t reference = _findReferenceSnapshot(referenceSnapshot, toSend);
+        TickNumber referenceTick = (reference != NO_SNAPSHOT) ? referenceSnapshot : INVALID_TICK;
+
+        _invalidateEncodings(tickToSend);
+        EncodedSnapshot &encoded = _getEncodedSnapshot(tickToSend, toSend, reference);
+
+        if(interest != nullptr)
+        {
+            interest->selectObjects(referenceTick, encoded.objects, mSelectedObjects);
 
         }else
         {
-            Snapshot &a = *(it-1);
-            Snapshot &b = *it;
+            mSelectedObjects.assign(encoded.objects.begin(), encoded.objects.end());
+        }
 
-            double delta = (realtime - a.realtime)/(b.realtime - a.realtime);
+        size_t discreteChangeCount = 0;
 
-            for(auto &states : a.statesMap)
+        for(auto id : mSelectedObjects)
+        {
+            const EncodedObject *encodedObject = nullptr;
+            if(interest != nullptr && reference != NO_SNAPSHOT && interest->needsFullStates(id))
             {
-                auto obj = mLevel.getLevelObjectById(states.first);
-                if(obj == nullptr) continue;
+                encodedObject = _getFullObjectEncoding(id, toSend);
 
-                auto stateInB = b.statesMap.find(states.first);
-                if(stateInB == b.statesMap.end())
-                {
-                    // no corresponding change in B. this should not happen, as
-                    //  all snapshots reflect all changes since load. for now, assume steady state
-                    Logger::warn() << "Incomplete timeline. A tracked state seems to have disappeared";
-                    states.second.applyToObject(*obj);
-
-                }else
+            }else
+            {
+                auto it = encoded.encodedObjects.find(id);
+                if(it != encoded.encodedObjects.end())
                 {
-                    // TODO: a flag indicating that a state has not changed since the last snapshot might improve performance a tiny bit by ommitting the lerp.
-                    //  we still have to store full snapshots, as we must move through the timeline arbitrarily, and for every missing state, we'd have to
-                    //  search previous and intermediate snapshots to recover the original state
-                    CombinedStates lerped;
-                    lerped.lerp(states.second, stateInB->second, delta);
-                    lerped.applyToObject(*obj);
+                    encodedObject = &it->second;
                 }
             }
+
+            if(encodedObject == nullptr)
+            {
+                continue;
+            }
+
+            if(encodedObject->basicChangeCount > 0)
+            {
+                c.objectStatesChanged(tickToSend, id, encodedObject->basicStates);
+            }
+
+            if(encodedObject->extraChangeCount > 0)
+            {
+                c.objectExtraStatesChanged(tickToSend, id, encodedObject->extraStates.data(), encodedObject->extraStates.size());
+            }
+
+            discreteChangeCount += encodedObject->basicChangeCount + encodedObject->extraChangeCount;
+
+            if(interest != nullptr)
+            {
+                interest->objectSent(id, tickToSend);
+            }
         }
+
+        c.confirmSnapshot(tickToSend, _getTimelineSnapshot(toSend).realtime, discreteChangeCount, referenceTick);
     }
 
-    void StateManager::sendSnapshotToClient(TickNumber tickToSend, odNet::DownlinkConnector &c, TickNumber referenceSnapshot)
+    void StateManager::prepareSnapshotEncodings(TickNumber tickToSend, const std::vector<TickNumber> &referenceSnapshots, od::ThreadPool *pool)
     {
-        auto toSend = _getSnapshot(tickToSend, mSnapshots, false);
-        if(toSend == mSnapshots.end())
+        size_t toSend = _findTimelineSnapshot(tickToSend);
+        if(toSend == NO_SNAPSHOT)
         {
             OD_PANIC() << "Snapshot with given tick not available for sending";
         }
 
-        size_t discreteChangeCount = 0;
-
-        auto reference = (referenceSnapshot != INVALID_TICK) ? _getSnapshot(referenceSnapshot, mSnapshots, false) : mSnapshots.end();
+        _invalidateEncodings(tickToSend);
 
-        for(auto &states : toSend->statesMap)
+        // create all cache entries up front. the jobs only fill them, so the map itself is never modified concurrently
+        std::vector<std::pair<size_t, EncodedSnapshot*>> jobs;
+        for(auto referenceSnapshot : referenceSnapshots)
         {
-            CombinedStates encodedState = states.second;
-            if(reference != mSnapshots.end())
+            size_t reference = _findReferenceSnapshot(referenceSnapshot, toSend);
+            TickNumber referenceTick = (reference != NO_SNAPSHOT) ? referenceSnapshot : INVALID_TICK;
+
+            auto inserted = mEncodedSnapshots.emplace(std::piecewise_construct, std::forward_as_tuple(referenceTick, tickToSend), std::forward_as_tuple());
+            if(inserted.second)
             {
-                auto referenceState = reference->statesMap.find(states.first);
-                if(referenceState != reference->statesMap.end())
-                {
-                    encodedState.deltaEncode(referenceState->second, encodedState);
-                }
+                jobs.emplace_back(reference, &inserted.first->second);
             }
+        }
 
-            size_t basicChangeCount = encodedState.basicStates.countStatesWithValue();
-            if(basicChangeCount > 0)
+        if(jobs.empty())
+        {
+            return;
+        }
+
+        std::vector<std::future<void>> futures;
+        if(pool != nullptr)
+        {
+            futures.reserve(jobs.size() - 1);
+            for(size_t i = 1; i < jobs.size(); ++i)
             {
-                c.objectStatesChanged(tickToSend, states.first, encodedState.basicStates);
+                auto &job = jobs[i];
+                futures.push_back(pool->async([this, toSend, &job](){ _encodeSnapshot(toSend, job.first, *job.second); }));
             }
 
-            size_t extraChangeCount = (encodedState.extraStates != nullptr) ? encodedState.extraStates->countStatesWithValue() : 0;
-            if(extraChangeCount > 0)
+        }else
+        {
+            for(size_t i = 1; i < jobs.size(); ++i)
             {
-                mExtraStateSerializationBuffer.clear();
-                od::VectorOutputBuffer buf(mExtraStateSerializationBuffer);
-                std::ostream out(&buf);
-                od::DataWriter writer(out);
-                encodedState.extraStates->serialize(writer, odState::StateSerializationPurpose::NETWORK);
-
-                c.objectExtraStatesChanged(tickToSend, states.first, mExtraStateSerializationBuffer.data(), mExtraStateSerializationBuffer.size());
+                _encodeSnapshot(toSend, jobs[i].first, *jobs[i].second);
             }
-
-            discreteChangeCount += basicChangeCount + extraChangeCount;
         }
 
-        c.confirmSnapshot(tickToSend, toSend->realtime, discreteChangeCount, referenceSnapshot);
+        // the calling thread takes the first job instead of just waiting
+        _encodeSnapshot(toSend, jobs[0].first, *jobs[0].second);
+
+        for(auto &future : futures)
+        {
+            future.get();
+        }
     }
 
     StateManager::SnapshotIterator StateManager::_getSnapshot(TickNumber tick, std::deque<Snapshot> &snapshots, bool createIfNotFound)
@@ -321,44 +431,582 @@ namespace odState
             discreteChangeCount += states.second.countStatesWithValue();
         }
 
-        if(incomingSnapshot->targetDiscreteChangeCount == discreteChangeCount)
+        if(incomingSnapshot->targetDiscreteChangeCount != discreteChangeCount)
         {
-            // this snapshot is complete! move it to the timeline
-            if(mSnapshots.size() >= TICK_CAPACITY)
+            Logger::warn() << incomingSnapshot->targetDiscreteChangeCount << " > " << discreteChangeCount;
+            return;
+        }
+
+        // this snapshot is complete! move it to the timeline
+
+        if(_findTimelineSnapshot(tick) != NO_SNAPSHOT)
+        {
+            OD_PANIC() << "Re-committing snapshot";
+        }
+
+        if(mTimelineSize == mTimeline.size() && tick < _getTimelineSnapshot(0).tick)
+        {
+            // we'd have to fold newer states into the baseline to make room for this one. it's outdated anyway
+            Logger::warn() << "Dropping snapshot " << tick << " as it is older than all snapshots in the full timeline";
+            mIncomingSnapshots.erase(incomingSnapshot);
+            return;
+        }
+
+        size_t reference = NO_SNAPSHOT;
+        if(incomingSnapshot->referenceSnapshot != INVALID_TICK)
+        {
+            reference = _findTimelineSnapshot(incomingSnapshot->referenceSnapshot);
+            if(reference == NO_SNAPSHOT)
             {
-                // TODO: implement this as a ring buffer or something so we don't loose the allocated extra StateBundles
-                mSnapshots.pop_front();
+                OD_PANIC() << "Reference snapshot no longer contained in timeline";
             }
+        }
+
+        // the snapshots the new one will be inserted between
+        size_t successor = _findFirstTimelineSnapshotAfterTick(tick);
+        size_t preceding = (successor > 0) ? successor - 1 : NO_SNAPSHOT;
 
-            // undo delta-encoding by merging incoming with the reference snapshot (only if this is not a full snapshot)
-            if(incomingSnapshot->referenceSnapshot != INVALID_TICK)
+        StatesMap &changes = incomingSnapshot->statesMap;
+        if(reference != NO_SNAPSHOT)
+        {
+            // undo delta-encoding by merging incoming changes with the reference states
+            for(auto &deltaStates : changes)
             {
-                auto referenceSnapshot = _getSnapshot(incomingSnapshot->referenceSnapshot, mSnapshots, false);
-                if(referenceSnapshot == mSnapshots.end())
+                CombinedStates *referenceStates = _resolveStates(deltaStates.first, reference);
+                if(referenceStates != nullptr)
                 {
-                    OD_PANIC() << "Reference snapshot no longer contained in timeline";
+                    deltaStates.second.merge(*referenceStates, deltaStates.second);
                 }
+            }
 
-                for(auto &referenceStates : referenceSnapshot->statesMap)
+            // objects that changed between the reference and the preceding snapshot, but are not listed in the
+            //  delta, have their reference states again. since the timeline stores changes against the preceding
+            //  snapshot, these count as changes, too
+            for(size_t i = reference + 1; preceding != NO_SNAPSHOT && i <= preceding; ++i)
+            {
+                for(auto &states : _getTimelineSnapshot(i).statesMap)
                 {
-                    auto &deltaStates = incomingSnapshot->statesMap[referenceStates.first];
-                    deltaStates.merge(referenceStates.second, deltaStates);
+                    if(changes.find(states.first) != changes.end())
+                    {
+                        continue;
+                    }
+
+                    CombinedStates *referenceStates = _resolveStates(states.first, reference);
+                    if(referenceStates != nullptr)
+                    {
+                        changes.emplace(states.first, *referenceStates);
+                    }
                 }
             }
+        }
 
-            auto snapshot = _getSnapshot(tick, mSnapshots, true);
-            if(snapshot->confirmed) OD_PANIC() << "Re-committing snapshot";
-            *snapshot = std::move(*incomingSnapshot);
-            mIncomingSnapshots.erase(incomingSnapshot);
+        // if the snapshot arrived out of order, the successor's changes are relative to our preceding snapshot. objects
+        //  we change must be listed in the successor with their preceding states, or lookups would resolve to ours
+        if(successor < mTimelineSize && !_getTimelineSnapshot(successor).isFull)
+        {
+            StatesMap &successorChanges = _getTimelineSnapshot(successor).statesMap;
+            for(auto &states : changes)
+            {
+                if(successorChanges.find(states.first) != successorChanges.end())
+                {
+                    continue;
+                }
+
+                CombinedStates *precedingStates = _resolveStates(states.first, preceding);
+                if(precedingStates != nullptr)
+                {
+                    successorChanges.emplace(states.first, *precedingStates);
+                }
+            }
+        }
+
+        Snapshot &snapshot = _insertTimelineSnapshot(tick);
+        snapshot.statesMap.swap(changes);
+        snapshot.realtime = incomingSnapshot->realtime;
+        snapshot.isFull = (reference == NO_SNAPSHOT);
+        snapshot.confirmed = true;
+        snapshot.referenceSnapshot = incomingSnapshot->referenceSnapshot;
+        mIncomingSnapshots.erase(incomingSnapshot);
+
+        if(mUplinkConnectorForAck != nullptr)
+        {
+            mUplinkConnectorForAck->acknowledgeSnapshot(tick);
+        }
+    }
+
+    size_t StateManager::_findTimelineSnapshot(TickNumber tick)
+    {
+        size_t index = _findFirstTimelineSnapshotAfterTick(tick - 1);
+        if(index < mTimelineSize && _getTimelineSnapshot(index).tick == tick)
+        {
+            return index;
+        }
+
+        return NO_SNAPSHOT;
+    }
+
+    size_t StateManager::_findFirstTimelineSnapshotAfterTick(TickNumber tick)
+    {
+        size_t first = 0;
+        size_t count = mTimelineSize;
+        while(count > 0)
+        {
+            size_t step = count/2;
+            if(_getTimelineSnapshot(first + step).tick <= tick)
+            {
+                first += step + 1;
+                count -= step + 1;
+
+            }else
+            {
+                count = step;
+            }
+        }
+
+        return first;
+    }
+
+    size_t StateManager::_findFirstTimelineSnapshotAfter(double realtime)
+    {
+        size_t first = 0;
+        size_t count = mTimelineSize;
+        while(count > 0)
+        {
+            size_t step = count/2;
+            if(_getTimelineSnapshot(first + step).realtime <= realtime)
+            {
+                first += step + 1;
+                count -= step + 1;
+
+            }else
+            {
+                count = step;
+            }
+        }
 
-            if(mUplinkConnectorForAck != nullptr)
+        return first;
+    }
+
+    StateManager::Snapshot &StateManager::_insertTimelineSnapshot(TickNumber tick)
+    {
+        if(mTimelineSize == mTimeline.size())
+        {
+            // ring is full. fold the oldest snapshot into the baseline and reuse it's slot (and it's allocated map)
+            Snapshot &oldest = _getTimelineSnapshot(0);
+            if(oldest.isFull)
+            {
+                mBaseline.swap(oldest.statesMap);
+
+            }else
             {
-                mUplinkConnectorForAck->acknowledgeSnapshot(tick);
+                for(auto &states : oldest.statesMap)
+                {
+                    mBaseline[states.first] = std::move(states.second);
+                }
             }
 
+            mTimelineStart = (mTimelineStart + 1) % mTimeline.size();
+            --mTimelineSize;
+        }
+
+        // keep the timeline sorted. snapshots are almost always inserted in order, so this rarely moves anything
+        size_t index = mTimelineSize++;
+        while(index > 0 && _getTimelineSnapshot(index - 1).tick > tick)
+        {
+            std::swap(_getTimelineSnapshot(index - 1), _getTimelineSnapshot(index));
+            --index;
+        }
+
+        Snapshot &snapshot = _getTimelineSnapshot(index);
+        snapshot.statesMap.clear();
+        snapshot.tick = tick;
+        snapshot.realtime = 0.0;
+        snapshot.isFull = false;
+        snapshot.targetDiscreteChangeCount = 0;
+        snapshot.confirmed = false;
+        snapshot.referenceSnapshot = INVALID_TICK;
+
+        return snapshot;
+    }
+
+    StateManager::CombinedStates *StateManager::_resolveStates(od::LevelObjectId id, size_t index)
+    {
+        if(index != NO_SNAPSHOT)
+        {
+            for(size_t i = index + 1; i-- > 0; )
+            {
+                Snapshot &snapshot = _getTimelineSnapshot(i);
+
+                auto it = snapshot.statesMap.find(id);
+                if(it != snapshot.statesMap.end())
+                {
+                    return &it->second;
+                }
+
+                if(snapshot.isFull)
+                {
+                    return nullptr;
+                }
+            }
+        }
+
+        auto it = mBaseline.find(id);
+        return (it != mBaseline.end()) ? &it->second : nullptr;
+    }
+
+    bool StateManager::_collectChangedObjects(TickNumber fromTick, TickNumber toTick, ObjectIdSet &objects)
+    {
+        size_t from = _findTimelineSnapshot(fromTick);
+        if(from == NO_SNAPSHOT)
+        {
+            return false;
+        }
+
+        for(size_t i = from + 1; i < mTimelineSize && _getTimelineSnapshot(i).tick <= toTick; ++i)
+        {
+            for(auto &states : _getTimelineSnapshot(i).statesMap)
+            {
+                objects.insert(states.first);
+            }
+        }
+
+        return true;
+    }
+
+    void StateManager::_collectAllObjects(size_t index, ObjectIdSet &objects)
+    {
+        for(auto &states : mBaseline)
+        {
+            objects.insert(states.first);
+        }
+
+        for(size_t i = 0; i <= index; ++i)
+        {
+            for(auto &states : _getTimelineSnapshot(i).statesMap)
+            {
+                objects.insert(states.first);
+            }
+        }
+    }
+
+    size_t StateManager::_findReferenceSnapshot(TickNumber referenceTick, size_t toSend)
+    {
+        if(referenceTick == INVALID_TICK)
+        {
+            return NO_SNAPSHOT;
+        }
+
+        size_t reference = _findTimelineSnapshot(referenceTick);
+        return (reference != NO_SNAPSHOT && reference <= toSend) ? reference : NO_SNAPSHOT;
+    }
+
+    bool StateManager::_encodeObject(const CombinedStates &states, const CombinedStates *referenceStates, EncodedObject &result) const
+    {
+        CombinedStates encodedStates = states;
+        if(referenceStates != nullptr)
+        {
+            encodedStates.deltaEncode(*referenceStates, encodedStates);
+        }
+
+        result.basicStates = encodedStates.basicStates;
+        result.basicChangeCount = encodedStates.basicStates.countStatesWithValue();
+
+        result.extraStates.clear();
+        result.extraChangeCount = (encodedStates.extraStates != nullptr) ? encodedStates.extraStates->countStatesWithValue() : 0;
+        if(result.extraChangeCount > 0)
+        {
+            od::BitWriter writer(result.extraStates);
+            encodedStates.extraStates->serializeQuantized(writer, mQuantization);
+            writer.flush();
+        }
+
+        return result.basicChangeCount + result.extraChangeCount > 0;
+    }
+
+    void StateManager::_encodeSnapshot(size_t toSend, size_t reference, EncodedSnapshot &result)
+    {
+        // when delta-encoding, only objects that changed since the reference can have anything to send
+        ObjectIdSet candidates;
+        if(reference != NO_SNAPSHOT)
+        {
+            _collectChangedObjects(_getTimelineSnapshot(reference).tick, _getTimelineSnapshot(toSend).tick, candidates);
+
         }else
         {
-            Logger::warn() << incomingSnapshot->targetDiscreteChangeCount << " > " << discreteChangeCount;
+            _collectAllObjects(toSend, candidates);
+        }
+
+        for(auto id : candidates)
+        {
+            CombinedStates *states = _resolveStates(id, toSend);
+            if(states == nullptr)
+            {
+                continue;
+            }
+
+            CombinedStates *referenceStates = (reference != NO_SNAPSHOT) ? _resolveStates(id, reference) : nullptr;
+
+            EncodedObject encodedObject;
+            if(_encodeObject(*states, referenceStates, encodedObject))
+            {
+                result.objects.insert(id);
+                result.encodedObjects.emplace(id, std::move(encodedObject));
+            }
+        }
+    }
+
+    void StateManager::_invalidateEncodings(TickNumber tickToSend)
+    {
+        if(tickToSend != mEncodingTick)
+        {
+            mEncodedSnapshots.clear();
+            mFullObjectEncodings.clear();
+            mEncodingTick = tickToSend;
+        }
+    }
+
+    StateManager::EncodedSnapshot &StateManager::_getEncodedSnapshot(TickNumber tickToSend, size_t toSend, size_t reference)
+    {
+        TickNumber referenceTick = (reference != NO_SNAPSHOT) ? _getTimelineSnapshot(reference).tick : INVALID_TICK;
+
+        auto inserted = mEncodedSnapshots.emplace(std::piecewise_construct, std::forward_as_tuple(referenceTick, tickToSend), std::forward_as_tuple());
+        if(inserted.second)
+        {
+            _encodeSnapshot(toSend, reference, inserted.first->second);
+        }
+
+        return inserted.first->second;
+    }
+
+    const StateManager::EncodedObject *StateManager::_getFullObjectEncoding(od::LevelObjectId id, size_t toSend)
+    {
+        auto it = mFullObjectEncodings.find(id);
+        if(it != mFullObjectEncodings.end())
+        {
+            return &it->second;
+        }
+
+        CombinedStates *states = _resolveStates(id, toSend);
+        if(states == nullptr)
+        {
+            return nullptr;
+        }
+
+        EncodedObject &encodedObject = mFullObjectEncodings[id];
+        _encodeObject(*states, nullptr, encodedObject);
+        return &encodedObject;
+    }
+
+    bool StateManager::_selectSnapshots(double realtime, size_t &a, size_t &b, double &delta)
+    {
+        // find the first snapshots with a time later than the requested one
+        size_t later = _findFirstTimelineSnapshotAfter(realtime);
+
+        delta = 0.0;
+
+        if(later == mTimelineSize)
+        {
+            // the latest snapshot is older than the requested time -> extrapolate from the two latest snapshots.
+            //  we only go so far past the latest one, though. for longer gaps, having objects stop is less jarring
+            //  than having them fly off
+            b = mTimelineSize - 1;
+            a = b;
+
+            if(mMaxExtrapolationTime > 0.0 && b > 0)
+            {
+                Snapshot &snapshotA = _getTimelineSnapshot(b - 1);
+                Snapshot &snapshotB = _getTimelineSnapshot(b);
+                double interval = snapshotB.realtime - snapshotA.realtime;
+                if(interval > 0.0)
+                {
+                    double extrapolationTime = std::min(realtime - snapshotB.realtime, mMaxExtrapolationTime);
+                    a = b - 1;
+                    delta = 1.0 + extrapolationTime/interval;
+                    return true;
+                }
+            }
+
+        }else if(later == 0)
+        {
+            // we only have one snapshot in the timeline, and it's later than the requested time.
+            //  extrapolating here is probably unnecessary, so we just apply the snapshot as if it happened right now.
+            a = 0;
+            b = 0;
+
+        }else
+        {
+            a = later - 1;
+            b = later;
+
+            Snapshot &snapshotA = _getTimelineSnapshot(a);
+            Snapshot &snapshotB = _getTimelineSnapshot(b);
+            delta = (realtime - snapshotA.realtime)/(snapshotB.realtime - snapshotA.realtime);
+        }
+
+        return false;
+    }
+
+    bool StateManager::_blendStates(const CombinedStates *statesA, const CombinedStates *statesB, float delta, bool extrapolate, CombinedStates &result)
+    {
+        if(statesA == statesB)
+        {
+            // object did not change between A and B (or we are not interpolating at all)
+            if(statesA == nullptr)
+            {
+                return false;
+            }
+
+            result = *statesA;
+
+        }else if(statesB == nullptr)
+        {
+            // no corresponding state in B. this should not happen, as
+            //  all snapshots reflect all changes since load. for now, assume steady state
+            Logger::warn() << "Incomplete timeline. A tracked state seems to have disappeared";
+            result = *statesA;
+
+        }else if(statesA == nullptr)
+        {
+            // object started being tracked between A and B
+            result = *statesB;
+
+        }else if(extrapolate)
+        {
+            result.extrapolate(*statesA, *statesB, delta);
+
+        }else
+        {
+            result.lerp(*statesA, *statesB, delta);
+        }
+
+        return true;
+    }
+
+    void StateManager::_applyObjectStates(od::LevelObjectId id, size_t a, size_t b, float delta, bool extrapolate, double realtime)
+    {
+        auto obj = mLevel.getLevelObjectById(id);
+        if(obj == nullptr)
+        {
+            return;
+        }
+
+        CombinedStates *statesA = _resolveStates(id, a);
+        CombinedStates *statesB = (a == b) ? statesA : _resolveStates(id, b);
+
+        bool isBlended = (statesA != statesB && statesA != nullptr && statesB != nullptr);
+        bool isCorrected = (mErrorCorrections.find(id) != mErrorCorrections.end());
+        if(!isBlended && !isCorrected)
+        {
+            // nothing to calculate. apply the states we have without copying them (see _blendStates() for the cases)
+            if(statesA != statesB && statesB == nullptr)
+            {
+                Logger::warn() << "Incomplete timeline. A tracked state seems to have disappeared";
+            }
+
+            CombinedStates *states = (statesB != nullptr) ? statesB : statesA;
+            if(states != nullptr)
+            {
+                states->applyToObject(*obj);
+            }
+
+            return;
+        }
+
+        CombinedStates blended;
+        if(!_blendStates(statesA, statesB, delta, extrapolate, blended))
+        {
+            return;
+        }
+
+        if(isCorrected)
+        {
+            _applyErrorCorrection(id, realtime, blended.basicStates);
+        }
+
+        if(extrapolate && isBlended)
+        {
+            mExtrapolatedStates[id] = blended.basicStates;
+        }
+
+        blended.applyToObject(*obj);
+    }
+
+    void StateManager::_beginErrorCorrection(double realtime)
+    {
+        if(mErrorCorrectionTime <= 0.0)
+        {
+            mExtrapolatedStates.clear();
+            return;
+        }
+
+        // where should the objects have been at the time we last applied, given what we know now?
+        size_t a;
+        size_t b;
+        double delta;
+        bool extrapolating = _selectSnapshots(mLastAppliedRealtime, a, b, delta);
+
+        for(auto &extrapolated : mExtrapolatedStates)
+        {
+            auto id = extrapolated.first;
+            auto &applied = extrapolated.second;
+
+            CombinedStates *statesA = _resolveStates(id, a);
+            CombinedStates *statesB = (a == b) ? statesA : _resolveStates(id, b);
+            CombinedStates actual;
+            if(!_blendStates(statesA, statesB, delta, extrapolating, actual))
+            {
+                continue;
+            }
+
+            ErrorCorrection correction;
+            correction.positionError = glm::vec3(0.0f);
+            correction.rotationError = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+            correction.startTime = realtime;
+
+            if(applied.position.hasValue() && actual.basicStates.position.hasValue())
+            {
+                correction.positionError = applied.position.get() - actual.basicStates.position.get();
+            }
+
+            if(applied.rotation.hasValue() && actual.basicStates.rotation.hasValue())
+            {
+                correction.rotationError = applied.rotation.get() * glm::inverse(actual.basicStates.rotation.get());
+            }
+
+            mErrorCorrections[id] = correction;
+        }
+
+        mExtrapolatedStates.clear();
+    }
+
+    void StateManager::_applyErrorCorrection(od::LevelObjectId id, double realtime, od::ObjectStates &states)
+    {
+        auto it = mErrorCorrections.find(id);
+        if(it == mErrorCorrections.end())
+        {
+            return;
+        }
+
+        auto &correction = it->second;
+        float remaining = (mErrorCorrectionTime > 0.0) ? (1.0 - (realtime - correction.startTime)/mErrorCorrectionTime) : 0.0f;
+        if(remaining <= 0.0f)
+        {
+            // this is the last time the object needs to be touched for the correction. it gets it's actual states now
+            mErrorCorrections.erase(it);
+            return;
+        }
+
+        remaining = std::min(remaining, 1.0f);
+
+        if(states.position.hasValue())
+        {
+            states.position = states.position.get() + correction.positionError * remaining;
+        }
+
+        if(states.rotation.hasValue())
+        {
+            glm::quat identity(1.0f, 0.0f, 0.0f, 0.0f);
+            states.rotation = glm::slerp(identity, correction.rotationError, remaining) * states.rotation.get();
         }
     }
 
@@ -452,6 +1100,27 @@ namespace odState
         }
     }
 
+    void StateManager::CombinedStates::extrapolate(const CombinedStates &lhs, const CombinedStates &rhs, float delta)
+    {
+        basicStates.extrapolate(lhs.basicStates, rhs.basicStates, delta);
+
+        if(lhs.extraStates != nullptr && rhs.extraStates != nullptr)
+        {
+            makeExtraStatesUnique();
+            if(extraStates == nullptr)
+            {
+                extraStates = rhs.extraStates->cloneShared();
+            }
+
+            extraStates->extrapolate(*lhs.extraStates, *rhs.extraStates, delta);
+
+        }else
+        {
+            // nothing to extrapolate from. the latest states are the best guess we have
+            extraStates = (rhs.extraStates != nullptr) ? rhs.extraStates : lhs.extraStates;
+        }
+    }
+
     void StateManager::CombinedStates::deltaEncode(const CombinedStates &reference, const CombinedStates &toEncode)
     {
         basicStates.deltaEncode(reference.basicStates, toEncode.basicStates);
@@ -0,0 +1,232 @@
+
+#include <odCore/state/StateQuantization.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <odCore/Panic.h>
+
+namespace odState
+{
+
+    static constexpr float MAX_SMALLEST_THREE_COMPONENT = 0.70710678f; // 1/sqrt(2)
+
+    static uint32_t _quantize(float value, float min, float step, uint32_t maxQuantized)
+    {
+        float q = std::round((value - min) / step);
+        if(!(q > 0.0f)) // also catches NaNs
+        {
+            return 0;
+
+        }else if(q >= static_cast<float>(maxQuantized))
+        {
+            return maxQuantized;
+        }
+
+        return static_cast<uint32_t>(q);
+    }
+
+    static uint32_t _maxQuantized(size_t bits)
+    {
+        return static_cast<uint32_t>((static_cast<uint64_t>(1) << bits) - 1);
+    }
+
+
+    StateQuantization::StateQuantization()
+    : mHasPositionBounds(false)
+    , mBoundsMin(0.0f)
+    , mBoundsMax(0.0f)
+    , mPositionResolution(DEFAULT_POSITION_RESOLUTION)
+    , mPositionBits{ 0, 0, 0 }
+    , mPositionStep{ 1.0f, 1.0f, 1.0f }
+    {
+    }
+
+    StateQuantization::StateQuantization(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, float positionResolution)
+    : mHasPositionBounds(true)
+    , mBoundsMin(boundsMin)
+    , mBoundsMax(boundsMax)
+    , mPositionResolution(positionResolution)
+    {
+        if(!(positionResolution > 0.0f))
+        {
+            OD_PANIC() << "Position resolution must be positive";
+        }
+
+        for(size_t axis = 0; axis < 3; ++axis)
+        {
+            float range = boundsMax[axis] - boundsMin[axis];
+            if(!(range >= 0.0f))
+            {
+                OD_PANIC() << "Quantization bounds are inverted";
+            }
+
+            // find the smallest number of bits that can represent the range at the requested resolution
+            double steps = std::ceil(static_cast<double>(range) / positionResolution);
+            size_t bits = 0;
+            while(bits < 32 && _maxQuantized(bits) < steps)
+            {
+                ++bits;
+            }
+
+            mPositionBits[axis] = bits;
+            mPositionStep[axis] = (bits > 0) ? (range / _maxQuantized(bits)) : 1.0f;
+        }
+    }
+
+    bool StateQuantization::areValidBounds(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, float positionResolution)
+    {
+        if(!std::isfinite(positionResolution) || !(positionResolution > 0.0f))
+        {
+            return false;
+        }
+
+        for(size_t axis = 0; axis < 3; ++axis)
+        {
+            // catches NaNs, too
+            if(!std::isfinite(boundsMin[axis]) || !std::isfinite(boundsMax[axis]) || !(boundsMax[axis] - boundsMin[axis] >= 0.0f))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    StateQuantization StateQuantization::forLevelBounds(const od::AxisAlignedBoundingBox &levelBounds)
+    {
+        glm::vec3 min = levelBounds.min();
+        glm::vec3 max = levelBounds.max();
+        if(!(min.x <= max.x && min.y <= max.y && min.z <= max.z))
+        {
+            return StateQuantization();
+        }
+
+        glm::vec3 margin(LEVEL_BOUNDS_MARGIN);
+        return StateQuantization(min - margin, max + margin, DEFAULT_POSITION_RESOLUTION);
+    }
+
+    void StateQuantization::writePosition(od::BitWriter &writer, const glm::vec3 &position) const
+    {
+        bool inBounds = mHasPositionBounds;
+        for(size_t axis = 0; axis < 3 && inBounds; ++axis)
+        {
+            // written so NaNs count as out of bounds
+            inBounds = (position[axis] >= mBoundsMin[axis] && position[axis] <= mBoundsMax[axis]);
+        }
+
+        if(mHasPositionBounds)
+        {
+            writer.writeBool(inBounds);
+        }
+
+        if(inBounds)
+        {
+            for(size_t axis = 0; axis < 3; ++axis)
+            {
+                writer.write(_quantize(position[axis], mBoundsMin[axis], mPositionStep[axis], _maxQuantized(mPositionBits[axis])), mPositionBits[axis]);
+            }
+
+        }else
+        {
+            writer.writeFloat(position.x);
+            writer.writeFloat(position.y);
+            writer.writeFloat(position.z);
+        }
+    }
+
+    glm::vec3 StateQuantization::readPosition(od::BitReader &reader) const
+    {
+        glm::vec3 position;
+
+        if(mHasPositionBounds && reader.readBool())
+        {
+            for(size_t axis = 0; axis < 3; ++axis)
+            {
+                uint32_t q = reader.read(mPositionBits[axis]);
+                position[axis] = std::min(mBoundsMin[axis] + q * mPositionStep[axis], mBoundsMax[axis]);
+            }
+
+        }else
+        {
+            position.x = reader.readFloat();
+            position.y = reader.readFloat();
+            position.z = reader.readFloat();
+        }
+
+        return position;
+    }
+
+    void StateQuantization::writeRotation(od::BitWriter &writer, const glm::quat &rotation)
+    {
+        glm::quat q = rotation;
+        float length = glm::length(q);
+        if(length > 0.0f)
+        {
+            q = q / length;
+
+        }else
+        {
+            q = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+        }
+
+        // the largest component is left out and restored from the unit length. -q is the same rotation as q, so we
+        //  flip the sign to make sure the dropped component is positive
+        size_t largest = 0;
+        for(size_t i = 1; i < 4; ++i)
+        {
+            if(std::abs(q[i]) > std::abs(q[largest]))
+            {
+                largest = i;
+            }
+        }
+
+        float sign = (q[largest] < 0.0f) ? -1.0f : 1.0f;
+        uint32_t maxQ = _maxQuantized(ROTATION_COMPONENT_BITS);
+        float step = 2*MAX_SMALLEST_THREE_COMPONENT / maxQ;
+
+        writer.write(largest, 2);
+        for(size_t i = 0; i < 4; ++i)
+        {
+            if(i != largest)
+            {
+                writer.write(_quantize(sign*q[i], -MAX_SMALLEST_THREE_COMPONENT, step, maxQ), ROTATION_COMPONENT_BITS);
+            }
+        }
+    }
+
+    glm::quat StateQuantization::readRotation(od::BitReader &reader)
+    {
+        uint32_t maxQ = _maxQuantized(ROTATION_COMPONENT_BITS);
+        float step = 2*MAX_SMALLEST_THREE_COMPONENT / maxQ;
+
+        size_t largest = reader.read(2);
+
+        glm::quat q;
+        float sumOfSquares = 0.0f;
+        for(size_t i = 0; i < 4; ++i)
+        {
+            if(i != largest)
+            {
+                q[i] = -MAX_SMALLEST_THREE_COMPONENT + reader.read(ROTATION_COMPONENT_BITS) * step;
+                sumOfSquares += q[i]*q[i];
+            }
+        }
+
+        q[largest] = std::sqrt(std::max(0.0f, 1.0f - sumOfSquares));
+
+        return glm::normalize(q);
+    }
+
+    void StateQuantization::writeUnitInterval(od::BitWriter &writer, float value)
+    {
+        uint32_t maxQ = _maxQuantized(UNIT_INTERVAL_BITS);
+        writer.write(_quantize(value, 0.0f, 1.0f/maxQ, maxQ), UNIT_INTERVAL_BITS);
+    }
+
+    float StateQuantization::readUnitInterval(od::BitReader &reader)
+    {
+        return static_cast<float>(reader.read(UNIT_INTERVAL_BITS)) / _maxQuantized(UNIT_INTERVAL_BITS);
+    }
+
+}
@@ -11,6 +11,8 @@
 #include <memory>
 #include <thread>
 #include <exception>
+#include <atomic>
+#include <chrono>
 
 #include <odCore/Logger.h>
 #include <odCore/Client.h>
@@ -23,6 +25,7 @@
 #include <odCore/net/UplinkConnector.h>
 #include <odCore/net/DownlinkConnector.h>
 #include <odCore/net/LocalTunnel.h>
+#include <odCore/net/UdpTransport.h>
 
 #include <odCore/physics/PhysicsSystem.h>
 
@@ -62,6 +65,13 @@ static void printUsage()
         << "    -t  Use a simulated network tunnel to connect client and server" << std::endl
         << "    -d <drop rate>  Simulate packet drops (implies -t, range 0-1)" << std::endl
         << "    -l <min>:<max>  Simulate packet latency (implies -t, min/max are seconds)" << std::endl
+        << "    -s <seed>  Seed for the simulated network conditions (default 0)" << std::endl
+        << "    -b <bytes/s>  Simulate a bandwidth limit (implies -t)" << std::endl
+        << "    -u <port>  Connect client and server over UDP on the loopback interface (0 picks a free port). -d applies to this, too" << std::endl
+        << "    -x <seconds>  Max. time the client extrapolates objects when snapshots are late (0 disables, default 0.2)" << std::endl
+        << "    -a <dir>  Cache decoded assets in the given directory to speed up subsequent starts" << std::endl
+        << "    -r <MiB>  Memory budget for keeping recently used assets loaded (0 disables, default 128)" << std::endl
+        << "    -m  Write asset manifests next to loaded levels to speed up subsequent loads" << std::endl
         << "If no level file and no options are given, the default intro level is loaded." << std::endl
         << "The latter assumes the current directory to be the game root." << std::endl
         << std::endl;
@@ -102,7 +112,15 @@ int main(int argc, char **argv)
     float dropRate = 0;
     double latencyMin = 0;
     double latencyMax = 0;
-    while((c = getopt(argc, argv, "vhcptd:l:")) != -1)
+    std::string assetCacheDir;
+    int retentionBudgetMiB = -1;
+    bool writeLevelManifests = false;
+    double maxExtrapolationTime = -1;
+    bool useUdp = false;
+    int udpPort = 0;
+    uint64_t networkSeed = odNet::LocalTunnel::DEFAULT_SEED;
+    double bandwidth = 0;
+    while((c = getopt(argc, argv, "vhcptmd:l:a:r:x:u:s:b:")) != -1)
     {
         switch(c)
         {
@@ -126,6 +144,10 @@ int main(int argc, char **argv)
             useLocalTunnel = true;
             break;
 
+        case 'm':
+            writeLevelManifests = true;
+            break;
+
         case 'd':
             {
                 useLocalTunnel = true;
@@ -154,6 +176,72 @@ int main(int argc, char **argv)
             }
             break;
 
+        case 's':
+            {
+                std::istringstream in(optarg);
+                in >> networkSeed;
+                if(in.fail())
+                {
+                    std::cout << "-s option needs a non-negative integer as argument" << std::endl;
+                    return 1;
+                }
+            }
+            break;
+
+        case 'b':
+            {
+                useLocalTunnel = true;
+                std::istringstream in(optarg);
+                in >> bandwidth;
+                if(in.fail() || bandwidth < 0)
+                {
+                    std::cout << "-b option needs a non-negative real number as argument" << std::endl;
+                    return 1;
+                }
+            }
+            break;
+
+        case 'x':
+            {
+                std::istringstream in(optarg);
+                in >> maxExtrapolationTime;
+                if(in.fail() || maxExtrapolationTime < 0)
+                {
+                    std::cout << "-x option needs a non-negative real number as argument" << std::endl;
+                    return 1;
+                }
+            }
+            break;
+
+        case 'u':
+            {
+                useUdp = true;
+                std::istringstream in(optarg);
+                in >> udpPort;
+                if(in.fail() || udpPort < 0 || udpPort > 0xffff)
+                {
+                    std::cout << "-u option needs a port number as argument" << std::endl;
+                    return 1;
+                }
+            }
+            break;
+
+        case 'a':
+            assetCacheDir = optarg;
+            break;
+
+        case 'r':
+            {
+                std::istringstream in(optarg);
+                in >> retentionBudgetMiB;
+                if(in.fail() || retentionBudgetMiB < 0)
+                {
+                    std::cout << "-r option needs a non-negative integer as argument" << std::endl;
+                    return 1;
+                }
+            }
+            break;
+
         case '?':
             std::cout << "Unknown option -" << optopt << std::endl;
             printUsage();
@@ -165,6 +253,17 @@ int main(int argc, char **argv)
     odOsg::Renderer osgRenderer;
 
     odDb::DbManager dbManager;
+    if(!assetCacheDir.empty())
+    {
+        dbManager.getDecodedAssetCache().setCacheDirectory(od::FilePath(assetCacheDir));
+    }
+
+    if(retentionBudgetMiB >= 0)
+    {
+        dbManager.getRetentionCache().setBudget(static_cast<size_t>(retentionBudgetMiB) * 1024 * 1024);
+    }
+
+    dbManager.setLevelManifestWritingEnabled(writeLevelManifests);
 
     odRfl::RflManager rflManager;
     odRfl::Rfl &dragonRfl = rflManager.loadStaticRfl<dragonRfl::DragonRfl>(); // TODO: add option to specify dynamic RFL
@@ -172,12 +271,68 @@ int main(int argc, char **argv)
     od::Client client(dbManager, rflManager, osgRenderer, &soundSystem);
     sClient = &client;
 
+    if(maxExtrapolationTime >= 0)
+    {
+        client.setMaxExtrapolationTime(maxExtrapolationTime);
+    }
+
     od::Server server(dbManager, rflManager);
     auto clientId = server.addClient();
     sServer = &server;
 
+    std::atomic_bool udpClientAccepted(false);
+    std::shared_ptr<odNet::DownlinkConnector> udpClientDownlink; // written by the network thread before the flag is set
+    std::unique_ptr<odNet::UdpTransport> serverTransport;
+    std::unique_ptr<odNet::UdpTransport> clientTransport;
     std::unique_ptr<odNet::LocalTunnel> localTunnel;
-    if(!useLocalTunnel)
+    if(useUdp)
+    {
+        serverTransport = std::make_unique<odNet::UdpTransport>();
+        clientTransport = std::make_unique<odNet::UdpTransport>();
+        if(dropRate > 0)
+        {
+            auto serverInjector = std::make_unique<odNet::UdpFaultInjector>(static_cast<uint32_t>(networkSeed*2 + 1));
+            serverInjector->setDropRate(dropRate);
+            serverTransport->setFaultInjector(std::move(serverInjector));
+
+            auto clientInjector = std::make_unique<odNet::UdpFaultInjector>(static_cast<uint32_t>(networkSeed*2 + 2));
+            clientInjector->setDropRate(dropRate);
+            clientTransport->setFaultInjector(std::move(clientInjector));
+        }
+
+        auto acceptCallback = [&server, &udpClientAccepted, &udpClientDownlink, clientId](const odNet::UdpEndpoint &remote, std::shared_ptr<odNet::DownlinkConnector> downlinkInput) -> std::shared_ptr<odNet::UplinkConnector>
+        {
+            // we only have the one local client. the callback is only ever called from the network thread, so this can't race
+            if(udpClientAccepted.load())
+            {
+                return nullptr;
+            }
+
+            // the downlink may only be assigned on the server's thread. the main thread does that once we set the flag
+            udpClientDownlink = downlinkInput;
+            udpClientAccepted.store(true);
+
+            return server.getUplinkConnectorForClient(clientId);
+        };
+        serverTransport->listen(odNet::IpV4Address::loopback(), static_cast<uint16_t>(udpPort), acceptCallback);
+
+        client.setUplinkConnector(clientTransport->connect(odNet::IpV4Address::loopback(), serverTransport->getLocalPort(), client.getDownlinkConnector()));
+
+        // the server must know the client before it loads a level, or the client won't be told to load it, too
+        auto waitStart = std::chrono::steady_clock::now();
+        while(!udpClientAccepted.load())
+        {
+            if(std::chrono::steady_clock::now() - waitStart > std::chrono::seconds(5))
+            {
+                OD_PANIC() << "Client did not connect to server over UDP";
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        server.setClientDownlinkConnector(clientId, udpClientDownlink);
+
+    }else if(!useLocalTunnel)
     {
         server.setClientDownlinkConnector(clientId, client.getDownlinkConnector());
         client.setUplinkConnector(server.getUplinkConnectorForClient(clientId));
@@ -185,8 +340,16 @@ int main(int argc, char **argv)
     }else
     {
         localTunnel = std::make_unique<odNet::LocalTunnel>(client.getDownlinkConnector(), server.getUplinkConnectorForClient(clientId));
-        localTunnel->setDropRate(dropRate);
-        localTunnel->setLatency(latencyMin, latencyMax);
+        localTunnel->setSeed(networkSeed);
+
+        odNet::LocalTunnel::LinkConditions conditions;
+        conditions.lossRate = dropRate;
+        conditions.latency = latencyMin;
+        conditions.jitter = latencyMax - latencyMin;
+        conditions.bandwidth = bandwidth;
+        conditions.maxQueueDelay = (bandwidth > 0) ? 1.0 : 0.0;
+        localTunnel->setConditions(conditions);
+
         server.setClientDownlinkConnector(clientId, localTunnel->getDownlinkInput());
         client.setUplinkConnector(localTunnel->getUplinkInput());
     }
@@ -271,6 +434,19 @@ int main(int argc, char **argv)
     server.setIsDone(true); // clientThreadFunc() will not have set this if it terminated abnormally! (non-OD-exception)
     serverThread.join();
 
+    if(localTunnel != nullptr)
+    {
+        for(auto direction : { odNet::LocalTunnel::Direction::DOWNLINK, odNet::LocalTunnel::Direction::UPLINK })
+        {
+            auto stats = localTunnel->getStatistics(direction);
+            Logger::info() << "Tunnel " << ((direction == odNet::LocalTunnel::Direction::UPLINK) ? "uplink" : "downlink")
+                    << ": " << stats.packetsDelivered << "/" << stats.packetsSent << " packets delivered, "
+                    << stats.packetsLost << " lost, " << stats.packetsQueueDropped << " dropped from queue, "
+                    << stats.packetsDuplicated << " duplicated, " << stats.packetsReordered << " reordered, "
+                    << "avg. delay " << stats.getAverageDelay() << "s, max. delay " << stats.maxDelay << "s";
+        }
+    }
+
     sClient = nullptr;
     sServer = nullptr;
 
@@ -0,0 +1,500 @@
+
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <memory>
+#include <limits>
+#include <map>
+#include <random>
+#include <vector>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+#include <odCore/Logger.h>
+#include <odCore/Server.h>
+#include <odCore/Level.h>
+#include <odCore/Layer.h>
+#include <odCore/LevelObject.h>
+#include <odCore/Panic.h>
+#include <odCore/Version.h>
+
+#include <odCore/net/DownlinkConnector.h>
+#include <odCore/net/LocalTunnel.h>
+#include <odCore/net/UplinkConnector.h>
+
+#include <odCore/rfl/DummyClass.h>
+#include <odCore/rfl/Rfl.h>
+#include <odCore/rfl/RflManager.h>
+
+#include <odCore/db/DbManager.h>
+
+/**
+ * @brief Class for the synthetic level's objects: walks in a straight line across the terrain and bounces off the level borders.
+ */
+class Wanderer final : public odRfl::SpawnableClass, public odRfl::ClassImpl<Wanderer>
+{
+public:
+
+    Wanderer(const glm::vec2 &velocity, const od::AxisAlignedBoundingBox &bounds)
+    : mVelocity(velocity)
+    , mBounds(bounds)
+    {
+    }
+
+    virtual odRfl::FieldBundle &getFields() override { return mFields; }
+
+    virtual void onSpawned() override
+    {
+        getLevelObject().setEnableUpdate(true);
+    }
+
+    virtual void onUpdate(float relTime) override
+    {
+        auto &obj = getLevelObject();
+
+        glm::vec3 position = obj.getPosition();
+        position.x += mVelocity.x*relTime;
+        position.z += mVelocity.y*relTime;
+
+        if(position.x < mBounds.min().x || position.x > mBounds.max().x)
+        {
+            mVelocity.x = -mVelocity.x;
+            position.x = std::max(mBounds.min().x, std::min(position.x, mBounds.max().x));
+        }
+
+        if(position.z < mBounds.min().z || position.z > mBounds.max().z)
+        {
+            mVelocity.y = -mVelocity.y;
+            position.z = std::max(mBounds.min().z, std::min(position.z, mBounds.max().z));
+        }
+
+        od::Layer *layer = obj.getAssociatedLayer();
+        if(layer != nullptr)
+        {
+            float height = layer->getAbsoluteHeightAt(glm::vec2(position.x, position.z));
+            if(!std::isnan(height))
+            {
+                position.y = height;
+            }
+        }
+
+        obj.setPosition(position);
+    }
+
+
+private:
+
+    odRfl::DummyFields mFields;
+    glm::vec2 mVelocity;
+    od::AxisAlignedBoundingBox mBounds;
+
+};
+
+
+/**
+ * @brief Stands in for a client: counts what it receives and acknowledges complete snapshots.
+ *
+ * Only called from the benchmark thread, since the tunnels use a manual clock.
+ */
+class SyntheticClient final : public odNet::DownlinkConnector
+{
+public:
+
+    SyntheticClient()
+    : mLastAcknowledgedTick(odState::INVALID_TICK)
+    , mReceivedSnapshotCount(0)
+    , mReceivedObjectStateCount(0)
+    , mReceivedEventCount(0)
+    {
+    }
+
+    inline size_t getReceivedSnapshotCount() const { return mReceivedSnapshotCount; }
+    inline size_t getReceivedObjectStateCount() const { return mReceivedObjectStateCount; }
+
+    virtual void globalDatabaseTableEntry(odDb::GlobalDatabaseIndex dbIndex, const std::string &path) override
+    {
+    }
+
+    virtual void loadLevel(const std::string &path, size_t loadedDatabaseCount, const odState::StateQuantization &quantization) override
+    {
+    }
+
+    virtual void objectStatesChanged(odState::TickNumber tick, od::LevelObjectId id, const od::ObjectStates &states) override
+    {
+        mIncomingSnapshots[tick].receivedChangeCount += states.countStatesWithValue();
+        ++mReceivedObjectStateCount;
+        _checkComplete(tick);
+    }
+
+    virtual void confirmSnapshot(odState::TickNumber tick, double realtime, size_t discreteChangeCount, odState::TickNumber referenceTick) override
+    {
+        auto &snapshot = mIncomingSnapshots[tick];
+        snapshot.confirmed = true;
+        snapshot.targetChangeCount = discreteChangeCount;
+        _checkComplete(tick);
+    }
+
+    virtual void objectExtraStatesChanged(odState::TickNumber tick, od::LevelObjectId id, const char *data, size_t size) override
+    {
+        // the synthetic level's objects have no extra states
+    }
+
+    virtual void globalMessage(odNet::MessageChannelCode code, const char *data, size_t size) override
+    {
+    }
+
+    virtual void event(const odState::EventVariant &e, double realtime) override
+    {
+        ++mReceivedEventCount;
+    }
+
+    void update(odNet::UplinkConnector &uplink)
+    {
+        if(!mCompletedTicks.empty())
+        {
+            auto latest = *std::max_element(mCompletedTicks.begin(), mCompletedTicks.end());
+            mCompletedTicks.clear();
+
+            if(mLastAcknowledgedTick == odState::INVALID_TICK || latest > mLastAcknowledgedTick)
+            {
+                uplink.acknowledgeSnapshot(latest);
+                uplink.flush();
+                mLastAcknowledgedTick = latest;
+            }
+        }
+    }
+
+
+private:
+
+    struct IncomingSnapshot
+    {
+        IncomingSnapshot()
+        : confirmed(false)
+        , receivedChangeCount(0)
+        , targetChangeCount(0)
+        {
+        }
+
+        bool confirmed;
+        size_t receivedChangeCount;
+        size_t targetChangeCount;
+    };
+
+    void _checkComplete(odState::TickNumber tick)
+    {
+        auto &snapshot = mIncomingSnapshots[tick];
+        if(snapshot.confirmed && snapshot.receivedChangeCount >= snapshot.targetChangeCount)
+        {
+            mCompletedTicks.push_back(tick);
+            ++mReceivedSnapshotCount;
+
+            // whatever is older than this will never be acknowledged
+            mIncomingSnapshots.erase(mIncomingSnapshots.begin(), mIncomingSnapshots.upper_bound(tick));
+        }
+    }
+
+    std::map<odState::TickNumber, IncomingSnapshot> mIncomingSnapshots;
+    std::vector<odState::TickNumber> mCompletedTicks;
+    odState::TickNumber mLastAcknowledgedTick;
+
+    size_t mReceivedSnapshotCount;
+    size_t mReceivedObjectStateCount;
+    size_t mReceivedEventCount;
+
+};
+
+
+struct TimingSeries
+{
+    std::vector<double> samples;
+
+    double mean() const
+    {
+        double sum = 0.0;
+        for(auto s : samples) sum += s;
+        return samples.empty() ? 0.0 : sum/samples.size();
+    }
+
+    double percentile(double p) const
+    {
+        if(samples.empty())
+        {
+            return 0.0;
+        }
+
+        std::vector<double> sorted(samples);
+        size_t index = static_cast<size_t>(p*(sorted.size() - 1) + 0.5);
+        std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+        return sorted[index];
+    }
+};
+
+static void printUsage()
+{
+    std::cout
+        << "Usage: odServerBenchmark [options]" << std::endl
+        << "Runs a headless server on a generated level against synthetic clients and reports tick costs" << std::endl
+        << "Options:" << std::endl
+        << "    -v  Increase verbosity of logger" << std::endl
+        << "    -h  Display this message and exit" << std::endl
+        << "    -n <count>  Number of synthetic clients (default 8)" << std::endl
+        << "    -o <count>  Number of objects in the level (default 1000)" << std::endl
+        << "    -m <fraction>  Fraction of objects that keep moving (default 0.5)" << std::endl
+        << "    -g <count>  Number of layers along each axis of the level (default 4)" << std::endl
+        << "    -s <cells>  Width and height of each layer (default 64)" << std::endl
+        << "    -t <ticks>  Number of measured ticks (default 600)" << std::endl
+        << "    -w <ticks>  Number of warmup ticks before measuring (default 60)" << std::endl
+        << "    -d <distance>  Relevance distance for clients (default unlimited)" << std::endl
+        << "    -b <count>  Max. objects per snapshot (default unlimited)" << std::endl
+        << "    -l <seconds>  Simulated one-way latency of the client tunnels (default 0)" << std::endl
+        << "    -x <rate>  Simulated loss rate of the client tunnels (default 0)" << std::endl
+        << "    -e <seed>  Seed for level generation and network simulation (default 0)" << std::endl
+        << std::endl;
+}
+
+template <typename T>
+static bool parseOption(const char *arg, char option, T &value)
+{
+    std::istringstream in(arg);
+    in >> value;
+    if(in.fail() || value < 0)
+    {
+        std::cout << "-" << option << " option needs a non-negative number as argument" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    od::Logger::getDefaultLogger().setOutputLogLevel(od::LogLevel::Info);
+
+    od::Logger::info() << "OpenDrakan server benchmark version " << OD_VERSION_TAG << " (" << OD_VERSION_BRANCH << " " << OD_VERSION_COMMIT << ")";
+
+    int c;
+    size_t clientCount = 8;
+    float movingFraction = 0.5f;
+    size_t measuredTicks = 600;
+    size_t warmupTicks = 60;
+    float relevanceDistance = -1;
+    size_t maxObjectsPerSnapshot = 0;
+    double latency = 0.0;
+    double lossRate = 0.0;
+    od::SyntheticLevelParameters levelParams;
+    while((c = getopt(argc, argv, "vhn:o:m:g:s:t:w:d:b:l:x:e:")) != -1)
+    {
+        bool valid = true;
+        switch(c)
+        {
+        case 'v':
+            od::Logger::getDefaultLogger().increaseOutputLogLevel();
+            break;
+
+        case 'h':
+            printUsage();
+            return 0;
+
+        case 'n': valid = parseOption(optarg, c, clientCount); break;
+        case 'o': valid = parseOption(optarg, c, levelParams.objectCount); break;
+        case 'm': valid = parseOption(optarg, c, movingFraction); break;
+        case 'g': valid = parseOption(optarg, c, levelParams.layerGridSize); break;
+        case 's': valid = parseOption(optarg, c, levelParams.layerSize); break;
+        case 't': valid = parseOption(optarg, c, measuredTicks); break;
+        case 'w': valid = parseOption(optarg, c, warmupTicks); break;
+        case 'd': valid = parseOption(optarg, c, relevanceDistance); break;
+        case 'b': valid = parseOption(optarg, c, maxObjectsPerSnapshot); break;
+        case 'l': valid = parseOption(optarg, c, latency); break;
+        case 'x': valid = parseOption(optarg, c, lossRate); break;
+        case 'e': valid = parseOption(optarg, c, levelParams.seed); break;
+
+        case '?':
+            std::cout << "Unknown option -" << optopt << std::endl;
+            printUsage();
+            return 1;
+        }
+
+        if(!valid)
+        {
+            return 1;
+        }
+    }
+
+    if(clientCount == 0 || clientCount > levelParams.objectCount)
+    {
+        std::cout << "Need at least one client, and at least one object per client to serve as it's viewpoint" << std::endl;
+        return 1;
+    }
+
+    // no RFLs are needed. the synthetic level's objects get their behaviour from us
+    odDb::DbManager dbManager;
+    odRfl::RflManager rflManager;
+    od::Server server(dbManager, rflManager);
+
+    if(relevanceDistance >= 0)
+    {
+        server.setClientRelevanceDistance(relevanceDistance);
+    }
+
+    server.setMaxObjectsPerSnapshot(maxObjectsPerSnapshot);
+
+    // clients are connected through tunnels with a manual clock, so a run only depends on the parameters and the seed
+    std::vector<odNet::ClientId> clientIds;
+    std::vector<std::shared_ptr<SyntheticClient>> clients;
+    std::vector<std::unique_ptr<odNet::LocalTunnel>> tunnels;
+    for(size_t i = 0; i < clientCount; ++i)
+    {
+        auto clientId = server.addClient();
+        auto client = std::make_shared<SyntheticClient>();
+        auto tunnel = std::make_unique<odNet::LocalTunnel>(client, server.getUplinkConnectorForClient(clientId));
+        tunnel->useManualClock();
+        tunnel->setSeed(levelParams.seed + i);
+
+        odNet::LocalTunnel::LinkConditions conditions;
+        conditions.latency = latency;
+        conditions.lossRate = lossRate;
+        tunnel->setConditions(conditions);
+
+        server.setClientDownlinkConnector(clientId, tunnel->getDownlinkInput());
+
+        clientIds.push_back(clientId);
+        clients.push_back(client);
+        tunnels.push_back(std::move(tunnel));
+    }
+
+    server.loadSyntheticLevel(levelParams);
+
+    od::Level &level = *server.getLevel();
+    std::minstd_rand random(levelParams.seed);
+    std::uniform_real_distribution<float> unitDistribution(0.0f, 1.0f);
+    size_t movingCount = 0;
+    size_t objectIndex = 0;
+    level.forEachObject([&](od::LevelObject &obj)
+    {
+        if(objectIndex < levelParams.objectCount*movingFraction)
+        {
+            float direction = unitDistribution(random) * 2*M_PI;
+            float speed = 1.0f + unitDistribution(random)*4.0f;
+            glm::vec2 velocity(std::cos(direction)*speed, std::sin(direction)*speed);
+
+            obj.despawn();
+            obj.setRflClassInstance(std::make_unique<Wanderer>(velocity, level.getBoundingBox()));
+            obj.spawn();
+
+            ++movingCount;
+        }
+
+        // clients view the level from the first objects
+        if(objectIndex < clientCount)
+        {
+            server.setClientViewpointObject(clientIds[objectIndex], obj.getObjectId());
+        }
+
+        ++objectIndex;
+    });
+
+    const double tickTime = 1.0/60.0;
+    auto runTick = [&]()
+    {
+        server.step(tickTime);
+
+        for(size_t i = 0; i < clientCount; ++i)
+        {
+            tunnels[i]->advanceClock(tickTime);
+            clients[i]->update(*tunnels[i]->getUplinkInput());
+        }
+    };
+
+    Logger::info() << "Running " << warmupTicks << " warmup ticks";
+    for(size_t i = 0; i < warmupTicks; ++i)
+    {
+        runTick();
+    }
+
+    std::vector<odNet::LocalTunnel::LinkStatistics> downlinkStatsBefore;
+    std::vector<odNet::LocalTunnel::LinkStatistics> uplinkStatsBefore;
+    std::vector<size_t> snapshotCountBefore;
+    std::vector<size_t> objectStateCountBefore;
+    for(size_t i = 0; i < clientCount; ++i)
+    {
+        downlinkStatsBefore.push_back(tunnels[i]->getStatistics(odNet::LocalTunnel::Direction::DOWNLINK));
+        uplinkStatsBefore.push_back(tunnels[i]->getStatistics(odNet::LocalTunnel::Direction::UPLINK));
+        snapshotCountBefore.push_back(clients[i]->getReceivedSnapshotCount());
+        objectStateCountBefore.push_back(clients[i]->getReceivedObjectStateCount());
+    }
+
+    Logger::info() << "Running " << measuredTicks << " measured ticks";
+    TimingSeries total, levelUpdate, physics, clientUpdate, commit, send;
+    for(size_t i = 0; i < measuredTicks; ++i)
+    {
+        runTick();
+
+        auto &timings = server.getLastTickTimings();
+        total.samples.push_back(timings.total);
+        levelUpdate.samples.push_back(timings.levelUpdate);
+        physics.samples.push_back(timings.physics);
+        clientUpdate.samples.push_back(timings.clients);
+        commit.samples.push_back(timings.commit);
+        send.samples.push_back(timings.send);
+    }
+
+    size_t downlinkBytes = 0;
+    size_t downlinkPackets = 0;
+    size_t uplinkBytes = 0;
+    size_t snapshots = 0;
+    size_t objectStates = 0;
+    for(size_t i = 0; i < clientCount; ++i)
+    {
+        auto downlinkStats = tunnels[i]->getStatistics(odNet::LocalTunnel::Direction::DOWNLINK);
+        auto uplinkStats = tunnels[i]->getStatistics(odNet::LocalTunnel::Direction::UPLINK);
+        downlinkBytes += downlinkStats.bytesSent - downlinkStatsBefore[i].bytesSent;
+        downlinkPackets += downlinkStats.packetsSent - downlinkStatsBefore[i].packetsSent;
+        uplinkBytes += uplinkStats.bytesSent - uplinkStatsBefore[i].bytesSent;
+        snapshots += clients[i]->getReceivedSnapshotCount() - snapshotCountBefore[i];
+        objectStates += clients[i]->getReceivedObjectStateCount() - objectStateCountBefore[i];
+    }
+
+    double measuredSeconds = measuredTicks*tickTime;
+    double perClient = 1.0/clientCount;
+
+    auto printSeries = [](const char *name, const TimingSeries &series)
+    {
+        std::cout << "  " << std::left << std::setw(14) << name << std::right << std::fixed << std::setprecision(3)
+                  << " mean " << std::setw(8) << series.mean()
+                  << "  p50 " << std::setw(8) << series.percentile(0.5)
+                  << "  p90 " << std::setw(8) << series.percentile(0.9)
+                  << "  p99 " << std::setw(8) << series.percentile(0.99)
+                  << "  max " << std::setw(8) << series.percentile(1.0) << std::endl;
+    };
+
+    std::cout << std::endl
+              << "Level: " << (levelParams.layerGridSize*levelParams.layerGridSize) << " layers of " << levelParams.layerSize << "x" << levelParams.layerSize
+              << " cells, " << levelParams.objectCount << " objects (" << movingCount << " moving)" << std::endl
+              << "Clients: " << clientCount << ", measured ticks: " << measuredTicks << " (" << measuredSeconds << "s of server time)" << std::endl
+              << std::endl
+              << "Tick phases [ms]:" << std::endl;
+    printSeries("total", total);
+    printSeries("level update", levelUpdate);
+    printSeries("physics", physics);
+    printSeries("clients", clientUpdate);
+    printSeries("commit", commit);
+    printSeries("send", send);
+
+    std::cout << std::endl
+              << std::setprecision(1)
+              << "Per client:" << std::endl
+              << "  downlink     " << (downlinkBytes*perClient/measuredSeconds/1024) << " KiB/s, "
+                                   << (downlinkBytes*perClient/measuredTicks) << " bytes/tick, "
+                                   << (downlinkPackets*perClient/measuredTicks) << " packets/tick" << std::endl
+              << "  uplink       " << (uplinkBytes*perClient/measuredSeconds/1024) << " KiB/s" << std::endl
+              << "  snapshots    " << (snapshots*perClient) << " complete, "
+                                   << (snapshots > 0 ? static_cast<double>(objectStates)/snapshots : 0.0) << " objects each on average" << std::endl
+              << std::endl;
+
+    return 0;
+}
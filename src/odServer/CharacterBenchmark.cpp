@@ -0,0 +1,282 @@
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <glm/vec3.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <odCore/Logger.h>
+#include <odCore/Server.h>
+#include <odCore/Level.h>
+#include <odCore/LevelObject.h>
+#include <odCore/Version.h>
+
+#include <odCore/physics/CharacterController.h>
+
+#include <odCore/rfl/DummyClass.h>
+#include <odCore/rfl/Rfl.h>
+#include <odCore/rfl/RflManager.h>
+
+#include <odCore/db/DbManager.h>
+
+/**
+ * @brief What all walkers report to the benchmark. Step times are in microseconds.
+ */
+struct WalkerStatistics
+{
+    WalkerStatistics()
+    : measuring(false)
+    , desiredDistance(0.0)
+    , walkedDistance(0.0)
+    {
+    }
+
+    bool measuring;
+    std::vector<double> stepTimes;
+    double desiredDistance;
+    double walkedDistance;
+};
+
+
+/**
+ * @brief Class for the synthetic level's objects: walks straight ahead using a character controller and turns around at the level borders.
+ *
+ * Walkers have no model and thus no physics handle, so they only collide with the terrain.
+ */
+class Walker final : public odRfl::SpawnableClass, public odRfl::ClassImpl<Walker>
+{
+public:
+
+    Walker(odPhysics::PhysicsSystem &physicsSystem, float speed, const od::AxisAlignedBoundingBox &bounds, WalkerStatistics &stats)
+    : mPhysicsSystem(physicsSystem)
+    , mSpeed(speed)
+    , mBounds(bounds)
+    , mStats(stats)
+    {
+    }
+
+    virtual odRfl::FieldBundle &getFields() override { return mFields; }
+
+    virtual void onSpawned() override
+    {
+        auto &obj = getLevelObject();
+        obj.setEnableUpdate(true);
+
+        // same dimensions as the player
+        mController = std::make_unique<odPhysics::CharacterController>(mPhysicsSystem, nullptr, obj, 0.05f, 0.3f);
+    }
+
+    virtual void onUpdate(float relTime) override
+    {
+        auto &obj = getLevelObject();
+
+        // keep a cell's distance from the borders, so the controller never runs off the terrain
+        glm::vec3 position = obj.getPosition();
+        glm::vec3 forward = obj.getRotation() * glm::vec3(0, 0, 1);
+        bool leavingX = (position.x < mBounds.min().x + 1 && forward.x < 0) || (position.x > mBounds.max().x - 1 && forward.x > 0);
+        bool leavingZ = (position.z < mBounds.min().z + 1 && forward.z < 0) || (position.z > mBounds.max().z - 1 && forward.z > 0);
+        if(leavingX || leavingZ)
+        {
+            obj.setRotation(obj.getRotation() * glm::quat(glm::vec3(0, M_PI, 0)));
+        }
+
+        mController->moveRelative(glm::vec3(0, 0, mSpeed*relTime), relTime);
+
+        auto stepStart = std::chrono::steady_clock::now();
+        mController->update(relTime);
+        auto stepTime = std::chrono::steady_clock::now() - stepStart;
+
+        if(mStats.measuring)
+        {
+            mStats.stepTimes.push_back(1e-3 * std::chrono::duration_cast<std::chrono::nanoseconds>(stepTime).count());
+
+            glm::vec3 walked = obj.getPosition() - position;
+            mStats.walkedDistance += std::sqrt(walked.x*walked.x + walked.z*walked.z);
+            mStats.desiredDistance += mSpeed*relTime;
+        }
+    }
+
+    inline bool isOnGround() const { return mController != nullptr && mController->isOnGround(); }
+
+
+private:
+
+    odRfl::DummyFields mFields;
+    odPhysics::PhysicsSystem &mPhysicsSystem;
+    float mSpeed;
+    od::AxisAlignedBoundingBox mBounds;
+    WalkerStatistics &mStats;
+    std::unique_ptr<odPhysics::CharacterController> mController;
+
+};
+
+
+static void printUsage()
+{
+    std::cout
+        << "Usage: odCharacterBenchmark [options]" << std::endl
+        << "Lets characters walk across a generated level using the character controller and reports the cost per step" << std::endl
+        << "Options:" << std::endl
+        << "    -v  Increase verbosity of logger" << std::endl
+        << "    -h  Display this message and exit" << std::endl
+        << "    -n <count>  Number of characters (default 1000)" << std::endl
+        << "    -g <count>  Number of layers along each axis of the level (default 4)" << std::endl
+        << "    -s <cells>  Width and height of each layer (default 64)" << std::endl
+        << "    -a <lu>  Max. deviation of the terrain height (default 4)" << std::endl
+        << "    -t <ticks>  Number of measured ticks (default 600)" << std::endl
+        << "    -w <ticks>  Number of warmup ticks before measuring (default 60)" << std::endl
+        << "    -e <seed>  Seed for level generation (default 0)" << std::endl
+        << std::endl;
+}
+
+template <typename T>
+static bool parseOption(const char *arg, char option, T &value)
+{
+    std::istringstream in(arg);
+    in >> value;
+    if(in.fail() || value < 0)
+    {
+        std::cout << "-" << option << " option needs a non-negative number as argument" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    od::Logger::getDefaultLogger().setOutputLogLevel(od::LogLevel::Info);
+
+    od::Logger::info() << "OpenDrakan character controller benchmark version " << OD_VERSION_TAG << " (" << OD_VERSION_BRANCH << " " << OD_VERSION_COMMIT << ")";
+
+    int c;
+    size_t measuredTicks = 600;
+    size_t warmupTicks = 60;
+    od::SyntheticLevelParameters levelParams;
+    while((c = getopt(argc, argv, "vhn:g:s:a:t:w:e:")) != -1)
+    {
+        bool valid = true;
+        switch(c)
+        {
+        case 'v':
+            od::Logger::getDefaultLogger().increaseOutputLogLevel();
+            break;
+
+        case 'h':
+            printUsage();
+            return 0;
+
+        case 'n': valid = parseOption(optarg, c, levelParams.objectCount); break;
+        case 'g': valid = parseOption(optarg, c, levelParams.layerGridSize); break;
+        case 's': valid = parseOption(optarg, c, levelParams.layerSize); break;
+        case 'a': valid = parseOption(optarg, c, levelParams.terrainAmplitude); break;
+        case 't': valid = parseOption(optarg, c, measuredTicks); break;
+        case 'w': valid = parseOption(optarg, c, warmupTicks); break;
+        case 'e': valid = parseOption(optarg, c, levelParams.seed); break;
+
+        case '?':
+            std::cout << "Unknown option -" << optopt << std::endl;
+            printUsage();
+            return 1;
+        }
+
+        if(!valid)
+        {
+            return 1;
+        }
+    }
+
+    if(levelParams.objectCount == 0 || measuredTicks == 0)
+    {
+        std::cout << "Need at least one character and one measured tick" << std::endl;
+        return 1;
+    }
+
+    // no RFLs and no clients are needed. the level's objects get their behaviour from us
+    odDb::DbManager dbManager;
+    odRfl::RflManager rflManager;
+    od::Server server(dbManager, rflManager);
+
+    server.loadSyntheticLevel(levelParams);
+
+    od::Level &level = *server.getLevel();
+    std::minstd_rand random(levelParams.seed);
+    std::uniform_real_distribution<float> unitDistribution(0.0f, 1.0f);
+    WalkerStatistics stats;
+    std::vector<Walker*> walkers;
+    level.forEachObject([&](od::LevelObject &obj)
+    {
+        float speed = 0.5f + unitDistribution(random)*1.5f;
+        auto walker = std::make_unique<Walker>(server.getPhysicsSystem(), speed, level.getBoundingBox(), stats);
+        walkers.push_back(walker.get());
+
+        obj.despawn();
+        obj.setRflClassInstance(std::move(walker));
+        obj.spawn();
+    });
+
+    const double tickTime = 1.0/60.0;
+
+    Logger::info() << "Running " << warmupTicks << " warmup ticks";
+    for(size_t i = 0; i < warmupTicks; ++i)
+    {
+        server.step(tickTime);
+    }
+
+    Logger::info() << "Running " << measuredTicks << " measured ticks";
+    stats.measuring = true;
+    stats.stepTimes.reserve(measuredTicks*walkers.size());
+    std::vector<double> tickTimes;
+    tickTimes.reserve(measuredTicks);
+    for(size_t i = 0; i < measuredTicks; ++i)
+    {
+        server.step(tickTime);
+        tickTimes.push_back(server.getLastTickTimings().levelUpdate);
+    }
+    stats.measuring = false;
+
+    size_t onGroundCount = std::count_if(walkers.begin(), walkers.end(), [](Walker *w){ return w->isOnGround(); });
+
+    auto printSeries = [](const char *name, std::vector<double> &samples)
+    {
+        double sum = 0.0;
+        for(auto s : samples) sum += s;
+
+        std::sort(samples.begin(), samples.end());
+        auto percentile = [&samples](double p){ return samples[static_cast<size_t>(p*(samples.size() - 1) + 0.5)]; };
+
+        std::cout << "  " << std::left << std::setw(14) << name << std::right << std::fixed << std::setprecision(3)
+                  << " mean " << std::setw(8) << (sum/samples.size())
+                  << "  p50 " << std::setw(8) << percentile(0.5)
+                  << "  p90 " << std::setw(8) << percentile(0.9)
+                  << "  p99 " << std::setw(8) << percentile(0.99)
+                  << "  max " << std::setw(8) << percentile(1.0) << std::endl;
+    };
+
+    std::cout << std::endl
+              << "Level: " << (levelParams.layerGridSize*levelParams.layerGridSize) << " layers of " << levelParams.layerSize << "x" << levelParams.layerSize
+              << " cells, terrain amplitude " << levelParams.terrainAmplitude << " lu" << std::endl
+              << "Characters: " << walkers.size() << ", measured ticks: " << measuredTicks << std::endl
+              << std::endl;
+
+    std::cout << "Character step [us]:" << std::endl;
+    printSeries("per character", stats.stepTimes);
+
+    std::cout << "Level update [ms]:" << std::endl;
+    printSeries("per tick", tickTimes);
+
+    std::cout << std::endl
+              << std::setprecision(1)
+              << "On ground at end: " << (100.0*onGroundCount/walkers.size()) << "%" << std::endl
+              << "Distance walked: " << (stats.desiredDistance > 0 ? 100.0*stats.walkedDistance/stats.desiredDistance : 0.0) << "% of desired" << std::endl
+              << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,256 @@
+
+#include <signal.h>
+#include <unistd.h>
+#include <iostream>
+#include <sstream>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+#include <odCore/Logger.h>
+#include <odCore/Server.h>
+#include <odCore/Panic.h>
+#include <odCore/FilePath.h>
+#include <odCore/Version.h>
+
+#include <odCore/net/UplinkConnector.h>
+#include <odCore/net/DownlinkConnector.h>
+#include <odCore/net/UdpTransport.h>
+
+#include <odCore/rfl/RflManager.h>
+
+#include <odCore/db/DbManager.h>
+
+#include <dragonRfl/RflDragon.h>
+
+static std::atomic_bool sIsDone(false);
+static void handleSignal(int signal)
+{
+    if(signal == SIGINT)
+    {
+        sIsDone.store(true);
+    }
+}
+
+static void printUsage()
+{
+    std::cout
+        << "Usage: odServer [options] <level file>" << std::endl
+        << "Headless OpenDrakan dedicated server" << std::endl
+        << "Options:" << std::endl
+        << "    -v  Increase verbosity of logger" << std::endl
+        << "    -h  Display this message and exit" << std::endl
+        << "    -u <port>  UDP port to listen on (default 27500)" << std::endl
+        << "    -a <dir>  Cache decoded assets in the given directory to speed up subsequent starts" << std::endl
+        << "    -r <MiB>  Memory budget for keeping recently used assets loaded (0 disables, default 128)" << std::endl
+        << "    -d <distance>  Only send clients updates on objects within this distance of their player (default unlimited)" << std::endl
+        << std::endl;
+}
+
+static od::FilePath findEngineRoot(const od::FilePath &dir, const std::string &rrcFileName)
+{
+    // ascend in the passed directory until we find a Dragon.rrc
+    od::FilePath path = od::FilePath(rrcFileName, dir).adjustCase();
+    while(!path.exists() && path.depth() > 1)
+    {
+        path = od::FilePath(rrcFileName, path.dir().dir()).adjustCase();
+    }
+
+    if(!path.exists())
+    {
+        OD_PANIC() << "Could not find engine root in passed level path. "
+                << "Make sure your level is located in the same directory or a subdirectory of " << rrcFileName;
+    }
+
+    return path.dir();
+}
+
+int main(int argc, char **argv)
+{
+    signal(SIGINT, &handleSignal);
+
+    od::Logger::getDefaultLogger().setOutputLogLevel(od::LogLevel::Info);
+
+    od::Logger::info() << "Starting OpenDrakan dedicated server version " << OD_VERSION_TAG << " (" << OD_VERSION_BRANCH << " " << OD_VERSION_COMMIT << ")";
+
+    int c;
+    int port = 27500;
+    std::string assetCacheDir;
+    int retentionBudgetMiB = -1;
+    float relevanceDistance = -1;
+    while((c = getopt(argc, argv, "vhu:a:r:d:")) != -1)
+    {
+        switch(c)
+        {
+        case 'v':
+            od::Logger::getDefaultLogger().increaseOutputLogLevel();
+            break;
+
+        case 'h':
+            printUsage();
+            return 0;
+
+        case 'u':
+            {
+                std::istringstream in(optarg);
+                in >> port;
+                if(in.fail() || port < 0 || port > 0xffff)
+                {
+                    std::cout << "-u option needs a port number as argument" << std::endl;
+                    return 1;
+                }
+            }
+            break;
+
+        case 'a':
+            assetCacheDir = optarg;
+            break;
+
+        case 'r':
+            {
+                std::istringstream in(optarg);
+                in >> retentionBudgetMiB;
+                if(in.fail() || retentionBudgetMiB < 0)
+                {
+                    std::cout << "-r option needs a non-negative integer as argument" << std::endl;
+                    return 1;
+                }
+            }
+            break;
+
+        case 'd':
+            {
+                std::istringstream in(optarg);
+                in >> relevanceDistance;
+                if(in.fail() || relevanceDistance < 0)
+                {
+                    std::cout << "-d option needs a non-negative real number as argument" << std::endl;
+                    return 1;
+                }
+            }
+            break;
+
+        case '?':
+            std::cout << "Unknown option -" << optopt << std::endl;
+            printUsage();
+            return 1;
+        }
+    }
+
+    if(optind >= argc)
+    {
+        std::cout << "No level file given" << std::endl;
+        printUsage();
+        return 1;
+    }
+
+    od::FilePath levelPath(argv[optind]);
+    if(!levelPath.exists())
+    {
+        std::cerr << "Level file " << levelPath << " does not exist" << std::endl;
+        return 1;
+    }
+
+    odDb::DbManager dbManager;
+    if(!assetCacheDir.empty())
+    {
+        dbManager.getDecodedAssetCache().setCacheDirectory(od::FilePath(assetCacheDir));
+    }
+
+    if(retentionBudgetMiB >= 0)
+    {
+        dbManager.getRetentionCache().setBudget(static_cast<size_t>(retentionBudgetMiB) * 1024 * 1024);
+    }
+
+    odRfl::RflManager rflManager;
+    auto &rfl = static_cast<dragonRfl::DragonRfl&>(rflManager.loadStaticRfl<dragonRfl::DragonRfl>());
+
+    // the server never touches a renderer or sound system, so unlike the game, we don't need to create any
+    od::Server server(dbManager, rflManager);
+    server.setEngineRootDir(findEngineRoot(levelPath, "dragon.rrc"));
+
+    if(relevanceDistance >= 0)
+    {
+        server.setClientRelevanceDistance(relevanceDistance);
+    }
+
+    server.loadLevel(levelPath);
+
+    // clients are accepted and dropped on the transport's network thread, but may only be hooked up to or removed
+    //  from the server between ticks. we add them right away (that is synchronized) and finish the job in the tick hook
+    struct PendingClient
+    {
+        odNet::ClientId id;
+        std::shared_ptr<odNet::DownlinkConnector> downlink;
+    };
+    std::vector<PendingClient> pendingClients;
+    std::vector<odNet::ClientId> pendingDisconnects;
+    std::unordered_map<odNet::UdpEndpoint, odNet::ClientId, odNet::UdpEndpoint::Hash> clientsByRemote;
+    std::mutex pendingClientsMutex; // guards all three above
+
+    auto acceptCallback = [&server, &pendingClients, &clientsByRemote, &pendingClientsMutex](const odNet::UdpEndpoint &remote, std::shared_ptr<odNet::DownlinkConnector> downlinkInput) -> std::shared_ptr<odNet::UplinkConnector>
+    {
+        auto clientId = server.addClient();
+
+        std::lock_guard<std::mutex> lock(pendingClientsMutex);
+        pendingClients.push_back({ clientId, downlinkInput });
+        clientsByRemote[remote] = clientId;
+
+        return server.getUplinkConnectorForClient(clientId);
+    };
+
+    auto disconnectCallback = [&pendingDisconnects, &clientsByRemote, &pendingClientsMutex](const odNet::UdpEndpoint &remote)
+    {
+        std::lock_guard<std::mutex> lock(pendingClientsMutex);
+        auto it = clientsByRemote.find(remote);
+        if(it != clientsByRemote.end())
+        {
+            pendingDisconnects.push_back(it->second);
+            clientsByRemote.erase(it);
+        }
+    };
+
+    odNet::UdpTransport transport;
+    transport.listen(odNet::IpV4Address::any(), static_cast<uint16_t>(port), acceptCallback, disconnectCallback);
+
+    std::vector<PendingClient> newClients;
+    std::vector<odNet::ClientId> leftClients;
+    server.run([&server, &rfl, &pendingClients, &pendingDisconnects, &pendingClientsMutex, &newClients, &leftClients]()
+    {
+        if(sIsDone.load())
+        {
+            server.setIsDone(true);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(pendingClientsMutex);
+            newClients.swap(pendingClients);
+            leftClients.swap(pendingDisconnects);
+        }
+
+        for(auto &client : newClients)
+        {
+            Logger::info() << "Client " << client.id << " joined";
+
+            server.setClientDownlinkConnector(client.id, client.downlink);
+            rfl.spawnHumanControlForPlayer(server, client.id);
+        }
+        newClients.clear();
+
+        // a client may have joined and left since the last tick, so this has to come after the joins
+        for(auto id : leftClients)
+        {
+            Logger::info() << "Client " << id << " left";
+
+            rfl.despawnHumanControlForPlayer(server, id);
+            server.removeClient(id);
+        }
+        leftClients.clear();
+    });
+
+    Logger::info() << "Shutting down dedicated server";
+
+    return 0;
+}